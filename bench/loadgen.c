@@ -0,0 +1,219 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "api/client.h"
+#include "api/server.h"
+
+/* Loopback load generator: each connection keeps `depth` prepared point lookups in flight and
+ * reports throughput and latency. Without -a it serves an in-process database on a Unix socket,
+ * spread over -w shard threads when given. */
+
+#define LOADGEN_SOCKET "unix:loadgen.sock"
+#define LOADGEN_QUERY "SELECT name FROM bench WHERE _id = ?"
+
+typedef struct {
+    const char* address;
+    size_t depth;
+    size_t requests;
+    size_t rows;
+    uint64_t* latencies;
+    bool failed;
+} Worker;
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+static void* run_worker(void* arg) {
+    Worker* worker = arg;
+    char error[PROTOCOL_ERROR_SIZE];
+    ShadeClient* client = shade_client_connect(worker->address, error, sizeof(error));
+    uint32_t statement = client ? shade_client_prepare(client, LOADGEN_QUERY, NULL) : 0;
+    if (!statement) {
+        fprintf(stderr, "loadgen: %s\n", client ? shade_client_error(client) : error);
+        worker->failed = true;
+        shade_client_close(client);
+        return NULL;
+    }
+
+    /* Request ids are consecutive, so a ring indexed by id finds each send time. */
+    uint64_t* sent_at = calloc(worker->depth, sizeof(uint64_t));
+    unsigned int seed = (unsigned int)(uintptr_t)worker;
+    uint32_t first_request = 0;
+    size_t sent = 0;
+    size_t received = 0;
+
+    while (received < worker->requests && !worker->failed) {
+        while (sent < worker->requests && sent - received < worker->depth) {
+            Value key = value_integer((int64_t)(rand_r(&seed) % worker->rows) + 1);
+            uint32_t request = shade_client_send_execute(client, statement, &key, 1);
+            if (!request) {
+                worker->failed = true;
+                break;
+            }
+            if (sent == 0) first_request = request;
+            sent_at[(request - first_request) % worker->depth] = now_ns();
+            sent++;
+        }
+
+        uint32_t request;
+        ShadeClientResult* result = shade_client_receive(client, &request);
+        if (!result) {
+            fprintf(stderr, "loadgen: %s\n", shade_client_error(client));
+            worker->failed = true;
+            break;
+        }
+        worker->latencies[received++] = now_ns() - sent_at[(request - first_request) % worker->depth];
+        shade_client_result_free(result);
+    }
+
+    free(sent_at);
+    shade_client_close(client);
+    return NULL;
+}
+
+static int compare_latency(const void* a, const void* b) {
+    uint64_t left = *(const uint64_t*)a;
+    uint64_t right = *(const uint64_t*)b;
+    return (left > right) - (left < right);
+}
+
+static bool run_load(const char* address, size_t connections, size_t depth, size_t requests, size_t rows) {
+    Worker* workers = calloc(connections, sizeof(Worker));
+    pthread_t* threads = calloc(connections, sizeof(pthread_t));
+    uint64_t* latencies = malloc(sizeof(uint64_t) * connections * requests);
+    if (!workers || !threads || !latencies) {
+        free(workers);
+        free(threads);
+        free(latencies);
+        return false;
+    }
+
+    uint64_t started = now_ns();
+    for (size_t i = 0; i < connections; i++) {
+        workers[i] = (Worker){address, depth, requests, rows, latencies + i * requests, false};
+        pthread_create(&threads[i], NULL, run_worker, &workers[i]);
+    }
+    bool failed = false;
+    for (size_t i = 0; i < connections; i++) {
+        pthread_join(threads[i], NULL);
+        failed = failed || workers[i].failed;
+    }
+    double seconds = (double)(now_ns() - started) / 1e9;
+
+    if (!failed) {
+        size_t total = connections * requests;
+        qsort(latencies, total, sizeof(uint64_t), compare_latency);
+        printf("connections=%-3zu depth=%-4zu %10.0f req/s   p50=%8.1f us   p99=%8.1f us\n",
+               connections, depth, (double)total / seconds,
+               (double)latencies[total / 2] / 1e3, (double)latencies[total * 99 / 100] / 1e3);
+    }
+
+    free(workers);
+    free(threads);
+    free(latencies);
+    return !failed;
+}
+
+static bool seed_table(const char* address, size_t rows) {
+    char error[PROTOCOL_ERROR_SIZE];
+    ShadeClient* client = shade_client_connect(address, error, sizeof(error));
+    if (!client) {
+        fprintf(stderr, "loadgen: %s\n", error);
+        return false;
+    }
+
+    ShadeClientResult* created = shade_client_exec(client, "CREATE TABLE bench (id INT, name STRING, score FLOAT)");
+    if (created) {
+        uint64_t started = now_ns();
+        char* sql = malloc(64 * 1024);
+        for (size_t first = 0; sql && first < rows; first += 500) {
+            size_t used = (size_t)snprintf(sql, 64, "INSERT INTO bench VALUES ");
+            for (size_t id = first; id < first + 500 && id < rows; id++) {
+                used += (size_t)snprintf(sql + used, 64 * 1024 - used, "%s(%zu, 'name-%zu', %zu.5)",
+                                         id > first ? ", " : "", id, id, id % 100);
+            }
+            shade_client_send_exec(client, sql);
+        }
+        while (shade_client_in_flight(client) > 0) {
+            shade_client_result_free(shade_client_receive(client, NULL));
+        }
+        free(sql);
+        double seconds = (double)(now_ns() - started) / 1e9;
+        printf("seeded %zu rows %10.0f rows/s\n", rows, (double)rows / seconds);
+    }
+    shade_client_result_free(created);
+    shade_client_close(client);
+    return true;
+}
+
+static void* run_server(void* arg) {
+    server_run(arg);
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    const char* address = NULL;
+    size_t connections = 4;
+    size_t depth = 0;
+    size_t requests = 50000;
+    size_t rows = 10000;
+    size_t shards = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "a:c:d:n:r:w:")) != -1) {
+        switch (option) {
+            case 'a': address = optarg; break;
+            case 'c': connections = strtoul(optarg, NULL, 10); break;
+            case 'd': depth = strtoul(optarg, NULL, 10); break;
+            case 'n': requests = strtoul(optarg, NULL, 10); break;
+            case 'r': rows = strtoul(optarg, NULL, 10); break;
+            case 'w': shards = strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "Usage: %s [-a address] [-c connections] [-d depth] [-n requests per connection]"
+                                " [-r rows] [-w shards]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (connections == 0 || requests == 0 || rows == 0) return 2;
+
+    MemoryStorage* storage = NULL;
+    StatementCache* statements = NULL;
+    ShadeServer* server = NULL;
+    pthread_t server_thread;
+    if (!address) {
+        char error[PROTOCOL_ERROR_SIZE];
+        address = LOADGEN_SOCKET;
+        storage = memory_storage_create();
+        statements = statement_cache_create();
+        server = server_create_sharded(storage, statements, address, shards, error, sizeof(error));
+        if (!server) {
+            fprintf(stderr, "loadgen: %s\n", error);
+            return 1;
+        }
+        pthread_create(&server_thread, NULL, run_server, server);
+    }
+
+    /* Without -d, sweep a few depths to show what pipelining buys. */
+    static const size_t sweep[] = {1, 4, 16, 64};
+    size_t runs = depth ? 1 : sizeof(sweep) / sizeof(sweep[0]);
+    bool success = seed_table(address, rows);
+    for (size_t i = 0; success && i < runs; i++) {
+        success = run_load(address, connections, depth ? depth : sweep[i], requests, rows);
+    }
+
+    if (server) {
+        server_stop(server);
+        pthread_join(server_thread, NULL);
+        server_destroy(server);
+        statement_cache_destroy(statements);
+        memory_storage_destroy(storage);
+    }
+    return success ? 0 : 1;
+}
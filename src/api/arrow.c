@@ -0,0 +1,329 @@
+#include "arrow.h"
+#include "../query/batch.h"
+#include <string.h>
+
+#define ARROW_MAX_BUFFERS 3
+
+typedef struct {
+    void* buffers[ARROW_MAX_BUFFERS];
+    const void* buffer_ptrs[ARROW_MAX_BUFFERS];
+    struct ArrowArray* child_storage;
+    struct ArrowArray** child_ptrs;
+} ArrowArrayPrivate;
+
+typedef struct {
+    char* name;
+    struct ArrowSchema* child_storage;
+    struct ArrowSchema** child_ptrs;
+} ArrowSchemaPrivate;
+
+static void release_schema(struct ArrowSchema* schema) {
+    if (!schema || !schema->release) return;
+    
+    ArrowSchemaPrivate* private_data = schema->private_data;
+    for (int64_t i = 0; i < schema->n_children; i++) {
+        struct ArrowSchema* child = schema->children[i];
+        if (child->release) child->release(child);
+    }
+    
+    if (private_data) {
+        free(private_data->name);
+        free(private_data->child_storage);
+        free(private_data->child_ptrs);
+        free(private_data);
+    }
+    schema->release = NULL;
+}
+
+static void release_array(struct ArrowArray* array) {
+    if (!array || !array->release) return;
+    
+    ArrowArrayPrivate* private_data = array->private_data;
+    for (int64_t i = 0; i < array->n_children; i++) {
+        struct ArrowArray* child = array->children[i];
+        if (child->release) child->release(child);
+    }
+    
+    if (private_data) {
+        for (int i = 0; i < ARROW_MAX_BUFFERS; i++) {
+            free(private_data->buffers[i]);
+        }
+        free(private_data->child_storage);
+        free(private_data->child_ptrs);
+        free(private_data);
+    }
+    array->release = NULL;
+}
+
+static bool init_schema(struct ArrowSchema* schema, const char* format, const char* name,
+                        int64_t flags, size_t n_children) {
+    ArrowSchemaPrivate* private_data = calloc(1, sizeof(ArrowSchemaPrivate));
+    if (!private_data) return false;
+    
+    private_data->name = string_duplicate(name ? name : "");
+    if (n_children > 0) {
+        private_data->child_storage = calloc(n_children, sizeof(struct ArrowSchema));
+        private_data->child_ptrs = malloc(sizeof(struct ArrowSchema*) * n_children);
+    }
+    
+    if (!private_data->name || (n_children > 0 && (!private_data->child_storage || !private_data->child_ptrs))) {
+        free(private_data->name);
+        free(private_data->child_storage);
+        free(private_data->child_ptrs);
+        free(private_data);
+        return false;
+    }
+    
+    for (size_t i = 0; i < n_children; i++) {
+        private_data->child_ptrs[i] = &private_data->child_storage[i];
+    }
+    
+    schema->format = format;
+    schema->name = private_data->name;
+    schema->metadata = NULL;
+    schema->flags = flags;
+    schema->n_children = 0;
+    schema->children = private_data->child_ptrs;
+    schema->dictionary = NULL;
+    schema->release = release_schema;
+    schema->private_data = private_data;
+    return true;
+}
+
+static bool init_array(struct ArrowArray* array, int64_t length, int64_t n_buffers, size_t n_children) {
+    ArrowArrayPrivate* private_data = calloc(1, sizeof(ArrowArrayPrivate));
+    if (!private_data) return false;
+    
+    if (n_children > 0) {
+        private_data->child_storage = calloc(n_children, sizeof(struct ArrowArray));
+        private_data->child_ptrs = malloc(sizeof(struct ArrowArray*) * n_children);
+        if (!private_data->child_storage || !private_data->child_ptrs) {
+            free(private_data->child_storage);
+            free(private_data->child_ptrs);
+            free(private_data);
+            return false;
+        }
+        for (size_t i = 0; i < n_children; i++) {
+            private_data->child_ptrs[i] = &private_data->child_storage[i];
+        }
+    }
+    
+    array->length = length;
+    array->null_count = 0;
+    array->offset = 0;
+    array->n_buffers = n_buffers;
+    array->n_children = 0;
+    array->buffers = private_data->buffer_ptrs;
+    array->children = private_data->child_ptrs;
+    array->dictionary = NULL;
+    array->release = release_array;
+    array->private_data = private_data;
+    return true;
+}
+
+static void* array_buffer(struct ArrowArray* array, int index, size_t size) {
+    ArrowArrayPrivate* private_data = array->private_data;
+    void* buffer = malloc(size ? size : 1);
+    if (!buffer) return NULL;
+    
+    private_data->buffers[index] = buffer;
+    private_data->buffer_ptrs[index] = buffer;
+    return buffer;
+}
+
+static void drop_validity_if_full(struct ArrowArray* array) {
+    if (array->null_count != 0) return;
+    
+    ArrowArrayPrivate* private_data = array->private_data;
+    free(private_data->buffers[0]);
+    private_data->buffers[0] = NULL;
+    private_data->buffer_ptrs[0] = NULL;
+}
+
+static bool pack_bool_values(uint8_t* out_bits, const bool* values, size_t count) {
+    memset(out_bits, 0, bitmap_byte_count(count));
+    for (size_t i = 0; i < count; i++) {
+        if (values[i]) bitmap_set(out_bits, i, true);
+    }
+    return true;
+}
+
+static bool export_value_column(DataRecord* const* records, size_t count, size_t column, ValueType type,
+                                struct ArrowArray* array) {
+    size_t n_buffers = type == VALUE_STRING ? 3 : 2;
+    if (!init_array(array, (int64_t)count, (int64_t)n_buffers, 0)) return false;
+    
+    uint8_t* validity = array_buffer(array, 0, bitmap_byte_count(count));
+    if (!validity) return false;
+    
+    size_t valid = 0;
+    switch (type) {
+        case VALUE_INTEGER: {
+            int64_t* values = array_buffer(array, 1, sizeof(int64_t) * count);
+            if (!values) return false;
+            valid = gather_int_column(records, count, column, values, validity);
+            break;
+        }
+        case VALUE_FLOAT: {
+            double* values = array_buffer(array, 1, sizeof(double) * count);
+            if (!values) return false;
+            valid = gather_float_column(records, count, column, values, validity);
+            break;
+        }
+        case VALUE_BOOLEAN: {
+            bool* unpacked = malloc(sizeof(bool) * (count ? count : 1));
+            uint8_t* bits = array_buffer(array, 1, bitmap_byte_count(count));
+            if (!unpacked || !bits) {
+                free(unpacked);
+                return false;
+            }
+            valid = gather_bool_column(records, count, column, unpacked, validity);
+            pack_bool_values(bits, unpacked, count);
+            free(unpacked);
+            break;
+        }
+        case VALUE_STRING: {
+            int32_t* offsets = array_buffer(array, 1, sizeof(int32_t) * (count + 1));
+            if (!offsets) return false;
+            
+            size_t total_length = 0;
+            for (size_t i = 0; i < count; i++) {
+                const Value* value = &records[i]->values[column];
+                if (value->type == VALUE_STRING && value->data.string) {
+                    total_length += strlen(value->data.string);
+                }
+            }
+            if (total_length > INT32_MAX) return false;
+            
+            char* data = array_buffer(array, 2, total_length);
+            if (!data) return false;
+            
+            memset(validity, 0, bitmap_byte_count(count));
+            int32_t position = 0;
+            for (size_t i = 0; i < count; i++) {
+                const Value* value = &records[i]->values[column];
+                offsets[i] = position;
+                if (value->type == VALUE_STRING && value->data.string) {
+                    size_t length = strlen(value->data.string);
+                    memcpy(data + position, value->data.string, length);
+                    position += (int32_t)length;
+                    bitmap_set(validity, i, true);
+                    valid++;
+                }
+            }
+            offsets[count] = position;
+            break;
+        }
+        default:
+            return false;
+    }
+    
+    array->null_count = (int64_t)(count - valid);
+    drop_validity_if_full(array);
+    return true;
+}
+
+static bool export_state_column(DataRecord* const* records, size_t count, struct ArrowArray* array) {
+    if (!init_array(array, (int64_t)count, 3, 0)) return false;
+    
+    int32_t* offsets = array_buffer(array, 1, sizeof(int32_t) * (count + 1));
+    if (!offsets) return false;
+    
+    size_t total_length = 0;
+    for (size_t i = 0; i < count; i++) {
+        total_length += strlen(datarecord_state_to_string(records[i]->state));
+    }
+    
+    char* data = array_buffer(array, 2, total_length);
+    if (!data) return false;
+    
+    int32_t position = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char* state = datarecord_state_to_string(records[i]->state);
+        size_t length = strlen(state);
+        offsets[i] = position;
+        memcpy(data + position, state, length);
+        position += (int32_t)length;
+    }
+    offsets[count] = position;
+    return true;
+}
+
+static bool export_strength_column(DataRecord* const* records, size_t count, struct ArrowArray* array) {
+    if (!init_array(array, (int64_t)count, 2, 0)) return false;
+    
+    float* strengths = array_buffer(array, 1, sizeof(float) * count);
+    if (!strengths) return false;
+    
+    gather_state_column(records, count, NULL, strengths);
+    return true;
+}
+
+static const char* arrow_format(ValueType type) {
+    switch (type) {
+        case VALUE_INTEGER: return "l";
+        case VALUE_FLOAT: return "g";
+        case VALUE_BOOLEAN: return "b";
+        case VALUE_STRING: return "u";
+        default: return "n";
+    }
+}
+
+bool arrow_export_records(DataRecord* const* records, size_t count, const TableSchema* schema,
+                          const size_t* column_map, size_t column_count,
+                          struct ArrowSchema* out_schema, struct ArrowArray* out_array) {
+    if ((!records && count > 0) || !schema || !out_schema || !out_array) return false;
+    
+    out_schema->release = NULL;
+    out_array->release = NULL;
+    
+    if (!column_map) column_count = schema->column_count;
+    
+    for (size_t i = 0; i < column_count; i++) {
+        size_t column = column_map ? column_map[i] : i;
+        if (column >= schema->column_count || schema->columns[column].type == VALUE_NULL) return false;
+    }
+    
+    size_t n_children = column_count + 2;
+    
+    if (!init_schema(out_schema, "+s", "", 0, n_children) ||
+        !init_array(out_array, (int64_t)count, 1, n_children)) {
+        release_schema(out_schema);
+        return false;
+    }
+    
+    for (size_t i = 0; i < n_children; i++) {
+        struct ArrowSchema* child_schema = out_schema->children[i];
+        struct ArrowArray* child_array = out_array->children[i];
+        bool exported = false;
+        
+        if (i < column_count) {
+            size_t column = column_map ? column_map[i] : i;
+            ValueType type = schema->columns[column].type;
+            if (init_schema(child_schema, arrow_format(type), schema->columns[column].name, ARROW_FLAG_NULLABLE, 0)) {
+                out_schema->n_children++;
+                exported = export_value_column(records, count, column, type, child_array);
+            }
+        } else if (i == column_count) {
+            if (init_schema(child_schema, "u", ARROW_STATE_COLUMN, 0, 0)) {
+                out_schema->n_children++;
+                exported = export_state_column(records, count, child_array);
+            }
+        } else {
+            if (init_schema(child_schema, "f", ARROW_STRENGTH_COLUMN, 0, 0)) {
+                out_schema->n_children++;
+                exported = export_strength_column(records, count, child_array);
+            }
+        }
+        
+        if (child_array->release) out_array->n_children++;
+        
+        if (!exported) {
+            release_schema(out_schema);
+            release_array(out_array);
+            return false;
+        }
+    }
+    
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef SHADE_ARROW_H
+#define SHADE_ARROW_H
+
+#include "../types/data.h"
+#include "../types/schema.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+struct ArrowSchema {
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+    void (*release)(struct ArrowSchema*);
+    void* private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+    void (*release)(struct ArrowArray*);
+    void* private_data;
+};
+
+#endif
+
+#define ARROW_STATE_COLUMN "_state"
+#define ARROW_STRENGTH_COLUMN "_ghost_strength"
+
+/* column_map selects and orders schema columns; NULL exports every column. */
+bool arrow_export_records(DataRecord* const* records, size_t count, const TableSchema* schema,
+                          const size_t* column_map, size_t column_count,
+                          struct ArrowSchema* out_schema, struct ArrowArray* out_array);
+
+#endif
@@ -1,8 +1,6 @@
+#define _POSIX_C_SOURCE 200809L
 #include "cli.h"
 
-#define MAX_INPUT_LENGTH 1024
-#define MAX_ARGS 32
-
 CLIState* cli_create(void) {
     return cli_create_with_persistence(NULL);
 }
@@ -23,8 +21,12 @@ CLIState* cli_create_with_persistence(const char* data_dir) {
     
     cli->running = true;
     cli->current_database = NULL;
+    cli->statements = statement_cache_create();
+    cli->batch = false;
     
-    if (!cli->storage) {
+    if (!cli->storage || !cli->statements) {
+        memory_storage_destroy(cli->storage);
+        statement_cache_destroy(cli->statements);
         free(cli->data_directory);
         free(cli);
         return NULL;
@@ -40,6 +42,7 @@ void cli_destroy(CLIState* cli) {
         memory_storage_save(cli->storage);  
     }
     
+    statement_cache_destroy(cli->statements);
     memory_storage_destroy(cli->storage);
     free(cli->current_database);
     free(cli->data_directory);
@@ -60,198 +63,164 @@ static void print_help(void) {
     printf("  DROP TABLE <name>                                  - Remove a table\n");
     printf("  DEBUG INFO                                         - Show memory usage info\n");
     printf("  INSERT INTO <table> VALUES (<val1>, ...)           - Insert a new record\n");
+    printf("  INSERT INTO <table> VALUES (...), (...)            - Insert several records at once\n");
+    printf("  COPY <table> FROM '<file>' [FORMAT csv|ndjson]     - Bulk load records from a file\n");
+    printf("  COPY <table> TO '<file>' [WITH GHOSTS] [FORMAT ..] - Export records (csv, ndjson, binary)\n");
     printf("  SELECT * FROM <table>                              - Query all data\n");
     printf("  SELECT * FROM <table> WITH GHOSTS                  - Query including ghosts\n");
-    printf("  DELETE FROM <table> WHERE id = <id>                - Delete record\n");
+    printf("  SELECT * FROM <table> WHERE <condition>            - Query matching records\n");
+    printf("  SELECT <col1>, <col2> FROM <table> ...             - Query selected columns\n");
+    printf("  SELECT COUNT(*), SUM(<col>), ... FROM <table> ...  - Compute aggregates\n");
+    printf("  SELECT <col>, COUNT(*) ... GROUP BY <col>          - Aggregate per group\n");
+    printf("  SELECT ... ORDER BY <col> [ASC|DESC] [LIMIT <n>]   - Sort and limit results\n");
+    printf("  SELECT ... LIMIT <n> OFFSET <m>                    - Return one page of results\n");
+    printf("  SELECT ... FROM <a> JOIN <b> ON <a.col> = <b.col>  - Join two tables on equal columns\n");
+    printf("  DELETE FROM <table> WHERE <condition>              - Delete matching records\n");
+    printf("  EXPLAIN [ANALYZE] <query>                          - Show the plan, or run it and time each step\n");
     printf("  RESURRECT <table> <id>                             - Bring ghost back to life\n");
     printf("  GHOST STATS                                        - Show ghost analytics\n");
     printf("  DECAY GHOSTS <amount>                              - Weaken all ghosts\n");
+    printf("  ANALYZE [<table>]                                  - Refresh planner statistics\n");
+    printf("  STATS <table>                                      - Show row counts and column statistics\n");
     printf("  HELP                                               - Show this help message\n");
     printf("  EXIT                                               - Exit Shade DB\n");
     printf("\n");
     printf("Data types: INT, FLOAT, BOOL, STRING\n");
     printf("Example: CREATE TABLE users (id INT, name STRING, age INT)\n");
+    printf("Strings: 'single' or \"double\" quoted; separate statements on one line with ;\n");
+    printf("Conditions: =, !=, <, <=, >, >=, BETWEEN .. AND .., IS [NOT] NULL, AND, OR, NOT\n");
+    printf("            _id refers to the record id\n");
+    printf("Aggregates: COUNT, SUM, AVG, MIN, MAX; WEIGHTED_COUNT, WEIGHTED_SUM, WEIGHTED_AVG\n");
+    printf("            weigh ghosts by their strength\n");
     printf("\n");
     printf("Persistence:\n");
     printf("  (Persistence-related commands are not implemented yet completely.)\n");
 }
 
-static ValueType parse_type(const char* type_str) {
-    if (string_case_compare(type_str, "INT") == 0) return VALUE_INTEGER;
-    if (string_case_compare(type_str, "FLOAT") == 0) return VALUE_FLOAT;
-    if (string_case_compare(type_str, "BOOL") == 0) return VALUE_BOOLEAN;
-    if (string_case_compare(type_str, "STRING") == 0) return VALUE_STRING;
-    return VALUE_NULL;
-}
-
-static Value parse_value(const char* value_str, ValueType type) {
-    Value value = value_null();
-    
-    switch (type) {
-        case VALUE_INTEGER:
-            value = value_integer(atoi(value_str));
-            break;
-        case VALUE_FLOAT:
-            value = value_float(atof(value_str));
-            break;
-        case VALUE_BOOLEAN:
-            if (string_case_compare(value_str, "true") == 0 || strcmp(value_str, "1") == 0) {
-                value = value_boolean(true);
-            } else {
-                value = value_boolean(false);
-            }
-            break;
-        case VALUE_STRING:
-            if (value_str[0] == '"' && value_str[strlen(value_str)-1] == '"') {
-                char* unquoted = string_duplicate_n(value_str + 1, strlen(value_str) - 2);
-                value = value_string(unquoted);
-                free(unquoted);
-            } else {
-                value = value_string(value_str);
-            }
-            break;
-        default:
-            break;
+static bool handle_create_table(CLIState* cli, const Command* command) {
+    char error[PARSER_ERROR_SIZE];
+    if (!command_create_table(cli->storage, command, error, sizeof(error))) {
+        printf("Error: %s\n", error);
+        return false;
     }
     
-    return value;
+    printf("Table '%s' created with %zu columns\n", command->table_name, command->column_count);
+    return true;
 }
 
-static bool handle_create_table(CLIState* cli, char** args, int arg_count) {
-    if (arg_count < 4) {
-        printf("Usage: CREATE TABLE <name> (<col1 type>, <col2 type>, ...)\n");
+static bool handle_insert(CLIState* cli, Command* command) {
+    char error[PARSER_ERROR_SIZE];
+    size_t row_count = command->row_count;
+    uint64_t first_id = command_insert(cli->storage, command, error, sizeof(error));
+    if (first_id == 0) {
+        printf("Error: %s\n", error);
         return false;
     }
     
-    const char* table_name = args[2];
-
-    char columns_str_buf[512] = {0};
-    for (int i = 3; i < arg_count; i++) {
-        strcat(columns_str_buf, args[i]);
-        strcat(columns_str_buf, " ");
+    if (row_count == 1) {
+        printf("Inserted record with id: %lu\n", first_id);
+    } else {
+        printf("Inserted %zu records with ids %lu-%lu\n", row_count, first_id, first_id + row_count - 1);
     }
+    return true;
+}
 
-    char* columns_str = columns_str_buf;
-    ColumnSchema columns[32];
-    int column_count = 0;
-    
-    char* token = strtok(columns_str, "(), ");
-    while (token && column_count < 32) {
-        if (column_count % 2 == 0) {
-            columns[column_count/2].name = string_duplicate(token);
-        } else {
-            columns[column_count/2].type = parse_type(token);
-        }
-        column_count++;
-        token = strtok(NULL, "(), ");
-    }
-    
-    column_count /= 2; 
-    
-    TableSchema* schema = tableschema_create(table_name, columns, column_count);
-    if (!schema) {
-        printf("Error: Failed to create table schema\n");
-        return false;
-    }
-    
-    MemoryTable* table = memory_storage_create_table(cli->storage, table_name, schema);
+static bool handle_copy_to(CLIState* cli, const Command* command) {
+    MemoryTable* table = memory_storage_get_table(cli->storage, command->table_name);
     if (!table) {
-        printf("Error: Table '%s' already exists\n", table_name);
-        tableschema_destroy(schema);
+        printf("Error: Table '%s' not found\n", command->table_name);
         return false;
     }
     
-    printf("Table '%s' created with %d columns\n", table_name, column_count);
-    
-    for (int i = 0; i < column_count; i++) {
-        free((char*)columns[i].name);
+    ExportStats stats;
+    if (!copy_to_file(table, command->path, command->format, command->include_ghosts, &stats)) {
+        printf("Error: %s\n", stats.error);
+        return false;
     }
     
+    printf("Exported %zu records (%lu bytes) to '%s'\n", stats.rows_written, stats.bytes_written, command->path);
     return true;
 }
 
-static bool handle_insert(CLIState* cli, char** args, int arg_count) {
-    if (arg_count < 5) {
-        printf("Usage: INSERT INTO <table> VALUES (<val1>, <val2>, ...)\n");
+static bool handle_copy(CLIState* cli, const Command* command) {
+    MemoryTable* table = memory_storage_get_table(cli->storage, command->table_name);
+    if (!table) {
+        printf("Error: Table '%s' not found\n", command->table_name);
         return false;
     }
     
-    const char* table_name = args[2];
-    MemoryTable* table = memory_storage_get_table(cli->storage, table_name);
-    if (!table) {
-        printf("Error: Table '%s' not found\n", table_name);
+    CopyStats stats;
+    if (!copy_from_file(table, command->path, command->format, &stats)) {
+        printf("Error: %s\n", stats.error);
         return false;
     }
     
-    char values_str_buf[512] = {0};
-    for (int i = 4; i < arg_count; i++) {
-        strcat(values_str_buf, args[i]);
-        strcat(values_str_buf, " ");
+    printf("Loaded %zu records into '%s'", stats.rows_loaded, command->table_name);
+    if (stats.rows_rejected > 0) {
+        printf(" (%zu rejected, first at line %zu)", stats.rows_rejected, stats.first_rejected_line);
     }
+    printf("\n");
+    return true;
+}
 
-    char* values_str = values_str_buf;
-    Value values[32];
-    size_t value_count = 0;
-    
-    char* token = strtok(values_str, "(), ");
-    while (token && value_count < 32 && value_count < table->schema->column_count) {
-        values[value_count] = parse_value(token, table->schema->columns[value_count].type);
-        value_count++;
-        token = strtok(NULL, "(), ");
-    }
+/* Repeated statements come from the cache already parsed and bound. */
+static PreparedStatement* prepare_statement(CLIState* cli, const char* text) {
+    char error[PARSER_ERROR_SIZE];
+    PreparedStatement* statement = statement_prepare(cli->statements, cli->storage, text, error, sizeof(error));
     
-    if (value_count != table->schema->column_count) {
-        printf("Error: Expected %zu values, got %zu\n", table->schema->column_count, value_count);
-        return false;
+    if (!statement) {
+        printf("Error: %s\n", error);
+        return NULL;
     }
-    
-    QueryResult* result = execute_insert_simple(cli->storage, table_name, values, value_count);
-    if (result && result->count > 0) {
-        printf("Inserted record with id: %lu\n", result->records[0]->id);
-        queryresult_destroy(result);
-        return true;
-    } else {
-        printf("Error: Failed to insert record\n");
-        if (result) queryresult_destroy(result);
-        return false;
+    if (statement->query->parameter_count > 0) {
+        printf("Error: Parameters are only supported by prepared statements in the embedded API\n");
+        statement_release(statement);
+        return NULL;
     }
+    return statement;
 }
 
-static bool handle_select(CLIState* cli, char** args, int arg_count) {
-    if (arg_count < 4) {
-        printf("Usage: SELECT * FROM <table> [WITH GHOSTS]\n");
-        return false;
-    }
-    
-    const char* table_name = args[3];
-    bool include_ghosts = false;
-    
-    if (arg_count >= 5 && string_case_compare(args[4], "WITH") == 0 && 
-        arg_count >= 6 && string_case_compare(args[5], "GHOSTS") == 0) {
-        include_ghosts = true;
-    }
-    
-    Query* query = query_create(QUERY_SELECT, table_name);
-    if (!query) return false;
-    
-    query->include_ghosts = include_ghosts;
-    
-    QueryResult* result = execute_query(cli->storage, query);
-    if (!result) {
-        printf("Error: Table '%s' not found\n", table_name);
-        query_destroy(query);
-        return false;
+static QueryResult* run_statement(PreparedStatement* statement) {
+    char error[PARSER_ERROR_SIZE];
+    QueryResult* result = statement_execute(statement, NULL, error, sizeof(error));
+    if (!result) printf("Error: %s\n", error);
+    return result;
+}
+
+static void print_value(const Value* value) {
+    switch (value->type) {
+        case VALUE_INTEGER:
+            printf("%-12ld", value->data.integer);
+            break;
+        case VALUE_FLOAT:
+            printf("%-12.2f", value->data.float_val);
+            break;
+        case VALUE_BOOLEAN:
+            printf("%-12s", value->data.boolean ? "true" : "false");
+            break;
+        case VALUE_STRING:
+            printf("%-12s", value->data.string);
+            break;
+        default:
+            printf("%-12s", "NULL");
+            break;
     }
+}
+
+static bool handle_select(PreparedStatement* statement) {
+    QueryResult* result = run_statement(statement);
+    if (!result) return false;
     
-    MemoryTable* table = memory_storage_get_table(cli->storage, table_name);
-    
+    const Query* query = statement->query;
+    /* Aggregate rows have no lifecycle state; joined rows take theirs from both sides. */
+    bool show_state = !query_is_aggregate(query);
     printf("\n");
-    for (size_t i = 0; i < table->schema->column_count; i++) {
-        printf("%-12s", table->schema->columns[i].name);
+    for (size_t i = 0; i < result->column_count; i++) {
+        printf("%-12s", result->schema->columns[result->column_map[i]].name);
     }
-    printf("STATE\n");
-    printf("------------");
-    for (size_t i = 0; i < table->schema->column_count; i++) {
+    printf("%s\n", show_state ? "STATE" : "");
+    printf("%s", show_state ? "------------" : "");
+    for (size_t i = 0; i < result->column_count; i++) {
         printf("------------");
     }
     printf("\n");
@@ -259,28 +228,14 @@ static bool handle_select(CLIState* cli, char** args, int arg_count) {
     for (size_t i = 0; i < result->count; i++) {
         DataRecord* record = result->records[i];
         
-        for (size_t j = 0; j < record->value_count; j++) {
-            switch (record->values[j].type) {
-                case VALUE_INTEGER:
-                    printf("%-12ld", record->values[j].data.integer);
-                    break;
-                case VALUE_FLOAT:
-                    printf("%-12.2f", record->values[j].data.float_val);
-                    break;
-                case VALUE_BOOLEAN:
-                    printf("%-12s", record->values[j].data.boolean ? "true" : "false");
-                    break;
-                case VALUE_STRING:
-                    printf("%-12s", record->values[j].data.string);
-                    break;
-                default:
-                    printf("%-12s", "NULL");
-                    break;
-            }
+        for (size_t j = 0; j < result->column_count; j++) {
+            print_value(&record->values[result->column_map[j]]);
         }
         
         const char* state = datarecord_state_to_string(record->state);
-        if (record->state == DATA_STATE_GHOST) {
+        if (!show_state) {
+            /* Nothing to print. */
+        } else if (record->state == DATA_STATE_GHOST) {
             printf("GHOST(%.2f)", record->ghost_strength);
         } else {
             printf("%s", state);
@@ -295,37 +250,57 @@ static bool handle_select(CLIState* cli, char** args, int arg_count) {
     printf(")\n\n");
     
     queryresult_destroy(result);
-    query_destroy(query);
     return true;
 }
 
-static bool handle_delete(CLIState* cli, char** args, int arg_count) {
-    if (arg_count < 6) {
-        printf("Usage: DELETE FROM <table> WHERE id = <id>\n");
-        return false;
+static bool handle_delete(PreparedStatement* statement) {
+    char error[PARSER_ERROR_SIZE];
+    QueryResult* result = statement_execute(statement, NULL, error, sizeof(error));
+    size_t deleted = result ? result->count : 0;
+    
+    if (deleted == 1) {
+        printf("Deleted record %lu (now a ghost)\n", result->records[0]->id);
+    } else if (deleted > 1) {
+        printf("Deleted %zu records (now ghosts)\n", deleted);
+    } else {
+        printf("Error: No matching records to delete\n");
     }
     
-    const char* table_name = args[2];
-    uint64_t id = atol(args[arg_count - 1]);
+    queryresult_destroy(result);
+    return deleted > 0;
+}
+
+static bool handle_explain(PreparedStatement* statement) {
+    QueryResult* result = run_statement(statement);
+    if (!result) return false;
     
-    bool success = execute_delete_simple(cli->storage, table_name, id);
-    if (success) {
-        printf("Deleted record %lu (now a ghost)\n", id);
-        return true;
-    } else {
-        printf("Error: Failed to delete record %lu\n", id);
-        return false;
+    for (size_t i = 0; i < result->count; i++) {
+        printf("%s\n", result->records[i]->values[0].data.string);
     }
+    queryresult_destroy(result);
+    return true;
 }
 
-static bool handle_resurrect(CLIState* cli, char** args, int arg_count) {
-    if (arg_count < 3) {
-        printf("Usage: RESURRECT <table> <id>\n");
-        return false;
+static bool handle_query(CLIState* cli, const Command* command) {
+    PreparedStatement* statement = prepare_statement(cli, command->text);
+    if (!statement) return false;
+    
+    bool success;
+    if (statement->query->explain != EXPLAIN_NONE) {
+        success = handle_explain(statement);
+    } else if (statement->query->type == QUERY_DELETE) {
+        success = handle_delete(statement);
+    } else {
+        success = handle_select(statement);
     }
     
-    const char* table_name = args[1];
-    uint64_t id = atol(args[2]);
+    statement_release(statement);
+    return success;
+}
+
+static bool handle_resurrect(CLIState* cli, const Command* command) {
+    const char* table_name = command->table_name;
+    uint64_t id = command->id;
     
     bool success = resurrect_ghost(cli->storage, table_name, id);
     if (success) {
@@ -349,40 +324,79 @@ static bool handle_ghost_stats(CLIState* cli) {
     return true;
 }
 
-static bool handle_decay_ghosts(CLIState* cli, char** args, int arg_count) {
-    if (arg_count < 3) {
-        printf("Usage: DECAY GHOSTS <amount>\n");
-        return false;
-    }
-    
-    float amount = atof(args[2]);
+static bool handle_decay_ghosts(CLIState* cli, const Command* command) {
+    float amount = (float)command->amount;
     decay_all_ghosts(cli->storage, amount);
     
     printf("Decayed all ghosts by %.2f\n", amount);
     return true;
 }
 
+static bool handle_analyze(CLIState* cli, const Command* command) {
+    if (command->table_name) {
+        MemoryTable* table = memory_storage_get_table(cli->storage, command->table_name);
+        if (!table) {
+            printf("Error: Table '%s' not found\n", command->table_name);
+            return false;
+        }
+        if (!memory_table_analyze(table)) {
+            printf("Error: Failed to analyze table '%s'\n", command->table_name);
+            return false;
+        }
+        printf("Analyzed table '%s'\n", command->table_name);
+        return true;
+    }
+
+    for (size_t i = 0; i < cli->storage->table_count; i++) {
+        if (!memory_table_analyze(cli->storage->tables[i])) {
+            printf("Error: Failed to analyze table '%s'\n", cli->storage->tables[i]->name);
+            return false;
+        }
+    }
+    printf("Analyzed %zu table(s)\n", cli->storage->table_count);
+    return true;
+}
+
+static bool handle_stats(CLIState* cli, const Command* command) {
+    MemoryTable* table = memory_storage_get_table(cli->storage, command->table_name);
+    if (!table) {
+        printf("Error: Table '%s' not found\n", command->table_name);
+        return false;
+    }
+
+    const TableStats* stats = table->stats;
+    printf("Table '%s': %zu living, %zu ghosts, %zu exorcised", table->name,
+           stats->living_count, stats->ghost_count, stats->exorcised_count);
+    if (stats->analyzed) {
+        printf(" (%zu changes since ANALYZE)\n", stats->modified_count);
+    } else {
+        printf(" (never analyzed)\n");
+    }
+
+    printf("%-12s%-12s%-12s%-12s%-12s%s\n", "column", "nulls", "distinct", "min", "max", "buckets");
+    for (size_t i = 0; i < stats->column_count; i++) {
+        const ColumnStats* column = &stats->columns[i];
+        printf("%-12s%-12zu%-12.0f", table->schema->columns[i].name, column->null_count,
+               column_stats_distinct(column));
+        print_value(&column->min);
+        print_value(&column->max);
+        printf("%zu\n", column->bucket_count);
+    }
+    return true;
+}
+
 static bool handle_exit(CLIState* cli) {
     cli->running = false;
     printf("Exiting\n");
     return true;
 }
 
-static bool handle_unknown(char** args) {
-    printf("Unknown command: '%s'. Type HELP for available commands.\n", args[0]);
-    return false;
-}
-
-static bool handle_drop_table(CLIState* cli, char** args, int arg_count) {
-    if (arg_count < 3) {
-        printf("Usage: DROP TABLE <name>\n");
-        return false;
-    }
-    
-    const char* table_name = args[2];
+static bool handle_drop_table(CLIState* cli, const Command* command) {
+    const char* table_name = command->table_name;
     
     bool success = execute_drop_table(cli->storage, table_name);
     if (success) {
+        statement_cache_invalidate(cli->statements);
         printf("Table '%s' dropped successfully\n", table_name);
         return true;
     } else {
@@ -396,18 +410,14 @@ static bool handle_debug_info(CLIState* cli) {
     return true;
 }
 
-static bool handle_use_database(CLIState* cli, char** args, int arg_count) {
-    if (arg_count < 2) {
-        printf("Usage: USE <database_path>\n");
-        return false;
-    }
-    
-    const char* db_path = args[1];
+static bool handle_use_database(CLIState* cli, const Command* command) {
+    const char* db_path = command->path;
     
     if (cli->persistence_enabled) {
         memory_storage_save(cli->storage);
     }
     
+    statement_cache_invalidate(cli->statements);
     memory_storage_destroy(cli->storage);
     
     cli->storage = memory_storage_load(db_path);
@@ -423,6 +433,7 @@ static bool handle_use_database(CLIState* cli, char** args, int arg_count) {
     free(cli->data_directory);
     cli->data_directory = string_duplicate(db_path);
     cli->persistence_enabled = true;
+    if (cli->storage->defer_index != cli->batch) memory_storage_defer_index(cli->storage, cli->batch);
     
     printf("Using database: %s\n", db_path);
     return true;
@@ -443,13 +454,8 @@ static bool handle_save(CLIState* cli) {
     return success;
 }
 
-static bool handle_enable_persistence(CLIState* cli, char** args, int arg_count) {
-    if (arg_count < 2) {
-        printf("Usage: ENABLE PERSISTENCE <data_directory>\n");
-        return false;
-    }
-    
-    const char* data_dir = args[2];
+static bool handle_enable_persistence(CLIState* cli, const Command* command) {
+    const char* data_dir = command->path;
     
     if (cli->persistence_enabled) {
         printf("Persistence already enabled for: %s\n", cli->data_directory);
@@ -467,86 +473,139 @@ static bool handle_enable_persistence(CLIState* cli, char** args, int arg_count)
     return success;
 }
 
-static bool execute_command(CLIState* cli, char** args, int arg_count) {
-    if (arg_count == 0) return true;
-    
-    char* command = args[0];
-
-    if (string_case_compare(command, "USE") == 0) {
-        return handle_use_database(cli, args, arg_count);
-    } else if (string_case_compare(command, "SAVE") == 0) {
-        return handle_save(cli);
-    } else if (string_case_compare(command, "ENABLE") == 0 && arg_count > 1 && string_case_compare(args[1], "PERSISTENCE") == 0) {
-        return handle_enable_persistence(cli, args, arg_count);
-    } else if (string_case_compare(command, "HELP") == 0) {
-        print_help();
-        return true;
-    } else if (string_case_compare(command, "DEBUG") == 0 && arg_count > 1 && 
-        string_case_compare(args[1], "INFO") == 0) {
-        return handle_debug_info(cli); 
-    } else if (string_case_compare(command, "CREATE") == 0 && arg_count > 1 && 
-        string_case_compare(args[1], "TABLE") == 0) {
-        return handle_create_table(cli, args, arg_count);
-    } else if (string_case_compare(command, "DROP") == 0 && arg_count > 1 && 
-        string_case_compare(args[1], "TABLE") == 0) {
-        return handle_drop_table(cli, args, arg_count);  
-    } else if (string_case_compare(command, "INSERT") == 0 && arg_count > 1 && 
-        string_case_compare(args[1], "INTO") == 0) {
-        return handle_insert(cli, args, arg_count);
-    } else if (string_case_compare(command, "SELECT") == 0) {
-        return handle_select(cli, args, arg_count);
-    } else if (string_case_compare(command, "DELETE") == 0) {
-        return handle_delete(cli, args, arg_count);
-    } else if (string_case_compare(command, "RESURRECT") == 0) {
-        return handle_resurrect(cli, args, arg_count);
-    } else if (string_case_compare(command, "GHOST") == 0 && arg_count > 1 && 
-        string_case_compare(args[1], "STATS") == 0) {
-        return handle_ghost_stats(cli);
-    } else if (string_case_compare(command, "DECAY") == 0 && arg_count > 1 && 
-        string_case_compare(args[1], "GHOSTS") == 0) {
-        return handle_decay_ghosts(cli, args, arg_count);
-    } else if (string_case_compare(command, "EXIT") == 0 || 
-        string_case_compare(command, "QUIT") == 0) {
-        return handle_exit(cli);
-    } else {
-        return handle_unknown(args);
+static bool execute_command(CLIState* cli, Command* command) {
+    switch (command->type) {
+        case COMMAND_EMPTY: return true;
+        case COMMAND_QUERY: return handle_query(cli, command);
+        case COMMAND_CREATE_TABLE: return handle_create_table(cli, command);
+        case COMMAND_DROP_TABLE: return handle_drop_table(cli, command);
+        case COMMAND_INSERT: return handle_insert(cli, command);
+        case COMMAND_COPY_FROM: return handle_copy(cli, command);
+        case COMMAND_COPY_TO: return handle_copy_to(cli, command);
+        case COMMAND_RESURRECT: return handle_resurrect(cli, command);
+        case COMMAND_GHOST_STATS: return handle_ghost_stats(cli);
+        case COMMAND_DECAY_GHOSTS: return handle_decay_ghosts(cli, command);
+        case COMMAND_ANALYZE: return handle_analyze(cli, command);
+        case COMMAND_STATS: return handle_stats(cli, command);
+        case COMMAND_USE: return handle_use_database(cli, command);
+        case COMMAND_SAVE: return handle_save(cli);
+        case COMMAND_ENABLE_PERSISTENCE: return handle_enable_persistence(cli, command);
+        case COMMAND_DEBUG_INFO: return handle_debug_info(cli);
+        case COMMAND_HELP:
+            print_help();
+            return true;
+        case COMMAND_EXIT: return handle_exit(cli);
     }
+    return false;
 }
 
-static int parse_input(char* input, char** args) {
-    int count = 0;
-    char* token = strtok(input, " \t\n");
-    
-    while (token && count < MAX_ARGS - 1) {
-        args[count++] = token;
-        token = strtok(NULL, " \t\n");
+bool cli_execute(CLIState* cli, const char* text) {
+    bool success = true;
+    
+    while (cli->running && *text) {
+        char error[PARSER_ERROR_SIZE];
+        const char* next;
+        Command* command = parse_command(text, &next, error, sizeof(error));
+        if (!command) {
+            printf("Error: %s\n", error);
+            return false;
+        }
+        
+        success = execute_command(cli, command) && success;
+        command_destroy(command);
+        text = next;
     }
-    
-    args[count] = NULL;
-    return count;
+    return success;
 }
 
 void cli_run(CLIState* cli) {
     printf("Shade Database v0.1.0 - Data with a Memory\n");
     printf("Type 'HELP' for commands, 'EXIT' to quit\n\n");
     
-    char input[MAX_INPUT_LENGTH];
-    char* args[MAX_ARGS];
+    char* line = NULL;
+    size_t capacity = 0;
     
     while (cli->running) {
         print_prompt();
         
-        if (!fgets(input, sizeof(input), stdin)) {
+        if (getline(&line, &capacity, stdin) < 0) {
             break;
         }
         
-        input[strcspn(input, "\n")] = 0;
+        cli_execute(cli, line);
+    }
+    free(line);
+}
+
+/* Lexes text from *scanned on and reports whether its last token is a `;` outside any quotes.
+ * Advances *scanned past whole tokens, so each line of a long statement is lexed once; a quote
+ * still open at the end is lexed again once the next line arrives. */
+static bool ends_statement(const char* text, size_t* scanned) {
+    Lexer lexer;
+    lexer_init(&lexer, text + *scanned);
+    bool ends = false;
+    
+    for (Token token = lexer_next(&lexer); token.type != TOKEN_END; token = lexer_next(&lexer)) {
+        if (token.type == TOKEN_ERROR && token.start[token.length] == '\0') return false;
+        ends = token.type == TOKEN_SEMICOLON;
+        *scanned = (size_t)(token.start + token.length - text);
+    }
+    return ends;
+}
+
+static bool run_script_statement(CLIState* cli, const char* text, const char* name, size_t line_number) {
+    if (cli_execute(cli, text)) return true;
+    fprintf(stderr, "%s:%zu: statement failed\n", name, line_number);
+    return false;
+}
+
+bool cli_run_script(CLIState* cli, FILE* input, const char* name) {
+    char* line = NULL;
+    size_t capacity = 0;
+    size_t line_number = 0;
+    char* statement = NULL;
+    size_t length = 0;
+    size_t statement_capacity = 0;
+    size_t first_line = 0;
+    size_t scanned = 0;
+    bool success = true;
+    ssize_t read;
+    
+    if (cli->batch) memory_storage_defer_index(cli->storage, true);
+    
+    while (cli->running && (read = getline(&line, &capacity, input)) >= 0) {
+        line_number++;
+        if (length == 0 && line[strspn(line, " \t\r\n")] == '\0') continue;
+        if (length == 0) first_line = line_number;
         
-        if (strlen(input) == 0) {
-            continue;
+        if (length + (size_t)read + 1 > statement_capacity) {
+            size_t grown = statement_capacity ? statement_capacity : 256;
+            while (grown < length + (size_t)read + 1) grown *= 2;
+            char* resized = realloc(statement, grown);
+            if (!resized) {
+                fprintf(stderr, "%s:%zu: out of memory\n", name, line_number);
+                success = false;
+                break;
+            }
+            statement = resized;
+            statement_capacity = grown;
         }
+        memcpy(statement + length, line, (size_t)read + 1);
+        length += (size_t)read;
         
-        int arg_count = parse_input(input, args);
-        execute_command(cli, args, arg_count);
+        if (!ends_statement(statement, &scanned)) continue;
+        success = run_script_statement(cli, statement, name, first_line) && success;
+        length = 0;
+        scanned = 0;
     }
+    
+    /* The last statement may leave out its `;`. */
+    if (cli->running && length > 0) {
+        success = run_script_statement(cli, statement, name, first_line) && success;
+    }
+    free(statement);
+    free(line);
+    
+    if (cli->batch) memory_storage_defer_index(cli->storage, false);
+    return success;
 }
@@ -2,10 +2,14 @@
 #define SHADE_CLI_H
 
 #include "../storage/memory.h"
+#include "../storage/copy.h"
 #include "../ghost/analytics.h"
 #include "../types/schema.h"
 #include "../types/value.h"
 #include "../query/executor.h"
+#include "../query/export.h"
+#include "../query/parser.h"
+#include "../query/statement.h"
 #include "../ghost/lifecycle.h"
 #include "../ghost/analytics.h"
 #include <stdio.h>
@@ -18,6 +22,9 @@ typedef struct {
     char* current_database;
     char* data_directory;  
     bool persistence_enabled;
+    StatementCache* statements;
+    /* Run scripts as one implicit batch, deferring index writes until a query reads them. */
+    bool batch;
 } CLIState;
 
 CLIState* cli_create(void);
@@ -25,9 +32,12 @@ CLIState* cli_create_with_persistence(const char* data_dir);
 void cli_destroy(CLIState* cli);
 
 void cli_run(CLIState* cli);
-
-typedef bool (*CommandHandler)(CLIState* cli, char** args, int arg_count);
-
-void cli_register_commands(void);
+/* Runs every `;`-separated statement in text, stopping at the first that fails to parse;
+ * returns false if any statement failed. */
+bool cli_execute(CLIState* cli, const char* text);
+/* Runs input without prompts, one statement at a time: each runs once a line ends it with `;`, so
+ * it may span lines, and the last may end at EOF instead. Reports failures as name:line of the
+ * statement's first line on stderr; returns false if any statement failed. */
+bool cli_run_script(CLIState* cli, FILE* input, const char* name);
 
 #endif
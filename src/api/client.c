@@ -0,0 +1,518 @@
+#define _POSIX_C_SOURCE 200809L
+#include "client.h"
+#include "protocol.h"
+#include "../types/data.h"
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CLIENT_READ_CHUNK 65536
+#define CLIENT_FLUSH_THRESHOLD 65536
+
+typedef struct {
+    uint32_t request;
+    ShadeClientResult* result;
+    bool malformed;
+} PendingRequest;
+
+struct ShadeClient {
+    int fd;
+    WireBuffer input;
+    WireBuffer output;
+    char error[PROTOCOL_ERROR_SIZE];
+
+    uint32_t next_request;
+    PendingRequest* pending;
+    size_t pending_count;
+    size_t pending_capacity;
+};
+
+typedef struct {
+    uint64_t id;
+    DataState state;
+    float ghost_strength;
+} ClientRow;
+
+struct ShadeClientResult {
+    char** column_names;
+    ValueType* column_types;
+    size_t column_count;
+
+    ClientRow* rows;
+    Value* values;
+    size_t row_count;
+    size_t row_capacity;
+
+    uint64_t affected;
+    uint64_t first_id;
+    uint32_t statement;
+    size_t param_count;
+};
+
+static void set_error(ShadeClient* client, const char* message) {
+    snprintf(client->error, sizeof(client->error), "%s", message);
+}
+
+ShadeClient* shade_client_connect(const char* address, char* error, size_t error_size) {
+    struct sockaddr_storage socket_address;
+    socklen_t address_length;
+    if (!address || !protocol_resolve_address(address, &socket_address, &address_length, error, error_size)) {
+        return NULL;
+    }
+
+    int fd = socket(socket_address.ss_family, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&socket_address, address_length) != 0) {
+        snprintf(error, error_size, "Cannot connect to '%s': %s", address, strerror(errno));
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+
+    int nodelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    ShadeClient* client = calloc(1, sizeof(ShadeClient));
+    if (!client) {
+        snprintf(error, error_size, "Out of memory");
+        close(fd);
+        return NULL;
+    }
+    client->fd = fd;
+    wire_buffer_init(&client->input);
+    wire_buffer_init(&client->output);
+    return client;
+}
+
+void shade_client_close(ShadeClient* client) {
+    if (!client) return;
+
+    for (size_t i = 0; i < client->pending_count; i++) {
+        shade_client_result_free(client->pending[i].result);
+    }
+    free(client->pending);
+    close(client->fd);
+    wire_buffer_free(&client->input);
+    wire_buffer_free(&client->output);
+    free(client);
+}
+
+const char* shade_client_error(const ShadeClient* client) {
+    return client ? client->error : "No client";
+}
+
+static bool read_available(ShadeClient* client) {
+    WireBuffer* input = &client->input;
+    if (!wire_buffer_reserve(input, CLIENT_READ_CHUNK)) {
+        set_error(client, "Out of memory");
+        return false;
+    }
+
+    ssize_t received;
+    do {
+        received = read(client->fd, input->data + input->length, input->capacity - input->length);
+    } while (received < 0 && errno == EINTR);
+
+    if (received <= 0) {
+        set_error(client, received == 0 ? "Server closed the connection" : strerror(errno));
+        return false;
+    }
+    input->length += (size_t)received;
+    return true;
+}
+
+/* Keeps reading replies while writing, since the server stops reading requests while its own
+ * output is backed up. */
+static bool flush_output(ShadeClient* client) {
+    WireBuffer* output = &client->output;
+    if (output->failed) {
+        set_error(client, "Out of memory");
+        return false;
+    }
+
+    size_t sent = 0;
+    bool success = true;
+    while (success && sent < output->length) {
+        struct pollfd watch = {client->fd, POLLIN | POLLOUT, 0};
+        if (poll(&watch, 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            set_error(client, strerror(errno));
+            success = false;
+            break;
+        }
+
+        if (watch.revents & POLLIN) success = read_available(client);
+        if (success && (watch.revents & (POLLOUT | POLLERR | POLLHUP))) {
+            ssize_t written = send(client->fd, output->data + sent, output->length - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (written >= 0) {
+                sent += (size_t)written;
+            } else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                set_error(client, strerror(errno));
+                success = false;
+            }
+        }
+    }
+    wire_buffer_consume(output, sent);
+    return success;
+}
+
+/* Blocks until a whole frame is buffered; the caller consumes frame->size bytes when done. */
+static bool next_frame(ShadeClient* client, WireFrame* frame) {
+    for (;;) {
+        FrameStatus status = wire_next_frame(client->input.data, client->input.length, frame);
+        if (status == FRAME_READY) return true;
+        if (status == FRAME_INVALID) {
+            set_error(client, "Malformed reply");
+            return false;
+        }
+        if (!read_available(client)) return false;
+    }
+}
+
+static ShadeClientResult* result_create(void) {
+    return calloc(1, sizeof(ShadeClientResult));
+}
+
+void shade_client_result_free(ShadeClientResult* result) {
+    if (!result) return;
+
+    for (size_t i = 0; i < result->column_count; i++) {
+        free(result->column_names[i]);
+    }
+    for (size_t i = 0; i < result->row_count * result->column_count; i++) {
+        value_destroy(&result->values[i]);
+    }
+    free(result->column_names);
+    free(result->column_types);
+    free(result->rows);
+    free(result->values);
+    free(result);
+}
+
+static bool read_columns(ShadeClientResult* result, WireReader* reader) {
+    uint32_t count = wire_get_u32(reader);
+    if (reader->failed || count > reader->length) return false;
+
+    result->column_names = calloc(count ? count : 1, sizeof(char*));
+    result->column_types = calloc(count ? count : 1, sizeof(ValueType));
+    if (!result->column_names || !result->column_types) return false;
+
+    for (uint32_t i = 0; i < count; i++) {
+        result->column_types[i] = (ValueType)wire_get_u8(reader);
+        result->column_names[i] = wire_get_string(reader);
+        if (!result->column_names[i]) return false;
+        result->column_count++;
+    }
+    return true;
+}
+
+static bool read_rows(ShadeClientResult* result, WireReader* reader) {
+    uint32_t count = wire_get_u32(reader);
+    if (reader->failed || count > reader->length) return false;
+
+    size_t needed = result->row_count + count;
+    if (needed > result->row_capacity) {
+        size_t capacity = result->row_capacity ? result->row_capacity : 64;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        ClientRow* rows = realloc(result->rows, sizeof(ClientRow) * capacity);
+        if (rows) result->rows = rows;
+        Value* values = realloc(result->values, sizeof(Value) * capacity * (result->column_count ? result->column_count : 1));
+        if (values) result->values = values;
+        if (!rows || !values) return false;
+        result->row_capacity = capacity;
+    }
+
+    for (uint32_t r = 0; r < count; r++) {
+        ClientRow* row = &result->rows[result->row_count];
+        row->id = wire_get_u64(reader);
+        row->state = (DataState)wire_get_u8(reader);
+        row->ghost_strength = (float)wire_get_f64(reader);
+
+        Value* values = &result->values[result->row_count * result->column_count];
+        for (size_t i = 0; i < result->column_count; i++) {
+            if (!wire_get_value(reader, &values[i])) {
+                for (size_t j = 0; j < i; j++) {
+                    value_destroy(&values[j]);
+                }
+                return false;
+            }
+        }
+        result->row_count++;
+    }
+    return true;
+}
+
+static PendingRequest* find_pending(ShadeClient* client, uint32_t request) {
+    for (size_t i = 0; i < client->pending_count; i++) {
+        if (client->pending[i].request == request) return &client->pending[i];
+    }
+    return NULL;
+}
+
+/* Starts a request frame and tracks its reply; returns the request id, or 0 on error. */
+static uint32_t begin_request(ShadeClient* client, MessageType type, size_t* start) {
+    if (client->pending_count == client->pending_capacity) {
+        size_t capacity = client->pending_capacity ? client->pending_capacity * 2 : 16;
+        PendingRequest* pending = realloc(client->pending, sizeof(PendingRequest) * capacity);
+        if (!pending) {
+            set_error(client, "Out of memory");
+            return 0;
+        }
+        client->pending = pending;
+        client->pending_capacity = capacity;
+    }
+
+    ShadeClientResult* result = result_create();
+    if (!result) {
+        set_error(client, "Out of memory");
+        return 0;
+    }
+
+    if (++client->next_request == 0) client->next_request = 1;
+    PendingRequest* pending = &client->pending[client->pending_count++];
+    pending->request = client->next_request;
+    pending->result = result;
+    pending->malformed = false;
+
+    *start = wire_begin_message(&client->output, type, pending->request);
+    return pending->request;
+}
+
+static uint32_t end_request(ShadeClient* client, size_t start, uint32_t request) {
+    wire_end_message(&client->output, start);
+    if (client->output.length >= CLIENT_FLUSH_THRESHOLD && !flush_output(client)) return 0;
+    return request;
+}
+
+uint32_t shade_client_send_exec(ShadeClient* client, const char* sql) {
+    if (!client || !sql) return 0;
+
+    size_t start;
+    uint32_t request = begin_request(client, MESSAGE_EXEC, &start);
+    if (!request) return 0;
+    wire_put_string(&client->output, sql);
+    return end_request(client, start, request);
+}
+
+uint32_t shade_client_send_prepare(ShadeClient* client, const char* sql) {
+    if (!client || !sql) return 0;
+
+    size_t start;
+    uint32_t request = begin_request(client, MESSAGE_PREPARE, &start);
+    if (!request) return 0;
+    wire_put_string(&client->output, sql);
+    return end_request(client, start, request);
+}
+
+uint32_t shade_client_send_execute(ShadeClient* client, uint32_t statement,
+                                   const Value* params, size_t param_count) {
+    if (!client || (param_count > 0 && !params)) return 0;
+
+    size_t start;
+    uint32_t request = begin_request(client, MESSAGE_EXECUTE, &start);
+    if (!request) return 0;
+    wire_put_u32(&client->output, statement);
+    wire_put_u32(&client->output, (uint32_t)param_count);
+    for (size_t i = 0; i < param_count; i++) {
+        wire_put_value(&client->output, &params[i]);
+    }
+    return end_request(client, start, request);
+}
+
+uint32_t shade_client_send_finalize(ShadeClient* client, uint32_t statement) {
+    if (!client) return 0;
+
+    size_t start;
+    uint32_t request = begin_request(client, MESSAGE_CLOSE, &start);
+    if (!request) return 0;
+    wire_put_u32(&client->output, statement);
+    return end_request(client, start, request);
+}
+
+bool shade_client_flush(ShadeClient* client) {
+    return client && flush_output(client);
+}
+
+size_t shade_client_in_flight(const ShadeClient* client) {
+    return client ? client->pending_count : 0;
+}
+
+/* Adds one reply frame to its request; returns true once the request has finished. */
+static bool apply_frame(ShadeClient* client, PendingRequest* pending, WireFrame* frame) {
+    ShadeClientResult* result = pending->result;
+    WireReader* reader = &frame->payload;
+    bool valid = !pending->malformed;
+
+    switch (frame->type) {
+        case MESSAGE_COLUMNS:
+            if (valid) valid = result->column_count == 0 && read_columns(result, reader);
+            break;
+        case MESSAGE_ROWS:
+            if (valid) valid = read_rows(result, reader);
+            break;
+        case MESSAGE_COMPLETE:
+            result->affected = wire_get_u64(reader);
+            result->first_id = wire_get_u64(reader);
+            return true;
+        case MESSAGE_PREPARED:
+            result->statement = wire_get_u32(reader);
+            result->param_count = wire_get_u32(reader);
+            return true;
+        case MESSAGE_ERROR: {
+            char* message = wire_get_string(reader);
+            set_error(client, message ? message : "Malformed reply");
+            free(message);
+            pending->malformed = true;
+            return true;
+        }
+        default:
+            valid = false;
+            break;
+    }
+
+    if (!valid || reader->failed) pending->malformed = true;
+    return false;
+}
+
+ShadeClientResult* shade_client_receive(ShadeClient* client, uint32_t* request) {
+    if (request) *request = 0;
+    if (!client) return NULL;
+    if (client->pending_count == 0) {
+        set_error(client, "No requests in flight");
+        return NULL;
+    }
+    if (!flush_output(client)) return NULL;
+
+    for (;;) {
+        WireFrame frame;
+        if (!next_frame(client, &frame)) return NULL;
+
+        PendingRequest* pending = find_pending(client, frame.request);
+        if (!pending) {
+            set_error(client, "Reply to an unknown request");
+            return NULL;
+        }
+
+        bool finished = apply_frame(client, pending, &frame);
+        wire_buffer_consume(&client->input, frame.size);
+        if (!finished) continue;
+
+        PendingRequest done = *pending;
+        *pending = client->pending[--client->pending_count];
+        if (request) *request = done.request;
+
+        if (done.malformed) {
+            if (frame.type != MESSAGE_ERROR) set_error(client, "Malformed reply");
+            shade_client_result_free(done.result);
+            return NULL;
+        }
+        return done.result;
+    }
+}
+
+static ShadeClientResult* wait_for(ShadeClient* client, uint32_t request) {
+    if (!request) return NULL;
+
+    uint32_t finished;
+    ShadeClientResult* result = shade_client_receive(client, &finished);
+    if (result && finished != request) {
+        shade_client_result_free(result);
+        set_error(client, "Reply to an unexpected request");
+        return NULL;
+    }
+    return result;
+}
+
+static bool idle(ShadeClient* client) {
+    if (!client) return false;
+    if (client->pending_count > 0) {
+        set_error(client, "Receive pipelined replies first");
+        return false;
+    }
+    return true;
+}
+
+ShadeClientResult* shade_client_exec(ShadeClient* client, const char* sql) {
+    if (!idle(client)) return NULL;
+    return wait_for(client, shade_client_send_exec(client, sql));
+}
+
+uint32_t shade_client_prepare(ShadeClient* client, const char* sql, size_t* param_count) {
+    if (!idle(client)) return 0;
+
+    ShadeClientResult* result = wait_for(client, shade_client_send_prepare(client, sql));
+    if (!result) return 0;
+
+    uint32_t statement = result->statement;
+    if (param_count) *param_count = result->param_count;
+    shade_client_result_free(result);
+    return statement;
+}
+
+ShadeClientResult* shade_client_execute(ShadeClient* client, uint32_t statement,
+                                        const Value* params, size_t param_count) {
+    if (!idle(client)) return NULL;
+    return wait_for(client, shade_client_send_execute(client, statement, params, param_count));
+}
+
+bool shade_client_finalize(ShadeClient* client, uint32_t statement) {
+    if (!idle(client)) return false;
+
+    ShadeClientResult* result = wait_for(client, shade_client_send_finalize(client, statement));
+    shade_client_result_free(result);
+    return result != NULL;
+}
+
+size_t shade_client_result_row_count(const ShadeClientResult* result) {
+    return result ? result->row_count : 0;
+}
+
+size_t shade_client_result_column_count(const ShadeClientResult* result) {
+    return result ? result->column_count : 0;
+}
+
+const char* shade_client_result_column_name(const ShadeClientResult* result, size_t col) {
+    if (!result || col >= result->column_count) return NULL;
+    return result->column_names[col];
+}
+
+ValueType shade_client_result_column_type(const ShadeClientResult* result, size_t col) {
+    if (!result || col >= result->column_count) return VALUE_NULL;
+    return result->column_types[col];
+}
+
+const Value* shade_client_result_value(const ShadeClientResult* result, size_t row, size_t col) {
+    if (!result || row >= result->row_count || col >= result->column_count) return NULL;
+    return &result->values[row * result->column_count + col];
+}
+
+uint64_t shade_client_result_row_id(const ShadeClientResult* result, size_t row) {
+    if (!result || row >= result->row_count) return 0;
+    return result->rows[row].id;
+}
+
+bool shade_client_result_is_ghost(const ShadeClientResult* result, size_t row) {
+    if (!result || row >= result->row_count) return false;
+    return result->rows[row].state == DATA_STATE_GHOST;
+}
+
+uint64_t shade_client_result_affected(const ShadeClientResult* result) {
+    return result ? result->affected : 0;
+}
+
+uint64_t shade_client_result_first_id(const ShadeClientResult* result) {
+    return result ? result->first_id : 0;
+}
+
+uint32_t shade_client_result_statement(const ShadeClientResult* result) {
+    return result ? result->statement : 0;
+}
+
+size_t shade_client_result_param_count(const ShadeClientResult* result) {
+    return result ? result->param_count : 0;
+}
@@ -0,0 +1,57 @@
+#ifndef SHADE_CLIENT_H
+#define SHADE_CLIENT_H
+
+#include "../types/value.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct ShadeClient ShadeClient;
+typedef struct ShadeClientResult ShadeClientResult;
+
+/* Client for a `shade --serve` server. Failures return NULL, 0 or false and leave a message in
+ * shade_client_error. */
+ShadeClient* shade_client_connect(const char* address, char* error, size_t error_size);
+void shade_client_close(ShadeClient* client);
+const char* shade_client_error(const ShadeClient* client);
+
+/* The calls below wait for their reply and fail while pipelined requests are in flight. */
+
+/* Runs one shell statement; queries return their rows, other statements an empty result. */
+ShadeClientResult* shade_client_exec(ShadeClient* client, const char* sql);
+
+/* Returns a statement id valid on this connection, or 0 on error. */
+uint32_t shade_client_prepare(ShadeClient* client, const char* sql, size_t* param_count);
+/* params holds one value per `?` placeholder. */
+ShadeClientResult* shade_client_execute(ShadeClient* client, uint32_t statement,
+                                        const Value* params, size_t param_count);
+bool shade_client_finalize(ShadeClient* client, uint32_t statement);
+
+/* Pipelining: each send queues a request and returns its id (0 on error) without waiting.
+ * Requests go out when the buffer fills, on flush, or on receive, which returns the next request
+ * to finish: its result, or NULL with *request set to its id if it failed. NULL with *request set
+ * to 0 means the connection failed. Prepare replies carry the new statement id in their result. */
+uint32_t shade_client_send_exec(ShadeClient* client, const char* sql);
+uint32_t shade_client_send_prepare(ShadeClient* client, const char* sql);
+uint32_t shade_client_send_execute(ShadeClient* client, uint32_t statement,
+                                   const Value* params, size_t param_count);
+uint32_t shade_client_send_finalize(ShadeClient* client, uint32_t statement);
+bool shade_client_flush(ShadeClient* client);
+ShadeClientResult* shade_client_receive(ShadeClient* client, uint32_t* request);
+size_t shade_client_in_flight(const ShadeClient* client);
+
+size_t shade_client_result_row_count(const ShadeClientResult* result);
+size_t shade_client_result_column_count(const ShadeClientResult* result);
+const char* shade_client_result_column_name(const ShadeClientResult* result, size_t col);
+ValueType shade_client_result_column_type(const ShadeClientResult* result, size_t col);
+const Value* shade_client_result_value(const ShadeClientResult* result, size_t row, size_t col);
+uint64_t shade_client_result_row_id(const ShadeClientResult* result, size_t row);
+bool shade_client_result_is_ghost(const ShadeClientResult* result, size_t row);
+/* Rows returned or affected, and the first id an INSERT assigned. */
+uint64_t shade_client_result_affected(const ShadeClientResult* result);
+uint64_t shade_client_result_first_id(const ShadeClientResult* result);
+uint32_t shade_client_result_statement(const ShadeClientResult* result);
+size_t shade_client_result_param_count(const ShadeClientResult* result);
+void shade_client_result_free(ShadeClientResult* result);
+
+#endif
@@ -0,0 +1,278 @@
+#define _POSIX_C_SOURCE 200809L
+#include "protocol.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/un.h>
+
+#define WIRE_INITIAL_CAPACITY 4096
+
+void wire_buffer_init(WireBuffer* buffer) {
+    memset(buffer, 0, sizeof(WireBuffer));
+}
+
+void wire_buffer_free(WireBuffer* buffer) {
+    free(buffer->data);
+    wire_buffer_init(buffer);
+}
+
+bool wire_buffer_reserve(WireBuffer* buffer, size_t length) {
+    if (buffer->failed) return false;
+    if (buffer->capacity - buffer->length >= length) return true;
+
+    size_t capacity = buffer->capacity ? buffer->capacity : WIRE_INITIAL_CAPACITY;
+    while (capacity - buffer->length < length) {
+        capacity *= 2;
+    }
+
+    char* data = realloc(buffer->data, capacity);
+    if (!data) {
+        buffer->failed = true;
+        return false;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+void wire_buffer_consume(WireBuffer* buffer, size_t length) {
+    if (length >= buffer->length) {
+        buffer->length = 0;
+        return;
+    }
+    memmove(buffer->data, buffer->data + length, buffer->length - length);
+    buffer->length -= length;
+}
+
+static void put_bytes(WireBuffer* buffer, const void* data, size_t length) {
+    if (!wire_buffer_reserve(buffer, length)) return;
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+}
+
+void wire_put_u8(WireBuffer* buffer, uint8_t value) {
+    put_bytes(buffer, &value, 1);
+}
+
+void wire_put_u32(WireBuffer* buffer, uint32_t value) {
+    unsigned char bytes[4];
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    put_bytes(buffer, bytes, sizeof(bytes));
+}
+
+void wire_put_u64(WireBuffer* buffer, uint64_t value) {
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    put_bytes(buffer, bytes, sizeof(bytes));
+}
+
+void wire_put_f64(WireBuffer* buffer, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    wire_put_u64(buffer, bits);
+}
+
+void wire_put_string(WireBuffer* buffer, const char* text) {
+    size_t length = strlen(text);
+    wire_put_u32(buffer, (uint32_t)length);
+    put_bytes(buffer, text, length);
+}
+
+void wire_put_value(WireBuffer* buffer, const Value* value) {
+    wire_put_u8(buffer, (uint8_t)value->type);
+    switch (value->type) {
+        case VALUE_INTEGER:
+            wire_put_u64(buffer, (uint64_t)value->data.integer);
+            break;
+        case VALUE_FLOAT:
+            wire_put_f64(buffer, value->data.float_val);
+            break;
+        case VALUE_BOOLEAN:
+            wire_put_u8(buffer, value->data.boolean ? 1 : 0);
+            break;
+        case VALUE_STRING:
+            wire_put_string(buffer, value->data.string);
+            break;
+        default:
+            break;
+    }
+}
+
+size_t wire_begin_message(WireBuffer* buffer, MessageType type, uint32_t request) {
+    size_t start = buffer->length;
+    wire_put_u32(buffer, 0);
+    wire_put_u8(buffer, (uint8_t)type);
+    wire_put_u32(buffer, request);
+    return start;
+}
+
+void wire_end_message(WireBuffer* buffer, size_t start) {
+    if (buffer->failed) return;
+
+    uint32_t payload = (uint32_t)(buffer->length - start - PROTOCOL_HEADER_SIZE);
+    for (int i = 0; i < 4; i++) {
+        buffer->data[start + i] = (char)(payload >> (8 * i));
+    }
+}
+
+void wire_put_error(WireBuffer* buffer, uint32_t request, const char* message) {
+    size_t start = wire_begin_message(buffer, MESSAGE_ERROR, request);
+    wire_put_string(buffer, message);
+    wire_end_message(buffer, start);
+}
+
+static uint32_t read_u32(const unsigned char* bytes) {
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+FrameStatus wire_next_frame(const char* data, size_t length, WireFrame* frame) {
+    if (length < PROTOCOL_HEADER_SIZE) return FRAME_PARTIAL;
+
+    const unsigned char* header = (const unsigned char*)data;
+    uint32_t payload = read_u32(header);
+    if (payload > PROTOCOL_MAX_FRAME) return FRAME_INVALID;
+    if (length - PROTOCOL_HEADER_SIZE < payload) return FRAME_PARTIAL;
+
+    frame->type = (MessageType)header[4];
+    frame->request = read_u32(header + 5);
+    frame->payload.data = data + PROTOCOL_HEADER_SIZE;
+    frame->payload.length = payload;
+    frame->payload.position = 0;
+    frame->payload.failed = false;
+    frame->size = PROTOCOL_HEADER_SIZE + payload;
+    return FRAME_READY;
+}
+
+static const unsigned char* get_bytes(WireReader* reader, size_t length) {
+    if (reader->failed || reader->length - reader->position < length) {
+        reader->failed = true;
+        return NULL;
+    }
+    const unsigned char* bytes = (const unsigned char*)reader->data + reader->position;
+    reader->position += length;
+    return bytes;
+}
+
+uint8_t wire_get_u8(WireReader* reader) {
+    const unsigned char* bytes = get_bytes(reader, 1);
+    return bytes ? bytes[0] : 0;
+}
+
+uint32_t wire_get_u32(WireReader* reader) {
+    const unsigned char* bytes = get_bytes(reader, 4);
+    return bytes ? read_u32(bytes) : 0;
+}
+
+uint64_t wire_get_u64(WireReader* reader) {
+    const unsigned char* bytes = get_bytes(reader, 8);
+    if (!bytes) return 0;
+    return (uint64_t)read_u32(bytes) | (uint64_t)read_u32(bytes + 4) << 32;
+}
+
+double wire_get_f64(WireReader* reader) {
+    uint64_t bits = wire_get_u64(reader);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+char* wire_get_string(WireReader* reader) {
+    uint32_t length = wire_get_u32(reader);
+    const unsigned char* bytes = get_bytes(reader, length);
+    if (!bytes) return NULL;
+
+    char* text = malloc((size_t)length + 1);
+    if (!text) {
+        reader->failed = true;
+        return NULL;
+    }
+    memcpy(text, bytes, length);
+    text[length] = '\0';
+    return text;
+}
+
+bool wire_get_value(WireReader* reader, Value* out) {
+    uint8_t type = wire_get_u8(reader);
+    out->type = VALUE_NULL;
+
+    switch (type) {
+        case VALUE_INTEGER:
+            *out = value_integer((int64_t)wire_get_u64(reader));
+            break;
+        case VALUE_FLOAT:
+            *out = value_float(wire_get_f64(reader));
+            break;
+        case VALUE_BOOLEAN:
+            *out = value_boolean(wire_get_u8(reader) != 0);
+            break;
+        case VALUE_STRING: {
+            char* text = wire_get_string(reader);
+            if (!text) return false;
+            out->type = VALUE_STRING;
+            out->data.string = text;
+            break;
+        }
+        case VALUE_NULL:
+            break;
+        default:
+            reader->failed = true;
+            break;
+    }
+    return !reader->failed;
+}
+
+bool protocol_resolve_address(const char* address, struct sockaddr_storage* out, socklen_t* length,
+                              char* error, size_t error_size) {
+    memset(out, 0, sizeof(*out));
+
+    if (strncmp(address, "unix:", 5) == 0 || strchr(address, '/')) {
+        const char* path = strncmp(address, "unix:", 5) == 0 ? address + 5 : address;
+        struct sockaddr_un* local = (struct sockaddr_un*)out;
+        if (*path == '\0' || strlen(path) >= sizeof(local->sun_path)) {
+            snprintf(error, error_size, "Invalid socket path '%s'", path);
+            return false;
+        }
+        local->sun_family = AF_UNIX;
+        strcpy(local->sun_path, path);
+        *length = sizeof(struct sockaddr_un);
+        return true;
+    }
+
+    char host[INET_ADDRSTRLEN] = "127.0.0.1";
+    const char* port_text = address;
+    const char* colon = strrchr(address, ':');
+    if (colon) {
+        size_t host_length = (size_t)(colon - address);
+        if (host_length >= sizeof(host)) {
+            snprintf(error, error_size, "Invalid address '%s'", address);
+            return false;
+        }
+        memcpy(host, address, host_length);
+        host[host_length] = '\0';
+        port_text = colon + 1;
+    }
+
+    char* end;
+    unsigned long port = strtoul(port_text, &end, 10);
+    struct sockaddr_in* inet = (struct sockaddr_in*)out;
+    if (*port_text == '\0' || *end != '\0' || port == 0 || port > 65535 ||
+        inet_pton(AF_INET, host, &inet->sin_addr) != 1) {
+        snprintf(error, error_size, "Invalid address '%s'", address);
+        return false;
+    }
+    /* The protocol has no authentication, so it never leaves the machine. */
+    if ((ntohl(inet->sin_addr.s_addr) >> 24) != 127) {
+        snprintf(error, error_size, "Address '%s' is not a loopback address", address);
+        return false;
+    }
+    inet->sin_family = AF_INET;
+    inet->sin_port = htons((uint16_t)port);
+    *length = sizeof(struct sockaddr_in);
+    return true;
+}
@@ -0,0 +1,95 @@
+#ifndef SHADE_PROTOCOL_H
+#define SHADE_PROTOCOL_H
+
+#include "../types/value.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+/* Every frame is a u32 payload length, a u8 message type and a u32 request id followed by the
+ * payload. Integers are little-endian; strings are a u32 length and their bytes; values are a
+ * u8 ValueType and the same encoding as the binary export format. */
+#define PROTOCOL_HEADER_SIZE 9
+#define PROTOCOL_MAX_FRAME (16u << 20)
+#define PROTOCOL_ERROR_SIZE 256
+
+/* Clients number their requests and may send many before reading replies. Every reply frame
+ * carries the id of its request, and every request gets exactly one PREPARED, COMPLETE or ERROR
+ * reply; queries send COLUMNS and ROWS frames before their COMPLETE. Replies to different
+ * requests may finish out of order and their row batches may interleave. */
+typedef enum {
+    MESSAGE_PREPARE = 'P',   /* string sql */
+    MESSAGE_EXECUTE = 'E',   /* u32 statement, u32 count, values */
+    MESSAGE_CLOSE = 'C',     /* u32 statement */
+    MESSAGE_EXEC = 'X',      /* string: one shell statement */
+
+    MESSAGE_PREPARED = 'p',  /* u32 statement, u32 parameter count */
+    MESSAGE_COLUMNS = 'c',   /* u32 count, then a u8 type and string name per column */
+    MESSAGE_ROWS = 'r',      /* u32 count, then per row u64 id, u8 state, f64 strength, values */
+    MESSAGE_COMPLETE = 'k',  /* u64 rows returned or affected, u64 first inserted id */
+    MESSAGE_ERROR = 'e'      /* string message */
+} MessageType;
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} WireBuffer;
+
+typedef struct {
+    const char* data;
+    size_t length;
+    size_t position;
+    bool failed;
+} WireReader;
+
+typedef enum {
+    FRAME_PARTIAL,
+    FRAME_READY,
+    FRAME_INVALID
+} FrameStatus;
+
+typedef struct {
+    MessageType type;
+    uint32_t request;
+    WireReader payload;
+    size_t size;
+} WireFrame;
+
+void wire_buffer_init(WireBuffer* buffer);
+void wire_buffer_free(WireBuffer* buffer);
+bool wire_buffer_reserve(WireBuffer* buffer, size_t length);
+/* Drops the first length bytes, keeping the rest. */
+void wire_buffer_consume(WireBuffer* buffer, size_t length);
+
+/* Returns the offset to pass to wire_end_message once the payload has been written. */
+size_t wire_begin_message(WireBuffer* buffer, MessageType type, uint32_t request);
+void wire_end_message(WireBuffer* buffer, size_t start);
+
+void wire_put_u8(WireBuffer* buffer, uint8_t value);
+void wire_put_u32(WireBuffer* buffer, uint32_t value);
+void wire_put_u64(WireBuffer* buffer, uint64_t value);
+void wire_put_f64(WireBuffer* buffer, double value);
+void wire_put_string(WireBuffer* buffer, const char* text);
+void wire_put_value(WireBuffer* buffer, const Value* value);
+void wire_put_error(WireBuffer* buffer, uint32_t request, const char* message);
+
+/* Finds the frame at the start of data, which is frame->size bytes long when ready. */
+FrameStatus wire_next_frame(const char* data, size_t length, WireFrame* frame);
+
+uint8_t wire_get_u8(WireReader* reader);
+uint32_t wire_get_u32(WireReader* reader);
+uint64_t wire_get_u64(WireReader* reader);
+double wire_get_f64(WireReader* reader);
+/* Returns a malloc'd copy, or NULL if the payload is short. */
+char* wire_get_string(WireReader* reader);
+bool wire_get_value(WireReader* reader, Value* out);
+
+/* "unix:PATH" or anything containing '/' is a Unix socket; otherwise "[HOST:]PORT" over TCP,
+ * where HOST is an IPv4 loopback address and defaults to 127.0.0.1. */
+bool protocol_resolve_address(const char* address, struct sockaddr_storage* out, socklen_t* length,
+                              char* error, size_t error_size);
+
+#endif
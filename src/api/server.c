@@ -0,0 +1,929 @@
+#define _POSIX_C_SOURCE 200809L
+#include "server.h"
+#include "shard.h"
+#include "../query/command.h"
+#include "../query/parser.h"
+#include "../util/string_utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SERVER_READ_CHUNK 65536
+
+/* A query whose rows are encoded a batch at a time, only while the client keeps up. The
+ * statement reference keeps the schema the result borrows alive. */
+typedef struct {
+    uint32_t request;
+    PreparedStatement* statement;
+    QueryResult* result;
+    size_t next_row;
+} ResultStream;
+
+typedef struct Connection {
+    /* -1 once closed; a closed connection lingers until its last gather is answered. */
+    int fd;
+    WireBuffer input;
+    WireBuffer output;
+    uint32_t events;
+    bool input_closed;
+
+    ResultStream streams[SERVER_MAX_IN_FLIGHT];
+    size_t stream_count;
+    size_t next_stream;
+    size_t gathers;
+
+    /* Statement ids are slot indexes plus one; closed slots are reused. */
+    PreparedStatement** statements;
+    size_t statement_count;
+
+    struct Connection* prev;
+    struct Connection* next;
+} Connection;
+
+/* A request sent to one or more shards, answered once every one has replied. Queries keep their
+ * statement and a copy of their table's schema for the gather; inserts remember the shard given
+ * their first row, whose id they answer with. */
+typedef struct {
+    Connection* connection;
+    uint32_t request;
+    PreparedStatement* statement;
+    TableSchema* schema;
+    ShardTask* replies[SHARD_MAX_COUNT];
+    size_t expected;
+    size_t received;
+    size_t first_shard;
+} Gather;
+
+struct ShadeServer {
+    MemoryStorage* storage;
+    StatementCache* statements;
+    int listen_fd;
+    int epoll_fd;
+    int wake_fds[2];
+    char* socket_path;
+    Connection* connections;
+    /* When set, storage only holds the empty tables the router prepares statements against. */
+    ShardPool* shards;
+    volatile bool running;
+};
+
+static bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool watch(ShadeServer* server, int fd, uint32_t events, void* tag, int operation) {
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.ptr = tag;
+    return epoll_ctl(server->epoll_fd, operation, fd, &event) == 0;
+}
+
+ShadeServer* server_create(MemoryStorage* storage, StatementCache* statements, const char* address,
+                           char* error, size_t error_size) {
+    return server_create_sharded(storage, statements, address, 0, error, error_size);
+}
+
+/* Clears a socket left behind by an earlier server; any other file at the path is the user's. */
+static bool clear_socket_path(const char* path, const char* address, char* error, size_t error_size) {
+    struct stat info;
+    if (lstat(path, &info) != 0) return true;
+
+    if (!S_ISSOCK(info.st_mode)) {
+        snprintf(error, error_size, "Cannot listen on '%s': address in use", address);
+        return false;
+    }
+    unlink(path);
+    return true;
+}
+
+ShadeServer* server_create_sharded(MemoryStorage* storage, StatementCache* statements, const char* address,
+                                   size_t shard_count, char* error, size_t error_size) {
+    struct sockaddr_storage socket_address;
+    socklen_t address_length;
+    if (!storage || !statements || !address) {
+        snprintf(error, error_size, "Invalid parameters");
+        return NULL;
+    }
+    if (shard_count > 0 && storage->table_count > 0) {
+        snprintf(error, error_size, "Shards must start from an empty database");
+        return NULL;
+    }
+    if (!protocol_resolve_address(address, &socket_address, &address_length, error, error_size)) return NULL;
+
+    ShadeServer* server = calloc(1, sizeof(ShadeServer));
+    if (!server) {
+        snprintf(error, error_size, "Out of memory");
+        return NULL;
+    }
+    server->storage = storage;
+    server->statements = statements;
+    server->listen_fd = -1;
+    server->epoll_fd = -1;
+    server->wake_fds[0] = server->wake_fds[1] = -1;
+
+    int family = socket_address.ss_family;
+    const char* path = ((struct sockaddr_un*)&socket_address)->sun_path;
+    if (family == AF_UNIX && !clear_socket_path(path, address, error, error_size)) {
+        server_destroy(server);
+        return NULL;
+    }
+
+    /* The socket file is ours to remove only once bind has made it. */
+    int reuse = 1;
+    server->listen_fd = socket(family, SOCK_STREAM, 0);
+    bool bound = server->listen_fd >= 0 &&
+                 (family != AF_INET ||
+                  setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == 0) &&
+                 bind(server->listen_fd, (struct sockaddr*)&socket_address, address_length) == 0;
+    if (bound && family == AF_UNIX) server->socket_path = string_duplicate(path);
+    if (!bound || listen(server->listen_fd, SOMAXCONN) != 0 || !set_nonblocking(server->listen_fd)) {
+        snprintf(error, error_size, "Cannot listen on '%s': %s", address, strerror(errno));
+        server_destroy(server);
+        return NULL;
+    }
+
+    server->epoll_fd = epoll_create1(0);
+    if (server->epoll_fd < 0 || pipe(server->wake_fds) != 0 || !set_nonblocking(server->wake_fds[1]) ||
+        !watch(server, server->listen_fd, EPOLLIN, NULL, EPOLL_CTL_ADD) ||
+        !watch(server, server->wake_fds[0], EPOLLIN, server, EPOLL_CTL_ADD)) {
+        snprintf(error, error_size, "Cannot start event loop: %s", strerror(errno));
+        server_destroy(server);
+        return NULL;
+    }
+
+    if (shard_count > 0) {
+        server->shards = shard_pool_create(shard_count, error, error_size);
+        if (!server->shards ||
+            !watch(server, shard_pool_reply_fd(server->shards), EPOLLIN, server->shards, EPOLL_CTL_ADD)) {
+            if (server->shards) snprintf(error, error_size, "Cannot start event loop: %s", strerror(errno));
+            server_destroy(server);
+            return NULL;
+        }
+    }
+
+    return server;
+}
+
+static void stream_finish(ResultStream* stream) {
+    queryresult_destroy(stream->result);
+    statement_release(stream->statement);
+}
+
+static void connection_close(ShadeServer* server, Connection* connection) {
+    if (connection->fd >= 0) {
+        epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+        close(connection->fd);
+        connection->fd = -1;
+
+        for (size_t i = 0; i < connection->stream_count; i++) {
+            stream_finish(&connection->streams[i]);
+        }
+        connection->stream_count = 0;
+
+        for (size_t i = 0; i < connection->statement_count; i++) {
+            statement_release(connection->statements[i]);
+        }
+        free(connection->statements);
+        connection->statements = NULL;
+        connection->statement_count = 0;
+        wire_buffer_free(&connection->input);
+        wire_buffer_free(&connection->output);
+    }
+    if (connection->gathers > 0) return;
+
+    if (connection->prev) connection->prev->next = connection->next;
+    else server->connections = connection->next;
+    if (connection->next) connection->next->prev = connection->prev;
+    free(connection);
+}
+
+static void accept_connections(ShadeServer* server) {
+    for (;;) {
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+
+        int nodelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+        Connection* connection = calloc(1, sizeof(Connection));
+        if (!connection || !set_nonblocking(fd) || !watch(server, fd, EPOLLIN, connection, EPOLL_CTL_ADD)) {
+            free(connection);
+            close(fd);
+            continue;
+        }
+        connection->fd = fd;
+        connection->events = EPOLLIN;
+        wire_buffer_init(&connection->input);
+        wire_buffer_init(&connection->output);
+
+        connection->next = server->connections;
+        if (server->connections) server->connections->prev = connection;
+        server->connections = connection;
+    }
+}
+
+static void send_complete(WireBuffer* out, uint32_t request, uint64_t rows, uint64_t first_id) {
+    size_t start = wire_begin_message(out, MESSAGE_COMPLETE, request);
+    wire_put_u64(out, rows);
+    wire_put_u64(out, first_id);
+    wire_end_message(out, start);
+}
+
+/* Sends the column header now and leaves the rows to pump_streams; takes over the reference. */
+static void start_stream(Connection* connection, uint32_t request, PreparedStatement* statement,
+                         QueryResult* result) {
+    WireBuffer* out = &connection->output;
+    size_t start = wire_begin_message(out, MESSAGE_COLUMNS, request);
+    wire_put_u32(out, (uint32_t)result->column_count);
+    for (size_t i = 0; i < result->column_count; i++) {
+        const ColumnSchema* column = &result->schema->columns[result->column_map[i]];
+        wire_put_u8(out, (uint8_t)column->type);
+        wire_put_string(out, column->name);
+    }
+    wire_end_message(out, start);
+
+    ResultStream* stream = &connection->streams[connection->stream_count++];
+    stream->request = request;
+    stream->statement = statement;
+    stream->result = result;
+    stream->next_row = 0;
+}
+
+/* Encodes one ROWS frame, or the COMPLETE frame once every row is out; true when finished. */
+static bool stream_next_batch(WireBuffer* out, ResultStream* stream) {
+    QueryResult* result = stream->result;
+    if (stream->next_row == result->count) {
+        send_complete(out, stream->request, result->count, 0);
+        return true;
+    }
+
+    size_t count = result->count - stream->next_row;
+    if (count > SERVER_ROW_BATCH) count = SERVER_ROW_BATCH;
+
+    size_t start = wire_begin_message(out, MESSAGE_ROWS, stream->request);
+    wire_put_u32(out, (uint32_t)count);
+    for (size_t r = stream->next_row; r < stream->next_row + count; r++) {
+        const DataRecord* record = result->records[r];
+        wire_put_u64(out, record->id);
+        wire_put_u8(out, (uint8_t)record->state);
+        wire_put_f64(out, record->ghost_strength);
+        for (size_t i = 0; i < result->column_count; i++) {
+            wire_put_value(out, &record->values[result->column_map[i]]);
+        }
+    }
+    wire_end_message(out, start);
+
+    stream->next_row += count;
+    return false;
+}
+
+/* Takes turns between the connection's streams until the output reaches high_water or the
+ * budget of frames runs out; returns whether anything was encoded. */
+static bool pump_streams(Connection* connection, size_t* budget, size_t high_water) {
+    bool progressed = false;
+
+    while (connection->stream_count > 0 && *budget > 0 && connection->output.length < high_water) {
+        if (connection->next_stream >= connection->stream_count) connection->next_stream = 0;
+
+        ResultStream* stream = &connection->streams[connection->next_stream];
+        if (stream_next_batch(&connection->output, stream)) {
+            stream_finish(stream);
+            connection->stream_count--;
+            memmove(stream, stream + 1, sizeof(ResultStream) * (connection->stream_count - connection->next_stream));
+        } else {
+            connection->next_stream++;
+        }
+        (*budget)--;
+        progressed = true;
+    }
+    return progressed;
+}
+
+/* Rows borrow records and schemas from the tables, so every stream must be written out before
+ * any table goes away. */
+static void finish_all_streams(ShadeServer* server) {
+    for (Connection* connection = server->connections; connection; connection = connection->next) {
+        size_t budget = SIZE_MAX;
+        pump_streams(connection, &budget, SIZE_MAX);
+    }
+}
+
+/* Sends a task to every shard, or only to `only` unless it is SIZE_MAX. */
+static void scatter(ShadeServer* server, Connection* connection, uint32_t request, ShardTaskType type,
+                    const char* text, PreparedStatement* statement, const Value* parameters, size_t parameter_count,
+                    size_t only) {
+    size_t count = only == SIZE_MAX ? shard_pool_count(server->shards) : 1;
+    Gather* gather = calloc(1, sizeof(Gather));
+    ShardTask* tasks[SHARD_MAX_COUNT];
+    size_t created = 0;
+
+    bool ready = gather != NULL;
+    if (ready && statement) {
+        const TableSchema* schema = statement->schema;
+        gather->schema = tableschema_create(schema->name, schema->columns, schema->column_count);
+        ready = gather->schema != NULL;
+    }
+    while (ready && created < count) {
+        tasks[created] = shard_task_create(type, gather, text, parameters, parameter_count);
+        ready = tasks[created] != NULL;
+        if (ready) created++;
+    }
+    if (!ready) {
+        for (size_t i = 0; i < created; i++) {
+            shard_task_destroy(tasks[i]);
+        }
+        if (gather) tableschema_destroy(gather->schema);
+        free(gather);
+        wire_put_error(&connection->output, request, "Out of memory");
+        return;
+    }
+
+    gather->connection = connection;
+    gather->request = request;
+    gather->statement = statement;
+    gather->expected = count;
+    statement_retain(statement);
+    connection->gathers++;
+
+    for (size_t i = 0; i < count; i++) {
+        shard_pool_submit(server->shards, only == SIZE_MAX ? i : only, tasks[i]);
+    }
+}
+
+/* Joined rows would have to meet on one shard, and a plan differs per shard. */
+static void scatter_query(ShadeServer* server, Connection* connection, uint32_t request,
+                          PreparedStatement* statement, const Value* parameters) {
+    char error[PARSER_ERROR_SIZE];
+    Query* query = statement->query;
+    if (query->join) {
+        wire_put_error(&connection->output, request, "Joins are not supported across shards");
+        return;
+    }
+    if (query->explain != EXPLAIN_NONE) {
+        wire_put_error(&connection->output, request, "EXPLAIN is not supported across shards");
+        return;
+    }
+
+    /* Binding checks the parameters here and lets a lookup by _id or key go to the one shard
+     * that can hold it. */
+    if (!statement_bind_parameters(statement, parameters, error, sizeof(error))) {
+        wire_put_error(&connection->output, request, error);
+        return;
+    }
+    scatter(server, connection, request, query_is_aggregate(query) ? SHARD_TASK_AGGREGATE : SHARD_TASK_SELECT,
+            statement->text, statement, parameters, query->parameter_count, shard_pool_route(server->shards, query));
+}
+
+/* Hands each shard the rows whose first value it owns, moving them out of the command. */
+static void scatter_insert(ShadeServer* server, Connection* connection, uint32_t request, Command* command) {
+    char error[PARSER_ERROR_SIZE];
+    if (!command_coerce_rows(server->storage, command, error, sizeof(error))) {
+        wire_put_error(&connection->output, request, error);
+        return;
+    }
+
+    size_t shard_count = shard_pool_count(server->shards);
+    size_t* owners = malloc(sizeof(size_t) * (command->row_count ? command->row_count : 1));
+    size_t counts[SHARD_MAX_COUNT] = {0};
+    ShardTask* tasks[SHARD_MAX_COUNT] = {0};
+    Gather* gather = calloc(1, sizeof(Gather));
+
+    bool ready = owners && gather;
+    for (size_t r = 0; ready && r < command->row_count; r++) {
+        owners[r] = shard_pool_owner(server->shards, &command->rows[r][0]);
+        counts[owners[r]]++;
+    }
+    for (size_t i = 0; ready && i < shard_count; i++) {
+        if (counts[i] == 0) continue;
+        tasks[i] = shard_task_create(SHARD_TASK_INSERT, gather, command->table_name, NULL, 0);
+        if (tasks[i]) tasks[i]->rows = malloc(sizeof(Value*) * counts[i]);
+        ready = tasks[i] && tasks[i]->rows;
+    }
+    if (!ready) {
+        for (size_t i = 0; i < shard_count; i++) {
+            shard_task_destroy(tasks[i]);
+        }
+        free(owners);
+        free(gather);
+        wire_put_error(&connection->output, request, "Out of memory");
+        return;
+    }
+
+    for (size_t r = 0; r < command->row_count; r++) {
+        ShardTask* task = tasks[owners[r]];
+        task->rows[task->count++] = command->rows[r];
+        task->row_width = command->row_width;
+    }
+    gather->first_shard = owners[0];
+    free(owners);
+    free(command->rows);
+    command->rows = NULL;
+    command->row_count = 0;
+
+    gather->connection = connection;
+    gather->request = request;
+    connection->gathers++;
+    for (size_t i = 0; i < shard_count; i++) {
+        if (!tasks[i]) continue;
+        gather->expected++;
+        shard_pool_submit(server->shards, i, tasks[i]);
+    }
+}
+
+/* Answers the request and frees the gather; returns false if its connection is gone. */
+static bool finish_gather(ShadeServer* server, Gather* gather) {
+    Connection* connection = gather->connection;
+    ShardTask* first = gather->replies[0];
+    char error[PARSER_ERROR_SIZE];
+
+    if (connection->fd >= 0 && gather->statement) {
+        QueryResult* result = shard_gather(gather->statement, gather->schema, gather->replies, gather->received,
+                                           error, sizeof(error));
+        gather->schema = NULL;
+        if (result) {
+            start_stream(connection, gather->request, gather->statement, result);
+            gather->statement = NULL;
+        } else {
+            wire_put_error(&connection->output, gather->request, error);
+        }
+    } else if (connection->fd >= 0) {
+        const ShardTask* failed = NULL;
+        for (size_t i = 0; i < gather->received && !failed; i++) {
+            if (gather->replies[i]->failed) failed = gather->replies[i];
+        }
+        size_t inserted = 0;
+        uint64_t first_id = 0;
+        for (size_t i = 0; i < gather->received && first->type == SHARD_TASK_INSERT; i++) {
+            inserted += gather->replies[i]->count;
+            if (gather->replies[i]->shard == gather->first_shard) first_id = gather->replies[i]->first_id;
+        }
+        if (failed) {
+            wire_put_error(&connection->output, gather->request, failed->error);
+        } else {
+            send_complete(&connection->output, gather->request, inserted, first_id);
+        }
+    }
+
+    statement_release(gather->statement);
+    tableschema_destroy(gather->schema);
+    for (size_t i = 0; i < gather->received; i++) {
+        shard_task_destroy(gather->replies[i]);
+    }
+    free(gather);
+
+    connection->gathers--;
+    if (connection->fd >= 0) return true;
+    if (connection->gathers == 0) connection_close(server, connection);
+    return false;
+}
+
+/* Returns the gather a reply completes, or NULL while it still waits for others. */
+static Gather* collect_reply(ShardTask* task) {
+    Gather* gather = task->owner;
+    gather->replies[gather->received++] = task;
+    return gather->received == gather->expected ? gather : NULL;
+}
+
+static void execute_statement(ShadeServer* server, Connection* connection, uint32_t request,
+                              PreparedStatement* statement, const Value* parameters) {
+    if (server->shards) {
+        scatter_query(server, connection, request, statement, parameters);
+        return;
+    }
+
+    char error[PARSER_ERROR_SIZE];
+    QueryResult* result = statement_execute(statement, parameters, error, sizeof(error));
+    if (!result) {
+        wire_put_error(&connection->output, request, error);
+        return;
+    }
+
+    statement_retain(statement);
+    start_stream(connection, request, statement, result);
+}
+
+static void handle_prepare(ShadeServer* server, Connection* connection, WireFrame* frame) {
+    WireBuffer* out = &connection->output;
+    char* sql = wire_get_string(&frame->payload);
+    if (!sql) {
+        wire_put_error(out, frame->request, "Malformed message");
+        return;
+    }
+
+    char error[PARSER_ERROR_SIZE];
+    PreparedStatement* statement = statement_prepare(server->statements, server->storage, sql, error, sizeof(error));
+    free(sql);
+    if (!statement) {
+        wire_put_error(out, frame->request, error);
+        return;
+    }
+
+    size_t slot = 0;
+    while (slot < connection->statement_count && connection->statements[slot]) {
+        slot++;
+    }
+    if (slot == connection->statement_count) {
+        PreparedStatement** statements = realloc(connection->statements,
+                                                 sizeof(PreparedStatement*) * (connection->statement_count + 1));
+        if (!statements) {
+            statement_release(statement);
+            wire_put_error(out, frame->request, "Out of memory");
+            return;
+        }
+        connection->statements = statements;
+        connection->statement_count++;
+    }
+    connection->statements[slot] = statement;
+
+    size_t start = wire_begin_message(out, MESSAGE_PREPARED, frame->request);
+    wire_put_u32(out, (uint32_t)(slot + 1));
+    wire_put_u32(out, (uint32_t)statement->query->parameter_count);
+    wire_end_message(out, start);
+}
+
+static PreparedStatement** find_statement(Connection* connection, uint32_t id) {
+    if (id == 0 || id > connection->statement_count || !connection->statements[id - 1]) return NULL;
+    return &connection->statements[id - 1];
+}
+
+static void handle_execute(ShadeServer* server, Connection* connection, WireFrame* frame) {
+    WireBuffer* out = &connection->output;
+    WireReader* reader = &frame->payload;
+    PreparedStatement** slot = find_statement(connection, wire_get_u32(reader));
+    uint32_t count = wire_get_u32(reader);
+    if (!slot) {
+        wire_put_error(out, frame->request, "Unknown statement");
+        return;
+    }
+
+    char error[PARSER_ERROR_SIZE];
+    PreparedStatement* statement = statement_refresh(server->statements, server->storage, *slot, error, sizeof(error));
+    if (!statement) {
+        wire_put_error(out, frame->request, error);
+        return;
+    }
+    *slot = statement;
+
+    if (count != statement->query->parameter_count || count > reader->length) {
+        snprintf(error, sizeof(error), "Expected %zu parameters, got %u", statement->query->parameter_count, count);
+        wire_put_error(out, frame->request, error);
+        return;
+    }
+
+    Value* parameters = calloc(count ? count : 1, sizeof(Value));
+    if (!parameters) {
+        wire_put_error(out, frame->request, "Out of memory");
+        return;
+    }
+
+    uint32_t decoded = 0;
+    while (decoded < count && wire_get_value(reader, &parameters[decoded])) {
+        decoded++;
+    }
+
+    if (decoded < count) {
+        wire_put_error(out, frame->request, "Malformed message");
+    } else {
+        execute_statement(server, connection, frame->request, statement, parameters);
+    }
+
+    for (uint32_t i = 0; i < decoded; i++) {
+        value_destroy(&parameters[i]);
+    }
+    free(parameters);
+}
+
+static void handle_close(Connection* connection, WireFrame* frame) {
+    PreparedStatement** slot = find_statement(connection, wire_get_u32(&frame->payload));
+    if (!slot) {
+        wire_put_error(&connection->output, frame->request, "Unknown statement");
+        return;
+    }
+
+    statement_release(*slot);
+    *slot = NULL;
+    send_complete(&connection->output, frame->request, 0, 0);
+}
+
+/* Schema changes apply to the router's empty tables first and then to every shard, which answer
+ * for the request. */
+static void complete_command(ShadeServer* server, Connection* connection, uint32_t request, const char* text) {
+    if (server->shards) {
+        scatter(server, connection, request, SHARD_TASK_COMMAND, text, NULL, NULL, 0, SIZE_MAX);
+    } else {
+        send_complete(&connection->output, request, 0, 0);
+    }
+}
+
+static void run_command(ShadeServer* server, Connection* connection, uint32_t request, Command* command,
+                        const char* text) {
+    WireBuffer* out = &connection->output;
+    char error[PARSER_ERROR_SIZE];
+
+    switch (command->type) {
+        case COMMAND_EMPTY:
+            send_complete(out, request, 0, 0);
+            return;
+        case COMMAND_QUERY: {
+            PreparedStatement* statement = statement_prepare(server->statements, server->storage, command->text,
+                                                             error, sizeof(error));
+            if (!statement) {
+                wire_put_error(out, request, error);
+            } else if (statement->query->parameter_count > 0) {
+                wire_put_error(out, request, "Statement has parameters; prepare it first");
+            } else {
+                execute_statement(server, connection, request, statement, NULL);
+            }
+            statement_release(statement);
+            return;
+        }
+        case COMMAND_CREATE_TABLE:
+            if (command_create_table(server->storage, command, error, sizeof(error))) {
+                complete_command(server, connection, request, text);
+            } else {
+                wire_put_error(out, request, error);
+            }
+            return;
+        case COMMAND_DROP_TABLE:
+            /* Gathered rows are copies that outlive the table. */
+            if (!server->shards) finish_all_streams(server);
+            if (!memory_storage_drop_table(server->storage, command->table_name)) {
+                snprintf(error, sizeof(error), "Table '%s' not found", command->table_name);
+                wire_put_error(out, request, error);
+                return;
+            }
+            statement_cache_invalidate(server->statements);
+            complete_command(server, connection, request, text);
+            return;
+        case COMMAND_INSERT: {
+            if (server->shards) {
+                scatter_insert(server, connection, request, command);
+                return;
+            }
+            size_t row_count = command->row_count;
+            uint64_t first_id = command_insert(server->storage, command, error, sizeof(error));
+            if (first_id == 0) {
+                wire_put_error(out, request, error);
+            } else {
+                send_complete(out, request, row_count, first_id);
+            }
+            return;
+        }
+        case COMMAND_ANALYZE:
+            if (command_analyze(server->storage, command->table_name, error, sizeof(error))) {
+                complete_command(server, connection, request, text);
+            } else {
+                wire_put_error(out, request, error);
+            }
+            return;
+        case COMMAND_SAVE:
+            if (memory_storage_save(server->storage)) {
+                send_complete(out, request, 0, 0);
+            } else {
+                wire_put_error(out, request, "No persistent database in use");
+            }
+            return;
+        default:
+            wire_put_error(out, request, "Statement is not supported by the server");
+            return;
+    }
+}
+
+static void handle_exec(ShadeServer* server, Connection* connection, WireFrame* frame) {
+    WireBuffer* out = &connection->output;
+    char* text = wire_get_string(&frame->payload);
+    if (!text) {
+        wire_put_error(out, frame->request, "Malformed message");
+        return;
+    }
+
+    char error[PARSER_ERROR_SIZE];
+    const char* end;
+    Command* command = parse_command(text, &end, error, sizeof(error));
+    if (!command) {
+        wire_put_error(out, frame->request, error);
+    } else if (*end != '\0') {
+        wire_put_error(out, frame->request, "Send one statement per message");
+    } else {
+        run_command(server, connection, frame->request, command, text);
+    }
+
+    command_destroy(command);
+    free(text);
+}
+
+/* New requests wait in the socket, pushing back on the client, while the connection already has
+ * a full set of queries in flight, streaming or waiting on shards, or a full output buffer. */
+static bool accepting_requests(const Connection* connection) {
+    return connection->stream_count + connection->gathers < SERVER_MAX_IN_FLIGHT &&
+           connection->output.length < SERVER_HIGH_WATER;
+}
+
+/* Answers complete frames from the input buffer while the budget lasts; false means the stream
+ * is unusable. */
+static bool process_input(ShadeServer* server, Connection* connection, size_t* budget, bool* progressed) {
+    size_t offset = 0;
+
+    while (*budget > 0 && accepting_requests(connection)) {
+        WireFrame frame;
+        FrameStatus status = wire_next_frame(connection->input.data + offset, connection->input.length - offset, &frame);
+        if (status == FRAME_INVALID) return false;
+        if (status == FRAME_PARTIAL) break;
+
+        switch (frame.type) {
+            case MESSAGE_PREPARE: handle_prepare(server, connection, &frame); break;
+            case MESSAGE_EXECUTE: handle_execute(server, connection, &frame); break;
+            case MESSAGE_CLOSE: handle_close(connection, &frame); break;
+            case MESSAGE_EXEC: handle_exec(server, connection, &frame); break;
+            default: wire_put_error(&connection->output, frame.request, "Unknown message type"); break;
+        }
+        offset += frame.size;
+        (*budget)--;
+        *progressed = true;
+    }
+
+    wire_buffer_consume(&connection->input, offset);
+    return !connection->output.failed;
+}
+
+/* Returns false once the peer has stopped sending or nothing more is available. */
+static bool read_input(Connection* connection) {
+    if (!wire_buffer_reserve(&connection->input, SERVER_READ_CHUNK)) {
+        connection->input_closed = true;
+        return false;
+    }
+
+    WireBuffer* input = &connection->input;
+    ssize_t received;
+    do {
+        received = read(connection->fd, input->data + input->length, input->capacity - input->length);
+    } while (received < 0 && errno == EINTR);
+
+    if (received > 0) {
+        input->length += (size_t)received;
+        return true;
+    }
+    if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) connection->input_closed = true;
+    return false;
+}
+
+static bool write_output(Connection* connection) {
+    WireBuffer* output = &connection->output;
+    size_t sent = 0;
+
+    while (sent < output->length) {
+        ssize_t written = send(connection->fd, output->data + sent, output->length - sent, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        sent += (size_t)written;
+    }
+    wire_buffer_consume(output, sent);
+    return true;
+}
+
+/* Reads, answers, streams and writes in turns until the connection would block or has used its
+ * share of the loop; returns false when it should be closed. */
+static bool service(ShadeServer* server, Connection* connection, bool readable) {
+    size_t budget = SERVER_FRAMES_PER_TURN;
+
+    for (;;) {
+        bool progressed = false;
+        if (readable && !connection->input_closed && accepting_requests(connection)) {
+            readable = read_input(connection);
+            progressed = readable;
+        }
+        if (!process_input(server, connection, &budget, &progressed)) return false;
+        if (pump_streams(connection, &budget, SERVER_HIGH_WATER)) progressed = true;
+        if (!write_output(connection)) return false;
+
+        if (!progressed || budget == 0 || connection->output.length >= SERVER_HIGH_WATER) break;
+    }
+
+    if (connection->input_closed && connection->stream_count == 0 && connection->gathers == 0 &&
+        connection->output.length == 0) {
+        return false;
+    }
+
+    /* Leftover budget-limited work asks to be woken as soon as the socket is writable. */
+    uint32_t events = 0;
+    if (!connection->input_closed && accepting_requests(connection)) events |= EPOLLIN;
+    if (connection->output.length > 0 || budget == 0) events |= EPOLLOUT;
+    if (events == connection->events) return true;
+
+    connection->events = events;
+    return watch(server, connection->fd, events, connection, EPOLL_CTL_MOD);
+}
+
+/* Answers every gather whose last reply has arrived. Servicing a connection may close it, so
+ * this runs after the loop has handled the connections' own events. */
+static void handle_replies(ShadeServer* server) {
+    uint64_t wakeups;
+    ssize_t ignored = read(shard_pool_reply_fd(server->shards), &wakeups, sizeof(wakeups));
+    (void)ignored;
+
+    ShardTask* task;
+    while ((task = shard_pool_next_reply(server->shards))) {
+        Gather* gather = collect_reply(task);
+        if (!gather) continue;
+
+        Connection* connection = gather->connection;
+        if (finish_gather(server, gather) && !service(server, connection, false)) {
+            connection_close(server, connection);
+        }
+    }
+}
+
+bool server_run(ShadeServer* server) {
+    if (!server) return false;
+
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    server->running = true;
+
+    while (server->running) {
+        int ready = epoll_wait(server->epoll_fd, events, SERVER_MAX_EVENTS, -1);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+
+        bool replies = false;
+        for (int i = 0; i < ready; i++) {
+            void* tag = events[i].data.ptr;
+            if (tag == NULL) {
+                accept_connections(server);
+                continue;
+            }
+            if (tag == server) {
+                server->running = false;
+                continue;
+            }
+            if (tag == server->shards) {
+                replies = true;
+                continue;
+            }
+
+            Connection* connection = tag;
+            bool open = !(events[i].events & EPOLLERR) &&
+                        service(server, connection, (events[i].events & (EPOLLIN | EPOLLHUP)) != 0);
+            if (!open) connection_close(server, connection);
+        }
+
+        if (replies) handle_replies(server);
+        /* One wakeup per shard for everything this turn sent it. */
+        if (server->shards) shard_pool_kick(server->shards);
+    }
+    return true;
+}
+
+void server_stop(ShadeServer* server) {
+    if (!server || server->wake_fds[1] < 0) return;
+
+    char byte = 1;
+    ssize_t ignored = write(server->wake_fds[1], &byte, 1);
+    (void)ignored;
+}
+
+void server_destroy(ShadeServer* server) {
+    if (!server) return;
+
+    /* Every task comes back once the shards stop; the answers go nowhere. */
+    if (server->shards) {
+        shard_pool_stop(server->shards);
+        ShardTask* task;
+        while ((task = shard_pool_next_reply(server->shards))) {
+            Gather* gather = collect_reply(task);
+            if (gather) finish_gather(server, gather);
+        }
+        shard_pool_destroy(server->shards);
+    }
+
+    while (server->connections) {
+        connection_close(server, server->connections);
+    }
+    if (server->listen_fd >= 0) close(server->listen_fd);
+    if (server->epoll_fd >= 0) close(server->epoll_fd);
+    for (int i = 0; i < 2; i++) {
+        if (server->wake_fds[i] >= 0) close(server->wake_fds[i]);
+    }
+    if (server->socket_path) {
+        unlink(server->socket_path);
+        free(server->socket_path);
+    }
+    free(server);
+}
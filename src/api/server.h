@@ -0,0 +1,36 @@
+#ifndef SHADE_SERVER_H
+#define SHADE_SERVER_H
+
+#include "../storage/memory.h"
+#include "../query/statement.h"
+#include "protocol.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SERVER_MAX_EVENTS 64
+#define SERVER_ROW_BATCH 256
+/* Flow control: a connection stops taking requests at this many queries still streaming rows or
+ * this many unsent bytes, and gets this many frames per turn of the event loop. */
+#define SERVER_MAX_IN_FLIGHT 64
+#define SERVER_HIGH_WATER (1 << 20)
+#define SERVER_FRAMES_PER_TURN 64
+
+typedef struct ShadeServer ShadeServer;
+
+/* Listens on address (see protocol_resolve_address) and serves storage from a single thread;
+ * statements prepared by any connection share the cache. */
+ShadeServer* server_create(MemoryStorage* storage, StatementCache* statements, const char* address,
+                           char* error, size_t error_size);
+/* Spreads the tables over shard_count pinned worker threads, each owning a partition of every
+ * table, while this thread routes requests and gathers their answers; storage must be empty and
+ * only keeps the table definitions. Joins and EXPLAIN are refused. */
+ShadeServer* server_create_sharded(MemoryStorage* storage, StatementCache* statements, const char* address,
+                                   size_t shard_count, char* error, size_t error_size);
+/* Runs the event loop until server_stop; returns false if it failed to wait for events. */
+bool server_run(ShadeServer* server);
+/* Safe to call from a signal handler or another thread. */
+void server_stop(ShadeServer* server);
+/* Closes every connection and removes the Unix socket file. */
+void server_destroy(ShadeServer* server);
+
+#endif
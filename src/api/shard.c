@@ -0,0 +1,596 @@
+#define _GNU_SOURCE
+#include "shard.h"
+#include "../query/command.h"
+#include "../query/parser.h"
+#include "../util/hash.h"
+#include "../util/parallel.h"
+#include "../util/spsc.h"
+#include "../util/string_utils.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+/* How long a shard waits for the router to make room for its answers before trying again. */
+#define SHARD_REPLY_RETRY_NS 50000
+
+typedef struct {
+    ShardPool* pool;
+    size_t index;
+    MemoryStorage* storage;
+    StatementCache* statements;
+    SpscQueue requests;
+    SpscQueue replies;
+    int wake_fd;
+    pthread_t thread;
+    bool started;
+
+    /* Shard side: answers waiting for room in the replies ring. */
+    ShardTask* unsent;
+    ShardTask* unsent_tail;
+
+    /* Router side: tasks waiting for room in the requests ring, and whether any were pushed
+     * since the shard was last woken. */
+    ShardTask* backlog;
+    ShardTask* backlog_tail;
+    bool kick;
+} Shard;
+
+struct ShardPool {
+    Shard shards[SHARD_MAX_COUNT];
+    size_t count;
+    int reply_fd;
+    size_t next_reply;
+    bool stopping;
+    bool stopped;
+};
+
+ShardTask* shard_task_create(ShardTaskType type, void* owner, const char* text,
+                             const Value* parameters, size_t parameter_count) {
+    ShardTask* task = calloc(1, sizeof(ShardTask));
+    if (!task) return NULL;
+
+    task->type = type;
+    task->owner = owner;
+    task->text = string_duplicate(text);
+    task->parameters = parameter_count > 0 ? calloc(parameter_count, sizeof(Value)) : NULL;
+    if (!task->text || (parameter_count > 0 && !task->parameters)) {
+        shard_task_destroy(task);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < parameter_count; i++) {
+        task->parameters[i] = value_clone(&parameters[i]);
+        task->parameter_count++;
+        if (task->parameters[i].type == VALUE_STRING && !task->parameters[i].data.string) {
+            shard_task_destroy(task);
+            return NULL;
+        }
+    }
+    return task;
+}
+
+void shard_task_destroy(ShardTask* task) {
+    if (!task) return;
+
+    for (size_t i = 0; i < task->parameter_count; i++) {
+        value_destroy(&task->parameters[i]);
+    }
+    for (size_t i = 0; i < task->count && task->records; i++) {
+        if (task->records[i]) datarecord_destroy(task->records[i]);
+    }
+    for (size_t r = 0; r < task->count && task->rows; r++) {
+        for (size_t i = 0; i < task->row_width; i++) {
+            value_destroy(&task->rows[r][i]);
+        }
+        free(task->rows[r]);
+    }
+    free(task->rows);
+    free(task->parameters);
+    free(task->records);
+    free(task->text);
+    free(task);
+}
+
+static void signal_fd(int fd) {
+    uint64_t one = 1;
+    ssize_t ignored = write(fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+static void fail_task(ShardTask* task, const char* message) {
+    task->failed = true;
+    snprintf(task->error, sizeof(task->error), "%s", message);
+}
+
+/* Rows needed to cover OFFSET plus LIMIT, or SIZE_MAX when unlimited. */
+static size_t window_end(const Query* query) {
+    if (!query->has_limit) return SIZE_MAX;
+    return query->limit > SIZE_MAX - query->offset ? SIZE_MAX : query->offset + query->limit;
+}
+
+static DataRecord* copy_record(const DataRecord* record) {
+    DataRecord* copy = datarecord_create(record->id, record->values, record->value_count);
+    if (!copy) return NULL;
+
+    copy->state = record->state;
+    copy->deleted_at = record->deleted_at;
+    copy->ghost_strength = record->ghost_strength;
+    return copy;
+}
+
+static void run_command(Shard* shard, ShardTask* task) {
+    const char* end;
+    Command* command = parse_command(task->text, &end, task->error, sizeof(task->error));
+    if (!command) {
+        task->failed = true;
+        return;
+    }
+
+    if (*end != '\0') {
+        fail_task(task, "Send one statement per message");
+    } else if (command->type == COMMAND_CREATE_TABLE) {
+        task->failed = !command_create_table(shard->storage, command, task->error, sizeof(task->error));
+    } else if (command->type == COMMAND_DROP_TABLE) {
+        if (memory_storage_drop_table(shard->storage, command->table_name)) {
+            statement_cache_invalidate(shard->statements);
+        } else {
+            task->failed = true;
+            snprintf(task->error, sizeof(task->error), "Table '%s' not found", command->table_name);
+        }
+    } else if (command->type == COMMAND_ANALYZE) {
+        task->failed = !command_analyze(shard->storage, command->table_name, task->error, sizeof(task->error));
+    } else {
+        fail_task(task, "Statement is not supported by the server");
+    }
+    command_destroy(command);
+}
+
+/* The router has checked and coerced the rows already. */
+static void run_insert(Shard* shard, ShardTask* task) {
+    MemoryTable* table = memory_storage_get_table(shard->storage, task->text);
+    if (!table) {
+        task->failed = true;
+        snprintf(task->error, sizeof(task->error), "Table '%s' not found", task->text);
+        return;
+    }
+
+    task->first_id = memory_table_insert_batch_owned(table, task->rows, task->count);
+    if (task->first_id == 0) {
+        fail_task(task, "Failed to insert record");
+        return;
+    }
+
+    /* The table owns the rows now. */
+    free(task->rows);
+    task->rows = NULL;
+}
+
+/* Runs a shallow copy of the prepared query that shares its bound clauses, without OFFSET, which
+ * only the router can apply; an aggregate reduces its rows to partial states per group. */
+static void run_query(Shard* shard, ShardTask* task) {
+    PreparedStatement* statement = statement_prepare(shard->statements, shard->storage, task->text,
+                                                     task->error, sizeof(task->error));
+    if (!statement || !statement_bind_parameters(statement, task->parameters, task->error, sizeof(task->error))) {
+        task->failed = true;
+        statement_release(statement);
+        return;
+    }
+
+    if (task->type == SHARD_TASK_AGGREGATE) {
+        if (!execute_partial_aggregate(statement->table, statement->query, &task->records, &task->count)) {
+            fail_task(task, "Query failed");
+        }
+        statement_release(statement);
+        return;
+    }
+
+    Query local = *statement->query;
+    local.offset = 0;
+    local.limit = window_end(statement->query);
+
+    QueryResult* result = execute_table_query(statement->table, &local);
+    if (!result) {
+        fail_task(task, "Query failed");
+        statement_release(statement);
+        return;
+    }
+
+    task->records = malloc(sizeof(DataRecord*) * (result->count ? result->count : 1));
+    for (size_t i = 0; task->records && i < result->count; i++) {
+        task->records[i] = copy_record(result->records[i]);
+        task->count++;
+        if (!task->records[i]) {
+            fail_task(task, "Out of memory");
+            break;
+        }
+    }
+    if (!task->records) fail_task(task, "Out of memory");
+
+    queryresult_destroy(result);
+    statement_release(statement);
+}
+
+static void run_task(Shard* shard, ShardTask* task) {
+    if (task->type == SHARD_TASK_SELECT || task->type == SHARD_TASK_AGGREGATE) {
+        run_query(shard, task);
+    } else if (task->type == SHARD_TASK_INSERT) {
+        run_insert(shard, task);
+    } else {
+        run_command(shard, task);
+    }
+}
+
+static bool flush_unsent(Shard* shard) {
+    /* A pushed task belongs to the router, so its successor is read first. */
+    while (shard->unsent) {
+        ShardTask* next = shard->unsent->next;
+        if (!spsc_push(&shard->replies, shard->unsent)) break;
+        shard->unsent = next;
+    }
+    if (!shard->unsent) shard->unsent_tail = NULL;
+    return shard->unsent == NULL;
+}
+
+/* Spreads the shards over the cores this process may use; a failure leaves the thread unpinned. */
+static void pin_thread(size_t index) {
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) return;
+
+    size_t target = index % (size_t)CPU_COUNT(&allowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &allowed) || target-- > 0) continue;
+
+        cpu_set_t pinned;
+        CPU_ZERO(&pinned);
+        CPU_SET(cpu, &pinned);
+        pthread_setaffinity_np(pthread_self(), sizeof(pinned), &pinned);
+        return;
+    }
+}
+
+static void* shard_main(void* arg) {
+    Shard* shard = arg;
+    ShardPool* pool = shard->pool;
+    pin_thread(shard->index);
+    parallel_set_thread_serial(true);
+
+    for (;;) {
+        /* The router pushes nothing after it sets stopping, so a drain that starts after seeing
+         * it finds every task. */
+        bool stopping = __atomic_load_n(&pool->stopping, __ATOMIC_ACQUIRE);
+
+        bool answered = false;
+        ShardTask* task;
+        while ((task = spsc_pop(&shard->requests))) {
+            run_task(shard, task);
+            task->next = NULL;
+            if (shard->unsent_tail) shard->unsent_tail->next = task;
+            else shard->unsent = task;
+            shard->unsent_tail = task;
+            flush_unsent(shard);
+            answered = true;
+        }
+        if (answered) signal_fd(pool->reply_fd);
+        if (stopping) break;
+
+        if (!flush_unsent(shard)) {
+            struct timespec pause = {0, SHARD_REPLY_RETRY_NS};
+            nanosleep(&pause, NULL);
+            signal_fd(pool->reply_fd);
+            continue;
+        }
+
+        uint64_t wakeups;
+        ssize_t ignored = read(shard->wake_fd, &wakeups, sizeof(wakeups));
+        (void)ignored;
+    }
+    return NULL;
+}
+
+ShardPool* shard_pool_create(size_t shard_count, char* error, size_t error_size) {
+    if (shard_count == 0 || shard_count > SHARD_MAX_COUNT) {
+        snprintf(error, error_size, "Shard count must be between 1 and %d", SHARD_MAX_COUNT);
+        return NULL;
+    }
+
+    ShardPool* pool = calloc(1, sizeof(ShardPool));
+    if (!pool) {
+        snprintf(error, error_size, "Out of memory");
+        return NULL;
+    }
+    pool->count = shard_count;
+    pool->reply_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    bool ready = pool->reply_fd >= 0;
+    for (size_t i = 0; i < shard_count; i++) {
+        Shard* shard = &pool->shards[i];
+        shard->pool = pool;
+        shard->index = i;
+        shard->wake_fd = eventfd(0, EFD_CLOEXEC);
+        shard->storage = memory_storage_create();
+        shard->statements = statement_cache_create();
+        memory_storage_partition_ids(shard->storage, i, shard_count);
+        if (!spsc_init(&shard->requests, SHARD_QUEUE_CAPACITY) || !spsc_init(&shard->replies, SHARD_QUEUE_CAPACITY) ||
+            shard->wake_fd < 0 || !shard->storage || !shard->statements) {
+            ready = false;
+        }
+    }
+
+    for (size_t i = 0; ready && i < shard_count; i++) {
+        Shard* shard = &pool->shards[i];
+        shard->started = pthread_create(&shard->thread, NULL, shard_main, shard) == 0;
+        ready = shard->started;
+    }
+
+    if (!ready) {
+        snprintf(error, error_size, "Cannot start %zu shards", shard_count);
+        shard_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+size_t shard_pool_count(const ShardPool* pool) {
+    return pool->count;
+}
+
+int shard_pool_reply_fd(const ShardPool* pool) {
+    return pool->reply_fd;
+}
+
+void shard_pool_submit(ShardPool* pool, size_t shard_index, ShardTask* task) {
+    Shard* shard = &pool->shards[shard_index];
+    task->shard = shard_index;
+    task->next = NULL;
+
+    if (!shard->backlog && spsc_push(&shard->requests, task)) {
+        shard->kick = true;
+        return;
+    }
+    if (shard->backlog_tail) shard->backlog_tail->next = task;
+    else shard->backlog = task;
+    shard->backlog_tail = task;
+}
+
+void shard_pool_kick(ShardPool* pool) {
+    for (size_t i = 0; i < pool->count; i++) {
+        Shard* shard = &pool->shards[i];
+        while (shard->backlog) {
+            ShardTask* next = shard->backlog->next;
+            if (!spsc_push(&shard->requests, shard->backlog)) break;
+            shard->backlog = next;
+            shard->kick = true;
+        }
+        if (!shard->backlog) shard->backlog_tail = NULL;
+
+        if (shard->kick) {
+            signal_fd(shard->wake_fd);
+            shard->kick = false;
+        }
+    }
+}
+
+/* Once the shards have stopped, their unsent answers and the router's backlog are safe to take. */
+static ShardTask* take_leftover(Shard* shard) {
+    ShardTask* task = shard->unsent;
+    if (task) {
+        shard->unsent = task->next;
+        return task;
+    }
+
+    task = shard->backlog;
+    if (task) {
+        shard->backlog = task->next;
+        fail_task(task, "Server is shutting down");
+    }
+    return task;
+}
+
+ShardTask* shard_pool_next_reply(ShardPool* pool) {
+    for (size_t tried = 0; tried < pool->count; tried++) {
+        Shard* shard = &pool->shards[pool->next_reply];
+        pool->next_reply = (pool->next_reply + 1) % pool->count;
+
+        ShardTask* task = spsc_pop(&shard->replies);
+        if (!task && pool->stopped) task = take_leftover(shard);
+        if (task) {
+            task->next = NULL;
+            return task;
+        }
+    }
+    return NULL;
+}
+
+size_t shard_pool_owner(const ShardPool* pool, const Value* key) {
+    uint64_t bits = 0;
+    switch (key->type) {
+        case VALUE_INTEGER:
+            bits = (uint64_t)key->data.integer;
+            break;
+        case VALUE_FLOAT: {
+            double number = key->data.float_val == 0.0 ? 0.0 : key->data.float_val;
+            memcpy(&bits, &number, sizeof(bits));
+            break;
+        }
+        case VALUE_BOOLEAN:
+            bits = key->data.boolean;
+            break;
+        case VALUE_STRING:
+            if (key->data.string) return (size_t)(hash_mix(hash_string(key->data.string)) % pool->count);
+            break;
+        default:
+            break;
+    }
+    return (size_t)(hash_mix(bits ^ 0x9e3779b97f4a7c15ULL) % pool->count);
+}
+
+/* The first equality the AND-ed conditions pin down: on _id, or on the first column with a key
+ * of its own type, which hashes the way the stored values did. */
+static const Predicate* routing_equality(const Predicate* predicate) {
+    if (!predicate) return NULL;
+    if (predicate->op == PRED_AND) {
+        const Predicate* left = routing_equality(predicate->left);
+        return left ? left : routing_equality(predicate->right);
+    }
+    if (predicate->op != PRED_EQ) return NULL;
+    if (predicate->column_index == PREDICATE_ROW_ID) return predicate->low.type == VALUE_INTEGER ? predicate : NULL;
+    if (predicate->column_index != 0 || predicate->compare_as_float) return NULL;
+    if (predicate->low.type != predicate->column_type) return NULL;
+    return predicate->low.type != VALUE_STRING || predicate->low.data.string ? predicate : NULL;
+}
+
+size_t shard_pool_route(const ShardPool* pool, const Query* query) {
+    const Predicate* equality = routing_equality(query->where);
+    if (!equality) return SIZE_MAX;
+    if (equality->column_index != PREDICATE_ROW_ID) return shard_pool_owner(pool, &equality->low);
+
+    int64_t id = equality->low.data.integer;
+    return id <= 0 ? 0 : (size_t)((uint64_t)(id - 1) % pool->count);
+}
+
+void shard_pool_stop(ShardPool* pool) {
+    if (!pool || pool->stopped) return;
+
+    shard_pool_kick(pool);
+    __atomic_store_n(&pool->stopping, true, __ATOMIC_RELEASE);
+    for (size_t i = 0; i < pool->count; i++) {
+        Shard* shard = &pool->shards[i];
+        if (!shard->started) continue;
+        signal_fd(shard->wake_fd);
+        pthread_join(shard->thread, NULL);
+    }
+    pool->stopped = true;
+}
+
+void shard_pool_destroy(ShardPool* pool) {
+    if (!pool) return;
+
+    shard_pool_stop(pool);
+    ShardTask* task;
+    while ((task = shard_pool_next_reply(pool))) {
+        shard_task_destroy(task);
+    }
+
+    for (size_t i = 0; i < pool->count; i++) {
+        Shard* shard = &pool->shards[i];
+        if (shard->requests.slots) {
+            while ((task = spsc_pop(&shard->requests))) {
+                shard_task_destroy(task);
+            }
+        }
+        spsc_free(&shard->requests);
+        spsc_free(&shard->replies);
+        statement_cache_destroy(shard->statements);
+        memory_storage_destroy(shard->storage);
+        if (shard->wake_fd >= 0) close(shard->wake_fd);
+    }
+    if (pool->reply_fd >= 0) close(pool->reply_fd);
+    free(pool);
+}
+
+/* The output order, with ties going to the lower id as in one table scanned in id order. */
+static bool precedes(const SortKey* keys, size_t key_count, const DataRecord* a, const DataRecord* b) {
+    int cmp = key_count > 0 ? sort_compare(keys, key_count, a, b) : 0;
+    return cmp < 0 || (cmp == 0 && a->id < b->id);
+}
+
+/* Merges the answers, each already in the order the keys give, into their first `limit` rows,
+ * which move out of the tasks. */
+static DataRecord** merge_replies(const SortKey* keys, size_t key_count, ShardTask** replies, size_t reply_count,
+                                  size_t limit, size_t* out_count) {
+    size_t total = 0;
+    for (size_t r = 0; r < reply_count; r++) {
+        total += replies[r]->count;
+    }
+    if (limit > total) limit = total;
+
+    DataRecord** merged = malloc(sizeof(DataRecord*) * (limit ? limit : 1));
+    if (!merged) return NULL;
+
+    size_t positions[SHARD_MAX_COUNT] = {0};
+    for (size_t n = 0; n < limit; n++) {
+        size_t best = SIZE_MAX;
+        for (size_t r = 0; r < reply_count; r++) {
+            if (positions[r] == replies[r]->count) continue;
+            if (best == SIZE_MAX ||
+                precedes(keys, key_count, replies[r]->records[positions[r]], replies[best]->records[positions[best]])) {
+                best = r;
+            }
+        }
+        merged[n] = replies[best]->records[positions[best]];
+        replies[best]->records[positions[best]++] = NULL;
+    }
+
+    *out_count = limit;
+    return merged;
+}
+
+QueryResult* shard_gather(PreparedStatement* statement, TableSchema* schema, ShardTask** replies,
+                          size_t reply_count, char* error, size_t error_size) {
+    const ShardTask* failed = NULL;
+    for (size_t r = 0; r < reply_count && !failed; r++) {
+        if (replies[r]->failed) failed = replies[r];
+    }
+
+    Query* query = statement->query;
+    size_t count = 0;
+    /* Partial rows merge whatever their order; the merged groups are sorted and windowed. */
+    DataRecord** records = NULL;
+    if (!failed && query_is_aggregate(query)) {
+        records = merge_replies(NULL, 0, replies, reply_count, SIZE_MAX, &count);
+    } else if (!failed) {
+        records = merge_replies(query->order_by, query->order_count, replies, reply_count, window_end(query), &count);
+    }
+    if (!records) {
+        snprintf(error, error_size, "%s", failed ? failed->error : "Out of memory");
+        tableschema_destroy(schema);
+        return NULL;
+    }
+
+    if (query_is_aggregate(query)) {
+        QueryResult* merged = merge_partial_aggregates(query, schema, records, count);
+        for (size_t i = 0; i < count; i++) {
+            datarecord_destroy(records[i]);
+        }
+        free(records);
+        tableschema_destroy(schema);
+        if (!merged) snprintf(error, error_size, "Query failed");
+        return merged;
+    }
+
+    size_t skip = query->offset < count ? query->offset : count;
+    for (size_t i = 0; i < skip; i++) {
+        datarecord_destroy(records[i]);
+    }
+    memmove(records, records + skip, sizeof(DataRecord*) * (count - skip));
+    count -= skip;
+
+    /* The rows are copies, so the result owns them and the schema like a derived one. */
+    QueryResult* result = calloc(1, sizeof(QueryResult));
+    size_t* column_map = NULL;
+    size_t column_count = 0;
+    if (result) column_map = query_column_map(query, schema, &column_count);
+    if (!column_map) {
+        for (size_t i = 0; i < count; i++) {
+            datarecord_destroy(records[i]);
+        }
+        free(records);
+        free(result);
+        tableschema_destroy(schema);
+        snprintf(error, error_size, "Out of memory");
+        return NULL;
+    }
+
+    result->records = records;
+    result->count = count;
+    result->column_map = column_map;
+    result->column_count = column_count;
+    result->schema = schema;
+    result->derived = true;
+    return result;
+}
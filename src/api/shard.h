@@ -0,0 +1,85 @@
+#ifndef SHADE_SHARD_H
+#define SHADE_SHARD_H
+
+#include "../query/statement.h"
+#include "../types/data.h"
+#include "../types/value.h"
+#include "protocol.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHARD_MAX_COUNT 64
+#define SHARD_QUEUE_CAPACITY 1024
+
+/* Shared-nothing execution: each shard is a thread pinned to a core that owns a storage holding
+ * one partition of every table, and touches nothing else. A single router thread hands it tasks
+ * through one SPSC ring and takes them back, answered, through another; a task and everything
+ * it points to belongs to whichever side holds it. A row lives on the shard its first column
+ * hashes to, and shard k numbers its records k + 1, k + 1 + count, ..., so a record id names
+ * its shard too. */
+typedef enum {
+    SHARD_TASK_COMMAND,  /* CREATE TABLE, DROP TABLE or ANALYZE, run on every shard */
+    SHARD_TASK_INSERT,   /* the rows of an INSERT that the shard owns, parsed by the router */
+    SHARD_TASK_SELECT,   /* a query without aggregates, with OFFSET folded into LIMIT */
+    SHARD_TASK_AGGREGATE /* an aggregate query, answered with partial rows per group */
+} ShardTaskType;
+
+typedef struct ShardTask {
+    ShardTaskType type;
+    size_t shard;
+    void* owner;
+    char* text;
+    Value* parameters;
+    size_t parameter_count;
+    /* An insert names its table in text and carries count rows of row_width values. */
+    Value** rows;
+    size_t row_width;
+
+    /* Filled in by the shard: copies of the matching records in output order, the partial rows
+     * of an aggregate, or the first new id. */
+    bool failed;
+    char error[PROTOCOL_ERROR_SIZE];
+    DataRecord** records;
+    size_t count;
+    uint64_t first_id;
+
+    struct ShardTask* next;
+} ShardTask;
+
+typedef struct ShardPool ShardPool;
+
+/* Copies text and parameters; the router owns the task until it is submitted. */
+ShardTask* shard_task_create(ShardTaskType type, void* owner, const char* text,
+                             const Value* parameters, size_t parameter_count);
+void shard_task_destroy(ShardTask* task);
+
+ShardPool* shard_pool_create(size_t shard_count, char* error, size_t error_size);
+size_t shard_pool_count(const ShardPool* pool);
+/* Readable, for the router's event loop, whenever answered tasks are waiting. */
+int shard_pool_reply_fd(const ShardPool* pool);
+
+/* Router side. Tasks queue up until shard_pool_kick wakes their shards; a full ring keeps them
+ * back until the next kick. */
+void shard_pool_submit(ShardPool* pool, size_t shard, ShardTask* task);
+void shard_pool_kick(ShardPool* pool);
+/* Returns the next answered task, or NULL when none is waiting. */
+ShardTask* shard_pool_next_reply(ShardPool* pool);
+/* The shard that owns rows whose first column holds key. */
+size_t shard_pool_owner(const ShardPool* pool, const Value* key);
+/* The only shard a bound WHERE clause can match rows on, by _id or by equality on the first
+ * column, or SIZE_MAX when it may be any. */
+size_t shard_pool_route(const ShardPool* pool, const Query* query);
+
+/* Lets the shards finish what they were given and waits for them; tasks still held back come
+ * out of shard_pool_next_reply failed. */
+void shard_pool_stop(ShardPool* pool);
+void shard_pool_destroy(ShardPool* pool);
+
+/* Router side: combines the answers to a SELECT or AGGREGATE of statement, which the router
+ * prepared against empty copies of the tables, into its final result. The table may have been
+ * dropped since, so this takes over a copy of its schema made when the tasks were sent. */
+QueryResult* shard_gather(PreparedStatement* statement, TableSchema* schema, ShardTask** replies,
+                          size_t reply_count, char* error, size_t error_size);
+
+#endif
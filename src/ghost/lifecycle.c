@@ -4,7 +4,10 @@
 bool resurrect_ghost(MemoryStorage* storage, const char* table_name, uint64_t id) {
     if (!storage || !table_name) return false;
     
-    MemoryTable* table = memory_storage_get_table(storage, table_name);
+    return resurrect_table_ghost(memory_storage_get_table(storage, table_name), id);
+}
+
+bool resurrect_table_ghost(MemoryTable* table, uint64_t id) {
     if (!table) return false;
     
     for (size_t i = 0; i < table->record_count; i++) {
@@ -13,6 +16,7 @@ bool resurrect_ghost(MemoryStorage* storage, const char* table_name, uint64_t id
             record->state = DATA_STATE_LIVING;
             record->deleted_at = 0;
             record->ghost_strength = 1.0f; 
+            table_stats_transition(table->stats, DATA_STATE_GHOST, DATA_STATE_LIVING);
             return true;
         }
     }
@@ -34,6 +38,7 @@ size_t resurrect_strong_ghosts(MemoryStorage* storage, float strength_threshold)
                 record->state = DATA_STATE_LIVING;
                 record->deleted_at = 0;
                 record->ghost_strength = 1.0f;
+                table_stats_transition(table->stats, DATA_STATE_GHOST, DATA_STATE_LIVING);
                 resurrected_count++;
             }
         }
@@ -52,6 +57,7 @@ void decay_all_ghosts(MemoryStorage* storage, float decay_amount) {
             DataRecord* record = table->records[i];
             if (record->state == DATA_STATE_GHOST) {
                 datarecord_decay_ghost(record, decay_amount);
+                table_stats_transition(table->stats, DATA_STATE_GHOST, record->state);
             }
         }
     }
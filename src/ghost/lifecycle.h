@@ -4,6 +4,7 @@
 #include "../storage/memory.h"
 
 bool resurrect_ghost(MemoryStorage* storage, const char* table_name, uint64_t id);
+bool resurrect_table_ghost(MemoryTable* table, uint64_t id);
 size_t resurrect_strong_ghosts(MemoryStorage* storage, float strength_threshold);
 
 void decay_all_ghosts(MemoryStorage* storage, float decay_amount);
@@ -1,17 +1,154 @@
+#define _POSIX_C_SOURCE 200809L
+#include <getopt.h>
+#include <signal.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include "api/cli.h"
+#include "api/server.h"
 
-int main() {
-    printf("Starting Shade Database...\n");
-    
-    CLIState* cli = cli_create();
+#define SCRIPT_OUTPUT_BUFFER (64 * 1024)
+
+static ShadeServer* active_server = NULL;
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "Usage: %s [-d data_dir] [-b] [-f script.sql | -c statements | --serve address [-w n]]\n",
+            program);
+    fprintf(stderr, "  -d, --data dir       Open the persistent database in dir\n");
+    fprintf(stderr, "  -f, --file file      Run the statements in file ('-' for stdin) and exit\n");
+    fprintf(stderr, "  -c, --command text   Run the given statements and exit\n");
+    fprintf(stderr, "  -b, --batch          Run the script as one batch, deferring index writes\n");
+    fprintf(stderr, "  -s, --serve address  Serve clients on a Unix socket path or a loopback [host:]port\n");
+    fprintf(stderr, "  -w, --workers n      Serve from n pinned threads that each own a part of every table\n");
+    fprintf(stderr, "Without -f or -c, statements are read from stdin when it is not a terminal.\n");
+}
+
+static void stop_server(int signal_number) {
+    (void)signal_number;
+    server_stop(active_server);
+}
+
+static bool serve(CLIState* cli, const char* address, size_t workers) {
+    char error[PROTOCOL_ERROR_SIZE];
+    ShadeServer* server = server_create_sharded(cli->storage, cli->statements, address, workers, error, sizeof(error));
+    if (!server) {
+        fprintf(stderr, "%s\n", error);
+        return false;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop_server;
+    sigemptyset(&action.sa_mask);
+    active_server = server;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    fprintf(stderr, "Listening on %s\n", address);
+    bool success = server_run(server);
+
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    active_server = NULL;
+    server_destroy(server);
+    return success;
+}
+
+static bool run_script(CLIState* cli, const char* script, const char* command) {
+    if (command) {
+        if (*command == '\0') return true;
+
+        FILE* input = fmemopen((void*)command, strlen(command), "r");
+        if (!input) {
+            fprintf(stderr, "Failed to read statements\n");
+            return false;
+        }
+        bool success = cli_run_script(cli, input, "-c");
+        fclose(input);
+        return success;
+    }
+
+    if (!script || strcmp(script, "-") == 0) {
+        return cli_run_script(cli, stdin, "stdin");
+    }
+
+    FILE* input = fopen(script, "r");
+    if (!input) {
+        fprintf(stderr, "Cannot open script '%s'\n", script);
+        return false;
+    }
+    bool success = cli_run_script(cli, input, script);
+    fclose(input);
+    return success;
+}
+
+int main(int argc, char** argv) {
+    const char* script = NULL;
+    const char* command = NULL;
+    const char* data_dir = NULL;
+    const char* address = NULL;
+    size_t workers = 0;
+    bool batch = false;
+    int option;
+
+    static const struct option long_options[] = {
+        {"file", required_argument, NULL, 'f'},
+        {"command", required_argument, NULL, 'c'},
+        {"data", required_argument, NULL, 'd'},
+        {"batch", no_argument, NULL, 'b'},
+        {"serve", required_argument, NULL, 's'},
+        {"workers", required_argument, NULL, 'w'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}
+    };
+
+    while ((option = getopt_long(argc, argv, "f:c:d:bs:w:h", long_options, NULL)) != -1) {
+        switch (option) {
+            case 'f': script = optarg; break;
+            case 'c': command = optarg; break;
+            case 'd': data_dir = optarg; break;
+            case 'b': batch = true; break;
+            case 's': address = optarg; break;
+            case 'w': workers = strtoul(optarg, NULL, 10); break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if (optind < argc || (script && command) || (address && (script || command)) ||
+        (workers > 0 && (!address || data_dir))) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    bool interactive = !address && !script && !command && isatty(STDIN_FILENO);
+    if (interactive) {
+        printf("Starting Shade Database...\n");
+    } else {
+        setvbuf(stdout, NULL, _IOFBF, SCRIPT_OUTPUT_BUFFER);
+    }
+
+    CLIState* cli = cli_create_with_persistence(data_dir);
     if (!cli) {
         fprintf(stderr, "Failed to initialize database\n");
         return 1;
     }
-    
-    cli_run(cli);
+
+    bool success = true;
+    if (address) {
+        success = serve(cli, address, workers);
+    } else if (interactive) {
+        cli_run(cli);
+    } else {
+        cli->batch = batch;
+        success = run_script(cli, script, command);
+    }
     cli_destroy(cli);
-    
-    return 0;
+
+    return success ? 0 : 1;
 }
@@ -0,0 +1,416 @@
+#include "aggregate.h"
+#include "batch.h"
+#include "predicate.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    const char* name;
+    AggregateFunction function;
+    bool weighted;
+} AggregateName;
+
+static const AggregateName aggregate_names[] = {
+    { "COUNT", AGG_COUNT, false },
+    { "SUM", AGG_SUM, false },
+    { "AVG", AGG_AVG, false },
+    { "MIN", AGG_MIN, false },
+    { "MAX", AGG_MAX, false },
+    { "WEIGHTED_COUNT", AGG_COUNT, true },
+    { "WEIGHTED_SUM", AGG_SUM, true },
+    { "WEIGHTED_AVG", AGG_AVG, true }
+};
+
+#define AGGREGATE_NAME_COUNT (sizeof(aggregate_names) / sizeof(aggregate_names[0]))
+
+bool aggregate_lookup(const char* name, AggregateFunction* function, bool* weighted) {
+    if (!name) return false;
+
+    for (size_t i = 0; i < AGGREGATE_NAME_COUNT; i++) {
+        if (string_case_compare(aggregate_names[i].name, name) == 0) {
+            if (function) *function = aggregate_names[i].function;
+            if (weighted) *weighted = aggregate_names[i].weighted;
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char* function_name(const Aggregate* aggregate) {
+    for (size_t i = 0; i < AGGREGATE_NAME_COUNT; i++) {
+        if (aggregate_names[i].function == aggregate->function &&
+            aggregate_names[i].weighted == aggregate->weighted) {
+            return aggregate_names[i].name;
+        }
+    }
+    return "?";
+}
+
+bool aggregate_init(Aggregate* aggregate, AggregateFunction function, bool weighted, const char* column) {
+    if (!aggregate) return false;
+
+    aggregate->function = function;
+    aggregate->weighted = weighted;
+    aggregate->column = column ? string_duplicate(column) : NULL;
+    aggregate->column_index = PREDICATE_UNBOUND;
+    aggregate->column_type = VALUE_NULL;
+    aggregate->position = 0;
+
+    return !column || aggregate->column;
+}
+
+void aggregate_free(Aggregate* aggregate) {
+    if (!aggregate) return;
+
+    free(aggregate->column);
+    aggregate->column = NULL;
+}
+
+static bool bind_error(char* error, size_t error_size, const char* message, const char* column) {
+    if (error && error_size > 0) {
+        snprintf(error, error_size, "%s '%s'", message, column);
+    }
+    return false;
+}
+
+bool aggregate_bind(Aggregate* aggregate, const TableSchema* schema, char* error, size_t error_size) {
+    if (!aggregate || !schema) return false;
+
+    aggregate->column_index = PREDICATE_UNBOUND;
+    aggregate->column_type = VALUE_NULL;
+
+    char message[64];
+    snprintf(message, sizeof(message), "%s requires a numeric column, got", function_name(aggregate));
+
+    if (!aggregate->column) {
+        return aggregate->function == AGG_COUNT || bind_error(error, error_size, message, "*");
+    }
+
+    int column = tableschema_find_column(schema, aggregate->column);
+    if (column < 0) {
+        return bind_error(error, error_size, tableschema_lookup_message(column), aggregate->column);
+    }
+    aggregate->column_index = column;
+    aggregate->column_type = schema->columns[column].type;
+
+    bool numeric = aggregate->column_type == VALUE_INTEGER || aggregate->column_type == VALUE_FLOAT;
+    if ((aggregate->function == AGG_SUM || aggregate->function == AGG_AVG) && !numeric) {
+        return bind_error(error, error_size, message, aggregate->column);
+    }
+
+    return true;
+}
+
+ValueType aggregate_result_type(const Aggregate* aggregate) {
+    switch (aggregate->function) {
+        case AGG_COUNT:
+            return aggregate->weighted ? VALUE_FLOAT : VALUE_INTEGER;
+        case AGG_SUM:
+            return aggregate->weighted ? VALUE_FLOAT : aggregate->column_type;
+        case AGG_AVG:
+            return VALUE_FLOAT;
+        default:
+            return aggregate->column_type;
+    }
+}
+
+char* aggregate_name(const Aggregate* aggregate) {
+    if (!aggregate) return NULL;
+
+    const char* function = function_name(aggregate);
+    const char* column = aggregate->column ? aggregate->column : "*";
+    size_t length = strlen(function) + strlen(column) + 3;
+
+    char* name = malloc(length);
+    if (name) snprintf(name, length, "%s(%s)", function, column);
+    return name;
+}
+
+void aggregate_state_init(AggregateState* state) {
+    memset(state, 0, sizeof(AggregateState));
+}
+
+static void load_weights(DataRecord* const* records, size_t count, const uint8_t* validity, double* weights) {
+    for (size_t i = 0; i < count; i++) {
+        const DataRecord* record = records[i];
+        double weight = record->state == DATA_STATE_GHOST ? record->ghost_strength : 1.0;
+        weights[i] = !validity || bitmap_get(validity, i) ? weight : 0.0;
+    }
+}
+
+static double sum_doubles(const double* values, size_t count) {
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        sum += values[i];
+    }
+    return sum;
+}
+
+static double dot_doubles(const double* values, const double* weights, size_t count) {
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        sum += values[i] * weights[i];
+    }
+    return sum;
+}
+
+static void update_extreme(const Aggregate* aggregate, AggregateState* state, const Value* value) {
+    bool replace = !state->has_extreme;
+    bool want_max = aggregate->function == AGG_MAX;
+
+    if (!replace) {
+        int order;
+        switch (value->type) {
+            case VALUE_INTEGER:
+                order = (value->data.integer > state->extreme.integer) - (value->data.integer < state->extreme.integer);
+                break;
+            case VALUE_FLOAT:
+                order = (value->data.float_val > state->extreme.float_val) - (value->data.float_val < state->extreme.float_val);
+                break;
+            case VALUE_BOOLEAN:
+                order = (int)value->data.boolean - (int)state->extreme.boolean;
+                break;
+            default:
+                order = strcmp(value->data.string, state->extreme.string);
+                break;
+        }
+        replace = want_max ? order > 0 : order < 0;
+    }
+
+    if (!replace) return;
+
+    switch (value->type) {
+        case VALUE_INTEGER: state->extreme.integer = value->data.integer; break;
+        case VALUE_FLOAT: state->extreme.float_val = value->data.float_val; break;
+        case VALUE_BOOLEAN: state->extreme.boolean = value->data.boolean; break;
+        default: state->extreme.string = value->data.string; break;
+    }
+    state->has_extreme = true;
+}
+
+static void accumulate_extremes(const Aggregate* aggregate, AggregateState* state,
+                                DataRecord* const* records, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const Value* value = &records[i]->values[aggregate->column_index];
+        if (value->type != aggregate->column_type) continue;
+        if (value->type == VALUE_STRING && !value->data.string) continue;
+
+        update_extreme(aggregate, state, value);
+    }
+}
+
+static void accumulate_block(const Aggregate* aggregate, AggregateState* state,
+                             DataRecord* const* records, size_t count) {
+    double weights[RECORD_BATCH_SIZE];
+    uint8_t validity[RECORD_BATCH_SIZE / 8];
+
+    if (aggregate->column_index < 0) {
+        state->count += count;
+        if (aggregate->weighted) {
+            load_weights(records, count, NULL, weights);
+            state->weight += sum_doubles(weights, count);
+        }
+        return;
+    }
+
+    if (aggregate->function == AGG_MIN || aggregate->function == AGG_MAX) {
+        accumulate_extremes(aggregate, state, records, count);
+        return;
+    }
+
+    if (aggregate->function == AGG_COUNT) {
+        size_t valid = 0;
+        switch (aggregate->column_type) {
+            case VALUE_STRING: {
+                const char* strings[RECORD_BATCH_SIZE];
+                valid = gather_string_column(records, count, aggregate->column_index, strings, validity);
+                break;
+            }
+            case VALUE_BOOLEAN: {
+                bool booleans[RECORD_BATCH_SIZE];
+                valid = gather_bool_column(records, count, aggregate->column_index, booleans, validity);
+                break;
+            }
+            case VALUE_FLOAT: {
+                double floats[RECORD_BATCH_SIZE];
+                valid = gather_float_column(records, count, aggregate->column_index, floats, validity);
+                break;
+            }
+            default: {
+                int64_t integers[RECORD_BATCH_SIZE];
+                valid = gather_int_column(records, count, aggregate->column_index, integers, validity);
+                break;
+            }
+        }
+
+        state->count += valid;
+        if (aggregate->weighted) {
+            load_weights(records, count, validity, weights);
+            state->weight += sum_doubles(weights, count);
+        }
+        return;
+    }
+
+    double values[RECORD_BATCH_SIZE];
+    if (aggregate->column_type == VALUE_INTEGER) {
+        int64_t integers[RECORD_BATCH_SIZE];
+        uint64_t sum = 0;
+
+        state->count += gather_int_column(records, count, aggregate->column_index, integers, validity);
+        for (size_t i = 0; i < count; i++) {
+            sum += (uint64_t)integers[i];
+            values[i] = (double)integers[i];
+        }
+        state->int_sum += sum;
+    } else {
+        state->count += gather_float_column(records, count, aggregate->column_index, values, validity);
+    }
+
+    if (aggregate->weighted) {
+        load_weights(records, count, validity, weights);
+        state->weight += sum_doubles(weights, count);
+        state->float_sum += dot_doubles(values, weights, count);
+    } else {
+        state->float_sum += sum_doubles(values, count);
+    }
+}
+
+void aggregate_accumulate(const Aggregate* aggregate, AggregateState* state,
+                          DataRecord* const* records, size_t count) {
+    if (!aggregate || !state || !records) return;
+
+    for (size_t offset = 0; offset < count; offset += RECORD_BATCH_SIZE) {
+        size_t block = count - offset < RECORD_BATCH_SIZE ? count - offset : RECORD_BATCH_SIZE;
+        accumulate_block(aggregate, state, records + offset, block);
+    }
+}
+
+static void accumulate_row(const Aggregate* aggregate, AggregateState* state, const DataRecord* record) {
+    double weight = record->state == DATA_STATE_GHOST ? record->ghost_strength : 1.0;
+
+    if (aggregate->column_index < 0) {
+        state->count++;
+        state->weight += weight;
+        return;
+    }
+
+    const Value* value = &record->values[aggregate->column_index];
+    if (value->type != aggregate->column_type) return;
+    if (value->type == VALUE_STRING && !value->data.string) return;
+
+    if (aggregate->function == AGG_MIN || aggregate->function == AGG_MAX) {
+        update_extreme(aggregate, state, value);
+        return;
+    }
+
+    state->count++;
+    state->weight += weight;
+    if (aggregate->function == AGG_COUNT) return;
+
+    double number = value->type == VALUE_INTEGER ? (double)value->data.integer : value->data.float_val;
+    if (value->type == VALUE_INTEGER) state->int_sum += (uint64_t)value->data.integer;
+    state->float_sum += aggregate->weighted ? number * weight : number;
+}
+
+void aggregate_accumulate_grouped(const Aggregate* aggregate, AggregateState* states, size_t stride,
+                                  const uint32_t* groups, DataRecord* const* records, size_t count) {
+    if (!aggregate || !states || !groups || !records) return;
+
+    for (size_t i = 0; i < count; i++) {
+        accumulate_row(aggregate, &states[(size_t)groups[i] * stride], records[i]);
+    }
+}
+
+void aggregate_merge(const Aggregate* aggregate, AggregateState* into, const AggregateState* from) {
+    if (!aggregate || !into || !from) return;
+
+    into->count += from->count;
+    into->weight += from->weight;
+    into->int_sum += from->int_sum;
+    into->float_sum += from->float_sum;
+
+    if (!from->has_extreme) return;
+
+    Value extreme;
+    extreme.type = aggregate->column_type;
+    switch (aggregate->column_type) {
+        case VALUE_INTEGER: extreme.data.integer = from->extreme.integer; break;
+        case VALUE_FLOAT: extreme.data.float_val = from->extreme.float_val; break;
+        case VALUE_BOOLEAN: extreme.data.boolean = from->extreme.boolean; break;
+        default: extreme.data.string = (char*)from->extreme.string; break;
+    }
+    update_extreme(aggregate, into, &extreme);
+}
+
+Value aggregate_finalize(const Aggregate* aggregate, const AggregateState* state) {
+    if (!aggregate || !state) return value_null();
+
+    switch (aggregate->function) {
+        case AGG_COUNT:
+            if (aggregate->weighted) return value_float(state->weight);
+            return value_integer((int64_t)state->count);
+        case AGG_SUM:
+            if (state->count == 0) return value_null();
+            if (!aggregate->weighted && aggregate->column_type == VALUE_INTEGER) {
+                return value_integer((int64_t)state->int_sum);
+            }
+            return value_float(state->float_sum);
+        case AGG_AVG:
+            if (aggregate->weighted) {
+                return state->weight > 0.0 ? value_float(state->float_sum / state->weight) : value_null();
+            }
+            return state->count > 0 ? value_float(state->float_sum / (double)state->count) : value_null();
+        default:
+            break;
+    }
+
+    if (!state->has_extreme) return value_null();
+
+    switch (aggregate->column_type) {
+        case VALUE_INTEGER: return value_integer(state->extreme.integer);
+        case VALUE_FLOAT: return value_float(state->extreme.float_val);
+        case VALUE_BOOLEAN: return value_boolean(state->extreme.boolean);
+        default: return value_string(state->extreme.string);
+    }
+}
+
+bool aggregate_state_store(const Aggregate* aggregate, const AggregateState* state, Value* values) {
+    if (!aggregate || !state || !values) return false;
+    
+    values[0] = value_integer((int64_t)state->count);
+    values[1] = value_float(state->weight);
+    values[2] = value_integer((int64_t)state->int_sum);
+    values[3] = value_float(state->float_sum);
+    values[4] = value_null();
+    if (!state->has_extreme) return true;
+    
+    switch (aggregate->column_type) {
+        case VALUE_INTEGER: values[4] = value_integer(state->extreme.integer); break;
+        case VALUE_FLOAT: values[4] = value_float(state->extreme.float_val); break;
+        case VALUE_BOOLEAN: values[4] = value_boolean(state->extreme.boolean); break;
+        default: values[4] = value_string(state->extreme.string); break;
+    }
+    return values[4].type != VALUE_STRING || values[4].data.string;
+}
+
+void aggregate_state_load(const Aggregate* aggregate, AggregateState* state, const Value* values) {
+    aggregate_state_init(state);
+    if (!aggregate || !values) return;
+    
+    state->count = (uint64_t)values[0].data.integer;
+    state->weight = values[1].data.float_val;
+    state->int_sum = (uint64_t)values[2].data.integer;
+    state->float_sum = values[3].data.float_val;
+    
+    const Value* extreme = &values[4];
+    if (extreme->type == VALUE_NULL || extreme->type != aggregate->column_type) return;
+    if (extreme->type == VALUE_STRING && !extreme->data.string) return;
+    
+    switch (extreme->type) {
+        case VALUE_INTEGER: state->extreme.integer = extreme->data.integer; break;
+        case VALUE_FLOAT: state->extreme.float_val = extreme->data.float_val; break;
+        case VALUE_BOOLEAN: state->extreme.boolean = extreme->data.boolean; break;
+        default: state->extreme.string = extreme->data.string; break;
+    }
+    state->has_extreme = true;
+}
@@ -0,0 +1,65 @@
+#ifndef SHADE_QUERY_AGGREGATE_H
+#define SHADE_QUERY_AGGREGATE_H
+
+#include "../types/data.h"
+#include "../types/schema.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef enum {
+    AGG_COUNT,
+    AGG_SUM,
+    AGG_AVG,
+    AGG_MIN,
+    AGG_MAX
+} AggregateFunction;
+
+/* Weighted aggregates count living rows as 1 and ghosts by their ghost_strength. */
+typedef struct {
+    AggregateFunction function;
+    bool weighted;
+    char* column;
+    int column_index;
+    ValueType column_type;
+    size_t position;
+} Aggregate;
+
+typedef struct {
+    uint64_t count;
+    double weight;
+    uint64_t int_sum;
+    double float_sum;
+    bool has_extreme;
+    union {
+        int64_t integer;
+        double float_val;
+        bool boolean;
+        const char* string;
+    } extreme;
+} AggregateState;
+
+bool aggregate_lookup(const char* name, AggregateFunction* function, bool* weighted);
+bool aggregate_init(Aggregate* aggregate, AggregateFunction function, bool weighted, const char* column);
+void aggregate_free(Aggregate* aggregate);
+
+bool aggregate_bind(Aggregate* aggregate, const TableSchema* schema, char* error, size_t error_size);
+ValueType aggregate_result_type(const Aggregate* aggregate);
+char* aggregate_name(const Aggregate* aggregate);
+
+void aggregate_state_init(AggregateState* state);
+void aggregate_accumulate(const Aggregate* aggregate, AggregateState* state,
+                          DataRecord* const* records, size_t count);
+/* Row i updates states[groups[i] * stride]. */
+void aggregate_accumulate_grouped(const Aggregate* aggregate, AggregateState* states, size_t stride,
+                                  const uint32_t* groups, DataRecord* const* records, size_t count);
+void aggregate_merge(const Aggregate* aggregate, AggregateState* into, const AggregateState* from);
+Value aggregate_finalize(const Aggregate* aggregate, const AggregateState* state);
+
+/* A state written out as values, to travel between partitions: the count, weight, integer sum,
+ * float sum and the extreme, NULL until one is seen. Loading borrows a string extreme from the values. */
+#define AGGREGATE_STATE_VALUES 5
+bool aggregate_state_store(const Aggregate* aggregate, const AggregateState* state, Value* values);
+void aggregate_state_load(const Aggregate* aggregate, AggregateState* state, const Value* values);
+
+#endif
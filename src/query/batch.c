@@ -0,0 +1,180 @@
+#include "batch.h"
+#include <string.h>
+
+size_t bitmap_byte_count(size_t bits) {
+    return (bits + 7) / 8;
+}
+
+void bitmap_set(uint8_t* bitmap, size_t index, bool value) {
+    if (value) {
+        bitmap[index / 8] |= (uint8_t)(1u << (index % 8));
+    } else {
+        bitmap[index / 8] &= (uint8_t)~(1u << (index % 8));
+    }
+}
+
+bool bitmap_get(const uint8_t* bitmap, size_t index) {
+    return (bitmap[index / 8] >> (index % 8)) & 1u;
+}
+
+bool column_vector_init(ColumnVector* vector, ValueType type, size_t capacity) {
+    if (!vector) return false;
+    
+    size_t element_size;
+    switch (type) {
+        case VALUE_INTEGER: element_size = sizeof(int64_t); break;
+        case VALUE_FLOAT: element_size = sizeof(double); break;
+        case VALUE_BOOLEAN: element_size = sizeof(bool); break;
+        case VALUE_STRING: element_size = sizeof(const char*); break;
+        default: return false;
+    }
+    
+    vector->type = type;
+    vector->count = 0;
+    vector->capacity = capacity;
+    vector->null_count = 0;
+    vector->data.integers = NULL;
+    vector->validity = malloc(bitmap_byte_count(capacity) ? bitmap_byte_count(capacity) : 1);
+    
+    void* data = malloc(element_size * (capacity ? capacity : 1));
+    if (!data || !vector->validity) {
+        free(data);
+        free(vector->validity);
+        vector->validity = NULL;
+        return false;
+    }
+    
+    switch (type) {
+        case VALUE_INTEGER: vector->data.integers = data; break;
+        case VALUE_FLOAT: vector->data.floats = data; break;
+        case VALUE_BOOLEAN: vector->data.booleans = data; break;
+        default: vector->data.strings = data; break;
+    }
+    
+    return true;
+}
+
+void column_vector_free(ColumnVector* vector) {
+    if (!vector) return;
+    
+    free(vector->data.integers);
+    free(vector->validity);
+    vector->data.integers = NULL;
+    vector->validity = NULL;
+    vector->count = 0;
+    vector->capacity = 0;
+}
+
+bool column_vector_gather(ColumnVector* vector, DataRecord* const* records, size_t count, size_t column) {
+    if (!vector || count > vector->capacity) return false;
+    
+    size_t valid = 0;
+    switch (vector->type) {
+        case VALUE_INTEGER:
+            valid = gather_int_column(records, count, column, vector->data.integers, vector->validity);
+            break;
+        case VALUE_FLOAT:
+            valid = gather_float_column(records, count, column, vector->data.floats, vector->validity);
+            break;
+        case VALUE_BOOLEAN:
+            valid = gather_bool_column(records, count, column, vector->data.booleans, vector->validity);
+            break;
+        case VALUE_STRING:
+            valid = gather_string_column(records, count, column, vector->data.strings, vector->validity);
+            break;
+        default:
+            return false;
+    }
+    
+    vector->count = count;
+    vector->null_count = count - valid;
+    return true;
+}
+
+static void clear_validity(uint8_t* validity, size_t count) {
+    if (validity) memset(validity, 0, bitmap_byte_count(count));
+}
+
+size_t gather_int_column(DataRecord* const* records, size_t count, size_t column,
+                         int64_t* out_values, uint8_t* out_validity) {
+    size_t valid = 0;
+    clear_validity(out_validity, count);
+    
+    for (size_t i = 0; i < count; i++) {
+        const Value* value = &records[i]->values[column];
+        bool present = value->type == VALUE_INTEGER;
+        
+        out_values[i] = present ? value->data.integer : 0;
+        if (out_validity && present) bitmap_set(out_validity, i, true);
+        valid += present;
+    }
+    
+    return valid;
+}
+
+size_t gather_float_column(DataRecord* const* records, size_t count, size_t column,
+                           double* out_values, uint8_t* out_validity) {
+    size_t valid = 0;
+    clear_validity(out_validity, count);
+    
+    for (size_t i = 0; i < count; i++) {
+        const Value* value = &records[i]->values[column];
+        bool present = value->type == VALUE_FLOAT;
+        
+        out_values[i] = present ? value->data.float_val : 0.0;
+        if (out_validity && present) bitmap_set(out_validity, i, true);
+        valid += present;
+    }
+    
+    return valid;
+}
+
+size_t gather_bool_column(DataRecord* const* records, size_t count, size_t column,
+                          bool* out_values, uint8_t* out_validity) {
+    size_t valid = 0;
+    clear_validity(out_validity, count);
+    
+    for (size_t i = 0; i < count; i++) {
+        const Value* value = &records[i]->values[column];
+        bool present = value->type == VALUE_BOOLEAN;
+        
+        out_values[i] = present ? value->data.boolean : false;
+        if (out_validity && present) bitmap_set(out_validity, i, true);
+        valid += present;
+    }
+    
+    return valid;
+}
+
+size_t gather_string_column(DataRecord* const* records, size_t count, size_t column,
+                            const char** out_values, uint8_t* out_validity) {
+    size_t valid = 0;
+    clear_validity(out_validity, count);
+    
+    for (size_t i = 0; i < count; i++) {
+        const Value* value = &records[i]->values[column];
+        bool present = value->type == VALUE_STRING && value->data.string != NULL;
+        
+        out_values[i] = present ? value->data.string : NULL;
+        if (out_validity && present) bitmap_set(out_validity, i, true);
+        valid += present;
+    }
+    
+    return valid;
+}
+
+void gather_state_column(DataRecord* const* records, size_t count,
+                         uint8_t* out_ghost_bitmap, float* out_strengths) {
+    clear_validity(out_ghost_bitmap, count);
+    
+    for (size_t i = 0; i < count; i++) {
+        const DataRecord* record = records[i];
+        
+        if (out_ghost_bitmap && record->state == DATA_STATE_GHOST) {
+            bitmap_set(out_ghost_bitmap, i, true);
+        }
+        if (out_strengths) {
+            out_strengths[i] = record->ghost_strength;
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef SHADE_QUERY_BATCH_H
+#define SHADE_QUERY_BATCH_H
+
+#include "../types/data.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define RECORD_BATCH_SIZE 1024
+
+typedef struct {
+    ValueType type;
+    size_t count;
+    size_t capacity;
+    union {
+        int64_t* integers;
+        double* floats;
+        bool* booleans;
+        const char** strings;
+    } data;
+    uint8_t* validity;
+    size_t null_count;
+} ColumnVector;
+
+size_t bitmap_byte_count(size_t bits);
+void bitmap_set(uint8_t* bitmap, size_t index, bool value);
+bool bitmap_get(const uint8_t* bitmap, size_t index);
+
+bool column_vector_init(ColumnVector* vector, ValueType type, size_t capacity);
+void column_vector_free(ColumnVector* vector);
+bool column_vector_gather(ColumnVector* vector, DataRecord* const* records, size_t count, size_t column);
+
+size_t gather_int_column(DataRecord* const* records, size_t count, size_t column,
+                         int64_t* out_values, uint8_t* out_validity);
+size_t gather_float_column(DataRecord* const* records, size_t count, size_t column,
+                           double* out_values, uint8_t* out_validity);
+size_t gather_bool_column(DataRecord* const* records, size_t count, size_t column,
+                          bool* out_values, uint8_t* out_validity);
+size_t gather_string_column(DataRecord* const* records, size_t count, size_t column,
+                            const char** out_values, uint8_t* out_validity);
+void gather_state_column(DataRecord* const* records, size_t count,
+                         uint8_t* out_ghost_bitmap, float* out_strengths);
+
+#endif
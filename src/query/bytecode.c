@@ -0,0 +1,517 @@
+#include "bytecode.h"
+#include "batch.h"
+#include <string.h>
+
+typedef enum {
+    FOLD_FALSE,
+    FOLD_TRUE,
+    FOLD_DYNAMIC
+} FoldResult;
+
+typedef struct {
+    PredicateProgram* program;
+    size_t depth;
+    bool failed;
+} Compiler;
+
+static PredicateInstruction* emit(Compiler* compiler, PredicateOpcode opcode, int stack_effect) {
+    PredicateProgram* program = compiler->program;
+
+    if (program->count == program->capacity) {
+        size_t capacity = program->capacity ? program->capacity * 2 : 16;
+        PredicateInstruction* code = realloc(program->code, sizeof(PredicateInstruction) * capacity);
+        if (!code) {
+            compiler->failed = true;
+            return NULL;
+        }
+        program->code = code;
+        program->capacity = capacity;
+    }
+
+    PredicateInstruction* instruction = &program->code[program->count++];
+    memset(instruction, 0, sizeof(PredicateInstruction));
+    instruction->opcode = (uint8_t)opcode;
+
+    compiler->depth = (size_t)((int)compiler->depth + stack_effect);
+    if (compiler->depth > program->stack_depth) {
+        program->stack_depth = compiler->depth;
+    }
+    return instruction;
+}
+
+static int int_floor(double value, int64_t* out) {
+    if (value >= 9223372036854775808.0) return 1;
+    if (value < -9223372036854775808.0) return -1;
+    *out = (int64_t)value;
+    if ((double)*out > value) (*out)--;
+    return 0;
+}
+
+static int int_ceil(double value, int64_t* out) {
+    if (value >= 9223372036854775808.0) return 1;
+    if (value < -9223372036854775808.0) return -1;
+    *out = (int64_t)value;
+    if ((double)*out < value) (*out)++;
+    return 0;
+}
+
+/* Rewrites an integer column compared against a float literal into an integer comparison. */
+static FoldResult fold_int_against_float(PredicateOp* op, double low, double high,
+                                         int64_t* out_low, int64_t* out_high, bool* not_null) {
+    *not_null = false;
+    if (low != low || high != high) {
+        if (*op != PRED_NE) return FOLD_FALSE;
+        *not_null = true;
+        return FOLD_DYNAMIC;
+    }
+
+    int side;
+    switch (*op) {
+        case PRED_EQ:
+        case PRED_NE:
+            if (int_floor(low, out_low) != 0 || (double)*out_low != low) {
+                if (*op == PRED_EQ) return FOLD_FALSE;
+                *not_null = true;
+            }
+            return FOLD_DYNAMIC;
+        case PRED_LT:
+        case PRED_GE:
+            side = int_ceil(low, out_low);
+            if (side == 0) return FOLD_DYNAMIC;
+            *not_null = (side > 0) == (*op == PRED_LT);
+            return *not_null ? FOLD_DYNAMIC : FOLD_FALSE;
+        case PRED_LE:
+        case PRED_GT:
+            side = int_floor(low, out_low);
+            if (side == 0) return FOLD_DYNAMIC;
+            *not_null = (side > 0) == (*op == PRED_LE);
+            return *not_null ? FOLD_DYNAMIC : FOLD_FALSE;
+        case PRED_BETWEEN:
+            side = int_ceil(low, out_low);
+            if (side > 0) return FOLD_FALSE;
+            if (side < 0) *out_low = INT64_MIN;
+            side = int_floor(high, out_high);
+            if (side < 0) return FOLD_FALSE;
+            if (side > 0) *out_high = INT64_MAX;
+            return *out_low <= *out_high ? FOLD_DYNAMIC : FOLD_FALSE;
+        default:
+            return FOLD_FALSE;
+    }
+}
+
+static PredicateOp negate_op(PredicateOp op) {
+    switch (op) {
+        case PRED_EQ: return PRED_NE;
+        case PRED_NE: return PRED_EQ;
+        case PRED_LT: return PRED_GE;
+        case PRED_LE: return PRED_GT;
+        case PRED_GT: return PRED_LE;
+        case PRED_GE: return PRED_LT;
+        case PRED_IS_NULL: return PRED_IS_NOT_NULL;
+        case PRED_IS_NOT_NULL: return PRED_IS_NULL;
+        default: return op;
+    }
+}
+
+static FoldResult compile_logical(Compiler* compiler, const Predicate* predicate, bool negate);
+
+/* A comparison with NULL is unknown, and so is its negation: NOT x = 1 must drop the rows where
+ * x is NULL just as x != 1 does. Negated leaves therefore compile to the opposite comparison,
+ * which rejects NULL like every comparison kernel, rather than to an inverted mask. */
+static FoldResult compile_leaf(Compiler* compiler, const Predicate* predicate, bool negate) {
+    bool row_id = predicate->column_index == PREDICATE_ROW_ID;
+    if (predicate->column_index < 0 && !row_id) {
+        compiler->failed = true;
+        return FOLD_FALSE;
+    }
+
+    if (negate && predicate->op == PRED_BETWEEN) {
+        Predicate below = *predicate;
+        Predicate above = *predicate;
+        below.op = PRED_LT;
+        above.op = PRED_GT;
+        above.low = predicate->high;
+
+        Predicate outside;
+        memset(&outside, 0, sizeof(outside));
+        outside.op = PRED_OR;
+        outside.left = &below;
+        outside.right = &above;
+        return compile_logical(compiler, &outside, false);
+    }
+
+    uint32_t column = row_id ? 0 : (uint32_t)predicate->column_index;
+    PredicateOp op = negate ? negate_op(predicate->op) : predicate->op;
+
+    if (op == PRED_IS_NULL || op == PRED_IS_NOT_NULL) {
+        if (row_id) return op == PRED_IS_NOT_NULL ? FOLD_TRUE : FOLD_FALSE;
+
+        PredicateInstruction* instruction = emit(compiler, op == PRED_IS_NULL ? OP_IS_NULL : OP_NOT_NULL, 1);
+        if (instruction) instruction->column = column;
+        return FOLD_DYNAMIC;
+    }
+
+    PredicateOpcode opcode;
+    PredicateInstruction operands;
+    memset(&operands, 0, sizeof(operands));
+
+    switch (predicate->column_type) {
+        case VALUE_INTEGER:
+            opcode = row_id ? OP_CMP_ID : OP_CMP_INT;
+            if (predicate->compare_as_float) {
+                bool not_null;
+                FoldResult folded = fold_int_against_float(&op, predicate->low.data.float_val,
+                                                           predicate->high.data.float_val,
+                                                           &operands.low.integer, &operands.high.integer,
+                                                           &not_null);
+                if (folded != FOLD_DYNAMIC) return folded;
+                if (not_null) {
+                    if (row_id) return FOLD_TRUE;
+                    PredicateInstruction* instruction = emit(compiler, OP_NOT_NULL, 1);
+                    if (instruction) instruction->column = column;
+                    return FOLD_DYNAMIC;
+                }
+            } else {
+                operands.low.integer = predicate->low.data.integer;
+                operands.high.integer = predicate->high.data.integer;
+                if (op == PRED_BETWEEN && operands.low.integer > operands.high.integer) return FOLD_FALSE;
+            }
+            break;
+        case VALUE_FLOAT:
+            opcode = OP_CMP_FLOAT;
+            operands.low.float_val = predicate->low.data.float_val;
+            operands.high.float_val = predicate->high.data.float_val;
+            if (op == PRED_BETWEEN && !(operands.low.float_val <= operands.high.float_val)) return FOLD_FALSE;
+            break;
+        case VALUE_BOOLEAN:
+            opcode = OP_CMP_BOOL;
+            operands.low.boolean = predicate->low.data.boolean;
+            if (op == PRED_NE) {
+                op = PRED_EQ;
+                operands.low.boolean = !operands.low.boolean;
+            }
+            break;
+        case VALUE_STRING:
+            opcode = OP_CMP_STRING;
+            operands.low.string = predicate->low.data.string;
+            operands.high.string = predicate->high.data.string;
+            if (op == PRED_BETWEEN && strcmp(operands.low.string, operands.high.string) > 0) return FOLD_FALSE;
+            break;
+        default:
+            compiler->failed = true;
+            return FOLD_FALSE;
+    }
+
+    PredicateInstruction* instruction = emit(compiler, opcode, 1);
+    if (instruction) {
+        instruction->cmp = (uint8_t)op;
+        instruction->column = column;
+        instruction->low = operands.low;
+        instruction->high = operands.high;
+    }
+    return FOLD_DYNAMIC;
+}
+
+static FoldResult compile_node(Compiler* compiler, const Predicate* predicate, bool negate);
+
+/* NOT (a AND b) compiles as NOT a OR NOT b, and the other way round. */
+static FoldResult compile_logical(Compiler* compiler, const Predicate* predicate, bool negate) {
+    bool is_and = (predicate->op == PRED_AND) != negate;
+    FoldResult absorbing = is_and ? FOLD_FALSE : FOLD_TRUE;
+
+    size_t start = compiler->program->count;
+    size_t start_depth = compiler->depth;
+
+    FoldResult left = compile_node(compiler, predicate->left, negate);
+    if (left == absorbing) return absorbing;
+    if (left != FOLD_DYNAMIC) return compile_node(compiler, predicate->right, negate);
+
+    size_t jump = compiler->program->count;
+    if (!emit(compiler, is_and ? OP_JUMP_IF_NONE : OP_JUMP_IF_ALL, 0)) return FOLD_FALSE;
+
+    FoldResult right = compile_node(compiler, predicate->right, negate);
+    if (right == absorbing) {
+        compiler->program->count = start;
+        compiler->depth = start_depth;
+        return absorbing;
+    }
+    if (right != FOLD_DYNAMIC) {
+        compiler->program->count = jump;
+        return FOLD_DYNAMIC;
+    }
+
+    if (!emit(compiler, is_and ? OP_AND : OP_OR, -1)) return FOLD_FALSE;
+    compiler->program->code[jump].jump = (uint32_t)compiler->program->count;
+    return FOLD_DYNAMIC;
+}
+
+/* NOT is pushed down to the leaves, so no instruction ever inverts a mask. */
+static FoldResult compile_node(Compiler* compiler, const Predicate* predicate, bool negate) {
+    if (!predicate || compiler->failed) {
+        compiler->failed = true;
+        return FOLD_FALSE;
+    }
+
+    switch (predicate->op) {
+        case PRED_AND:
+        case PRED_OR:
+            return compile_logical(compiler, predicate, negate);
+        case PRED_NOT:
+            return compile_node(compiler, predicate->left, !negate);
+        default:
+            return compile_leaf(compiler, predicate, negate);
+    }
+}
+
+PredicateProgram* predicate_compile(const Predicate* predicate) {
+    if (!predicate) return NULL;
+
+    PredicateProgram* program = malloc(sizeof(PredicateProgram));
+    if (!program) return NULL;
+
+    program->code = NULL;
+    program->count = 0;
+    program->capacity = 0;
+    program->stack_depth = 0;
+    program->stack = NULL;
+
+    Compiler compiler = { program, 0, false };
+    FoldResult result = compile_node(&compiler, predicate, false);
+
+    if (!compiler.failed && result != FOLD_DYNAMIC) {
+        program->count = 0;
+        PredicateInstruction* instruction = emit(&compiler, OP_CONST, 1);
+        if (instruction) instruction->low.boolean = result == FOLD_TRUE;
+    }
+
+    if (!compiler.failed) {
+        program->stack = malloc(program->stack_depth * RECORD_BATCH_SIZE);
+    }
+
+    if (compiler.failed || !program->stack) {
+        predicate_program_destroy(program);
+        return NULL;
+    }
+
+    return program;
+}
+
+void predicate_program_destroy(PredicateProgram* program) {
+    if (!program) return;
+
+    free(program->code);
+    free(program->stack);
+    free(program);
+}
+
+bool predicate_program_is_constant(const PredicateProgram* program, bool* out_value) {
+    if (!program || program->count != 1 || program->code[0].opcode != OP_CONST) return false;
+    if (out_value) *out_value = program->code[0].low.boolean;
+    return true;
+}
+
+static void cmp_int(DataRecord* const* records, size_t count, const PredicateInstruction* in, uint8_t* out) {
+    uint32_t column = in->column;
+    int64_t low = in->low.integer;
+    int64_t high = in->high.integer;
+
+#define INT_KERNEL(test) \
+    for (size_t i = 0; i < count; i++) { \
+        const Value* v = &records[i]->values[column]; \
+        int64_t x = v->data.integer; \
+        out[i] = (v->type == VALUE_INTEGER) & (test); \
+    }
+
+    switch (in->cmp) {
+        case PRED_EQ: INT_KERNEL(x == low); break;
+        case PRED_NE: INT_KERNEL(x != low); break;
+        case PRED_LT: INT_KERNEL(x < low); break;
+        case PRED_LE: INT_KERNEL(x <= low); break;
+        case PRED_GT: INT_KERNEL(x > low); break;
+        case PRED_GE: INT_KERNEL(x >= low); break;
+        case PRED_BETWEEN: INT_KERNEL((x >= low) & (x <= high)); break;
+        default: memset(out, 0, count); break;
+    }
+#undef INT_KERNEL
+}
+
+static void cmp_id(DataRecord* const* records, size_t count, const PredicateInstruction* in, uint8_t* out) {
+    int64_t low = in->low.integer;
+    int64_t high = in->high.integer;
+
+#define ID_KERNEL(test) \
+    for (size_t i = 0; i < count; i++) { \
+        int64_t x = (int64_t)records[i]->id; \
+        out[i] = (test); \
+    }
+
+    switch (in->cmp) {
+        case PRED_EQ: ID_KERNEL(x == low); break;
+        case PRED_NE: ID_KERNEL(x != low); break;
+        case PRED_LT: ID_KERNEL(x < low); break;
+        case PRED_LE: ID_KERNEL(x <= low); break;
+        case PRED_GT: ID_KERNEL(x > low); break;
+        case PRED_GE: ID_KERNEL(x >= low); break;
+        case PRED_BETWEEN: ID_KERNEL((x >= low) & (x <= high)); break;
+        default: memset(out, 0, count); break;
+    }
+#undef ID_KERNEL
+}
+
+static void cmp_float(DataRecord* const* records, size_t count, const PredicateInstruction* in, uint8_t* out) {
+    uint32_t column = in->column;
+    double low = in->low.float_val;
+    double high = in->high.float_val;
+
+#define FLOAT_KERNEL(test) \
+    for (size_t i = 0; i < count; i++) { \
+        const Value* v = &records[i]->values[column]; \
+        double x = v->data.float_val; \
+        out[i] = (v->type == VALUE_FLOAT) & (test); \
+    }
+
+    switch (in->cmp) {
+        case PRED_EQ: FLOAT_KERNEL(x == low); break;
+        case PRED_NE: FLOAT_KERNEL(x != low); break;
+        case PRED_LT: FLOAT_KERNEL(x < low); break;
+        case PRED_LE: FLOAT_KERNEL(x <= low); break;
+        case PRED_GT: FLOAT_KERNEL(x > low); break;
+        case PRED_GE: FLOAT_KERNEL(x >= low); break;
+        case PRED_BETWEEN: FLOAT_KERNEL((x >= low) & (x <= high)); break;
+        default: memset(out, 0, count); break;
+    }
+#undef FLOAT_KERNEL
+}
+
+static void cmp_bool(DataRecord* const* records, size_t count, const PredicateInstruction* in, uint8_t* out) {
+    uint32_t column = in->column;
+    bool literal = in->low.boolean;
+
+    for (size_t i = 0; i < count; i++) {
+        const Value* v = &records[i]->values[column];
+        out[i] = (v->type == VALUE_BOOLEAN) && v->data.boolean == literal;
+    }
+}
+
+static void cmp_string(DataRecord* const* records, size_t count, const PredicateInstruction* in, uint8_t* out) {
+    uint32_t column = in->column;
+
+    for (size_t i = 0; i < count; i++) {
+        const Value* v = &records[i]->values[column];
+        /* A string without text is NULL, which no comparison matches. */
+        if (v->type != VALUE_STRING || !v->data.string) {
+            out[i] = 0;
+            continue;
+        }
+
+        int cmp = strcmp(v->data.string, in->low.string);
+        switch (in->cmp) {
+            case PRED_EQ: out[i] = cmp == 0; break;
+            case PRED_NE: out[i] = cmp != 0; break;
+            case PRED_LT: out[i] = cmp < 0; break;
+            case PRED_LE: out[i] = cmp <= 0; break;
+            case PRED_GT: out[i] = cmp > 0; break;
+            case PRED_GE: out[i] = cmp >= 0; break;
+            case PRED_BETWEEN: out[i] = cmp >= 0 && strcmp(v->data.string, in->high.string) <= 0; break;
+            default: out[i] = 0; break;
+        }
+    }
+}
+
+static void null_check(DataRecord* const* records, size_t count, uint32_t column, uint8_t want_null, uint8_t* out) {
+    for (size_t i = 0; i < count; i++) {
+        const Value* v = &records[i]->values[column];
+        bool is_null = v->type == VALUE_NULL || (v->type == VALUE_STRING && !v->data.string);
+        out[i] = is_null == want_null;
+    }
+}
+
+static bool mask_is_uniform(const uint8_t* mask, size_t count, uint8_t value) {
+    for (size_t i = 0; i < count; i++) {
+        if (mask[i] != value) return false;
+    }
+    return true;
+}
+
+static const uint8_t* run_batch(PredicateProgram* program, DataRecord* const* records, size_t count) {
+    uint8_t* top = program->stack - RECORD_BATCH_SIZE;
+    const PredicateInstruction* code = program->code;
+
+    for (size_t pc = 0; pc < program->count; pc++) {
+        const PredicateInstruction* in = &code[pc];
+
+        switch (in->opcode) {
+            case OP_CONST:
+                top += RECORD_BATCH_SIZE;
+                memset(top, in->low.boolean, count);
+                break;
+            case OP_CMP_INT:
+                top += RECORD_BATCH_SIZE;
+                cmp_int(records, count, in, top);
+                break;
+            case OP_CMP_FLOAT:
+                top += RECORD_BATCH_SIZE;
+                cmp_float(records, count, in, top);
+                break;
+            case OP_CMP_BOOL:
+                top += RECORD_BATCH_SIZE;
+                cmp_bool(records, count, in, top);
+                break;
+            case OP_CMP_STRING:
+                top += RECORD_BATCH_SIZE;
+                cmp_string(records, count, in, top);
+                break;
+            case OP_CMP_ID:
+                top += RECORD_BATCH_SIZE;
+                cmp_id(records, count, in, top);
+                break;
+            case OP_IS_NULL:
+            case OP_NOT_NULL:
+                top += RECORD_BATCH_SIZE;
+                null_check(records, count, in->column, in->opcode == OP_IS_NULL, top);
+                break;
+            case OP_AND:
+                top -= RECORD_BATCH_SIZE;
+                for (size_t i = 0; i < count; i++) top[i] &= top[i + RECORD_BATCH_SIZE];
+                break;
+            case OP_OR:
+                top -= RECORD_BATCH_SIZE;
+                for (size_t i = 0; i < count; i++) top[i] |= top[i + RECORD_BATCH_SIZE];
+                break;
+            case OP_JUMP_IF_NONE:
+                if (mask_is_uniform(top, count, 0)) pc = in->jump - 1;
+                break;
+            case OP_JUMP_IF_ALL:
+                if (mask_is_uniform(top, count, 1)) pc = in->jump - 1;
+                break;
+        }
+    }
+
+    return top;
+}
+
+bool predicate_program_run(PredicateProgram* program, DataRecord* const* records, size_t count, uint8_t* out_mask) {
+    if (!program || (!records && count > 0) || !out_mask) return false;
+
+    for (size_t start = 0; start < count; start += RECORD_BATCH_SIZE) {
+        size_t chunk = count - start < RECORD_BATCH_SIZE ? count - start : RECORD_BATCH_SIZE;
+        memcpy(out_mask + start, run_batch(program, records + start, chunk), chunk);
+    }
+    return true;
+}
+
+size_t predicate_program_filter(PredicateProgram* program, DataRecord** records, size_t count) {
+    if (!program || !records) return 0;
+
+    size_t kept = 0;
+    for (size_t start = 0; start < count; start += RECORD_BATCH_SIZE) {
+        size_t chunk = count - start < RECORD_BATCH_SIZE ? count - start : RECORD_BATCH_SIZE;
+        const uint8_t* mask = run_batch(program, records + start, chunk);
+
+        for (size_t i = 0; i < chunk; i++) {
+            records[kept] = records[start + i];
+            kept += mask[i];
+        }
+    }
+    return kept;
+}
@@ -0,0 +1,54 @@
+#ifndef SHADE_QUERY_BYTECODE_H
+#define SHADE_QUERY_BYTECODE_H
+
+#include "predicate.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    OP_CONST,
+    OP_CMP_INT,
+    OP_CMP_FLOAT,
+    OP_CMP_BOOL,
+    OP_CMP_STRING,
+    OP_CMP_ID,
+    OP_IS_NULL,
+    OP_NOT_NULL,
+    OP_AND,
+    OP_OR,
+    OP_JUMP_IF_NONE,
+    OP_JUMP_IF_ALL
+} PredicateOpcode;
+
+typedef struct {
+    uint8_t opcode;
+    uint8_t cmp;
+    uint32_t column;
+    uint32_t jump;
+    union {
+        int64_t integer;
+        double float_val;
+        bool boolean;
+        const char* string;
+    } low, high;
+} PredicateInstruction;
+
+/* String literals are borrowed from the bound predicate, which must outlive the program.
+ * Programs keep their own mask stack, so one program must not run on two threads at once. */
+typedef struct {
+    PredicateInstruction* code;
+    size_t count;
+    size_t capacity;
+    size_t stack_depth;
+    uint8_t* stack;
+} PredicateProgram;
+
+PredicateProgram* predicate_compile(const Predicate* predicate);
+void predicate_program_destroy(PredicateProgram* program);
+
+/* Writes one byte per record into out_mask: 1 if the record matches, 0 otherwise. */
+bool predicate_program_run(PredicateProgram* program, DataRecord* const* records, size_t count, uint8_t* out_mask);
+size_t predicate_program_filter(PredicateProgram* program, DataRecord** records, size_t count);
+bool predicate_program_is_constant(const PredicateProgram* program, bool* out_value);
+
+#endif
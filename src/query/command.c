@@ -0,0 +1,123 @@
+#include "command.h"
+#include <stdio.h>
+#include <string.h>
+
+Command* command_create(CommandType type) {
+    Command* command = calloc(1, sizeof(Command));
+    if (!command) return NULL;
+
+    command->type = type;
+    command->format = COPY_FORMAT_AUTO;
+    return command;
+}
+
+void command_destroy(Command* command) {
+    if (!command) return;
+
+    for (size_t i = 0; i < command->column_count; i++) {
+        free((char*)command->columns[i].name);
+    }
+    free(command->columns);
+
+    for (size_t r = 0; r < command->row_count; r++) {
+        for (size_t i = 0; i < command->row_width; i++) {
+            value_destroy(&command->rows[r][i]);
+        }
+        free(command->rows[r]);
+    }
+    free(command->rows);
+
+    free(command->text);
+    free(command->table_name);
+    free(command->path);
+    free(command);
+}
+
+bool command_create_table(MemoryStorage* storage, const Command* command, char* error, size_t error_size) {
+    TableSchema* schema = tableschema_create(command->table_name, command->columns, command->column_count);
+    if (!schema) {
+        snprintf(error, error_size, "Failed to create table schema");
+        return false;
+    }
+
+    if (!memory_storage_create_table(storage, command->table_name, schema)) {
+        snprintf(error, error_size, "Table '%s' already exists", command->table_name);
+        tableschema_destroy(schema);
+        return false;
+    }
+    return true;
+}
+
+/* Literals convert to the column type only where nothing is lost; 0 and 1 stand for booleans. */
+static bool coerce_value(Value* value, const ColumnSchema* column, char* error, size_t error_size) {
+    if (value->type == VALUE_NULL || value->type == column->type) return true;
+
+    if (value->type == VALUE_INTEGER && column->type == VALUE_FLOAT) {
+        *value = value_float((double)value->data.integer);
+        return true;
+    }
+    if (value->type == VALUE_INTEGER && column->type == VALUE_BOOLEAN &&
+        (value->data.integer == 0 || value->data.integer == 1)) {
+        *value = value_boolean(value->data.integer == 1);
+        return true;
+    }
+
+    snprintf(error, error_size, "Column '%s' expects %s", column->name, value_type_to_string(column->type));
+    return false;
+}
+
+MemoryTable* command_coerce_rows(MemoryStorage* storage, Command* command, char* error, size_t error_size) {
+    MemoryTable* table = memory_storage_get_table(storage, command->table_name);
+    if (!table) {
+        snprintf(error, error_size, "Table '%s' not found", command->table_name);
+        return NULL;
+    }
+
+    const TableSchema* schema = table->schema;
+    if (command->row_width != schema->column_count) {
+        snprintf(error, error_size, "Expected %zu values, got %zu", schema->column_count, command->row_width);
+        return NULL;
+    }
+
+    for (size_t r = 0; r < command->row_count; r++) {
+        for (size_t i = 0; i < command->row_width; i++) {
+            if (!coerce_value(&command->rows[r][i], &schema->columns[i], error, error_size)) return NULL;
+        }
+    }
+    return table;
+}
+
+uint64_t command_insert(MemoryStorage* storage, Command* command, char* error, size_t error_size) {
+    MemoryTable* table = command_coerce_rows(storage, command, error, error_size);
+    if (!table) return 0;
+
+    uint64_t first_id = memory_table_insert_batch_owned(table, command->rows, command->row_count);
+    if (first_id == 0) {
+        snprintf(error, error_size, "Failed to insert record");
+        return 0;
+    }
+
+    /* The table owns the rows now. */
+    free(command->rows);
+    command->rows = NULL;
+    command->row_count = 0;
+    return first_id;
+}
+
+bool command_analyze(MemoryStorage* storage, const char* table_name, char* error, size_t error_size) {
+    for (size_t i = 0; i < storage->table_count; i++) {
+        MemoryTable* table = storage->tables[i];
+        if (table_name && strcmp(table->name, table_name) != 0) continue;
+        if (!memory_table_analyze(table)) {
+            snprintf(error, error_size, "Failed to analyze table '%s'", table->name);
+            return false;
+        }
+        if (table_name) return true;
+    }
+
+    if (table_name) {
+        snprintf(error, error_size, "Table '%s' not found", table_name);
+        return false;
+    }
+    return true;
+}
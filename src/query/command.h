@@ -0,0 +1,69 @@
+#ifndef SHADE_QUERY_COMMAND_H
+#define SHADE_QUERY_COMMAND_H
+
+#include "../storage/copy.h"
+#include "../storage/memory.h"
+#include "../types/schema.h"
+#include "../types/value.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef enum {
+    COMMAND_EMPTY,
+    COMMAND_QUERY,
+    COMMAND_CREATE_TABLE,
+    COMMAND_DROP_TABLE,
+    COMMAND_INSERT,
+    COMMAND_COPY_FROM,
+    COMMAND_COPY_TO,
+    COMMAND_RESURRECT,
+    COMMAND_GHOST_STATS,
+    COMMAND_DECAY_GHOSTS,
+    COMMAND_ANALYZE,
+    COMMAND_STATS,
+    COMMAND_USE,
+    COMMAND_SAVE,
+    COMMAND_ENABLE_PERSISTENCE,
+    COMMAND_DEBUG_INFO,
+    COMMAND_HELP,
+    COMMAND_EXIT
+} CommandType;
+
+/* One parsed shell statement. Queries keep only their text, which the statement cache parses
+ * on a miss; everything else is fully parsed. */
+typedef struct {
+    CommandType type;
+    char* text;
+    char* table_name;
+    char* path;
+
+    ColumnSchema* columns;
+    size_t column_count;
+
+    /* INSERT literals as written; the caller converts them to the column types. */
+    Value** rows;
+    size_t row_count;
+    size_t row_width;
+
+    CopyFormat format;
+    bool include_ghosts;
+    uint64_t id;
+    double amount;
+} Command;
+
+Command* command_create(CommandType type);
+void command_destroy(Command* command);
+
+/* Shared by every front end that runs commands; errors are written without an "Error: " prefix. */
+bool command_create_table(MemoryStorage* storage, const Command* command, char* error, size_t error_size);
+/* Checks an INSERT against its table and converts the literals to the column types in place.
+ * Returns the table, or NULL on error. */
+MemoryTable* command_coerce_rows(MemoryStorage* storage, Command* command, char* error, size_t error_size);
+/* Converts the literals to the column types and appends the rows, which the table then owns.
+ * Returns the first new id, or 0 on error. */
+uint64_t command_insert(MemoryStorage* storage, Command* command, char* error, size_t error_size);
+/* Refreshes the statistics of one table, or of every table when table_name is NULL. */
+bool command_analyze(MemoryStorage* storage, const char* table_name, char* error, size_t error_size);
+
+#endif
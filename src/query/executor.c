@@ -1,4 +1,7 @@
 #include "executor.h"
+#include "batch.h"
+#include "planner.h"
+#include "../util/parallel.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -17,6 +20,21 @@ Query* query_create(QueryType type, const char* table_name) {
     query->target_id = 0;
     query->include_ghosts = false;
     query->ghost_threshold = 0.0f;
+    query->where = NULL;
+    query->aggregates = NULL;
+    query->aggregate_count = 0;
+    query->group_by = NULL;
+    query->group_count = 0;
+    query->memory_budget = 0;
+    query->order_by = NULL;
+    query->order_count = 0;
+    query->limit = 0;
+    query->has_limit = false;
+    query->offset = 0;
+    query->join = NULL;
+    query->parameter_count = 0;
+    query->explain = EXPLAIN_NONE;
+    query->profile = NULL;
     
     return query;
 }
@@ -40,64 +58,1083 @@ void query_destroy(Query* query) {
         free(query->insert_values);
     }
     
+    predicate_destroy(query->where);
+    
+    for (size_t i = 0; i < query->aggregate_count; i++) {
+        aggregate_free(&query->aggregates[i]);
+    }
+    free(query->aggregates);
+    
+    for (size_t i = 0; i < query->group_count; i++) {
+        free(query->group_by[i].column);
+    }
+    free(query->group_by);
+    
+    for (size_t i = 0; i < query->order_count; i++) {
+        free(query->order_by[i].column);
+    }
+    free(query->order_by);
+    join_clause_destroy(query->join);
     free(query);
 }
 
-static QueryResult* execute_select(Query* query, QueryResult* result, MemoryTable* table) {
-    size_t record_count = 0;
-    DataRecord** all_records = memory_table_scan(table, &record_count);
+bool query_is_aggregate(const Query* query) {
+    return query->aggregate_count > 0 || query->group_count > 0;
+}
+
+static bool query_has_output(const Query* query, const char* name) {
+    for (size_t i = 0; i < query->select_count; i++) {
+        if (string_case_compare(query->select_columns[i], name) == 0) return true;
+    }
     
-    if (!all_records) {
-        result->count = 0;
-        return result;
+    bool found = false;
+    for (size_t i = 0; i < query->aggregate_count && !found; i++) {
+        char* aggregate = aggregate_name(&query->aggregates[i]);
+        found = aggregate && string_case_compare(aggregate, name) == 0;
+        free(aggregate);
+    }
+    return found;
+}
+
+size_t* query_column_map(const Query* query, const TableSchema* schema, size_t* out_count) {
+    if (!query || !schema || !out_count) return NULL;
+    
+    bool derived = query_is_aggregate(query);
+    size_t count = query->select_count > 0 ? query->select_count : schema->column_count;
+    if (derived) count = query->select_count + query->aggregate_count;
+    
+    size_t* map = malloc(sizeof(size_t) * (count ? count : 1));
+    if (!map) return NULL;
+    
+    for (size_t i = 0; i < count; i++) {
+        if (query->select_count == 0 || derived) {
+            map[i] = i;
+            continue;
+        }
+        
+        int column = tableschema_find_column(schema, query->select_columns[i]);
+        if (column < 0) {
+            free(map);
+            return NULL;
+        }
+        map[i] = (size_t)column;
+    }
+    
+    *out_count = count;
+    return map;
+}
+
+bool query_bind(Query* query, const TableSchema* schema, char* error, size_t error_size) {
+    if (!query || !schema) return false;
+    
+    for (size_t i = 0; i < query->select_count; i++) {
+        int column = tableschema_find_column(schema, query->select_columns[i]);
+        if (column < 0) {
+            if (error && error_size > 0) {
+                snprintf(error, error_size, "%s '%s'", tableschema_lookup_message(column), query->select_columns[i]);
+            }
+            return false;
+        }
+    }
+    
+    for (size_t i = 0; i < query->aggregate_count; i++) {
+        if (!aggregate_bind(&query->aggregates[i], schema, error, error_size)) return false;
+    }
+    
+    for (size_t i = 0; i < query->group_count; i++) {
+        if (!group_column_bind(&query->group_by[i], schema, error, error_size)) return false;
+    }
+    
+    for (size_t i = 0; query_is_aggregate(query) && i < query->select_count; i++) {
+        bool grouped = false;
+        for (size_t key = 0; key < query->group_count && !grouped; key++) {
+            grouped = string_case_compare(query->group_by[key].column, query->select_columns[i]) == 0;
+        }
+        if (!grouped) {
+            if (error && error_size > 0) {
+                snprintf(error, error_size, "Column '%s' must appear in GROUP BY", query->select_columns[i]);
+            }
+            return false;
+        }
+    }
+    
+    for (size_t i = 0; i < query->order_count; i++) {
+        if (!query_is_aggregate(query)) {
+            if (!sort_key_bind(&query->order_by[i], schema, error, error_size)) return false;
+        } else if (!query_has_output(query, query->order_by[i].column)) {
+            if (error && error_size > 0) {
+                snprintf(error, error_size, "ORDER BY column '%s' must appear in the select list",
+                         query->order_by[i].column);
+            }
+            return false;
+        }
+    }
+    
+    return !query->where || predicate_bind(query->where, schema, error, error_size);
+}
+
+bool query_bind_join(Query* query, const TableSchema* left, const TableSchema* right, char* error, size_t error_size) {
+    if (!query || !query->join) return false;
+    if (!join_clause_bind(query->join, left, right, error, error_size)) return false;
+    
+    TableSchema* schema = join_schema(left, right);
+    bool bound = schema && query_bind(query, schema, error, error_size);
+    tableschema_destroy(schema);
+    return bound;
+}
+
+static bool record_accepted(const DataRecord* record, bool include_ghosts, float ghost_threshold) {
+    if (record->state == DATA_STATE_GHOST) {
+        return include_ghosts && record->ghost_strength >= ghost_threshold;
+    }
+    return record->state != DATA_STATE_EXORCISED;
+}
+
+static bool select_accepts_record(const Query* query, const DataRecord* record) {
+    return record_accepted(record, query->include_ghosts, query->ghost_threshold);
+}
+
+static size_t fetch_matching(MemoryTable* table, const Query* query, PredicateProgram* filter,
+                             size_t* position, size_t end, size_t* ghost_count, size_t* exorcised_count,
+                             DataRecord** records, size_t max_records) {
+    size_t fetched = 0;
+    
+    while (fetched < max_records && *position < end) {
+        size_t candidates = 0;
+        size_t wanted = max_records - fetched;
+        
+        while (candidates < wanted && *position < end) {
+            DataRecord* record = table->records[(*position)++];
+            
+            if (record->state == DATA_STATE_GHOST) {
+                (*ghost_count)++;
+            } else if (record->state == DATA_STATE_EXORCISED) {
+                (*exorcised_count)++;
+            }
+            
+            if (select_accepts_record(query, record)) {
+                records[fetched + candidates++] = record;
+            }
+        }
+        
+        if (filter && candidates > 0) {
+            candidates = predicate_program_filter(filter, records + fetched, candidates);
+        }
+        fetched += candidates;
+    }
+    
+    return fetched;
+}
+
+static PredicateProgram* compile_where(const Query* query, const TableSchema* schema, bool* failed) {
+    *failed = false;
+    if (!query->where) return NULL;
+    
+    PredicateProgram* program = NULL;
+    if (predicate_bind(query->where, schema, NULL, 0)) {
+        program = predicate_compile(query->where);
+    }
+    
+    *failed = program == NULL;
+    
+    bool constant;
+    if (predicate_program_is_constant(program, &constant) && constant) {
+        predicate_program_destroy(program);
+        return NULL;
+    }
+    return program;
+}
+
+/* The first stage of a query reads the table; later ones work on rows an earlier stage produced. */
+static bool stage_is_first(const Query* query) {
+    return !query->profile || query->profile->operator_count == 0;
+}
+
+static OperatorProfile* begin_scan(const Query* query, const MemoryTable* table) {
+    if (stage_is_first(query)) return profile_begin(query->profile, OPERATOR_SCAN, NULL, "Seq Scan on %s", table->name);
+    return profile_begin(query->profile, OPERATOR_SCAN, NULL, "Filter");
+}
+
+static OperatorProfile* begin_aggregate(const Query* query, const MemoryTable* table) {
+    const char* kind = query->group_count > 0 ? "Group Aggregate" : "Aggregate";
+    if (stage_is_first(query)) return profile_begin(query->profile, OPERATOR_AGGREGATE, NULL, "%s on %s", kind, table->name);
+    return profile_begin(query->profile, OPERATOR_AGGREGATE, NULL, "%s", kind);
+}
+
+static OperatorProfile* begin_sort(const Query* query) {
+    return profile_begin(query->profile, OPERATOR_SORT, NULL, "Sort (%zu key%s)", query->order_count,
+                         query->order_count == 1 ? "" : "s");
+}
+
+static OperatorProfile* begin_limit(const Query* query) {
+    if (!query->has_limit) return profile_begin(query->profile, OPERATOR_LIMIT, NULL, "Offset %zu", query->offset);
+    return profile_begin(query->profile, OPERATOR_LIMIT, NULL, "Limit %zu offset %zu", query->limit, query->offset);
+}
+
+/* Records the plan's estimate on the stage that applies the WHERE clause, if `first` is one. */
+static void estimate_rows(const Query* query, size_t first, double rows) {
+    QueryProfile* profile = query->profile;
+    if (profile && first < profile->operator_count && profile->operators[first].kind == OPERATOR_SCAN) {
+        profile->operators[first].estimated_rows = rows;
+    }
+}
+
+static void skip_matching(MemoryTable* table, const Query* query, PredicateProgram* filter,
+                          size_t* position, size_t end, size_t* ghost_count, size_t* exorcised_count,
+                          size_t* skip) {
+    DataRecord* skipped[RECORD_BATCH_SIZE];
+    
+    while (*skip > 0 && *position < end) {
+        size_t wanted = *skip < RECORD_BATCH_SIZE ? *skip : RECORD_BATCH_SIZE;
+        *skip -= fetch_matching(table, query, filter, position, end, ghost_count, exorcised_count,
+                                skipped, wanted);
+    }
+}
+
+#define SCAN_CHUNK_ROWS (64 * 1024)
+
+typedef struct {
+    MemoryTable* table;
+    const Query* query;
+    PredicateProgram** filters;
+    AggregateState* states;
+    GroupBy* groups;
+    size_t* ghost_counts;
+    size_t* exorcised_counts;
+} AggregateJob;
+
+static void aggregate_chunk(void* context, size_t index) {
+    AggregateJob* job = context;
+    const Query* query = job->query;
+    AggregateState* states = job->states + index * query->aggregate_count;
+    
+    size_t position = index * SCAN_CHUNK_ROWS;
+    size_t end = position + SCAN_CHUNK_ROWS;
+    if (end > job->table->record_count) end = job->table->record_count;
+    
+    for (size_t i = 0; !job->groups && i < query->aggregate_count; i++) {
+        aggregate_state_init(&states[i]);
+    }
+    
+    DataRecord* batch[RECORD_BATCH_SIZE];
+    while (position < end) {
+        size_t count = fetch_matching(job->table, query, job->filters[index], &position, end,
+                                      &job->ghost_counts[index], &job->exorcised_counts[index],
+                                      batch, RECORD_BATCH_SIZE);
+        
+        if (job->groups) {
+            if (!groupby_add(job->groups, index, batch, count)) return;
+            continue;
+        }
+        
+        for (size_t i = 0; i < query->aggregate_count; i++) {
+            aggregate_accumulate(&query->aggregates[i], &states[i], batch, count);
+        }
+    }
+}
+
+static GroupOutput* aggregate_outputs(const Query* query, size_t* out_count) {
+    size_t count = query->select_count + query->aggregate_count;
+    GroupOutput* outputs = calloc(count ? count : 1, sizeof(GroupOutput));
+    bool* taken = calloc(count ? count : 1, sizeof(bool));
+    if (!outputs || !taken) {
+        free(outputs);
+        free(taken);
+        return NULL;
+    }
+    
+    for (size_t i = 0; i < query->aggregate_count; i++) {
+        size_t position = query->aggregates[i].position;
+        outputs[position].is_aggregate = true;
+        outputs[position].index = i;
+        taken[position] = true;
+    }
+    
+    size_t position = 0;
+    for (size_t i = 0; i < query->select_count; i++) {
+        while (taken[position]) position++;
+        
+        for (size_t key = 0; key < query->group_count; key++) {
+            if (string_case_compare(query->group_by[key].column, query->select_columns[i]) == 0) {
+                outputs[position].index = key;
+                break;
+            }
+        }
+        position++;
+    }
+    
+    free(taken);
+    *out_count = count;
+    return outputs;
+}
+
+static TableSchema* aggregate_schema(const Query* query, const GroupOutput* outputs, size_t count,
+                                     const TableSchema* source) {
+    ColumnSchema* columns = calloc(count, sizeof(ColumnSchema));
+    if (!columns) return NULL;
+    
+    TableSchema* schema = NULL;
+    bool named = true;
+    for (size_t i = 0; i < count; i++) {
+        if (outputs[i].is_aggregate) {
+            const Aggregate* aggregate = &query->aggregates[outputs[i].index];
+            columns[i].name = aggregate_name(aggregate);
+            columns[i].type = aggregate_result_type(aggregate);
+        } else {
+            const ColumnSchema* column = &source->columns[query->group_by[outputs[i].index].column_index];
+            columns[i].name = string_duplicate(column->name);
+            columns[i].type = column->type;
+        }
+        named = named && columns[i].name;
+    }
+    
+    if (named) schema = tableschema_create(source->name, columns, count);
+    
+    for (size_t i = 0; i < count; i++) {
+        free(columns[i].name);
+    }
+    free(columns);
+    return schema;
+}
+
+static bool finish_totals(Query* query, AggregateJob* job, size_t chunk_count, QueryResult* result) {
+    result->records = malloc(sizeof(DataRecord*));
+    Value* values = malloc(sizeof(Value) * query->aggregate_count);
+    if (!result->records || !values) {
+        free(values);
+        return false;
+    }
+    
+    for (size_t i = 0; i < query->aggregate_count; i++) {
+        AggregateState* total = &job->states[i];
+        for (size_t chunk = 1; chunk < chunk_count; chunk++) {
+            aggregate_merge(&query->aggregates[i], total, &job->states[chunk * query->aggregate_count + i]);
+        }
+        values[i] = aggregate_finalize(&query->aggregates[i], total);
+    }
+    
+    result->records[0] = datarecord_create_owned(0, values, query->aggregate_count);
+    if (!result->records[0]) {
+        for (size_t i = 0; i < query->aggregate_count; i++) {
+            value_destroy(&values[i]);
+        }
+        free(values);
+        return false;
+    }
+    
+    result->count = 1;
+    return true;
+}
+
+static size_t partition_bits_for(size_t record_count) {
+    if (record_count < SCAN_CHUNK_ROWS) return 0;
+    
+    size_t bits = 0;
+    while (bits < GROUPBY_MAX_PARTITION_BITS && ((size_t)1 << bits) < parallel_worker_count() * 4) bits++;
+    return bits;
+}
+
+static QueryResult* execute_aggregate(Query* query, QueryResult* result, MemoryTable* table) {
+    size_t chunk_count = (table->record_count + SCAN_CHUNK_ROWS - 1) / SCAN_CHUNK_ROWS;
+    if (chunk_count == 0) chunk_count = 1;
+    OperatorProfile* op = begin_aggregate(query, table);
+    
+    size_t output_count = 0;
+    GroupOutput* outputs = aggregate_outputs(query, &output_count);
+    
+    AggregateJob job = {
+        .table = table,
+        .query = query,
+        .filters = calloc(chunk_count, sizeof(PredicateProgram*)),
+        .states = malloc(sizeof(AggregateState) * (chunk_count * query->aggregate_count + 1)),
+        .ghost_counts = calloc(chunk_count, sizeof(size_t)),
+        .exorcised_counts = calloc(chunk_count, sizeof(size_t))
+    };
+    
+    if (outputs && query->group_count > 0) {
+        job.groups = groupby_create(query->group_by, query->group_count, query->aggregates,
+                                    query->aggregate_count, outputs, output_count, chunk_count,
+                                    partition_bits_for(table->record_count), query->memory_budget);
+    }
+    
+    bool failed = !outputs || !job.filters || !job.states || !job.ghost_counts || !job.exorcised_counts ||
+                  (query->group_count > 0 && !job.groups);
+    for (size_t i = 0; i < chunk_count && !failed; i++) {
+        job.filters[i] = compile_where(query, table->schema, &failed);
+    }
+    
+    if (!failed) failed = !parallel_run(chunk_count, aggregate_chunk, &job);
+    
+    if (!failed) {
+        result->derived = true;
+        result->schema = aggregate_schema(query, outputs, output_count, table->schema);
+        failed = !result->schema;
+    }
+    
+    if (!failed && job.groups) {
+        failed = !groupby_finish(job.groups, &result->records, &result->count);
+    } else if (!failed) {
+        failed = !finish_totals(query, &job, chunk_count, result);
+    }
+    
+    for (size_t chunk = 0; !failed && chunk < chunk_count; chunk++) {
+        result->ghost_count += job.ghost_counts[chunk];
+        result->exorcised_count += job.exorcised_counts[chunk];
+    }
+    
+    profile_count_allocations(op, 5 + chunk_count + (job.groups ? 1 : 0) + (failed ? 0 : result->count));
+    profile_end(op, table->record_count, failed ? 0 : result->count);
+    
+    for (size_t i = 0; job.filters && i < chunk_count; i++) {
+        predicate_program_destroy(job.filters[i]);
+    }
+    groupby_destroy(job.groups);
+    free(job.filters);
+    free(job.states);
+    free(job.ghost_counts);
+    free(job.exorcised_counts);
+    free(outputs);
+    
+    if (failed) {
+        queryresult_destroy(result);
+        return NULL;
+    }
+    return result;
+}
+
+/* Beyond this many rows a full sort beats keeping a heap per scan chunk. */
+#define ORDER_TOPK_MAX_ROWS 4096
+
+/* Rows needed to cover OFFSET plus LIMIT, or SIZE_MAX when unlimited. */
+static size_t window_end(const Query* query) {
+    if (!query->has_limit) return SIZE_MAX;
+    return query->limit > SIZE_MAX - query->offset ? SIZE_MAX : query->offset + query->limit;
+}
+
+static void apply_window(const Query* query, QueryResult* result) {
+    OperatorProfile* op = query->has_limit || query->offset > 0 ? begin_limit(query) : NULL;
+    size_t rows_in = result->count;
+    size_t start = query->offset < result->count ? query->offset : result->count;
+    size_t end = window_end(query) < result->count ? window_end(query) : result->count;
+    
+    for (size_t i = 0; result->derived && i < result->count; i++) {
+        if (i < start || i >= end) datarecord_destroy(result->records[i]);
+    }
+    
+    if (start > 0) memmove(result->records, result->records + start, sizeof(DataRecord*) * (end - start));
+    result->count = end - start;
+    profile_end(op, rows_in, result->count);
+}
+
+static bool sort_result(const Query* query, QueryResult* result) {
+    OperatorProfile* op = begin_sort(query);
+    bool success = sort_records(result->records, result->count, query->order_by, query->order_count);
+    profile_count_allocations(op, result->count > 1 ? 2 : 0);
+    profile_end(op, result->count, result->count);
+    return success;
+}
+
+static QueryResult* order_derived(Query* query, QueryResult* result) {
+    if (!result) return NULL;
+    
+    bool success = true;
+    for (size_t i = 0; success && i < query->order_count; i++) {
+        success = sort_key_bind(&query->order_by[i], result->schema, NULL, 0);
+    }
+    if (success && query->order_count > 0) {
+        success = sort_result(query, result);
+    }
+    
+    if (!success) {
+        queryresult_destroy(result);
+        return NULL;
+    }
+    
+    apply_window(query, result);
+    return result;
+}
+
+/* Sort keys over the group columns, where they sit in the table or, for partial rows, first. */
+static SortKey* group_sort_keys(const Query* query, bool partial) {
+    SortKey* keys = calloc(query->group_count ? query->group_count : 1, sizeof(SortKey));
+    for (size_t i = 0; keys && i < query->group_count; i++) {
+        keys[i].column = query->group_by[i].column;
+        keys[i].column_index = partial ? (int)i : query->group_by[i].column_index;
+        keys[i].column_type = query->group_by[i].column_type;
+    }
+    return keys;
+}
+
+/* The end of the run of rows sharing records[start]'s group; without GROUP BY all rows are one group. */
+static size_t group_end(const Query* query, const SortKey* keys, DataRecord** records, size_t start, size_t count) {
+    if (query->group_count == 0) return count;
+    
+    size_t end = start + 1;
+    while (end < count && sort_compare(keys, query->group_count, records[start], records[end]) == 0) end++;
+    return end;
+}
+
+static DataRecord* partial_row(const Query* query, const DataRecord* first, const AggregateState* states) {
+    size_t width = query->group_count + query->aggregate_count * AGGREGATE_STATE_VALUES;
+    Value* values = calloc(width ? width : 1, sizeof(Value));
+    if (!values) return NULL;
+    
+    bool stored = true;
+    for (size_t i = 0; i < query->group_count; i++) {
+        values[i] = value_clone(&first->values[query->group_by[i].column_index]);
+        stored = stored && (values[i].type != VALUE_STRING || values[i].data.string ||
+                            !first->values[query->group_by[i].column_index].data.string);
+    }
+    for (size_t i = 0; i < query->aggregate_count; i++) {
+        Value* state = values + query->group_count + i * AGGREGATE_STATE_VALUES;
+        stored = aggregate_state_store(&query->aggregates[i], &states[i], state) && stored;
+    }
+    
+    DataRecord* row = stored ? datarecord_create_owned(0, values, width) : NULL;
+    if (!row) {
+        for (size_t i = 0; i < width; i++) {
+            value_destroy(&values[i]);
+        }
+        free(values);
+    }
+    return row;
+}
+
+bool execute_partial_aggregate(MemoryTable* table, Query* query, DataRecord*** out_rows, size_t* out_count) {
+    if (!table || !query || !out_rows || !out_count || !query_is_aggregate(query)) return false;
+    
+    /* The partition only filters; grouping happens below and the rest once partials are merged. */
+    Query local = *query;
+    local.select_columns = NULL;
+    local.select_count = 0;
+    local.aggregates = NULL;
+    local.aggregate_count = 0;
+    local.group_by = NULL;
+    local.group_count = 0;
+    local.order_by = NULL;
+    local.order_count = 0;
+    local.has_limit = false;
+    local.offset = 0;
+    local.profile = NULL;
+    
+    QueryResult* matched = execute_table_query(table, &local);
+    SortKey* keys = group_sort_keys(query, false);
+    AggregateState* states = malloc(sizeof(AggregateState) * (query->aggregate_count + 1));
+    DataRecord** rows = matched ? malloc(sizeof(DataRecord*) * (matched->count + 1)) : NULL;
+    bool failed = !keys || !states || !rows ||
+                  (query->group_count > 0 && matched->count > 1 &&
+                   !sort_records(matched->records, matched->count, keys, query->group_count));
+    
+    size_t produced = 0;
+    size_t start = 0;
+    /* Without GROUP BY the one group exists even when no row matched. */
+    while (!failed && (start < matched->count || (query->group_count == 0 && produced == 0))) {
+        size_t end = group_end(query, keys, matched->records, start, matched->count);
+        for (size_t i = 0; i < query->aggregate_count; i++) {
+            aggregate_state_init(&states[i]);
+            aggregate_accumulate(&query->aggregates[i], &states[i], matched->records + start, end - start);
+        }
+        
+        rows[produced] = partial_row(query, start < matched->count ? matched->records[start] : NULL, states);
+        failed = !rows[produced];
+        if (!failed) produced++;
+        start = end;
+    }
+    
+    if (failed) {
+        for (size_t i = 0; i < produced; i++) {
+            datarecord_destroy(rows[i]);
+        }
+        free(rows);
+        rows = NULL;
+    }
+    queryresult_destroy(matched);
+    free(keys);
+    free(states);
+    
+    *out_rows = rows;
+    *out_count = failed ? 0 : produced;
+    return !failed;
+}
+
+static DataRecord* merged_row(const Query* query, const GroupOutput* outputs, size_t output_count,
+                              const DataRecord* first, const AggregateState* states) {
+    Value* values = calloc(output_count ? output_count : 1, sizeof(Value));
+    if (!values) return NULL;
+    
+    for (size_t i = 0; i < output_count; i++) {
+        size_t index = outputs[i].index;
+        values[i] = outputs[i].is_aggregate ? aggregate_finalize(&query->aggregates[index], &states[index]) :
+                                              value_clone(&first->values[index]);
+    }
+    
+    DataRecord* row = datarecord_create_owned(0, values, output_count);
+    if (!row) {
+        for (size_t i = 0; i < output_count; i++) {
+            value_destroy(&values[i]);
+        }
+        free(values);
+    }
+    return row;
+}
+
+QueryResult* merge_partial_aggregates(Query* query, const TableSchema* schema, DataRecord** partials, size_t count) {
+    if (!query || !schema || (!partials && count > 0) || !query_is_aggregate(query)) return NULL;
+    
+    size_t output_count = 0;
+    GroupOutput* outputs = aggregate_outputs(query, &output_count);
+    SortKey* keys = group_sort_keys(query, true);
+    AggregateState* states = malloc(sizeof(AggregateState) * (query->aggregate_count + 1));
+    QueryResult* result = calloc(1, sizeof(QueryResult));
+    if (result) {
+        result->derived = true;
+        result->records = malloc(sizeof(DataRecord*) * (count + 1));
+        result->schema = outputs ? aggregate_schema(query, outputs, output_count, schema) : NULL;
+        result->column_map = result->schema ? query_column_map(query, result->schema, &result->column_count) : NULL;
+    }
+    
+    bool failed = !keys || !states || !result || !result->records || !result->column_map ||
+                  (query->group_count > 0 && count > 1 && !sort_records(partials, count, keys, query->group_count));
+    
+    size_t start = 0;
+    while (!failed && (start < count || (query->group_count == 0 && result->count == 0))) {
+        size_t end = group_end(query, keys, partials, start, count);
+        for (size_t i = 0; i < query->aggregate_count; i++) {
+            aggregate_state_init(&states[i]);
+            for (size_t p = start; p < end; p++) {
+                AggregateState partial;
+                aggregate_state_load(&query->aggregates[i], &partial,
+                                     partials[p]->values + query->group_count + i * AGGREGATE_STATE_VALUES);
+                aggregate_merge(&query->aggregates[i], &states[i], &partial);
+            }
+        }
+        
+        DataRecord* row = merged_row(query, outputs, output_count, start < count ? partials[start] : NULL, states);
+        failed = !row;
+        if (!failed) result->records[result->count++] = row;
+        start = end;
+    }
+    
+    free(outputs);
+    free(keys);
+    free(states);
+    if (failed) {
+        queryresult_destroy(result);
+        return NULL;
+    }
+    return order_derived(query, result);
+}
+
+/* Unordered queries apply OFFSET and LIMIT here and stop scanning once the window is full. */
+static bool select_matching(const Query* query, QueryResult* result, MemoryTable* table) {
+    bool failed;
+    PredicateProgram* filter = compile_where(query, table->schema, &failed);
+    if (failed) return false;
+    
+    size_t position;
+    size_t end;
+    planner_scan_bounds(query, table, &position, &end);
+    
+    bool ordered = query->order_count > 0;
+    size_t skip = ordered ? 0 : query->offset;
+    size_t wanted = !ordered && query->has_limit ? query->limit : SIZE_MAX;
+    size_t capacity = 0;
+    size_t start = position;
+    OperatorProfile* op = begin_scan(query, table);
+    profile_count_allocations(op, filter ? 1 : 0);
+    
+    skip_matching(table, query, filter, &position, end, &result->ghost_count, &result->exorcised_count, &skip);
+    
+    while (position < end && result->count < wanted) {
+        if (capacity - result->count < RECORD_BATCH_SIZE) {
+            size_t new_capacity = capacity ? capacity * 2 : RECORD_BATCH_SIZE;
+            DataRecord** records = realloc(result->records, sizeof(DataRecord*) * new_capacity);
+            if (!records) {
+                failed = true;
+                break;
+            }
+            result->records = records;
+            capacity = new_capacity;
+            profile_count_allocations(op, 1);
+        }
+        
+        size_t batch = wanted - result->count < RECORD_BATCH_SIZE ? wanted - result->count : RECORD_BATCH_SIZE;
+        result->count += fetch_matching(table, query, filter, &position, end,
+                                        &result->ghost_count, &result->exorcised_count,
+                                        result->records + result->count, batch);
+    }
+    
+    /* OFFSET and LIMIT were applied while scanning, so the limit stage only reports them. */
+    size_t skipped = ordered ? 0 : query->offset - skip;
+    profile_end(op, position - start, result->count + skipped);
+    if (!ordered && (query->has_limit || query->offset > 0)) {
+        profile_end(begin_limit(query), result->count + skipped, result->count);
+    }
+    
+    predicate_program_destroy(filter);
+    return !failed;
+}
+
+typedef struct {
+    MemoryTable* table;
+    const Query* query;
+    PredicateProgram** filters;
+    TopK* heaps;
+    size_t* ghost_counts;
+    size_t* exorcised_counts;
+    size_t start;
+    size_t end;
+} OrderJob;
+
+static void order_chunk(void* context, size_t index) {
+    OrderJob* job = context;
+    
+    size_t position = job->start + index * SCAN_CHUNK_ROWS;
+    size_t end = position + SCAN_CHUNK_ROWS;
+    if (end > job->end) end = job->end;
+    
+    DataRecord* batch[RECORD_BATCH_SIZE];
+    while (position < end) {
+        size_t count = fetch_matching(job->table, job->query, job->filters[index], &position, end,
+                                      &job->ghost_counts[index], &job->exorcised_counts[index],
+                                      batch, RECORD_BATCH_SIZE);
+        
+        for (size_t i = 0; i < count; i++) {
+            topk_push(&job->heaps[index], batch[i], batch[i]->id);
+        }
+    }
+}
+
+static OperatorProfile* begin_top_k(const Query* query, const MemoryTable* table) {
+    if (stage_is_first(query)) {
+        return profile_begin(query->profile, OPERATOR_SORT, NULL, "Top-K Scan on %s (k=%zu)", table->name, window_end(query));
+    }
+    return profile_begin(query->profile, OPERATOR_SORT, NULL, "Top-K (k=%zu)", window_end(query));
+}
+
+static bool select_top_k(const Query* query, QueryResult* result, MemoryTable* table) {
+    if (query->where && !predicate_bind(query->where, table->schema, NULL, 0)) return false;
+    OperatorProfile* op = begin_top_k(query, table);
+    
+    size_t start;
+    size_t end;
+    planner_scan_bounds(query, table, &start, &end);
+    
+    size_t chunk_count = (end - start + SCAN_CHUNK_ROWS - 1) / SCAN_CHUNK_ROWS;
+    if (chunk_count == 0) chunk_count = 1;
+    
+    OrderJob job = {
+        .start = start,
+        .end = end,
+        .table = table,
+        .query = query,
+        .filters = calloc(chunk_count, sizeof(PredicateProgram*)),
+        .heaps = calloc(chunk_count, sizeof(TopK)),
+        .ghost_counts = calloc(chunk_count, sizeof(size_t)),
+        .exorcised_counts = calloc(chunk_count, sizeof(size_t))
+    };
+    
+    bool failed = !job.filters || !job.heaps || !job.ghost_counts || !job.exorcised_counts;
+    for (size_t i = 0; i < chunk_count && !failed; i++) {
+        job.filters[i] = compile_where(query, table->schema, &failed);
+        failed = failed || !topk_init(&job.heaps[i], query->order_by, query->order_count, window_end(query));
+    }
+    
+    if (!failed) failed = !parallel_run(chunk_count, order_chunk, &job);
+    
+    if (!failed) {
+        for (size_t chunk = 1; chunk < chunk_count; chunk++) {
+            topk_merge(&job.heaps[0], &job.heaps[chunk]);
+        }
+        
+        result->records = malloc(sizeof(DataRecord*) * (job.heaps[0].count + 1));
+        failed = !result->records;
+    }
+    
+    if (!failed) {
+        result->count = topk_finish(&job.heaps[0], result->records);
+        for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+            result->ghost_count += job.ghost_counts[chunk];
+            result->exorcised_count += job.exorcised_counts[chunk];
+        }
+    }
+    
+    profile_count_allocations(op, 5 + 2 * chunk_count);
+    profile_end(op, end - start, failed ? 0 : result->count);
+    
+    for (size_t i = 0; i < chunk_count; i++) {
+        if (job.filters) predicate_program_destroy(job.filters[i]);
+        if (job.heaps) topk_free(&job.heaps[i]);
     }
+    free(job.filters);
+    free(job.heaps);
+    free(job.ghost_counts);
+    free(job.exorcised_counts);
+    return !failed;
+}
+
+static DataRecord* record_by_id(MemoryTable* table, uint64_t id) {
+    size_t position = memory_table_position(table, id);
+    return position < table->record_count && table->records[position]->id == id ? table->records[position] : NULL;
+}
+
+static int compare_record_ids(const void* a, const void* b) {
+    uint64_t left = (*(DataRecord* const*)a)->id;
+    uint64_t right = (*(DataRecord* const*)b)->id;
+    return (left > right) - (left < right);
+}
+
+static OperatorProfile* begin_index_order(const Query* query, const MemoryTable* table) {
+    return profile_begin(query->profile, OPERATOR_INDEX, table->primary_index, "Index Order Scan on %s", table->name);
+}
+
+/* Keeps the records of one run of equal keys, in id order as a scan would meet them, that pass the
+ * filter. Returns how many of them landed at ordered[kept]. */
+static size_t keep_index_run(const Query* query, QueryResult* result, PredicateProgram* filter,
+                             DataRecord** run, size_t run_count) {
+    if (run_count > 1) qsort(run, run_count, sizeof(DataRecord*), compare_record_ids);
     
-    size_t match_count = 0;
-    for (size_t i = 0; i < record_count; i++) {
-        DataRecord* record = all_records[i];
+    size_t kept = 0;
+    for (size_t i = 0; i < run_count; i++) {
+        DataRecord* record = run[i];
         
         if (record->state == DATA_STATE_GHOST) {
             result->ghost_count++;
-            if (!query->include_ghosts || record->ghost_strength < query->ghost_threshold) {
-                continue;
-            }
         } else if (record->state == DATA_STATE_EXORCISED) {
             result->exorcised_count++;
-            continue;
         }
         
-        match_count++;
+        if (select_accepts_record(query, record)) run[kept++] = record;
     }
     
-    if (match_count > 0) {
-        result->records = malloc(sizeof(DataRecord*) * match_count);
-        if (!result->records) {
-            free(all_records);
-            result->count = 0;
-            return result;
-        }
+    if (filter && kept > 0) kept = predicate_program_filter(filter, run, kept);
+    return kept;
+}
+
+/* Walks the primary index in key order a page at a time and stops once OFFSET plus LIMIT rows have
+ * matched, so only the leaves holding them are read. Returns false without touching the result when
+ * the index cannot serve the order, so the caller sorts instead. */
+static bool select_by_index(const Query* query, QueryResult* result, MemoryTable* table) {
+    const SortKey* key = &query->order_by[0];
+    /* The stage is recorded only once the walk has served the order. */
+    ProfileMark mark = profile_mark(query->profile, table->primary_index);
+    
+    bool failed;
+    PredicateProgram* filter = compile_where(query, table->schema, &failed);
+    BTreeCursor cursor;
+    /* Records left out of the index would be missed, so the walk needs every one of them in it. */
+    bool opened = !failed && table->index_entries == table->record_count &&
+                  btree_cursor_open(table->primary_index, key->descending, &cursor);
+    bool usable = opened;
+    
+    size_t wanted = window_end(query);
+    size_t capacity = 0;
+    size_t kept = 0;
+    size_t entries = 0;
+    DataRecord** ordered = NULL;
+    DataRecord* next = NULL;
+    uint64_t id;
+    
+    if (usable && btree_cursor_next(&cursor, &id)) {
+        entries++;
+        next = record_by_id(table, id);
+        usable = next != NULL;
+    }
+    
+    while (usable && next && kept < wanted) {
+        size_t run_start = kept;
+        size_t run_end = kept;
         
-        size_t j = 0;
-        for (size_t i = 0; i < record_count; i++) {
-            DataRecord* record = all_records[i];
+        /* Gathers the run of records sharing next's key, then reads one past it. */
+        while (next) {
+            if (run_end > run_start && sort_compare(key, 1, ordered[run_end - 1], next) != 0) break;
             
-            if (record->state == DATA_STATE_GHOST) {
-                if (!query->include_ghosts || record->ghost_strength < query->ghost_threshold) {
-                    continue;
+            if (run_end == capacity) {
+                size_t grown = capacity ? capacity * 2 : 64;
+                DataRecord** resized = realloc(ordered, sizeof(DataRecord*) * grown);
+                if (!resized) {
+                    usable = false;
+                    break;
                 }
-            } else if (record->state == DATA_STATE_EXORCISED) {
-                continue;
+                ordered = resized;
+                capacity = grown;
             }
+            ordered[run_end++] = next;
+            next = NULL;
             
-            result->records[j++] = record;
+            if (btree_cursor_next(&cursor, &id)) {
+                entries++;
+                next = record_by_id(table, id);
+                usable = next != NULL;
+                if (!usable) break;
+            }
+        }
+        
+        /* The index orders keys the way the sort does; a pair it disagrees on leaves the order to the sort. */
+        if (usable && next && sort_compare(key, 1, ordered[run_end - 1], next) > 0) usable = false;
+        if (usable) kept += keep_index_run(query, result, filter, ordered + run_start, run_end - run_start);
+    }
+    
+    if (opened) {
+        usable = usable && !cursor.failed;
+        btree_cursor_close(&cursor);
+    }
+    predicate_program_destroy(filter);
+    
+    if (!usable) {
+        free(ordered);
+        result->ghost_count = 0;
+        result->exorcised_count = 0;
+        return false;
+    }
+    
+    OperatorProfile* op = begin_index_order(query, table);
+    profile_begin_at(op, mark);
+    profile_count_allocations(op, 1 + (filter ? 1 : 0));
+    profile_end(op, entries, kept);
+    result->records = ordered;
+    result->count = kept;
+    return true;
+}
+
+static int compare_ids(const void* a, const void* b) {
+    uint64_t left = *(const uint64_t*)a;
+    uint64_t right = *(const uint64_t*)b;
+    return (left > right) - (left < right);
+}
+
+/* The records an index plan reaches, in the id order a scan would visit them. */
+static DataRecord** index_candidates(MemoryTable* table, const QueryPlan* plan, OperatorProfile* op, size_t* out_count) {
+    uint32_t id_count = 0;
+    uint64_t* ids = memory_table_range_query(table, &plan->range, PRIMARY_KEY_COLUMN, &id_count);
+    DataRecord** records = malloc(sizeof(DataRecord*) * (id_count + 1));
+    if (!records) {
+        btree_free_results(ids);
+        return NULL;
+    }
+    
+    if (id_count > 1) qsort(ids, id_count, sizeof(uint64_t), compare_ids);
+    
+    size_t count = 0;
+    for (uint32_t i = 0; i < id_count; i++) {
+        DataRecord* record = record_by_id(table, ids[i]);
+        if (record) records[count++] = record;
+    }
+    btree_free_results(ids);
+    
+    profile_count_allocations(op, 2);
+    profile_end(op, id_count, count);
+    *out_count = count;
+    return records;
+}
+
+static bool ordered_by_top_k(const Query* query) {
+    return query->order_count > 0 && query->has_limit && window_end(query) <= ORDER_TOPK_MAX_ROWS;
+}
+
+static QueryResult* select_rows(Query* query, QueryResult* result, MemoryTable* table, bool index_order) {
+    if (query_is_aggregate(query)) {
+        return order_derived(query, execute_aggregate(query, result, table));
+    }
+    
+    bool success = true;
+    for (size_t i = 0; success && i < query->order_count; i++) {
+        success = sort_key_bind(&query->order_by[i], table->schema, NULL, 0);
+    }
+    
+    bool indexed = success && index_order && select_by_index(query, result, table);
+    bool top_k = ordered_by_top_k(query);
+    
+    if (success && !indexed && top_k) {
+        success = select_top_k(query, result, table);
+    } else if (success && !indexed) {
+        success = select_matching(query, result, table);
+        if (success && query->order_count > 0) {
+            success = sort_result(query, result);
         }
-        result->count = match_count;
     }
     
-    free(all_records);
+    if (!success) {
+        queryresult_destroy(result);
+        return NULL;
+    }
+    
+    if (query->order_count > 0) apply_window(query, result);
+    return result;
+}
+
+static OperatorProfile* begin_index_access(const Query* query, const MemoryTable* table, const QueryPlan* plan) {
+    const char* kind = plan->access == ACCESS_INDEX_LOOKUP ? "Index Lookup" : "Index Range Scan";
+    return profile_begin(query->profile, OPERATOR_INDEX, table->primary_index, "%s on %s", kind, table->name);
+}
+
+/* Index plans run the rest of the query over a view of the table holding only the records the
+ * index reached. */
+static QueryResult* execute_select(Query* query, QueryResult* result, MemoryTable* table) {
+    result->column_map = query_column_map(query, table->schema, &result->column_count);
+    if (!result->column_map) {
+        free(result);
+        return NULL;
+    }
+    
+    QueryPlan plan;
+    if (!plan_select(query, table, &plan)) {
+        queryresult_destroy(result);
+        return NULL;
+    }
+    
+    size_t first = query->profile ? query->profile->operator_count : 0;
+    if (plan.access == ACCESS_SCAN) {
+        result = select_rows(query, result, table, plan.index_order);
+        estimate_rows(query, first, plan.estimated_rows);
+        return result;
+    }
+    
+    MemoryTable reached = *table;
+    reached.records = index_candidates(table, &plan, begin_index_access(query, table, &plan), &reached.record_count);
+    if (!reached.records) {
+        queryresult_destroy(result);
+        return NULL;
+    }
+    reached.capacity = reached.record_count;
+    reached.primary_index = NULL;
+    reached.key_order = NULL;
+    
+    result = select_rows(query, result, &reached, false);
+    estimate_rows(query, first + 1, plan.estimated_rows);
+    free(reached.records);
     return result;
 }
 
+/* Lists the stages select_rows would run over `table`, without running them. */
+static bool describe_rows(Query* query, MemoryTable* table, double estimated_rows, bool index_order) {
+    bool aggregate = query_is_aggregate(query);
+    bool success = true;
+    for (size_t i = 0; !aggregate && success && i < query->order_count; i++) {
+        success = sort_key_bind(&query->order_by[i], table->schema, NULL, 0);
+    }
+    if (!success) return false;
+    
+    size_t first = query->profile->operator_count;
+    bool indexed = !aggregate && index_order;
+    bool top_k = !aggregate && !indexed && ordered_by_top_k(query);
+    
+    if (aggregate) {
+        begin_aggregate(query, table);
+    } else if (indexed) {
+        begin_index_order(query, table);
+    } else if (top_k) {
+        begin_top_k(query, table);
+    } else {
+        begin_scan(query, table);
+        estimate_rows(query, first, estimated_rows);
+    }
+    
+    if (query->order_count > 0 && !indexed && !top_k) begin_sort(query);
+    if (query->has_limit || query->offset > 0) begin_limit(query);
+    return true;
+}
+
 static QueryResult* execute_insert_query(Query* query, QueryResult* result, MemoryTable* table) {
     if (!query->insert_values || query->value_count != table->schema->column_count) {
         result->count = 0;
@@ -122,7 +1159,36 @@ static QueryResult* execute_insert_query(Query* query, QueryResult* result, Memo
     return result;
 }
 
+static QueryResult* execute_delete_where(Query* query, QueryResult* result, MemoryTable* table) {
+    bool include_ghosts = query->include_ghosts;
+    query->include_ghosts = false;
+    
+    result = execute_select(query, result, table);
+    query->include_ghosts = include_ghosts;
+    if (!result) return NULL;
+    
+    OperatorProfile* op = profile_begin(query->profile, OPERATOR_DELETE, NULL, "Delete on %s", table->name);
+    int64_t timestamp = time(NULL);
+    size_t deleted = 0;
+    for (size_t i = 0; i < result->count; i++) {
+        DataRecord* record = result->records[i];
+        if (memory_table_delete(table, record->id, timestamp)) {
+            result->records[deleted++] = record;
+        }
+    }
+    profile_end(op, result->count, deleted);
+    
+    result->count = deleted;
+    result->ghost_count = deleted;
+    result->exorcised_count = 0;
+    return result;
+}
+
 static QueryResult* execute_delete_query(Query* query, QueryResult* result, MemoryTable* table) {
+    if (query->where) {
+        return execute_delete_where(query, result, table);
+    }
+    
     bool success = memory_table_delete(table, query->target_id, time(NULL));
     
     if (success) {
@@ -152,31 +1218,363 @@ static QueryResult* execute_drop_table_query(MemoryStorage* storage, Query* quer
     }
 }
 
+static QueryResult* queryresult_create(TableSchema* schema) {
+    QueryResult* result = malloc(sizeof(QueryResult));
+    if (!result) return NULL;
+    
+    result->records = NULL;
+    result->count = 0;
+    result->ghost_count = 0;
+    result->exorcised_count = 0;
+    result->column_map = NULL;
+    result->column_count = 0;
+    result->schema = schema;
+    result->derived = false;
+    return result;
+}
+
+static DataRecord** join_input(MemoryTable* table, bool include_ghosts, float ghost_threshold, size_t* out_count) {
+    DataRecord** rows = malloc(sizeof(DataRecord*) * (table->record_count + 1));
+    if (!rows) return NULL;
+    
+    size_t count = 0;
+    for (size_t i = 0; i < table->record_count; i++) {
+        if (record_accepted(table->records[i], include_ghosts, ghost_threshold)) {
+            rows[count++] = table->records[i];
+        }
+    }
+    
+    *out_count = count;
+    return rows;
+}
+
+static bool join_by_index(const Query* query, MemoryTable* right, DataRecord* const* left, size_t left_count,
+                          JoinPair** out_pairs, size_t* out_count) {
+    const JoinClause* join = query->join;
+    size_t capacity = left_count + 1;
+    size_t count = 0;
+    JoinPair* pairs = malloc(sizeof(JoinPair) * capacity);
+    bool success = pairs != NULL;
+    
+    for (size_t i = 0; success && i < left_count; i++) {
+        const Value* key = &left[i]->values[join->left_index];
+        if (key->type != join->column_type || (key->type == VALUE_STRING && !key->data.string)) continue;
+        
+        BTreeRange range = { .start_key = *key, .end_key = *key, .include_start = true, .include_end = true };
+        uint32_t id_count = 0;
+        uint64_t* ids = btree_range_query(right->primary_index, &range, &id_count);
+        if (id_count > 1) qsort(ids, id_count, sizeof(uint64_t), compare_ids);
+        
+        for (uint32_t m = 0; success && m < id_count; m++) {
+            DataRecord* record = record_by_id(right, ids[m]);
+            if (!record || !record_accepted(record, join->include_ghosts, query->ghost_threshold)) continue;
+            
+            if (count == capacity) {
+                JoinPair* grown = realloc(pairs, sizeof(JoinPair) * capacity * 2);
+                success = grown != NULL;
+                if (!success) break;
+                pairs = grown;
+                capacity *= 2;
+            }
+            pairs[count].left = left[i];
+            pairs[count].right = record;
+            count++;
+        }
+        btree_free_results(ids);
+    }
+    
+    if (!success) {
+        free(pairs);
+        return false;
+    }
+    
+    *out_pairs = pairs;
+    *out_count = count;
+    return true;
+}
+
+typedef struct {
+    const JoinPair* pairs;
+    size_t count;
+    size_t left_columns;
+    size_t right_columns;
+    DataRecord** records;
+} JoinRowsJob;
+
+/* A joined row is a ghost when either side is, as strong as its weaker side. */
+static DataRecord* join_row(const JoinRowsJob* job, size_t index) {
+    const JoinPair* pair = &job->pairs[index];
+    size_t column_count = job->left_columns + job->right_columns;
+    
+    Value* values = malloc(sizeof(Value) * column_count);
+    if (!values) return NULL;
+    
+    for (size_t i = 0; i < column_count; i++) {
+        values[i] = i < job->left_columns ? value_clone(&pair->left->values[i])
+                                          : value_clone(&pair->right->values[i - job->left_columns]);
+    }
+    
+    DataRecord* record = datarecord_create_owned(index + 1, values, column_count);
+    if (!record) {
+        for (size_t i = 0; i < column_count; i++) {
+            value_destroy(&values[i]);
+        }
+        free(values);
+        return NULL;
+    }
+    
+    const DataRecord* sides[] = { pair->left, pair->right };
+    for (size_t side = 0; side < 2; side++) {
+        if (sides[side]->state != DATA_STATE_GHOST) continue;
+        
+        if (record->state != DATA_STATE_GHOST || sides[side]->ghost_strength < record->ghost_strength) {
+            record->ghost_strength = sides[side]->ghost_strength;
+        }
+        if (sides[side]->deleted_at > record->deleted_at) record->deleted_at = sides[side]->deleted_at;
+        record->state = DATA_STATE_GHOST;
+    }
+    return record;
+}
+
+static void join_rows_chunk(void* context, size_t index) {
+    JoinRowsJob* job = context;
+    size_t end = (index + 1) * SCAN_CHUNK_ROWS;
+    if (end > job->count) end = job->count;
+    
+    for (size_t i = index * SCAN_CHUNK_ROWS; i < end; i++) {
+        job->records[i] = join_row(job, i);
+    }
+}
+
+static bool join_records(MemoryTable* joined, MemoryTable* left, MemoryTable* right, const JoinPair* pairs, size_t count) {
+    JoinRowsJob job = {
+        .pairs = pairs,
+        .count = count,
+        .left_columns = left->schema->column_count,
+        .right_columns = right->schema->column_count,
+        .records = calloc(count + 1, sizeof(DataRecord*))
+    };
+    
+    bool success = job.records && parallel_run((count + SCAN_CHUNK_ROWS - 1) / SCAN_CHUNK_ROWS, join_rows_chunk, &job);
+    for (size_t i = 0; success && i < count; i++) {
+        success = job.records[i] != NULL;
+    }
+    
+    if (!success) {
+        for (size_t i = 0; job.records && i < count; i++) {
+            datarecord_destroy(job.records[i]);
+        }
+        free(job.records);
+        return false;
+    }
+    
+    joined->records = job.records;
+    joined->record_count = count;
+    joined->capacity = count;
+    joined->next_id = count + 1;
+    return true;
+}
+
+static OperatorProfile* begin_join(const Query* query, const MemoryTable* left, const MemoryTable* right,
+                                   JoinStrategy strategy) {
+    return profile_begin(query->profile, OPERATOR_JOIN, strategy == JOIN_INDEX ? right->primary_index : NULL,
+                         "%s %s with %s on %s = %s", strategy == JOIN_INDEX ? "Index Join" : "Hash Join",
+                         left->name, right->name, query->join->left_column, query->join->right_column);
+}
+
+static QueryResult* execute_explain(MemoryTable* table, MemoryTable* joined, Query* query);
+
+/* Materialises the joined rows into a transient table and runs the rest of the query over it. */
+QueryResult* execute_join_query(MemoryTable* left, MemoryTable* right, Query* query) {
+    if (!left || !right || !query || !query->join || query->type != QUERY_SELECT) return NULL;
+    memory_table_sync_index(left);
+    memory_table_sync_index(right);
+    if (query->explain != EXPLAIN_NONE) return execute_explain(left, right, query);
+    if (!join_clause_bind(query->join, left->schema, right->schema, NULL, 0)) return NULL;
+    
+    MemoryTable joined;
+    memset(&joined, 0, sizeof(joined));
+    joined.name = left->name;
+    joined.schema = join_schema(left->schema, right->schema);
+    
+    size_t left_count = 0;
+    size_t right_count = 0;
+    size_t pair_count = 0;
+    JoinPair* pairs = NULL;
+    DataRecord** left_rows = join_input(left, query->include_ghosts, query->ghost_threshold, &left_count);
+    DataRecord** right_rows = NULL;
+    bool success = joined.schema && left_rows;
+    OperatorProfile* op = NULL;
+    
+    if (success && plan_join(query->join, right, left_count) == JOIN_INDEX) {
+        op = begin_join(query, left, right, JOIN_INDEX);
+        success = join_by_index(query, right, left_rows, left_count, &pairs, &pair_count);
+    } else if (success) {
+        op = begin_join(query, left, right, JOIN_HASH);
+        right_rows = join_input(right, query->join->include_ghosts, query->ghost_threshold, &right_count);
+        success = right_rows && join_hash(query->join, left_rows, left_count, right_rows, right_count,
+                                          &pairs, &pair_count);
+    }
+    
+    success = success && join_records(&joined, left, right, pairs, pair_count);
+    profile_count_allocations(op, (right_rows ? 4 : 3) + (success ? pair_count : 0));
+    profile_end(op, left_count + right_count, success ? pair_count : 0);
+    free(left_rows);
+    free(right_rows);
+    free(pairs);
+    
+    QueryResult* result = success ? queryresult_create(joined.schema) : NULL;
+    if (result) {
+        bool include_ghosts = query->include_ghosts;
+        float ghost_threshold = query->ghost_threshold;
+        query->include_ghosts = true;
+        query->ghost_threshold = 0.0f;
+        
+        result = execute_select(query, result, &joined);
+        query->include_ghosts = include_ghosts;
+        query->ghost_threshold = ghost_threshold;
+    }
+    
+    bool* kept = result && !result->derived ? calloc(joined.record_count + 1, sizeof(bool)) : NULL;
+    if (result && !result->derived && !kept) {
+        queryresult_destroy(result);
+        result = NULL;
+    }
+    
+    for (size_t i = 0; kept && i < result->count; i++) {
+        kept[result->records[i]->id] = true;
+    }
+    for (size_t i = 0; i < joined.record_count; i++) {
+        if (!kept || !kept[joined.records[i]->id]) datarecord_destroy(joined.records[i]);
+    }
+    free(joined.records);
+    free(kept);
+    
+    if (result && !result->derived) {
+        result->derived = true;
+    } else {
+        tableschema_destroy(joined.schema);
+    }
+    return result;
+}
+
+static bool describe_query(Query* query, MemoryTable* table, MemoryTable* joined) {
+    MemoryTable view;
+    MemoryTable* target = table;
+    
+    if (joined) {
+        if (!join_clause_bind(query->join, table->schema, joined->schema, NULL, 0)) return false;
+        
+        size_t probes = table->stats->living_count + (query->include_ghosts ? table->stats->ghost_count : 0);
+        begin_join(query, table, joined, plan_join(query->join, joined, probes));
+        
+        memset(&view, 0, sizeof(view));
+        view.name = table->name;
+        view.schema = join_schema(table->schema, joined->schema);
+        if (!view.schema) return false;
+        target = &view;
+    }
+    
+    QueryPlan plan;
+    bool success = plan_select(query, target, &plan);
+    if (success && plan.access != ACCESS_SCAN) begin_index_access(query, target, &plan);
+    success = success && describe_rows(query, target, joined ? -1.0 : plan.estimated_rows, plan.index_order);
+    if (success && query->type == QUERY_DELETE) {
+        profile_begin(query->profile, OPERATOR_DELETE, NULL, "Delete on %s", table->name);
+    }
+    
+    if (joined) tableschema_destroy(view.schema);
+    return success;
+}
+
+static QueryResult* explain_result(const QueryProfile* profile) {
+    ColumnSchema column = column_create("QUERY PLAN", VALUE_STRING);
+    TableSchema* schema = tableschema_create("explain", &column, 1);
+    free((char*)column.name);
+    
+    QueryResult* result = schema ? queryresult_create(schema) : NULL;
+    if (!result) {
+        tableschema_destroy(schema);
+        return NULL;
+    }
+    result->derived = true;
+    
+    size_t lines = profile_line_count(profile);
+    result->records = malloc(sizeof(DataRecord*) * (lines + 1));
+    result->column_map = malloc(sizeof(size_t));
+    if (!result->records || !result->column_map) {
+        queryresult_destroy(result);
+        return NULL;
+    }
+    result->column_map[0] = 0;
+    result->column_count = 1;
+    
+    char line[256];
+    for (size_t i = 0; i < lines; i++) {
+        profile_format_line(profile, i, line, sizeof(line));
+        Value value = value_string(line);
+        DataRecord* record = datarecord_create(i + 1, &value, 1);
+        value_destroy(&value);
+        if (!record) {
+            queryresult_destroy(result);
+            return NULL;
+        }
+        result->records[result->count++] = record;
+    }
+    return result;
+}
+
+/* EXPLAIN lists the stages a query would run; EXPLAIN ANALYZE runs it, discarding its rows,
+ * and reports what each stage did. */
+static QueryResult* execute_explain(MemoryTable* table, MemoryTable* joined, Query* query) {
+    QueryProfile profile;
+    profile_init(&profile, query->explain == EXPLAIN_ANALYZE);
+    
+    ExplainMode mode = query->explain;
+    QueryProfile* attached = query->profile;
+    query->explain = EXPLAIN_NONE;
+    query->profile = &profile;
+    
+    bool success;
+    if (profile.analyze) {
+        uint64_t started = profile_now();
+        QueryResult* result = joined ? execute_join_query(table, joined, query) : execute_table_query(table, query);
+        profile.execution_ns = profile_now() - started;
+        success = result != NULL;
+        queryresult_destroy(result);
+    } else {
+        success = describe_query(query, table, joined);
+    }
+    
+    query->explain = mode;
+    query->profile = attached;
+    return success ? explain_result(&profile) : NULL;
+}
+
 QueryResult* execute_query(MemoryStorage* storage, Query* query) {
     if (!storage || !query || !query->table_name) return NULL;
 
     if (query->type == QUERY_DROP_TABLE) {
-        QueryResult* result = malloc(sizeof(QueryResult));
-        if (!result) return NULL;
-        
-        result->records = NULL;
-        result->count = 0;
-        result->ghost_count = 0;
-        result->exorcised_count = 0;
-        
-        return execute_drop_table_query(storage, query, result);
+        QueryResult* result = queryresult_create(NULL);
+        return result ? execute_drop_table_query(storage, query, result) : NULL;
     }
     
     MemoryTable* table = memory_storage_get_table(storage, query->table_name);
     if (!table) return NULL;
     
-    QueryResult* result = malloc(sizeof(QueryResult));
-    if (!result) return NULL;
+    if (query->join) {
+        return execute_join_query(table, memory_storage_get_table(storage, query->join->table_name), query);
+    }
+    return execute_table_query(table, query);
+}
+
+QueryResult* execute_table_query(MemoryTable* table, Query* query) {
+    if (!table || !query || query->join) return NULL;
+    memory_table_sync_index(table);
+    if (query->explain != EXPLAIN_NONE) return execute_explain(table, NULL, query);
     
-    result->records = NULL;
-    result->count = 0;
-    result->ghost_count = 0;
-    result->exorcised_count = 0;
+    QueryResult* result = queryresult_create(table->schema);
+    if (!result) return NULL;
     
     switch (query->type) {
         case QUERY_SELECT:
@@ -194,10 +1592,80 @@ QueryResult* execute_query(MemoryStorage* storage, Query* query) {
     }
 }
 
+QueryCursor* query_cursor_open(MemoryStorage* storage, const Query* query) {
+    if (!storage || !query || !query->table_name) return NULL;
+    
+    return query_cursor_open_table(memory_storage_get_table(storage, query->table_name), query);
+}
+
+QueryCursor* query_cursor_open_table(MemoryTable* table, const Query* query) {
+    if (!table || !query || query->type != QUERY_SELECT || query_is_aggregate(query)) return NULL;
+    if (query->order_count > 0 || query->join) return NULL;
+    memory_table_sync_index(table);
+    
+    bool failed;
+    PredicateProgram* filter = compile_where(query, table->schema, &failed);
+    if (failed) return NULL;
+    
+    QueryCursor* cursor = malloc(sizeof(QueryCursor));
+    if (cursor) {
+        cursor->column_map = query_column_map(query, table->schema, &cursor->column_count);
+    }
+    if (!cursor || !cursor->column_map) {
+        free(cursor);
+        predicate_program_destroy(filter);
+        return NULL;
+    }
+    
+    cursor->table = table;
+    cursor->query = query;
+    cursor->filter = filter;
+    planner_scan_bounds(query, table, &cursor->position, &cursor->end);
+    cursor->skip = query->offset;
+    cursor->remaining = query->has_limit ? query->limit : SIZE_MAX;
+    cursor->ghost_count = 0;
+    cursor->exorcised_count = 0;
+    
+    return cursor;
+}
+
+size_t query_cursor_fetch(QueryCursor* cursor, DataRecord** records, size_t max_records) {
+    if (!cursor || !records || max_records == 0) return 0;
+    
+    skip_matching(cursor->table, cursor->query, cursor->filter, &cursor->position, cursor->end,
+                  &cursor->ghost_count, &cursor->exorcised_count, &cursor->skip);
+    if (max_records > cursor->remaining) max_records = cursor->remaining;
+    
+    size_t fetched = fetch_matching(cursor->table, cursor->query, cursor->filter, &cursor->position,
+                                    cursor->end, &cursor->ghost_count, &cursor->exorcised_count, records, max_records);
+    cursor->remaining -= fetched;
+    return fetched;
+}
+
+bool query_cursor_finished(const QueryCursor* cursor) {
+    return !cursor || cursor->position >= cursor->end || cursor->remaining == 0;
+}
+
+void query_cursor_close(QueryCursor* cursor) {
+    if (!cursor) return;
+    
+    predicate_program_destroy(cursor->filter);
+    free(cursor->column_map);
+    free(cursor);
+}
+
 void queryresult_destroy(QueryResult* result) {
     if (!result) return;
     
+    if (result->derived) {
+        for (size_t i = 0; i < result->count; i++) {
+            datarecord_destroy(result->records[i]);
+        }
+        tableschema_destroy(result->schema);
+    }
+    
     free(result->records);
+    free(result->column_map);
     free(result);
 }
 
@@ -3,6 +3,13 @@
 
 #include "../storage/memory.h"
 #include "../types/data.h"
+#include "predicate.h"
+#include "bytecode.h"
+#include "aggregate.h"
+#include "groupby.h"
+#include "sort.h"
+#include "join.h"
+#include "explain.h"
 #include <stdbool.h>
 #include <stdlib.h>
 #include "../util/string_utils.h"
@@ -31,21 +38,89 @@ typedef struct {
     
     bool include_ghosts;
     float ghost_threshold; 
+    
+    Predicate* where;
+    
+    Aggregate* aggregates;
+    size_t aggregate_count;
+    GroupColumn* group_by;
+    size_t group_count;
+    
+    /* Working memory for grouping before partitions are split further; 0 uses the default. */
+    size_t memory_budget;
+    
+    SortKey* order_by;
+    size_t order_count;
+    size_t limit;
+    bool has_limit;
+    size_t offset;
+    
+    JoinClause* join;
+    
+    /* `?` placeholders in the WHERE clause, filled by predicate_set_parameters before running. */
+    size_t parameter_count;
+    
+    ExplainMode explain;
+    /* Borrowed; when set, each stage of the query records its rows, time and pages here. */
+    QueryProfile* profile;
 } Query;
 
 typedef struct {
     DataRecord** records;
     size_t count;
+    
+    /* Counted over the rows scanned, which stop early once LIMIT is satisfied. */
     size_t ghost_count;
     size_t exorcised_count;
+    
+    size_t* column_map;
+    size_t column_count;
+    
+    /* Derived results (aggregates) own their records and schema. */
+    TableSchema* schema;
+    bool derived;
 } QueryResult;
 
+typedef struct {
+    MemoryTable* table;
+    const Query* query;
+    PredicateProgram* filter;
+    size_t* column_map;
+    size_t column_count;
+    size_t position;
+    size_t end;
+    size_t skip;
+    size_t remaining;
+    size_t ghost_count;
+    size_t exorcised_count;
+} QueryCursor;
+
 Query* query_create(QueryType type, const char* table_name);
 void query_destroy(Query* query);
 
+bool query_bind(Query* query, const TableSchema* schema, char* error, size_t error_size);
+bool query_bind_join(Query* query, const TableSchema* left, const TableSchema* right, char* error, size_t error_size);
+bool query_is_aggregate(const Query* query);
+size_t* query_column_map(const Query* query, const TableSchema* schema, size_t* out_count);
+
 QueryResult* execute_query(MemoryStorage* storage, Query* query);
+QueryResult* execute_table_query(MemoryTable* table, Query* query);
+QueryResult* execute_join_query(MemoryTable* left, MemoryTable* right, Query* query);
 void queryresult_destroy(QueryResult* result);
 
+/* Two-phase aggregation for a table split into partitions. Each partition reduces the rows it
+ * matches to one partial row per group: the group key values, then AGGREGATE_STATE_VALUES per
+ * aggregate. Merging the partial rows of every partition gives the result over the whole table,
+ * ordered and windowed; the partial rows stay with the caller. */
+bool execute_partial_aggregate(MemoryTable* table, Query* query, DataRecord*** out_rows, size_t* out_count);
+QueryResult* merge_partial_aggregates(Query* query, const TableSchema* schema, DataRecord** partials, size_t count);
+
+QueryCursor* query_cursor_open(MemoryStorage* storage, const Query* query);
+QueryCursor* query_cursor_open_table(MemoryTable* table, const Query* query);
+size_t query_cursor_fetch(QueryCursor* cursor, DataRecord** records, size_t max_records);
+bool query_cursor_finished(const QueryCursor* cursor);
+void query_cursor_close(QueryCursor* cursor);
+
 QueryResult* execute_select_all(MemoryStorage* storage, const char* table_name);
 QueryResult* execute_insert_simple(MemoryStorage* storage, const char* table_name, Value* values, size_t value_count);
 bool execute_delete_simple(MemoryStorage* storage, const char* table_name, uint64_t id);
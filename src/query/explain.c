@@ -0,0 +1,103 @@
+#define _POSIX_C_SOURCE 200809L
+#include "explain.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+uint64_t profile_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+void profile_init(QueryProfile* profile, bool analyze) {
+    memset(profile, 0, sizeof(QueryProfile));
+    profile->analyze = analyze;
+}
+
+OperatorProfile* profile_begin(QueryProfile* profile, OperatorKind kind, const BTree* index,
+                               const char* format, ...) {
+    if (!profile || profile->operator_count == PROFILE_MAX_OPERATORS) return NULL;
+
+    OperatorProfile* op = &profile->operators[profile->operator_count++];
+    memset(op, 0, sizeof(OperatorProfile));
+    op->kind = kind;
+    op->estimated_rows = -1.0;
+    op->index = index;
+    op->index_pages = index ? index->pages_read : 0;
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(op->label, sizeof(op->label), format, args);
+    va_end(args);
+
+    if (profile->analyze) op->started_ns = profile_now();
+    return op;
+}
+
+void profile_end(OperatorProfile* op, size_t rows_in, size_t rows_out) {
+    if (!op) return;
+
+    op->elapsed_ns = profile_now() - op->started_ns;
+    op->rows_in = rows_in;
+    op->rows_out = rows_out;
+    if (op->index) op->pages_read = op->index->pages_read - op->index_pages;
+}
+
+ProfileMark profile_mark(const QueryProfile* profile, const BTree* index) {
+    ProfileMark mark = {0, index ? index->pages_read : 0};
+    if (profile && profile->analyze) mark.started_ns = profile_now();
+    return mark;
+}
+
+void profile_begin_at(OperatorProfile* op, ProfileMark mark) {
+    if (!op) return;
+
+    op->started_ns = mark.started_ns;
+    op->index_pages = mark.index_pages;
+}
+
+void profile_count_allocations(OperatorProfile* op, size_t count) {
+    if (op) op->allocations += count;
+}
+
+size_t profile_line_count(const QueryProfile* profile) {
+    if (!profile) return 0;
+    return profile->operator_count + (profile->analyze ? 1 : 0);
+}
+
+/* Appends to the text already in buffer, truncating at its end. */
+static size_t append(char* buffer, size_t size, size_t used, const char* format, ...) {
+    if (used >= size - 1) return used;
+
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer + used, size - used, format, args);
+    va_end(args);
+
+    if (written < 0) return used;
+    return used + (size_t)written < size ? used + (size_t)written : size - 1;
+}
+
+bool profile_format_line(const QueryProfile* profile, size_t line, char* buffer, size_t size) {
+    if (!profile || !buffer || size == 0 || line >= profile_line_count(profile)) return false;
+
+    buffer[0] = '\0';
+    if (line == profile->operator_count) {
+        append(buffer, size, 0, "Execution time: %.3f ms", (double)profile->execution_ns / 1e6);
+        return true;
+    }
+
+    const OperatorProfile* op = &profile->operators[profile->operator_count - 1 - line];
+    size_t used = append(buffer, size, 0, "%*s%s%s", (int)line * 2, "", line > 0 ? "-> " : "", op->label);
+    if (op->estimated_rows >= 0.0) {
+        used = append(buffer, size, used, "  (estimated rows=%.0f)", op->estimated_rows);
+    }
+    if (profile->analyze) {
+        append(buffer, size, used, "  (actual rows=%zu in=%zu time=%.3f ms pages=%llu allocs=%zu)",
+               op->rows_out, op->rows_in, (double)op->elapsed_ns / 1e6,
+               (unsigned long long)op->pages_read, op->allocations);
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef SHADE_QUERY_EXPLAIN_H
+#define SHADE_QUERY_EXPLAIN_H
+
+#include "../storage/btree.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define PROFILE_MAX_OPERATORS 8
+#define PROFILE_LABEL_SIZE 96
+
+typedef enum {
+    EXPLAIN_NONE,
+    EXPLAIN_PLAN,
+    EXPLAIN_ANALYZE
+} ExplainMode;
+
+typedef enum {
+    OPERATOR_SCAN,
+    OPERATOR_INDEX,
+    OPERATOR_JOIN,
+    OPERATOR_AGGREGATE,
+    OPERATOR_SORT,
+    OPERATOR_LIMIT,
+    OPERATOR_DELETE
+} OperatorKind;
+
+/* One stage of a query, in the order rows flow through it. Allocations count the buffers and
+ * rows the stage itself materializes, not every allocation made on its behalf. */
+typedef struct {
+    OperatorKind kind;
+    char label[PROFILE_LABEL_SIZE];
+    double estimated_rows;
+    size_t rows_in;
+    size_t rows_out;
+    uint64_t elapsed_ns;
+    uint64_t pages_read;
+    size_t allocations;
+
+    uint64_t started_ns;
+    const BTree* index;
+    uint64_t index_pages;
+} OperatorProfile;
+
+/* Attached to a query to record how it runs; stages are timed only while one is attached. */
+typedef struct {
+    bool analyze;
+    OperatorProfile operators[PROFILE_MAX_OPERATORS];
+    size_t operator_count;
+    uint64_t execution_ns;
+} QueryProfile;
+
+/* The clock and an index's page count at some point, for a stage recorded only once it is known
+ * to run. */
+typedef struct {
+    uint64_t started_ns;
+    uint64_t index_pages;
+} ProfileMark;
+
+uint64_t profile_now(void);
+void profile_init(QueryProfile* profile, bool analyze);
+
+/* Returns NULL when profile is NULL or full. Pages read from `index` until the matching
+ * profile_end are charged to the operator. */
+OperatorProfile* profile_begin(QueryProfile* profile, OperatorKind kind, const BTree* index,
+                               const char* format, ...);
+void profile_end(OperatorProfile* op, size_t rows_in, size_t rows_out);
+ProfileMark profile_mark(const QueryProfile* profile, const BTree* index);
+/* Charges the operator with the time and pages since mark rather than since profile_begin. */
+void profile_begin_at(OperatorProfile* op, ProfileMark mark);
+void profile_count_allocations(OperatorProfile* op, size_t count);
+
+/* One line per operator, the last stage first, then the execution time when analyzed. */
+size_t profile_line_count(const QueryProfile* profile);
+bool profile_format_line(const QueryProfile* profile, size_t line, char* buffer, size_t size);
+
+#endif
@@ -0,0 +1,325 @@
+#include "export.h"
+#include "batch.h"
+#include <math.h>
+#include <string.h>
+
+static void set_export_error(ExportStats* stats, const char* message, const char* detail) {
+    snprintf(stats->error, sizeof(stats->error), "%s%s%s", message, detail ? ": " : "", detail ? detail : "");
+}
+
+static bool csv_needs_quotes(const char* text) {
+    if (text[0] == '\0' || text[0] == ' ' || text[0] == '\t') return true;
+
+    size_t length = strcspn(text, ",\"\r\n");
+    if (text[length] != '\0') return true;
+
+    char last = text[length - 1];
+    return last == ' ' || last == '\t';
+}
+
+static void write_csv_string(BufferedWriter* writer, const char* text) {
+    if (!csv_needs_quotes(text)) {
+        writer_put_string(writer, text);
+        return;
+    }
+
+    writer_put_char(writer, '"');
+    const char* start = text;
+    for (const char* p = text; *p; p++) {
+        if (*p == '"') {
+            writer_put_bytes(writer, start, (size_t)(p - start + 1));
+            start = p;
+        }
+    }
+    writer_put_string(writer, start);
+    writer_put_char(writer, '"');
+}
+
+static void write_json_string(BufferedWriter* writer, const char* text) {
+    static const char hex[] = "0123456789abcdef";
+
+    writer_put_char(writer, '"');
+    const char* start = text;
+    for (const char* p = text; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+
+        writer_put_bytes(writer, start, (size_t)(p - start));
+        start = p + 1;
+
+        switch (c) {
+            case '"': writer_put_string(writer, "\\\""); break;
+            case '\\': writer_put_string(writer, "\\\\"); break;
+            case '\n': writer_put_string(writer, "\\n"); break;
+            case '\r': writer_put_string(writer, "\\r"); break;
+            case '\t': writer_put_string(writer, "\\t"); break;
+            default: {
+                char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                writer_put_bytes(writer, escape, sizeof(escape));
+                break;
+            }
+        }
+    }
+    writer_put_string(writer, start);
+    writer_put_char(writer, '"');
+}
+
+/* A string value without text, which value_string(NULL) can make, is written as NULL. */
+static bool export_is_null(const Value* value) {
+    return value->type == VALUE_NULL || (value->type == VALUE_STRING && !value->data.string);
+}
+
+static void write_text_value(BufferedWriter* writer, const Value* value, CopyFormat format) {
+    if (export_is_null(value)) {
+        if (format == COPY_FORMAT_NDJSON) writer_put_string(writer, "null");
+        return;
+    }
+
+    switch (value->type) {
+        case VALUE_INTEGER:
+            writer_put_int(writer, value->data.integer);
+            break;
+        case VALUE_FLOAT:
+            if (format == COPY_FORMAT_NDJSON && !isfinite(value->data.float_val)) {
+                writer_put_string(writer, "null");
+            } else {
+                writer_put_double(writer, value->data.float_val);
+            }
+            break;
+        case VALUE_BOOLEAN:
+            writer_put_string(writer, value->data.boolean ? "true" : "false");
+            break;
+        case VALUE_STRING:
+            if (format == COPY_FORMAT_NDJSON) {
+                write_json_string(writer, value->data.string);
+            } else {
+                write_csv_string(writer, value->data.string);
+            }
+            break;
+        default:
+            if (format == COPY_FORMAT_NDJSON) writer_put_string(writer, "null");
+            break;
+    }
+}
+
+static void write_state_name(BufferedWriter* writer, DataState state, CopyFormat format) {
+    const char* name = datarecord_state_to_string(state);
+    if (format == COPY_FORMAT_NDJSON) {
+        write_json_string(writer, name);
+    } else {
+        writer_put_string(writer, name);
+    }
+}
+
+static void write_csv_header(BufferedWriter* writer, const TableSchema* schema, bool include_ghosts) {
+    for (size_t i = 0; i < schema->column_count; i++) {
+        if (i > 0) writer_put_char(writer, ',');
+        write_csv_string(writer, schema->columns[i].name);
+    }
+    if (include_ghosts) {
+        writer_put_string(writer, "," EXPORT_STATE_COLUMN "," EXPORT_STRENGTH_COLUMN);
+    }
+    writer_put_char(writer, '\n');
+}
+
+static void write_csv_rows(BufferedWriter* writer, const TableSchema* schema, bool include_ghosts,
+                           DataRecord* const* records, size_t count) {
+    for (size_t r = 0; r < count; r++) {
+        const DataRecord* record = records[r];
+        for (size_t i = 0; i < schema->column_count; i++) {
+            if (i > 0) writer_put_char(writer, ',');
+            write_text_value(writer, &record->values[i], COPY_FORMAT_CSV);
+        }
+        if (include_ghosts) {
+            writer_put_char(writer, ',');
+            write_state_name(writer, record->state, COPY_FORMAT_CSV);
+            writer_put_char(writer, ',');
+            writer_put_double(writer, record->ghost_strength);
+        }
+        writer_put_char(writer, '\n');
+    }
+}
+
+static void write_ndjson_rows(BufferedWriter* writer, const TableSchema* schema, bool include_ghosts,
+                              DataRecord* const* records, size_t count) {
+    for (size_t r = 0; r < count; r++) {
+        const DataRecord* record = records[r];
+        writer_put_char(writer, '{');
+        for (size_t i = 0; i < schema->column_count; i++) {
+            if (i > 0) writer_put_char(writer, ',');
+            write_json_string(writer, schema->columns[i].name);
+            writer_put_char(writer, ':');
+            write_text_value(writer, &record->values[i], COPY_FORMAT_NDJSON);
+        }
+        if (include_ghosts) {
+            writer_put_string(writer, ",\"" EXPORT_STATE_COLUMN "\":");
+            write_state_name(writer, record->state, COPY_FORMAT_NDJSON);
+            writer_put_string(writer, ",\"" EXPORT_STRENGTH_COLUMN "\":");
+            writer_put_double(writer, record->ghost_strength);
+        }
+        writer_put_string(writer, "}\n");
+    }
+}
+
+static void write_binary_header(BufferedWriter* writer, const TableSchema* schema, bool include_ghosts) {
+    writer_put_bytes(writer, EXPORT_BINARY_MAGIC, strlen(EXPORT_BINARY_MAGIC));
+    writer_put_u32(writer, EXPORT_BINARY_VERSION);
+    writer_put_u32(writer, (uint32_t)schema->column_count);
+    writer_put_u8(writer, include_ghosts ? 1 : 0);
+
+    for (size_t i = 0; i < schema->column_count; i++) {
+        const char* name = schema->columns[i].name;
+        writer_put_u8(writer, (uint8_t)schema->columns[i].type);
+        writer_put_u32(writer, (uint32_t)strlen(name));
+        writer_put_string(writer, name);
+    }
+}
+
+static bool write_binary_rows(BufferedWriter* writer, const TableSchema* schema, bool include_ghosts,
+                              DataRecord* const* records, size_t count) {
+    size_t bitmap_bytes = bitmap_byte_count(schema->column_count);
+    uint8_t* validity = malloc(bitmap_bytes ? bitmap_bytes : 1);
+    if (!validity) return false;
+
+    for (size_t r = 0; r < count; r++) {
+        const DataRecord* record = records[r];
+
+        writer_put_u8(writer, 1);
+        writer_put_u64(writer, record->id);
+        if (include_ghosts) {
+            writer_put_u8(writer, (uint8_t)record->state);
+            writer_put_f64(writer, record->ghost_strength);
+        }
+
+        memset(validity, 0, bitmap_bytes);
+        for (size_t i = 0; i < schema->column_count; i++) {
+            bitmap_set(validity, i, !export_is_null(&record->values[i]));
+        }
+        writer_put_bytes(writer, validity, bitmap_bytes);
+
+        for (size_t i = 0; i < schema->column_count; i++) {
+            const Value* value = &record->values[i];
+            if (export_is_null(value)) continue;
+            switch (value->type) {
+                case VALUE_INTEGER:
+                    writer_put_u64(writer, (uint64_t)value->data.integer);
+                    break;
+                case VALUE_FLOAT:
+                    writer_put_f64(writer, value->data.float_val);
+                    break;
+                case VALUE_BOOLEAN:
+                    writer_put_u8(writer, value->data.boolean ? 1 : 0);
+                    break;
+                case VALUE_STRING: {
+                    size_t length = strlen(value->data.string);
+                    writer_put_u32(writer, (uint32_t)length);
+                    writer_put_bytes(writer, value->data.string, length);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+
+    free(validity);
+    return true;
+}
+
+bool copy_to_writer(MemoryTable* table, const Query* query, BufferedWriter* writer,
+                    CopyFormat format, ExportStats* stats) {
+    ExportStats local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(ExportStats));
+
+    if (!table || !query || !writer) {
+        set_export_error(stats, "Invalid parameters", NULL);
+        return false;
+    }
+    if (format == COPY_FORMAT_AUTO) format = COPY_FORMAT_CSV;
+
+    QueryCursor* cursor = query_cursor_open_table(table, query);
+    DataRecord** batch = malloc(sizeof(DataRecord*) * RECORD_BATCH_SIZE);
+    if (!cursor || !batch) {
+        query_cursor_close(cursor);
+        free(batch);
+        set_export_error(stats, "Memory allocation failed", NULL);
+        return false;
+    }
+
+    const TableSchema* schema = table->schema;
+    bool include_ghosts = query->include_ghosts;
+    uint64_t bytes_before = writer->bytes_written + writer->length;
+
+    if (format == COPY_FORMAT_CSV) {
+        write_csv_header(writer, schema, include_ghosts);
+    } else if (format == COPY_FORMAT_BINARY) {
+        write_binary_header(writer, schema, include_ghosts);
+    }
+
+    size_t fetched;
+    while (!writer->failed && (fetched = query_cursor_fetch(cursor, batch, RECORD_BATCH_SIZE)) > 0) {
+        if (format == COPY_FORMAT_NDJSON) {
+            write_ndjson_rows(writer, schema, include_ghosts, batch, fetched);
+        } else if (format == COPY_FORMAT_BINARY) {
+            if (!write_binary_rows(writer, schema, include_ghosts, batch, fetched)) {
+                writer->failed = true;
+                break;
+            }
+        } else {
+            write_csv_rows(writer, schema, include_ghosts, batch, fetched);
+        }
+        stats->rows_written += fetched;
+    }
+
+    if (format == COPY_FORMAT_BINARY) {
+        writer_put_u8(writer, 0);
+        writer_put_u64(writer, stats->rows_written);
+    }
+
+    query_cursor_close(cursor);
+    free(batch);
+
+    stats->bytes_written = writer->bytes_written + writer->length - bytes_before;
+    if (writer->failed) {
+        set_export_error(stats, "Write failed", NULL);
+        return false;
+    }
+    return true;
+}
+
+bool copy_to_file(MemoryTable* table, const char* path, CopyFormat format,
+                  bool include_ghosts, ExportStats* stats) {
+    ExportStats local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(ExportStats));
+
+    if (!table || !path) {
+        set_export_error(stats, "Invalid parameters", NULL);
+        return false;
+    }
+    if (format == COPY_FORMAT_AUTO) format = copy_format_for_path(path);
+
+    Query* query = query_create(QUERY_SELECT, table->name);
+    if (!query) {
+        set_export_error(stats, "Memory allocation failed", NULL);
+        return false;
+    }
+    query->include_ghosts = include_ghosts;
+
+    BufferedWriter* writer = writer_open(path, WRITER_DEFAULT_CAPACITY);
+    if (!writer) {
+        query_destroy(query);
+        set_export_error(stats, "Cannot open file", path);
+        return false;
+    }
+
+    bool success = copy_to_writer(table, query, writer, format, stats);
+    if (!writer_close(writer) && success) {
+        set_export_error(stats, "Write failed", path);
+        success = false;
+    }
+
+    query_destroy(query);
+    return success;
+}
@@ -0,0 +1,26 @@
+#ifndef SHADE_QUERY_EXPORT_H
+#define SHADE_QUERY_EXPORT_H
+
+#include "executor.h"
+#include "../storage/copy.h"
+#include "../util/writer.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define EXPORT_STATE_COLUMN "_state"
+#define EXPORT_STRENGTH_COLUMN "_ghost_strength"
+#define EXPORT_BINARY_MAGIC "SHADEBIN"
+#define EXPORT_BINARY_VERSION 1
+
+typedef struct {
+    size_t rows_written;
+    uint64_t bytes_written;
+    char error[128];
+} ExportStats;
+
+bool copy_to_writer(MemoryTable* table, const Query* query, BufferedWriter* writer,
+                    CopyFormat format, ExportStats* stats);
+bool copy_to_file(MemoryTable* table, const char* path, CopyFormat format,
+                  bool include_ghosts, ExportStats* stats);
+
+#endif
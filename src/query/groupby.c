@@ -0,0 +1,570 @@
+#include "groupby.h"
+#include "batch.h"
+#include "predicate.h"
+#include "../util/hash.h"
+#include "../util/parallel.h"
+#include <stdio.h>
+#include <string.h>
+
+#define GROUP_EMPTY UINT32_MAX
+#define GROUP_SPLIT_BITS 4
+#define GROUP_MAX_HASH_BITS 48
+#define GROUP_INITIAL_SLOTS 64
+#define GROUP_NULL_HASH 0x5bd1e9955bd1e995ULL
+
+typedef struct {
+    DataRecord* record;
+    uint64_t hash;
+} GroupRow;
+
+typedef struct {
+    GroupRow* rows;
+    size_t count;
+    size_t capacity;
+} GroupBucket;
+
+typedef struct {
+    const GroupRow* rows;
+    size_t count;
+} GroupSegment;
+
+typedef struct {
+    uint32_t* slots;
+    size_t slot_capacity;
+    const char** strings;
+    uint64_t* hashes;
+    size_t count;
+    size_t capacity;
+} StringInterner;
+
+/* Open-addressing table: slots hold group ids, group keys and states live in dense arrays. */
+typedef struct {
+    uint32_t* slots;
+    size_t slot_capacity;
+
+    int64_t* keys;
+    uint8_t* nulls;
+    uint64_t* hashes;
+    AggregateState* states;
+    size_t group_count;
+    size_t group_capacity;
+
+    StringInterner strings;
+} GroupTable;
+
+typedef struct {
+    DataRecord** records;
+    size_t count;
+    size_t capacity;
+    size_t spills;
+    bool failed;
+} GroupPartition;
+
+struct GroupBy {
+    const GroupColumn* keys;
+    size_t key_count;
+    const Aggregate* aggregates;
+    size_t aggregate_count;
+    const GroupOutput* outputs;
+    size_t output_count;
+
+    size_t source_count;
+    size_t partition_bits;
+    size_t partition_count;
+    size_t memory_budget;
+
+    GroupBucket* buckets;
+    bool* source_failed;
+    GroupPartition* partitions;
+};
+
+bool group_column_bind(GroupColumn* group, const TableSchema* schema, char* error, size_t error_size) {
+    if (!group || !schema) return false;
+
+    int column = tableschema_find_column(schema, group->column);
+    group->column_index = column >= 0 ? column : PREDICATE_UNBOUND;
+    if (column >= 0) group->column_type = schema->columns[column].type;
+
+    const char* message = NULL;
+    if (column < 0) {
+        message = tableschema_lookup_message(column);
+    } else if (group->column_type == VALUE_FLOAT) {
+        message = "GROUP BY requires an INT, BOOL or STRING column, got";
+    }
+
+    if (message && error && error_size > 0) {
+        snprintf(error, error_size, "%s '%s'", message, group->column);
+    }
+    return message == NULL;
+}
+
+static const Value* key_value(const GroupColumn* key, const DataRecord* record) {
+    const Value* value = &record->values[key->column_index];
+    if (value->type != key->column_type) return NULL;
+    if (value->type == VALUE_STRING && !value->data.string) return NULL;
+    return value;
+}
+
+static uint64_t hash_row(const GroupBy* groups, const DataRecord* record) {
+    uint64_t hash = 0x9e3779b97f4a7c15ULL;
+
+    for (size_t k = 0; k < groups->key_count; k++) {
+        const Value* value = key_value(&groups->keys[k], record);
+        uint64_t part = GROUP_NULL_HASH;
+
+        if (value) {
+            switch (value->type) {
+                case VALUE_INTEGER: part = (uint64_t)value->data.integer; break;
+                case VALUE_BOOLEAN: part = value->data.boolean ? 1 : 0; break;
+                default: part = hash_string(value->data.string); break;
+            }
+        }
+        hash = hash_mix(hash ^ part);
+    }
+
+    return hash;
+}
+
+static bool bucket_push(GroupBucket* bucket, DataRecord* record, uint64_t hash) {
+    if (bucket->count == bucket->capacity) {
+        size_t capacity = bucket->capacity ? bucket->capacity * 2 : RECORD_BATCH_SIZE;
+        GroupRow* rows = realloc(bucket->rows, sizeof(GroupRow) * capacity);
+        if (!rows) return false;
+
+        bucket->rows = rows;
+        bucket->capacity = capacity;
+    }
+
+    bucket->rows[bucket->count].record = record;
+    bucket->rows[bucket->count].hash = hash;
+    bucket->count++;
+    return true;
+}
+
+static uint32_t* allocate_slots(size_t capacity) {
+    uint32_t* slots = malloc(sizeof(uint32_t) * capacity);
+    if (slots) memset(slots, 0xff, sizeof(uint32_t) * capacity);
+    return slots;
+}
+
+static bool interner_grow(StringInterner* interner) {
+    size_t slot_capacity = interner->slot_capacity ? interner->slot_capacity * 2 : GROUP_INITIAL_SLOTS;
+    uint32_t* slots = allocate_slots(slot_capacity);
+    if (!slots) return false;
+
+    for (size_t id = 0; id < interner->count; id++) {
+        size_t slot = interner->hashes[id] & (slot_capacity - 1);
+        while (slots[slot] != GROUP_EMPTY) slot = (slot + 1) & (slot_capacity - 1);
+        slots[slot] = (uint32_t)id;
+    }
+
+    free(interner->slots);
+    interner->slots = slots;
+    interner->slot_capacity = slot_capacity;
+    return true;
+}
+
+static bool interner_intern(StringInterner* interner, const char* text, uint32_t* out_id) {
+    if (interner->count * 2 >= interner->slot_capacity && !interner_grow(interner)) return false;
+
+    uint64_t hash = hash_string(text);
+    size_t mask = interner->slot_capacity - 1;
+    size_t slot = hash & mask;
+
+    while (interner->slots[slot] != GROUP_EMPTY) {
+        uint32_t id = interner->slots[slot];
+        if (interner->hashes[id] == hash && strcmp(interner->strings[id], text) == 0) {
+            *out_id = id;
+            return true;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (interner->count == interner->capacity) {
+        size_t capacity = interner->capacity ? interner->capacity * 2 : GROUP_INITIAL_SLOTS;
+        const char** strings = realloc(interner->strings, sizeof(const char*) * capacity);
+        if (strings) interner->strings = strings;
+        uint64_t* hashes = strings ? realloc(interner->hashes, sizeof(uint64_t) * capacity) : NULL;
+        if (!hashes) return false;
+
+        interner->hashes = hashes;
+        interner->capacity = capacity;
+    }
+
+    interner->strings[interner->count] = text;
+    interner->hashes[interner->count] = hash;
+    interner->slots[slot] = (uint32_t)interner->count;
+    *out_id = (uint32_t)interner->count++;
+    return true;
+}
+
+static void table_free(GroupTable* table) {
+    free(table->slots);
+    free(table->keys);
+    free(table->nulls);
+    free(table->hashes);
+    free(table->states);
+    free(table->strings.slots);
+    free(table->strings.strings);
+    free(table->strings.hashes);
+    memset(table, 0, sizeof(GroupTable));
+}
+
+static size_t table_bytes(const GroupBy* groups, const GroupTable* table) {
+    size_t group_bytes = groups->key_count * (sizeof(int64_t) + 1) + sizeof(uint64_t) +
+                         groups->aggregate_count * sizeof(AggregateState);
+
+    return table->slot_capacity * sizeof(uint32_t) + table->group_capacity * group_bytes +
+           table->strings.slot_capacity * sizeof(uint32_t) +
+           table->strings.capacity * (sizeof(const char*) + sizeof(uint64_t));
+}
+
+static bool table_grow_slots(GroupTable* table) {
+    size_t slot_capacity = table->slot_capacity ? table->slot_capacity * 2 : GROUP_INITIAL_SLOTS;
+    uint32_t* slots = allocate_slots(slot_capacity);
+    if (!slots) return false;
+
+    for (size_t group = 0; group < table->group_count; group++) {
+        size_t slot = table->hashes[group] & (slot_capacity - 1);
+        while (slots[slot] != GROUP_EMPTY) slot = (slot + 1) & (slot_capacity - 1);
+        slots[slot] = (uint32_t)group;
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->slot_capacity = slot_capacity;
+    return true;
+}
+
+static bool table_grow_groups(const GroupBy* groups, GroupTable* table) {
+    size_t capacity = table->group_capacity ? table->group_capacity * 2 : GROUP_INITIAL_SLOTS;
+    size_t keys = groups->key_count;
+
+    int64_t* key_values = realloc(table->keys, sizeof(int64_t) * keys * capacity);
+    if (key_values) table->keys = key_values;
+    uint8_t* nulls = key_values ? realloc(table->nulls, keys * capacity) : NULL;
+    if (nulls) table->nulls = nulls;
+    uint64_t* hashes = nulls ? realloc(table->hashes, sizeof(uint64_t) * capacity) : NULL;
+    if (hashes) table->hashes = hashes;
+    AggregateState* states = hashes ? realloc(table->states, sizeof(AggregateState) *
+                                              groups->aggregate_count * capacity + 1) : NULL;
+    if (!states) return false;
+
+    table->states = states;
+    table->group_capacity = capacity;
+    return true;
+}
+
+static bool encode_key(const GroupBy* groups, GroupTable* table, const DataRecord* record,
+                       int64_t* key, uint8_t* nulls) {
+    for (size_t k = 0; k < groups->key_count; k++) {
+        const Value* value = key_value(&groups->keys[k], record);
+        nulls[k] = value == NULL;
+        key[k] = 0;
+        if (!value) continue;
+
+        switch (value->type) {
+            case VALUE_INTEGER:
+                key[k] = value->data.integer;
+                break;
+            case VALUE_BOOLEAN:
+                key[k] = value->data.boolean;
+                break;
+            default: {
+                uint32_t id;
+                if (!interner_intern(&table->strings, value->data.string, &id)) return false;
+                key[k] = id;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+static uint32_t table_find_or_insert(const GroupBy* groups, GroupTable* table, const DataRecord* record,
+                                     uint64_t hash) {
+    size_t keys = groups->key_count;
+    int64_t key[keys];
+    uint8_t nulls[keys];
+
+    if (!encode_key(groups, table, record, key, nulls)) return GROUP_EMPTY;
+    if (table->group_count * 2 >= table->slot_capacity && !table_grow_slots(table)) return GROUP_EMPTY;
+
+    size_t mask = table->slot_capacity - 1;
+    size_t slot = hash & mask;
+
+    while (table->slots[slot] != GROUP_EMPTY) {
+        uint32_t group = table->slots[slot];
+        if (table->hashes[group] == hash &&
+            memcmp(&table->keys[group * keys], key, sizeof(int64_t) * keys) == 0 &&
+            memcmp(&table->nulls[group * keys], nulls, keys) == 0) {
+            return group;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (table->group_count == table->group_capacity && !table_grow_groups(groups, table)) return GROUP_EMPTY;
+
+    size_t group = table->group_count++;
+    memcpy(&table->keys[group * keys], key, sizeof(int64_t) * keys);
+    memcpy(&table->nulls[group * keys], nulls, keys);
+    table->hashes[group] = hash;
+    for (size_t a = 0; a < groups->aggregate_count; a++) {
+        aggregate_state_init(&table->states[group * groups->aggregate_count + a]);
+    }
+
+    table->slots[slot] = (uint32_t)group;
+    return (uint32_t)group;
+}
+
+static Value group_key_value(const GroupBy* groups, const GroupTable* table, size_t group, size_t key) {
+    size_t index = group * groups->key_count + key;
+    if (table->nulls[index]) return value_null();
+
+    switch (groups->keys[key].column_type) {
+        case VALUE_INTEGER: return value_integer(table->keys[index]);
+        case VALUE_BOOLEAN: return value_boolean(table->keys[index] != 0);
+        default: return value_string(table->strings.strings[table->keys[index]]);
+    }
+}
+
+static bool emit_groups(const GroupBy* groups, const GroupTable* table, GroupPartition* partition) {
+    if (partition->capacity - partition->count < table->group_count) {
+        size_t capacity = partition->count + table->group_count;
+        DataRecord** records = realloc(partition->records, sizeof(DataRecord*) * (capacity ? capacity : 1));
+        if (!records) return false;
+
+        partition->records = records;
+        partition->capacity = capacity;
+    }
+
+    for (size_t group = 0; group < table->group_count; group++) {
+        Value* values = malloc(sizeof(Value) * groups->output_count);
+        if (!values) return false;
+
+        for (size_t o = 0; o < groups->output_count; o++) {
+            const GroupOutput* output = &groups->outputs[o];
+            if (output->is_aggregate) {
+                values[o] = aggregate_finalize(&groups->aggregates[output->index],
+                                               &table->states[group * groups->aggregate_count + output->index]);
+            } else {
+                values[o] = group_key_value(groups, table, group, output->index);
+            }
+        }
+
+        DataRecord* record = datarecord_create_owned(0, values, groups->output_count);
+        if (!record) {
+            for (size_t o = 0; o < groups->output_count; o++) {
+                value_destroy(&values[o]);
+            }
+            free(values);
+            return false;
+        }
+        partition->records[partition->count++] = record;
+    }
+
+    return true;
+}
+
+static bool aggregate_segments(GroupBy* groups, GroupPartition* partition,
+                               const GroupSegment* segments, size_t segment_count, size_t depth);
+
+static bool split_segments(GroupBy* groups, GroupPartition* partition,
+                           const GroupSegment* segments, size_t segment_count, size_t depth) {
+    GroupBucket splits[1 << GROUP_SPLIT_BITS];
+    memset(splits, 0, sizeof(splits));
+
+    size_t shift = 64 - groups->partition_bits - GROUP_SPLIT_BITS * (depth + 1);
+    bool success = true;
+
+    for (size_t s = 0; s < segment_count && success; s++) {
+        for (size_t i = 0; i < segments[s].count && success; i++) {
+            const GroupRow* row = &segments[s].rows[i];
+            size_t index = (row->hash >> shift) & ((1 << GROUP_SPLIT_BITS) - 1);
+            success = bucket_push(&splits[index], row->record, row->hash);
+        }
+    }
+
+    for (size_t j = 0; j < (1 << GROUP_SPLIT_BITS); j++) {
+        if (success && splits[j].count > 0) {
+            GroupSegment segment = { splits[j].rows, splits[j].count };
+            success = aggregate_segments(groups, partition, &segment, 1, depth + 1);
+        }
+        free(splits[j].rows);
+    }
+
+    return success;
+}
+
+static bool aggregate_segments(GroupBy* groups, GroupPartition* partition,
+                               const GroupSegment* segments, size_t segment_count, size_t depth) {
+    GroupTable table;
+    memset(&table, 0, sizeof(GroupTable));
+
+    bool can_split = groups->partition_bits + GROUP_SPLIT_BITS * (depth + 1) <= GROUP_MAX_HASH_BITS;
+    DataRecord* batch[RECORD_BATCH_SIZE];
+    uint32_t ids[RECORD_BATCH_SIZE];
+
+    for (size_t s = 0; s < segment_count; s++) {
+        for (size_t offset = 0; offset < segments[s].count; offset += RECORD_BATCH_SIZE) {
+            size_t count = segments[s].count - offset;
+            if (count > RECORD_BATCH_SIZE) count = RECORD_BATCH_SIZE;
+
+            const GroupRow* rows = segments[s].rows + offset;
+            for (size_t i = 0; i < count; i++) {
+                batch[i] = rows[i].record;
+                ids[i] = table_find_or_insert(groups, &table, rows[i].record, rows[i].hash);
+                if (ids[i] == GROUP_EMPTY) {
+                    table_free(&table);
+                    return false;
+                }
+            }
+
+            for (size_t a = 0; a < groups->aggregate_count; a++) {
+                aggregate_accumulate_grouped(&groups->aggregates[a], table.states + a,
+                                             groups->aggregate_count, ids, batch, count);
+            }
+
+            if (can_split && table_bytes(groups, &table) > groups->memory_budget) {
+                table_free(&table);
+                partition->spills++;
+                return split_segments(groups, partition, segments, segment_count, depth);
+            }
+        }
+    }
+
+    bool success = emit_groups(groups, &table, partition);
+    table_free(&table);
+    return success;
+}
+
+GroupBy* groupby_create(const GroupColumn* keys, size_t key_count,
+                        const Aggregate* aggregates, size_t aggregate_count,
+                        const GroupOutput* outputs, size_t output_count,
+                        size_t source_count, size_t partition_bits, size_t memory_budget) {
+    if (!keys || key_count == 0 || !outputs || output_count == 0 || source_count == 0) return NULL;
+    if (partition_bits > GROUPBY_MAX_PARTITION_BITS) partition_bits = GROUPBY_MAX_PARTITION_BITS;
+
+    GroupBy* groups = calloc(1, sizeof(GroupBy));
+    if (!groups) return NULL;
+
+    groups->keys = keys;
+    groups->key_count = key_count;
+    groups->aggregates = aggregates;
+    groups->aggregate_count = aggregate_count;
+    groups->outputs = outputs;
+    groups->output_count = output_count;
+    groups->source_count = source_count;
+    groups->partition_bits = partition_bits;
+    groups->partition_count = (size_t)1 << partition_bits;
+    groups->memory_budget = memory_budget ? memory_budget : GROUPBY_DEFAULT_MEMORY_BUDGET;
+
+    groups->buckets = calloc(source_count * groups->partition_count, sizeof(GroupBucket));
+    groups->source_failed = calloc(source_count, sizeof(bool));
+    groups->partitions = calloc(groups->partition_count, sizeof(GroupPartition));
+
+    if (!groups->buckets || !groups->source_failed || !groups->partitions) {
+        groupby_destroy(groups);
+        return NULL;
+    }
+
+    return groups;
+}
+
+bool groupby_add(GroupBy* groups, size_t source, DataRecord* const* records, size_t count) {
+    if (!groups || source >= groups->source_count) return false;
+
+    GroupBucket* buckets = groups->buckets + source * groups->partition_count;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t hash = hash_row(groups, records[i]);
+        size_t partition = groups->partition_bits ? hash >> (64 - groups->partition_bits) : 0;
+
+        if (!bucket_push(&buckets[partition], records[i], hash)) {
+            groups->source_failed[source] = true;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void finish_partition(void* context, size_t index) {
+    GroupBy* groups = context;
+    GroupPartition* partition = &groups->partitions[index];
+
+    GroupSegment* segments = malloc(sizeof(GroupSegment) * groups->source_count);
+    if (!segments) {
+        partition->failed = true;
+        return;
+    }
+
+    for (size_t s = 0; s < groups->source_count; s++) {
+        GroupBucket* bucket = &groups->buckets[s * groups->partition_count + index];
+        segments[s].rows = bucket->rows;
+        segments[s].count = bucket->count;
+    }
+
+    partition->failed = !aggregate_segments(groups, partition, segments, groups->source_count, 0);
+    free(segments);
+}
+
+bool groupby_finish(GroupBy* groups, DataRecord*** out_records, size_t* out_count) {
+    if (!groups || !out_records || !out_count) return false;
+
+    for (size_t s = 0; s < groups->source_count; s++) {
+        if (groups->source_failed[s]) return false;
+    }
+
+    if (!parallel_run(groups->partition_count, finish_partition, groups)) return false;
+
+    size_t total = 0;
+    for (size_t p = 0; p < groups->partition_count; p++) {
+        if (groups->partitions[p].failed) return false;
+        total += groups->partitions[p].count;
+    }
+
+    DataRecord** records = malloc(sizeof(DataRecord*) * (total ? total : 1));
+    if (!records) return false;
+
+    size_t count = 0;
+    for (size_t p = 0; p < groups->partition_count; p++) {
+        GroupPartition* partition = &groups->partitions[p];
+        if (partition->count == 0) continue;
+        memcpy(records + count, partition->records, sizeof(DataRecord*) * partition->count);
+        count += partition->count;
+        partition->count = 0;
+    }
+
+    *out_records = records;
+    *out_count = count;
+    return true;
+}
+
+size_t groupby_spill_count(const GroupBy* groups) {
+    size_t spills = 0;
+    for (size_t p = 0; groups && p < groups->partition_count; p++) {
+        spills += groups->partitions[p].spills;
+    }
+    return spills;
+}
+
+void groupby_destroy(GroupBy* groups) {
+    if (!groups) return;
+
+    for (size_t i = 0; groups->buckets && i < groups->source_count * groups->partition_count; i++) {
+        free(groups->buckets[i].rows);
+    }
+
+    for (size_t p = 0; groups->partitions && p < groups->partition_count; p++) {
+        GroupPartition* partition = &groups->partitions[p];
+        for (size_t i = 0; i < partition->count; i++) {
+            datarecord_destroy(partition->records[i]);
+        }
+        free(partition->records);
+    }
+
+    free(groups->buckets);
+    free(groups->source_failed);
+    free(groups->partitions);
+    free(groups);
+}
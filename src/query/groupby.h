@@ -0,0 +1,40 @@
+#ifndef SHADE_QUERY_GROUPBY_H
+#define SHADE_QUERY_GROUPBY_H
+
+#include "aggregate.h"
+#include "../types/data.h"
+#include "../types/schema.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define GROUPBY_DEFAULT_MEMORY_BUDGET (64 * 1024 * 1024)
+#define GROUPBY_MAX_PARTITION_BITS 6
+
+typedef struct {
+    char* column;
+    int column_index;
+    ValueType column_type;
+} GroupColumn;
+
+/* Output column i is group key `index` or aggregate `index`, in select-list order. */
+typedef struct {
+    bool is_aggregate;
+    size_t index;
+} GroupOutput;
+
+typedef struct GroupBy GroupBy;
+
+bool group_column_bind(GroupColumn* group, const TableSchema* schema, char* error, size_t error_size);
+
+/* Rows are scattered per source (one per scanning thread) into 2^partition_bits hash partitions. */
+GroupBy* groupby_create(const GroupColumn* keys, size_t key_count,
+                        const Aggregate* aggregates, size_t aggregate_count,
+                        const GroupOutput* outputs, size_t output_count,
+                        size_t source_count, size_t partition_bits, size_t memory_budget);
+bool groupby_add(GroupBy* groups, size_t source, DataRecord* const* records, size_t count);
+bool groupby_finish(GroupBy* groups, DataRecord*** out_records, size_t* out_count);
+size_t groupby_spill_count(const GroupBy* groups);
+void groupby_destroy(GroupBy* groups);
+
+#endif
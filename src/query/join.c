@@ -0,0 +1,403 @@
+#include "join.h"
+#include "predicate.h"
+#include "../util/hash.h"
+#include "../util/parallel.h"
+#include <stdio.h>
+#include <string.h>
+
+/* Build rows per partition, so each partition's table stays cache resident while it is probed. */
+#define JOIN_PARTITION_ROWS 4096
+#define JOIN_MAX_PARTITION_BITS 10
+#define JOIN_PROBE_CHUNK_ROWS (16 * 1024)
+#define JOIN_EMPTY UINT32_MAX
+
+typedef struct {
+    uint64_t hash;
+    DataRecord* record;
+} JoinEntry;
+
+typedef struct {
+    uint32_t position;
+    DataRecord* right;
+} JoinMatch;
+
+typedef struct {
+    const JoinClause* join;
+    size_t bits;
+    JoinEntry* entries;
+    size_t* offsets;
+    size_t* slot_offsets;
+    uint32_t* heads;
+    uint32_t* next;
+    DataRecord* const* probe;
+    size_t probe_count;
+    JoinPair** chunk_pairs;
+    size_t* chunk_counts;
+    bool* chunk_failed;
+} HashJoin;
+
+JoinClause* join_clause_create(const char* table_name) {
+    JoinClause* join = malloc(sizeof(JoinClause));
+    if (!join) return NULL;
+
+    join->table_name = string_duplicate(table_name);
+    join->include_ghosts = false;
+    join->left_column = NULL;
+    join->right_column = NULL;
+    join->left_index = PREDICATE_UNBOUND;
+    join->right_index = PREDICATE_UNBOUND;
+    join->column_type = VALUE_NULL;
+    join->strategy = JOIN_AUTO;
+
+    if (!join->table_name) {
+        free(join);
+        return NULL;
+    }
+    return join;
+}
+
+void join_clause_destroy(JoinClause* join) {
+    if (!join) return;
+
+    free(join->table_name);
+    free(join->left_column);
+    free(join->right_column);
+    free(join);
+}
+
+static char* qualified_name(const char* table, const char* column) {
+    size_t length = strlen(table) + strlen(column) + 2;
+    char* name = malloc(length);
+    if (name) snprintf(name, length, "%s.%s", table, column);
+    return name;
+}
+
+TableSchema* join_schema(const TableSchema* left, const TableSchema* right) {
+    if (!left || !right) return NULL;
+
+    size_t count = left->column_count + right->column_count;
+    ColumnSchema* columns = calloc(count, sizeof(ColumnSchema));
+    if (!columns) return NULL;
+
+    bool named = true;
+    for (size_t i = 0; i < count; i++) {
+        const TableSchema* source = i < left->column_count ? left : right;
+        const ColumnSchema* column = &source->columns[i < left->column_count ? i : i - left->column_count];
+
+        columns[i].name = qualified_name(source->name, column->name);
+        columns[i].type = column->type;
+        named = named && columns[i].name;
+    }
+
+    TableSchema* schema = named ? tableschema_create(left->name, columns, count) : NULL;
+
+    for (size_t i = 0; i < count; i++) {
+        free(columns[i].name);
+    }
+    free(columns);
+    return schema;
+}
+
+static bool join_error(char* error, size_t error_size, const char* message, const char* column) {
+    if (error && error_size > 0) {
+        snprintf(error, error_size, "%s '%s'", message, column);
+    }
+    return false;
+}
+
+bool join_clause_bind(JoinClause* join, const TableSchema* left, const TableSchema* right,
+                      char* error, size_t error_size) {
+    if (!join || !left || !right) return false;
+
+    TableSchema* schema = join_schema(left, right);
+    if (!schema) return false;
+
+    int first = tableschema_find_column(schema, join->left_column);
+    int second = tableschema_find_column(schema, join->right_column);
+    int left_count = (int)left->column_count;
+    bool bound = false;
+
+    if (first < 0) {
+        join_error(error, error_size, tableschema_lookup_message(first), join->left_column);
+    } else if (second < 0) {
+        join_error(error, error_size, tableschema_lookup_message(second), join->right_column);
+    } else {
+        if (first >= left_count && second < left_count) {
+            int index = first;
+            first = second;
+            second = index;
+
+            char* column = join->left_column;
+            join->left_column = join->right_column;
+            join->right_column = column;
+        }
+
+        ValueType type = schema->columns[first].type;
+        if (first >= left_count || second < left_count) {
+            join_error(error, error_size, "JOIN must compare a column of each table, got", join->right_column);
+        } else if (type != schema->columns[second].type || type == VALUE_FLOAT) {
+            join_error(error, error_size, "JOIN requires INT, BOOL or STRING columns of the same type, got",
+                       join->right_column);
+        } else {
+            join->left_index = first;
+            join->right_index = second - left_count;
+            join->column_type = type;
+            bound = true;
+        }
+    }
+
+    tableschema_destroy(schema);
+    return bound;
+}
+
+static const Value* join_key(const DataRecord* record, int column, ValueType type) {
+    const Value* value = &record->values[column];
+    if (value->type != type) return NULL;
+    if (type == VALUE_STRING && !value->data.string) return NULL;
+    return value;
+}
+
+static uint64_t hash_key(const Value* value) {
+    switch (value->type) {
+        case VALUE_INTEGER: return hash_mix((uint64_t)value->data.integer);
+        case VALUE_BOOLEAN: return hash_mix(value->data.boolean ? 1 : 0);
+        default: return hash_mix(hash_string(value->data.string));
+    }
+}
+
+static bool keys_equal(const Value* a, const Value* b) {
+    switch (a->type) {
+        case VALUE_INTEGER: return a->data.integer == b->data.integer;
+        case VALUE_BOOLEAN: return a->data.boolean == b->data.boolean;
+        default: return strcmp(a->data.string, b->data.string) == 0;
+    }
+}
+
+static size_t partition_of(uint64_t hash, size_t bits) {
+    return bits ? (size_t)(hash >> (64 - bits)) : 0;
+}
+
+static size_t slot_count(size_t entries) {
+    size_t slots = 1;
+    while (slots < entries * 2) slots *= 2;
+    return slots;
+}
+
+static void build_partition(void* context, size_t index) {
+    HashJoin* join = context;
+    size_t base = join->slot_offsets[index];
+    size_t mask = join->slot_offsets[index + 1] - base - 1;
+
+    for (size_t e = join->offsets[index + 1]; e > join->offsets[index]; e--) {
+        size_t entry = e - 1;
+        size_t slot = base + (join->entries[entry].hash & mask);
+        join->next[entry] = join->heads[slot];
+        join->heads[slot] = (uint32_t)entry;
+    }
+}
+
+static bool push_match(JoinMatch** matches, size_t* count, size_t* capacity, uint32_t position, DataRecord* right) {
+    if (*count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 1024;
+        JoinMatch* grown = realloc(*matches, sizeof(JoinMatch) * new_capacity);
+        if (!grown) return false;
+
+        *matches = grown;
+        *capacity = new_capacity;
+    }
+
+    (*matches)[*count].position = position;
+    (*matches)[*count].right = right;
+    (*count)++;
+    return true;
+}
+
+/* Probes one chunk partition by partition, then restores left-row order with a counting sort. */
+static bool probe_rows(HashJoin* join, size_t index, JoinMatch** matches, size_t* match_count,
+                       size_t* match_capacity, uint64_t* hashes, uint32_t* order, size_t* counts) {
+    const JoinClause* clause = join->join;
+    size_t start = index * JOIN_PROBE_CHUNK_ROWS;
+    size_t rows = join->probe_count - start < JOIN_PROBE_CHUNK_ROWS ? join->probe_count - start : JOIN_PROBE_CHUNK_ROWS;
+    size_t partitions = (size_t)1 << join->bits;
+
+    memset(counts, 0, sizeof(size_t) * (partitions + 1));
+    for (size_t i = 0; i < rows; i++) {
+        const Value* key = join_key(join->probe[start + i], clause->left_index, clause->column_type);
+        hashes[i] = key ? hash_key(key) : 0;
+        if (key) counts[partition_of(hashes[i], join->bits) + 1]++;
+    }
+
+    for (size_t p = 0; p < partitions; p++) {
+        counts[p + 1] += counts[p];
+    }
+    size_t valid = counts[partitions];
+
+    for (size_t i = 0; i < rows; i++) {
+        if (join_key(join->probe[start + i], clause->left_index, clause->column_type)) {
+            order[counts[partition_of(hashes[i], join->bits)]++] = (uint32_t)i;
+        }
+    }
+
+    for (size_t o = 0; o < valid; o++) {
+        uint32_t position = order[o];
+        uint64_t hash = hashes[position];
+        size_t partition = partition_of(hash, join->bits);
+        size_t base = join->slot_offsets[partition];
+        size_t mask = join->slot_offsets[partition + 1] - base - 1;
+        const Value* key = &join->probe[start + position]->values[clause->left_index];
+
+        for (uint32_t entry = join->heads[base + (hash & mask)]; entry != JOIN_EMPTY; entry = join->next[entry]) {
+            if (join->entries[entry].hash != hash) continue;
+
+            DataRecord* right = join->entries[entry].record;
+            if (!keys_equal(key, &right->values[clause->right_index])) continue;
+            if (!push_match(matches, match_count, match_capacity, position, right)) return false;
+        }
+    }
+
+    JoinPair* pairs = malloc(sizeof(JoinPair) * (*match_count + 1));
+    if (!pairs) return false;
+
+    memset(counts, 0, sizeof(size_t) * (rows + 1));
+    for (size_t m = 0; m < *match_count; m++) {
+        counts[(*matches)[m].position + 1]++;
+    }
+    for (size_t i = 0; i < rows; i++) {
+        counts[i + 1] += counts[i];
+    }
+    for (size_t m = 0; m < *match_count; m++) {
+        JoinPair* pair = &pairs[counts[(*matches)[m].position]++];
+        pair->left = join->probe[start + (*matches)[m].position];
+        pair->right = (*matches)[m].right;
+    }
+
+    join->chunk_pairs[index] = pairs;
+    join->chunk_counts[index] = *match_count;
+    return true;
+}
+
+static void probe_chunk(void* context, size_t index) {
+    HashJoin* join = context;
+    size_t partitions = (size_t)1 << join->bits;
+    size_t counted = JOIN_PROBE_CHUNK_ROWS > partitions ? JOIN_PROBE_CHUNK_ROWS : partitions;
+
+    JoinMatch* matches = NULL;
+    size_t match_count = 0;
+    size_t match_capacity = 0;
+    uint64_t* hashes = malloc(sizeof(uint64_t) * JOIN_PROBE_CHUNK_ROWS);
+    uint32_t* order = malloc(sizeof(uint32_t) * JOIN_PROBE_CHUNK_ROWS);
+    size_t* counts = malloc(sizeof(size_t) * (counted + 1));
+
+    join->chunk_failed[index] = !hashes || !order || !counts ||
+                                !probe_rows(join, index, &matches, &match_count, &match_capacity, hashes, order, counts);
+
+    free(matches);
+    free(hashes);
+    free(order);
+    free(counts);
+}
+
+static bool partition_build(HashJoin* join, DataRecord* const* right, size_t right_count) {
+    const JoinClause* clause = join->join;
+    size_t partitions = (size_t)1 << join->bits;
+
+    join->offsets = calloc(partitions + 1, sizeof(size_t));
+    join->slot_offsets = calloc(partitions + 1, sizeof(size_t));
+    uint64_t* hashes = malloc(sizeof(uint64_t) * (right_count + 1));
+    if (!join->offsets || !join->slot_offsets || !hashes) {
+        free(hashes);
+        return false;
+    }
+
+    for (size_t i = 0; i < right_count; i++) {
+        const Value* key = join_key(right[i], clause->right_index, clause->column_type);
+        hashes[i] = key ? hash_key(key) : 0;
+        if (key) join->offsets[partition_of(hashes[i], join->bits) + 1]++;
+    }
+
+    for (size_t p = 0; p < partitions; p++) {
+        size_t entries = join->offsets[p + 1];
+        join->offsets[p + 1] += join->offsets[p];
+        join->slot_offsets[p + 1] = join->slot_offsets[p] + slot_count(entries);
+    }
+
+    size_t entry_count = join->offsets[partitions];
+    size_t* cursor = malloc(sizeof(size_t) * partitions);
+    join->entries = malloc(sizeof(JoinEntry) * (entry_count + 1));
+    join->next = malloc(sizeof(uint32_t) * (entry_count + 1));
+    join->heads = malloc(sizeof(uint32_t) * join->slot_offsets[partitions]);
+    bool success = cursor && join->entries && join->next && join->heads && entry_count < JOIN_EMPTY;
+
+    if (success) {
+        memcpy(cursor, join->offsets, sizeof(size_t) * partitions);
+        memset(join->heads, 0xff, sizeof(uint32_t) * join->slot_offsets[partitions]);
+
+        for (size_t i = 0; i < right_count; i++) {
+            if (!join_key(right[i], clause->right_index, clause->column_type)) continue;
+
+            JoinEntry* entry = &join->entries[cursor[partition_of(hashes[i], join->bits)]++];
+            entry->hash = hashes[i];
+            entry->record = right[i];
+        }
+    }
+
+    free(cursor);
+    free(hashes);
+    return success && parallel_run(partitions, build_partition, join);
+}
+
+bool join_hash(const JoinClause* join, DataRecord* const* left, size_t left_count,
+               DataRecord* const* right, size_t right_count, JoinPair** out_pairs, size_t* out_count) {
+    if (!join || !out_pairs || !out_count) return false;
+
+    HashJoin state = {
+        .join = join,
+        .probe = left,
+        .probe_count = left_count
+    };
+    while (state.bits < JOIN_MAX_PARTITION_BITS && (right_count >> state.bits) > JOIN_PARTITION_ROWS) {
+        state.bits++;
+    }
+
+    size_t chunk_count = (left_count + JOIN_PROBE_CHUNK_ROWS - 1) / JOIN_PROBE_CHUNK_ROWS;
+    state.chunk_pairs = calloc(chunk_count + 1, sizeof(JoinPair*));
+    state.chunk_counts = calloc(chunk_count + 1, sizeof(size_t));
+    state.chunk_failed = calloc(chunk_count + 1, sizeof(bool));
+
+    bool success = state.chunk_pairs && state.chunk_counts && state.chunk_failed &&
+                   partition_build(&state, right, right_count) &&
+                   parallel_run(chunk_count, probe_chunk, &state);
+
+    size_t total = 0;
+    for (size_t chunk = 0; success && chunk < chunk_count; chunk++) {
+        success = !state.chunk_failed[chunk];
+        total += state.chunk_counts[chunk];
+    }
+
+    JoinPair* pairs = success ? malloc(sizeof(JoinPair) * (total + 1)) : NULL;
+    success = pairs != NULL;
+
+    size_t count = 0;
+    for (size_t chunk = 0; state.chunk_pairs && chunk < chunk_count; chunk++) {
+        if (success) {
+            memcpy(pairs + count, state.chunk_pairs[chunk], sizeof(JoinPair) * state.chunk_counts[chunk]);
+            count += state.chunk_counts[chunk];
+        }
+        free(state.chunk_pairs[chunk]);
+    }
+
+    free(state.chunk_pairs);
+    free(state.chunk_counts);
+    free(state.chunk_failed);
+    free(state.entries);
+    free(state.offsets);
+    free(state.slot_offsets);
+    free(state.heads);
+    free(state.next);
+
+    if (!success) return false;
+
+    *out_pairs = pairs;
+    *out_count = count;
+    return true;
+}
@@ -0,0 +1,48 @@
+#ifndef SHADE_QUERY_JOIN_H
+#define SHADE_QUERY_JOIN_H
+
+#include "../types/data.h"
+#include "../types/schema.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef enum {
+    JOIN_AUTO,
+    JOIN_HASH,
+    JOIN_INDEX
+} JoinStrategy;
+
+/* FROM <left> JOIN <table_name> ON <left_column> = <right_column>; the columns may be written
+ * in either order and are swapped into place when bound. */
+typedef struct {
+    char* table_name;
+    bool include_ghosts;
+    char* left_column;
+    char* right_column;
+    int left_index;
+    int right_index;
+    ValueType column_type;
+    JoinStrategy strategy;
+} JoinClause;
+
+typedef struct {
+    DataRecord* left;
+    DataRecord* right;
+} JoinPair;
+
+JoinClause* join_clause_create(const char* table_name);
+void join_clause_destroy(JoinClause* join);
+
+/* Output columns are the left columns followed by the right ones, named "table.column". */
+TableSchema* join_schema(const TableSchema* left, const TableSchema* right);
+bool join_clause_bind(JoinClause* join, const TableSchema* left, const TableSchema* right,
+                      char* error, size_t error_size);
+
+/* Builds a partitioned hash table over the right rows and probes it with the left rows in
+ * parallel. Pairs come out in left-row order, and in right-row order within one left row.
+ * NULL keys never match. */
+bool join_hash(const JoinClause* join, DataRecord* const* left, size_t left_count,
+               DataRecord* const* right, size_t right_count, JoinPair** out_pairs, size_t* out_count);
+
+#endif
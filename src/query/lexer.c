@@ -0,0 +1,167 @@
+#include "lexer.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* ASCII only and locale independent, unlike <ctype.h>, so scripts lex the same everywhere. */
+static inline bool is_space(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline bool is_alpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static inline bool is_alnum(char c) {
+    return is_alpha(c) || is_digit(c);
+}
+
+static inline char to_upper(char c) {
+    return c >= 'a' && c <= 'z' ? (char)(c - 'a' + 'A') : c;
+}
+
+void lexer_init(Lexer* lexer, const char* input) {
+    lexer->input = input;
+    lexer->position = input;
+    lexer->current.type = TOKEN_END;
+    lexer->current.start = input;
+    lexer->current.length = 0;
+}
+
+static Token make_token(TokenType type, const char* start, size_t length) {
+    Token token = { type, start, length };
+    return token;
+}
+
+static Token scan_token(const char* p) {
+    while (is_space(*p)) p++;
+
+    if (*p == '\0') return make_token(TOKEN_END, p, 0);
+
+    const char* start = p;
+    char c = *p;
+
+    if (is_alpha(c)) {
+        while (is_alnum(*p)) p++;
+        if (*p == '.' && is_alpha(p[1])) {
+            p++;
+            while (is_alnum(*p)) p++;
+        }
+        return make_token(TOKEN_IDENTIFIER, start, (size_t)(p - start));
+    }
+
+    if (is_digit(c) || (c == '.' && is_digit(p[1]))) {
+        bool is_float = false;
+        while (is_digit(*p)) p++;
+        if (*p == '.') {
+            is_float = true;
+            p++;
+            while (is_digit(*p)) p++;
+        }
+        if ((*p == 'e' || *p == 'E') &&
+            (is_digit(p[1]) || ((p[1] == '+' || p[1] == '-') && is_digit(p[2])))) {
+            is_float = true;
+            p += 2;
+            while (is_digit(*p)) p++;
+        }
+        return make_token(is_float ? TOKEN_FLOAT : TOKEN_INTEGER, start, (size_t)(p - start));
+    }
+
+    if (c == '\'' || c == '"') {
+        p++;
+        while (*p) {
+            if (*p == c) {
+                if (p[1] != c) break;
+                p++;
+            }
+            p++;
+        }
+        if (*p != c) return make_token(TOKEN_ERROR, start, (size_t)(p - start));
+        return make_token(TOKEN_STRING, start, (size_t)(p + 1 - start));
+    }
+
+    switch (c) {
+        case '*': return make_token(TOKEN_STAR, start, 1);
+        case ',': return make_token(TOKEN_COMMA, start, 1);
+        case '(': return make_token(TOKEN_LPAREN, start, 1);
+        case ')': return make_token(TOKEN_RPAREN, start, 1);
+        case ';': return make_token(TOKEN_SEMICOLON, start, 1);
+        case '-': return make_token(TOKEN_MINUS, start, 1);
+        case '?': return make_token(TOKEN_PARAMETER, start, 1);
+        case '=':
+            return make_token(TOKEN_EQ, start, p[1] == '=' ? 2 : 1);
+        case '!':
+            if (p[1] == '=') return make_token(TOKEN_NE, start, 2);
+            break;
+        case '<':
+            if (p[1] == '=') return make_token(TOKEN_LE, start, 2);
+            if (p[1] == '>') return make_token(TOKEN_NE, start, 2);
+            return make_token(TOKEN_LT, start, 1);
+        case '>':
+            if (p[1] == '=') return make_token(TOKEN_GE, start, 2);
+            return make_token(TOKEN_GT, start, 1);
+        default:
+            break;
+    }
+
+    return make_token(TOKEN_ERROR, start, 1);
+}
+
+Token lexer_next(Lexer* lexer) {
+    Token token = scan_token(lexer->position);
+    lexer->position = token.start + token.length;
+    lexer->current = token;
+    return token;
+}
+
+Token lexer_peek(const Lexer* lexer) {
+    return scan_token(lexer->position);
+}
+
+Token lexer_word(Lexer* lexer, const char* start) {
+    const char* p = start;
+    while (*p && !is_space(*p) && *p != ';') p++;
+
+    Token token = make_token(p > start ? TOKEN_IDENTIFIER : TOKEN_END, start, (size_t)(p - start));
+    lexer->position = p;
+    lexer->current = token;
+    return token;
+}
+
+bool token_is_keyword(const Token* token, const char* keyword) {
+    if (token->type != TOKEN_IDENTIFIER) return false;
+
+    size_t i = 0;
+    for (; i < token->length; i++) {
+        if (keyword[i] == '\0' || to_upper(token->start[i]) != to_upper(keyword[i])) return false;
+    }
+    return keyword[i] == '\0';
+}
+
+char* token_to_string(const Token* token) {
+    if (token->type != TOKEN_STRING) {
+        char* copy = malloc(token->length + 1);
+        if (!copy) return NULL;
+        memcpy(copy, token->start, token->length);
+        copy[token->length] = '\0';
+        return copy;
+    }
+
+    char quote = token->start[0];
+    const char* p = token->start + 1;
+    const char* end = token->start + token->length - 1;
+
+    char* copy = malloc((size_t)(end - p) + 1);
+    if (!copy) return NULL;
+
+    size_t length = 0;
+    while (p < end) {
+        if (*p == quote && p + 1 < end && p[1] == quote) p++;
+        copy[length++] = *p++;
+    }
+    copy[length] = '\0';
+    return copy;
+}
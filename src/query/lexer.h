@@ -0,0 +1,51 @@
+#ifndef SHADE_QUERY_LEXER_H
+#define SHADE_QUERY_LEXER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    TOKEN_END,
+    TOKEN_ERROR,
+    TOKEN_IDENTIFIER,
+    TOKEN_INTEGER,
+    TOKEN_FLOAT,
+    TOKEN_STRING,
+    TOKEN_STAR,
+    TOKEN_COMMA,
+    TOKEN_LPAREN,
+    TOKEN_RPAREN,
+    TOKEN_SEMICOLON,
+    TOKEN_MINUS,
+    TOKEN_PARAMETER,
+    TOKEN_EQ,
+    TOKEN_NE,
+    TOKEN_LT,
+    TOKEN_LE,
+    TOKEN_GT,
+    TOKEN_GE
+} TokenType;
+
+/* Tokens point into the lexer input; string tokens still include their quotes. */
+typedef struct {
+    TokenType type;
+    const char* start;
+    size_t length;
+} Token;
+
+typedef struct {
+    const char* input;
+    const char* position;
+    Token current;
+} Lexer;
+
+void lexer_init(Lexer* lexer, const char* input);
+Token lexer_next(Lexer* lexer);
+Token lexer_peek(const Lexer* lexer);
+/* Rescans from `start` as one run of non-space characters up to a `;`, for unquoted paths. */
+Token lexer_word(Lexer* lexer, const char* start);
+
+bool token_is_keyword(const Token* token, const char* keyword);
+char* token_to_string(const Token* token);
+
+#endif
@@ -0,0 +1,984 @@
+#include "parser.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    Lexer lexer;
+    Token token;
+    char* error;
+    size_t error_size;
+    bool failed;
+    size_t parameter_count;
+} Parser;
+
+static void parser_init(Parser* parser, const char* text, char* error, size_t error_size) {
+    lexer_init(&parser->lexer, text);
+    parser->token = lexer_next(&parser->lexer);
+    parser->error = error;
+    parser->error_size = error_size;
+    parser->failed = false;
+    parser->parameter_count = 0;
+}
+
+static void parser_advance(Parser* parser) {
+    parser->token = lexer_next(&parser->lexer);
+}
+
+static void parser_fail(Parser* parser, const char* message) {
+    if (parser->failed) return;
+    parser->failed = true;
+
+    if (!parser->error || parser->error_size == 0) return;
+
+    if (parser->token.type == TOKEN_END) {
+        snprintf(parser->error, parser->error_size, "%s at end of input", message);
+    } else {
+        int length = parser->token.length > 32 ? 32 : (int)parser->token.length;
+        snprintf(parser->error, parser->error_size, "%s near '%.*s'", message, length, parser->token.start);
+    }
+}
+
+static bool accept_keyword(Parser* parser, const char* keyword) {
+    if (!token_is_keyword(&parser->token, keyword)) return false;
+    parser_advance(parser);
+    return true;
+}
+
+static bool expect_keyword(Parser* parser, const char* keyword) {
+    if (accept_keyword(parser, keyword)) return true;
+
+    char message[64];
+    snprintf(message, sizeof(message), "Expected %s", keyword);
+    parser_fail(parser, message);
+    return false;
+}
+
+static bool accept_token(Parser* parser, TokenType type) {
+    if (parser->token.type != type) return false;
+    parser_advance(parser);
+    return true;
+}
+
+static const char* reserved_words[] = {
+    "SELECT", "FROM", "WHERE", "WITH", "AND", "OR", "NOT", "BETWEEN", "IS", "NULL", "TRUE", "FALSE",
+    "GROUP", "BY", "ORDER", "ASC", "DESC", "LIMIT", "OFFSET",
+    "JOIN", "INNER", "ON"
+};
+
+static bool is_reserved(const Token* token) {
+    char first = token->start[0] & ~0x20;
+    for (size_t i = 0; i < sizeof(reserved_words) / sizeof(reserved_words[0]); i++) {
+        if (reserved_words[i][0] == first && token_is_keyword(token, reserved_words[i])) return true;
+    }
+    return false;
+}
+
+static char* parse_identifier(Parser* parser) {
+    if (parser->token.type != TOKEN_IDENTIFIER || is_reserved(&parser->token)) {
+        parser_fail(parser, "Expected identifier");
+        return NULL;
+    }
+
+    char* name = token_to_string(&parser->token);
+    if (!name) {
+        parser_fail(parser, "Out of memory");
+        return NULL;
+    }
+
+    parser_advance(parser);
+    return name;
+}
+
+/* Integer tokens are plain digit runs and convert in place; floats go through strtod from a
+ * stack copy. Returns why the token was rejected, or NULL. */
+static const char* parse_number(const Token* token, bool negative, Value* out) {
+    if (token->type == TOKEN_INTEGER) {
+        uint64_t limit = negative ? (uint64_t)INT64_MAX + 1 : (uint64_t)INT64_MAX;
+        uint64_t value = 0;
+        for (size_t i = 0; i < token->length; i++) {
+            uint64_t digit = (uint64_t)(token->start[i] - '0');
+            if (value > (limit - digit) / 10) return "Number out of range";
+            value = value * 10 + digit;
+        }
+        *out = value_integer(negative && value > 0 ? -(int64_t)(value - 1) - 1 : (int64_t)value);
+        return NULL;
+    }
+
+    char buffer[64];
+    char* text = token->length < sizeof(buffer) ? buffer : token_to_string(token);
+    if (!text) return "Out of memory";
+    if (text == buffer) {
+        memcpy(buffer, token->start, token->length);
+        buffer[token->length] = '\0';
+    }
+
+    errno = 0;
+    double parsed = strtod(text, NULL);
+    if (text != buffer) free(text);
+    if (errno == ERANGE) return "Number out of range";
+
+    *out = value_float(negative ? -parsed : parsed);
+    return NULL;
+}
+
+/* The value takes the unquoted copy of the current string token without duplicating it again. */
+static bool parse_string(Parser* parser, Value* out) {
+    char* text = token_to_string(&parser->token);
+    if (!text) {
+        parser_fail(parser, "Out of memory");
+        return false;
+    }
+
+    out->type = VALUE_STRING;
+    out->data.string = text;
+    return true;
+}
+
+/* A `?` placeholder leaves out NULL and numbers itself in `parameter`, in order of appearance. */
+static bool parse_literal(Parser* parser, Value* out, int* parameter) {
+    *parameter = PREDICATE_NO_PARAMETER;
+    if (accept_token(parser, TOKEN_PARAMETER)) {
+        *out = value_null();
+        *parameter = (int)parser->parameter_count++;
+        return true;
+    }
+
+    bool negative = accept_token(parser, TOKEN_MINUS);
+    Token token = parser->token;
+
+    if (token.type == TOKEN_INTEGER || token.type == TOKEN_FLOAT) {
+        const char* failure = parse_number(&token, negative, out);
+        if (failure) {
+            parser_fail(parser, failure);
+            return false;
+        }
+        parser_advance(parser);
+        return true;
+    }
+
+    if (negative) {
+        parser_fail(parser, "Expected number");
+        return false;
+    }
+
+    if (token.type == TOKEN_STRING) {
+        if (!parse_string(parser, out)) return false;
+        parser_advance(parser);
+        return true;
+    }
+
+    if (token_is_keyword(&token, "TRUE") || token_is_keyword(&token, "FALSE")) {
+        *out = value_boolean(token_is_keyword(&token, "TRUE"));
+        parser_advance(parser);
+        return true;
+    }
+
+    parser_fail(parser, "Expected literal");
+    return false;
+}
+
+static bool comparison_op(TokenType type, PredicateOp* op) {
+    switch (type) {
+        case TOKEN_EQ: *op = PRED_EQ; return true;
+        case TOKEN_NE: *op = PRED_NE; return true;
+        case TOKEN_LT: *op = PRED_LT; return true;
+        case TOKEN_LE: *op = PRED_LE; return true;
+        case TOKEN_GT: *op = PRED_GT; return true;
+        case TOKEN_GE: *op = PRED_GE; return true;
+        default: return false;
+    }
+}
+
+static Predicate* parse_or(Parser* parser);
+
+static Predicate* parse_comparison(Parser* parser) {
+    if (accept_token(parser, TOKEN_LPAREN)) {
+        Predicate* inner = parse_or(parser);
+        if (inner && !accept_token(parser, TOKEN_RPAREN)) {
+            parser_fail(parser, "Expected )");
+            predicate_destroy(inner);
+            return NULL;
+        }
+        return inner;
+    }
+
+    char* column = parse_identifier(parser);
+    if (!column) return NULL;
+
+    Predicate* predicate = NULL;
+    PredicateOp op;
+
+    if (accept_keyword(parser, "IS")) {
+        bool negated = accept_keyword(parser, "NOT");
+        if (expect_keyword(parser, "NULL")) {
+            predicate = predicate_null_check(column, negated);
+        }
+    } else if (token_is_keyword(&parser->token, "BETWEEN") || token_is_keyword(&parser->token, "NOT")) {
+        bool negated = accept_keyword(parser, "NOT");
+        Value low = value_null();
+        Value high = value_null();
+        int low_parameter;
+        int high_parameter;
+
+        if (expect_keyword(parser, "BETWEEN") && parse_literal(parser, &low, &low_parameter) &&
+            expect_keyword(parser, "AND") && parse_literal(parser, &high, &high_parameter)) {
+            predicate = predicate_between(column, low, high);
+            if (predicate) {
+                predicate->low_parameter = low_parameter;
+                predicate->high_parameter = high_parameter;
+            }
+            if (negated) predicate = predicate_not(predicate);
+        } else {
+            value_destroy(&low);
+        }
+    } else if (comparison_op(parser->token.type, &op)) {
+        parser_advance(parser);
+        Value literal;
+        int parameter;
+        if (parse_literal(parser, &literal, &parameter)) {
+            predicate = predicate_compare(op, column, literal);
+            if (predicate) predicate->low_parameter = parameter;
+        }
+    } else {
+        parser_fail(parser, "Expected comparison");
+    }
+
+    free(column);
+    if (!predicate) parser_fail(parser, "Out of memory");
+    return predicate;
+}
+
+static Predicate* parse_not(Parser* parser) {
+    if (accept_keyword(parser, "NOT")) {
+        Predicate* child = parse_not(parser);
+        return child ? predicate_not(child) : NULL;
+    }
+    return parse_comparison(parser);
+}
+
+static Predicate* parse_and(Parser* parser) {
+    Predicate* left = parse_not(parser);
+
+    while (left && accept_keyword(parser, "AND")) {
+        left = predicate_and(left, parse_not(parser));
+    }
+    return left;
+}
+
+static Predicate* parse_or(Parser* parser) {
+    Predicate* left = parse_and(parser);
+
+    while (left && accept_keyword(parser, "OR")) {
+        left = predicate_or(left, parse_and(parser));
+    }
+    return left;
+}
+
+static bool parse_end(Parser* parser) {
+    accept_token(parser, TOKEN_SEMICOLON);
+    if (parser->token.type != TOKEN_END) {
+        parser_fail(parser, "Unexpected input");
+        return false;
+    }
+    return true;
+}
+
+static bool parse_with_ghosts(Parser* parser, Query* query) {
+    if (!accept_keyword(parser, "WITH")) return true;
+    if (!expect_keyword(parser, "GHOSTS")) return false;
+    query->include_ghosts = true;
+    return true;
+}
+
+static bool parse_join(Parser* parser, Query* query) {
+    bool inner = accept_keyword(parser, "INNER");
+    if (!inner && !token_is_keyword(&parser->token, "JOIN")) return true;
+    if (!expect_keyword(parser, "JOIN")) return false;
+
+    char* table_name = parse_identifier(parser);
+    if (!table_name) return false;
+
+    query->join = join_clause_create(table_name);
+    free(table_name);
+    if (!query->join) {
+        parser_fail(parser, "Out of memory");
+        return false;
+    }
+
+    if (accept_keyword(parser, "WITH")) {
+        if (!expect_keyword(parser, "GHOSTS")) return false;
+        query->join->include_ghosts = true;
+    }
+
+    if (!expect_keyword(parser, "ON")) return false;
+    query->join->left_column = parse_identifier(parser);
+    if (!query->join->left_column) return false;
+
+    if (!accept_token(parser, TOKEN_EQ)) {
+        parser_fail(parser, "JOIN supports only '=' conditions");
+        return false;
+    }
+    query->join->right_column = parse_identifier(parser);
+    return query->join->right_column != NULL;
+}
+
+static bool append_column(Parser* parser, Query* query, char* column) {
+    char** columns = realloc(query->select_columns, sizeof(char*) * (query->select_count + 1));
+    if (!columns) {
+        free(column);
+        parser_fail(parser, "Out of memory");
+        return false;
+    }
+
+    query->select_columns = columns;
+    query->select_columns[query->select_count++] = column;
+    return true;
+}
+
+static bool is_function_call(Parser* parser) {
+    return parser->token.type == TOKEN_IDENTIFIER && lexer_peek(&parser->lexer).type == TOKEN_LPAREN;
+}
+
+static bool parse_aggregate_call(Parser* parser, Aggregate* aggregate) {
+    AggregateFunction function;
+    bool weighted;
+
+    char* name = token_to_string(&parser->token);
+    bool known = aggregate_lookup(name, &function, &weighted);
+    free(name);
+
+    if (!known) {
+        parser_fail(parser, "Unknown function");
+        return false;
+    }
+
+    parser_advance(parser);
+    parser_advance(parser);
+
+    char* column = NULL;
+    if (!(function == AGG_COUNT && accept_token(parser, TOKEN_STAR))) {
+        column = parse_identifier(parser);
+        if (!column) return false;
+    }
+
+    if (!accept_token(parser, TOKEN_RPAREN)) {
+        free(column);
+        parser_fail(parser, "Expected )");
+        return false;
+    }
+
+    bool success = aggregate_init(aggregate, function, weighted, column);
+    free(column);
+    if (!success) parser_fail(parser, "Out of memory");
+    return success;
+}
+
+static bool parse_aggregate(Parser* parser, Query* query) {
+    Aggregate* aggregates = realloc(query->aggregates, sizeof(Aggregate) * (query->aggregate_count + 1));
+    if (!aggregates) {
+        parser_fail(parser, "Out of memory");
+        return false;
+    }
+    query->aggregates = aggregates;
+
+    if (!parse_aggregate_call(parser, &aggregates[query->aggregate_count])) return false;
+
+    aggregates[query->aggregate_count].position = query->select_count + query->aggregate_count;
+    query->aggregate_count++;
+    return true;
+}
+
+static bool parse_select_list(Parser* parser, Query* query, bool* star) {
+    *star = accept_token(parser, TOKEN_STAR);
+    if (*star) return true;
+
+    do {
+        bool success;
+
+        if (is_function_call(parser)) {
+            success = parse_aggregate(parser, query);
+        } else {
+            char* column = parse_identifier(parser);
+            success = column && append_column(parser, query, column);
+        }
+
+        if (!success) return false;
+    } while (accept_token(parser, TOKEN_COMMA));
+
+    return true;
+}
+
+static bool parse_group_by(Parser* parser, Query* query) {
+    if (!accept_keyword(parser, "GROUP")) return true;
+    if (!expect_keyword(parser, "BY")) return false;
+
+    do {
+        char* column = parse_identifier(parser);
+        if (!column) return false;
+
+        GroupColumn* group_by = realloc(query->group_by, sizeof(GroupColumn) * (query->group_count + 1));
+        if (!group_by) {
+            free(column);
+            parser_fail(parser, "Out of memory");
+            return false;
+        }
+
+        query->group_by = group_by;
+        query->group_by[query->group_count].column = column;
+        query->group_by[query->group_count].column_index = PREDICATE_UNBOUND;
+        query->group_by[query->group_count].column_type = VALUE_NULL;
+        query->group_count++;
+    } while (accept_token(parser, TOKEN_COMMA));
+
+    return true;
+}
+
+static char* parse_sort_column(Parser* parser) {
+    if (!is_function_call(parser)) return parse_identifier(parser);
+
+    Aggregate aggregate;
+    if (!parse_aggregate_call(parser, &aggregate)) return NULL;
+
+    char* name = aggregate_name(&aggregate);
+    aggregate_free(&aggregate);
+    if (!name) parser_fail(parser, "Out of memory");
+    return name;
+}
+
+static bool parse_order_by(Parser* parser, Query* query) {
+    if (!accept_keyword(parser, "ORDER")) return true;
+    if (!expect_keyword(parser, "BY")) return false;
+
+    do {
+        char* column = parse_sort_column(parser);
+        if (!column) return false;
+
+        SortKey* order_by = realloc(query->order_by, sizeof(SortKey) * (query->order_count + 1));
+        if (!order_by) {
+            free(column);
+            parser_fail(parser, "Out of memory");
+            return false;
+        }
+
+        query->order_by = order_by;
+        query->order_by[query->order_count].column = column;
+        query->order_by[query->order_count].column_index = PREDICATE_UNBOUND;
+        query->order_by[query->order_count].column_type = VALUE_NULL;
+        query->order_by[query->order_count].descending = accept_keyword(parser, "DESC");
+        if (!query->order_by[query->order_count].descending) accept_keyword(parser, "ASC");
+        query->order_count++;
+    } while (accept_token(parser, TOKEN_COMMA));
+
+    return true;
+}
+
+static bool parse_unsigned(Parser* parser, const char* expected, unsigned long long max,
+                           unsigned long long* out) {
+    if (parser->token.type != TOKEN_INTEGER) {
+        parser_fail(parser, expected);
+        return false;
+    }
+
+    char* text = token_to_string(&parser->token);
+    if (!text) {
+        parser_fail(parser, "Out of memory");
+        return false;
+    }
+
+    errno = 0;
+    unsigned long long value = strtoull(text, NULL, 10);
+    free(text);
+    if (errno == ERANGE || value > max) {
+        parser_fail(parser, "Number out of range");
+        return false;
+    }
+
+    parser_advance(parser);
+    *out = value;
+    return true;
+}
+
+static bool parse_row_count(Parser* parser, size_t* out) {
+    unsigned long long count;
+    if (!parse_unsigned(parser, "Expected row count", SIZE_MAX, &count)) return false;
+
+    *out = (size_t)count;
+    return true;
+}
+
+static bool parse_limit(Parser* parser, Query* query) {
+    if (accept_keyword(parser, "LIMIT")) {
+        if (!parse_row_count(parser, &query->limit)) return false;
+        query->has_limit = true;
+    }
+
+    return !accept_keyword(parser, "OFFSET") || parse_row_count(parser, &query->offset);
+}
+
+static Query* parse_select(Parser* parser) {
+    Query* query = query_create(QUERY_SELECT, NULL);
+    if (!query) {
+        parser_fail(parser, "Out of memory");
+        return NULL;
+    }
+
+    bool star;
+    bool success = parse_select_list(parser, query, &star) && expect_keyword(parser, "FROM");
+    if (success) {
+        query->table_name = parse_identifier(parser);
+        success = query->table_name != NULL;
+    }
+
+    success = success && parse_with_ghosts(parser, query) && parse_join(parser, query);
+    if (success && accept_keyword(parser, "WHERE")) {
+        query->where = parse_or(parser);
+        success = query->where != NULL && parse_with_ghosts(parser, query);
+    }
+    success = success && parse_group_by(parser, query);
+    success = success && parse_order_by(parser, query) && parse_limit(parser, query);
+
+    if (success && star && query->group_count > 0) {
+        parser_fail(parser, "SELECT * cannot be used with GROUP BY");
+        success = false;
+    } else if (success && query->group_count == 0 && query->aggregate_count > 0 && query->select_count > 0) {
+        parser_fail(parser, "Cannot mix columns and aggregates without GROUP BY");
+        success = false;
+    }
+
+    if (!success || !parse_end(parser)) {
+        query_destroy(query);
+        return NULL;
+    }
+    return query;
+}
+
+static Query* parse_delete(Parser* parser) {
+    if (!expect_keyword(parser, "FROM")) return NULL;
+
+    char* table_name = parse_identifier(parser);
+    if (!table_name) return NULL;
+
+    Query* query = query_create(QUERY_DELETE, table_name);
+    free(table_name);
+    if (!query) {
+        parser_fail(parser, "Out of memory");
+        return NULL;
+    }
+
+    bool success = expect_keyword(parser, "WHERE");
+    if (success) {
+        query->where = parse_or(parser);
+        success = query->where != NULL && parse_end(parser);
+    }
+
+    if (!success) {
+        query_destroy(query);
+        return NULL;
+    }
+    return query;
+}
+
+Query* parse_query(const char* text, char* error, size_t error_size) {
+    if (!text) return NULL;
+
+    Parser parser;
+    parser_init(&parser, text, error, error_size);
+
+    ExplainMode explain = EXPLAIN_NONE;
+    if (accept_keyword(&parser, "EXPLAIN")) {
+        explain = accept_keyword(&parser, "ANALYZE") ? EXPLAIN_ANALYZE : EXPLAIN_PLAN;
+    }
+
+    Query* query = NULL;
+    if (accept_keyword(&parser, "SELECT")) {
+        query = parse_select(&parser);
+    } else if (accept_keyword(&parser, "DELETE")) {
+        query = parse_delete(&parser);
+    } else {
+        parser_fail(&parser, "Unsupported statement");
+    }
+
+    if (query) {
+        query->explain = explain;
+        query->parameter_count = parser.parameter_count;
+    }
+    return query;
+}
+
+Predicate* parse_predicate(const char* text, char* error, size_t error_size) {
+    if (!text) return NULL;
+
+    Parser parser;
+    parser_init(&parser, text, error, error_size);
+
+    Predicate* predicate = parse_or(&parser);
+    if (predicate && !parse_end(&parser)) {
+        predicate_destroy(predicate);
+        return NULL;
+    }
+    return predicate;
+}
+
+static char* parse_path(Parser* parser) {
+    if (parser->token.type == TOKEN_END || parser->token.type == TOKEN_SEMICOLON) {
+        parser_fail(parser, "Expected path");
+        return NULL;
+    }
+
+    Token token = parser->token.type == TOKEN_STRING ? parser->token
+                                                     : lexer_word(&parser->lexer, parser->token.start);
+    char* path = token_to_string(&token);
+    if (!path) {
+        parser_fail(parser, "Out of memory");
+        return NULL;
+    }
+
+    parser_advance(parser);
+    return path;
+}
+
+static bool parse_column_type(Parser* parser, ValueType* out) {
+    static const struct { const char* name; ValueType type; } types[] = {
+        { "INT", VALUE_INTEGER }, { "FLOAT", VALUE_FLOAT }, { "BOOL", VALUE_BOOLEAN }, { "STRING", VALUE_STRING }
+    };
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (accept_keyword(parser, types[i].name)) {
+            *out = types[i].type;
+            return true;
+        }
+    }
+    parser_fail(parser, "Expected INT, FLOAT, BOOL or STRING");
+    return false;
+}
+
+static bool parse_create_table(Parser* parser, Command* command) {
+    if (!expect_keyword(parser, "TABLE")) return false;
+
+    command->table_name = parse_identifier(parser);
+    if (!command->table_name) return false;
+
+    if (!accept_token(parser, TOKEN_LPAREN)) {
+        parser_fail(parser, "Expected '('");
+        return false;
+    }
+
+    do {
+        ColumnSchema* columns = realloc(command->columns, sizeof(ColumnSchema) * (command->column_count + 1));
+        if (!columns) {
+            parser_fail(parser, "Out of memory");
+            return false;
+        }
+        command->columns = columns;
+
+        char* name = parse_identifier(parser);
+        if (!name) return false;
+
+        ColumnSchema* column = &command->columns[command->column_count++];
+        column->name = name;
+        column->type = VALUE_NULL;
+        if (!parse_column_type(parser, &column->type)) return false;
+    } while (accept_token(parser, TOKEN_COMMA));
+
+    if (!accept_token(parser, TOKEN_RPAREN)) {
+        parser_fail(parser, "Expected ')'");
+        return false;
+    }
+    return true;
+}
+
+static bool parse_drop_table(Parser* parser, Command* command) {
+    if (!expect_keyword(parser, "TABLE")) return false;
+
+    command->table_name = parse_identifier(parser);
+    return command->table_name != NULL;
+}
+
+static bool parse_insert_value(Parser* parser, Value* out) {
+    if (accept_keyword(parser, "NULL")) {
+        *out = value_null();
+        return true;
+    }
+
+    /* Bare words are strings, as the shell has always accepted. */
+    if (parser->token.type == TOKEN_IDENTIFIER && !is_reserved(&parser->token)) {
+        if (!parse_string(parser, out)) return false;
+        parser_advance(parser);
+        return true;
+    }
+
+    if (parser->token.type == TOKEN_PARAMETER) {
+        parser_fail(parser, "Expected literal");
+        return false;
+    }
+
+    int parameter;
+    return parse_literal(parser, out, &parameter);
+}
+
+static bool append_row(Command* command, Value* row) {
+    size_t count = command->row_count;
+    if (count == 0 || (count >= 4 && (count & (count - 1)) == 0)) {
+        Value** rows = realloc(command->rows, sizeof(Value*) * (count == 0 ? 4 : count * 2));
+        if (!rows) return false;
+        command->rows = rows;
+    }
+
+    command->rows[command->row_count++] = row;
+    return true;
+}
+
+/* Every row after the first must have as many values as the first. */
+static bool parse_insert_row(Parser* parser, Command* command) {
+    if (!accept_token(parser, TOKEN_LPAREN)) {
+        parser_fail(parser, "Expected '('");
+        return false;
+    }
+
+    bool first = command->row_count == 0;
+    size_t capacity = first ? 4 : command->row_width;
+    size_t count = 0;
+    Value* row = malloc(sizeof(Value) * (capacity > 0 ? capacity : 1));
+    bool success = row != NULL;
+    if (!success) parser_fail(parser, "Out of memory");
+
+    if (success && parser->token.type != TOKEN_RPAREN) {
+        do {
+            if (count == capacity) {
+                Value* grown = first ? realloc(row, sizeof(Value) * capacity * 2) : NULL;
+                if (!grown) {
+                    parser_fail(parser, first ? "Out of memory" : "Rows must have the same number of values");
+                    success = false;
+                    break;
+                }
+                row = grown;
+                capacity *= 2;
+            }
+
+            success = parse_insert_value(parser, &row[count]);
+            if (success) count++;
+        } while (success && accept_token(parser, TOKEN_COMMA));
+    }
+
+    if (success && !first && count != command->row_width) {
+        parser_fail(parser, "Rows must have the same number of values");
+        success = false;
+    }
+    if (success && !accept_token(parser, TOKEN_RPAREN)) {
+        parser_fail(parser, "Expected ')'");
+        success = false;
+    }
+    if (success && first) command->row_width = count;
+    if (success && !append_row(command, row)) {
+        parser_fail(parser, "Out of memory");
+        success = false;
+    }
+
+    if (!success && row) {
+        for (size_t i = 0; i < count; i++) {
+            value_destroy(&row[i]);
+        }
+        free(row);
+    }
+    return success;
+}
+
+static bool parse_insert(Parser* parser, Command* command) {
+    if (!expect_keyword(parser, "INTO")) return false;
+
+    command->table_name = parse_identifier(parser);
+    if (!command->table_name || !expect_keyword(parser, "VALUES")) return false;
+
+    do {
+        if (!parse_insert_row(parser, command)) return false;
+    } while (accept_token(parser, TOKEN_COMMA));
+    return true;
+}
+
+static bool parse_copy_format(Parser* parser, Command* command) {
+    if (!accept_keyword(parser, "FORMAT")) return true;
+
+    char* name = parser->token.type == TOKEN_IDENTIFIER ? token_to_string(&parser->token) : NULL;
+    bool known = name && copy_format_parse(name, &command->format);
+    free(name);
+    if (!known) {
+        parser_fail(parser, "Unknown format");
+        return false;
+    }
+
+    parser_advance(parser);
+    return true;
+}
+
+static bool parse_copy(Parser* parser, Command* command) {
+    command->table_name = parse_identifier(parser);
+    if (!command->table_name) return false;
+
+    if (accept_keyword(parser, "TO")) {
+        command->type = COMMAND_COPY_TO;
+    } else if (!expect_keyword(parser, "FROM")) {
+        return false;
+    }
+
+    command->path = parse_path(parser);
+    if (!command->path) return false;
+
+    if (command->type == COMMAND_COPY_TO && accept_keyword(parser, "WITH")) {
+        if (!expect_keyword(parser, "GHOSTS")) return false;
+        command->include_ghosts = true;
+    }
+    return parse_copy_format(parser, command);
+}
+
+static bool parse_resurrect(Parser* parser, Command* command) {
+    command->table_name = parse_identifier(parser);
+    if (!command->table_name) return false;
+
+    unsigned long long id;
+    if (!parse_unsigned(parser, "Expected record id", UINT64_MAX, &id)) return false;
+    command->id = (uint64_t)id;
+    return true;
+}
+
+static bool parse_ghost_stats(Parser* parser, Command* command) {
+    (void)command;
+    return expect_keyword(parser, "STATS");
+}
+
+static bool parse_decay_ghosts(Parser* parser, Command* command) {
+    if (!expect_keyword(parser, "GHOSTS")) return false;
+
+    Value amount;
+    int parameter;
+    if (parser->token.type == TOKEN_PARAMETER || !parse_literal(parser, &amount, &parameter)) {
+        parser_fail(parser, "Expected number");
+        return false;
+    }
+
+    bool numeric = amount.type == VALUE_INTEGER || amount.type == VALUE_FLOAT;
+    if (numeric) {
+        command->amount = amount.type == VALUE_INTEGER ? (double)amount.data.integer : amount.data.float_val;
+    }
+    value_destroy(&amount);
+    if (!numeric) parser_fail(parser, "Expected number");
+    return numeric;
+}
+
+static bool parse_analyze(Parser* parser, Command* command) {
+    if (parser->token.type == TOKEN_END || parser->token.type == TOKEN_SEMICOLON) return true;
+
+    command->table_name = parse_identifier(parser);
+    return command->table_name != NULL;
+}
+
+static bool parse_stats(Parser* parser, Command* command) {
+    command->table_name = parse_identifier(parser);
+    return command->table_name != NULL;
+}
+
+static bool parse_use(Parser* parser, Command* command) {
+    command->path = parse_path(parser);
+    return command->path != NULL;
+}
+
+static bool parse_enable_persistence(Parser* parser, Command* command) {
+    return expect_keyword(parser, "PERSISTENCE") && parse_use(parser, command);
+}
+
+static bool parse_debug_info(Parser* parser, Command* command) {
+    (void)command;
+    return expect_keyword(parser, "INFO");
+}
+
+/* Queries are only scanned for their end here, from their first keyword on; the statement cache
+ * parses them on a miss. */
+static bool parse_query_text(Parser* parser, Command* command) {
+    const char* start = parser->token.start;
+    const char* end = start;
+
+    while (parser->token.type != TOKEN_END && parser->token.type != TOKEN_SEMICOLON) {
+        end = parser->token.start + parser->token.length;
+        parser_advance(parser);
+    }
+
+    command->text = malloc((size_t)(end - start) + 1);
+    if (!command->text) {
+        parser_fail(parser, "Out of memory");
+        return false;
+    }
+    memcpy(command->text, start, (size_t)(end - start));
+    command->text[end - start] = '\0';
+    return true;
+}
+
+typedef bool (*CommandParser)(Parser* parser, Command* command);
+
+static const struct {
+    const char* keyword;
+    CommandType type;
+    CommandParser parse;
+} command_parsers[] = {
+    { "SELECT", COMMAND_QUERY, parse_query_text },
+    { "INSERT", COMMAND_INSERT, parse_insert },
+    { "DELETE", COMMAND_QUERY, parse_query_text },
+    { "EXPLAIN", COMMAND_QUERY, parse_query_text },
+    { "CREATE", COMMAND_CREATE_TABLE, parse_create_table },
+    { "DROP", COMMAND_DROP_TABLE, parse_drop_table },
+    { "COPY", COMMAND_COPY_FROM, parse_copy },
+    { "RESURRECT", COMMAND_RESURRECT, parse_resurrect },
+    { "GHOST", COMMAND_GHOST_STATS, parse_ghost_stats },
+    { "DECAY", COMMAND_DECAY_GHOSTS, parse_decay_ghosts },
+    { "ANALYZE", COMMAND_ANALYZE, parse_analyze },
+    { "STATS", COMMAND_STATS, parse_stats },
+    { "USE", COMMAND_USE, parse_use },
+    { "SAVE", COMMAND_SAVE, NULL },
+    { "ENABLE", COMMAND_ENABLE_PERSISTENCE, parse_enable_persistence },
+    { "DEBUG", COMMAND_DEBUG_INFO, parse_debug_info },
+    { "HELP", COMMAND_HELP, NULL },
+    { "EXIT", COMMAND_EXIT, NULL },
+    { "QUIT", COMMAND_EXIT, NULL }
+};
+
+Command* parse_command(const char* text, const char** end, char* error, size_t error_size) {
+    if (!text) return NULL;
+
+    Parser parser;
+    parser_init(&parser, text, error, error_size);
+
+    Command* command = NULL;
+    if (parser.token.type == TOKEN_END || parser.token.type == TOKEN_SEMICOLON) {
+        command = command_create(COMMAND_EMPTY);
+    } else {
+        for (size_t i = 0; i < sizeof(command_parsers) / sizeof(command_parsers[0]) && !command; i++) {
+            if (!token_is_keyword(&parser.token, command_parsers[i].keyword)) continue;
+
+            command = command_create(command_parsers[i].type);
+            if (!command) break;
+
+            if (command_parsers[i].type != COMMAND_QUERY) parser_advance(&parser);
+            if (command_parsers[i].parse && !command_parsers[i].parse(&parser, command)) {
+                command_destroy(command);
+                return NULL;
+            }
+        }
+        if (!command && !parser.failed) {
+            parser_fail(&parser, "Unknown command");
+            return NULL;
+        }
+    }
+
+    if (!command) {
+        parser_fail(&parser, "Out of memory");
+        return NULL;
+    }
+
+    if (!accept_token(&parser, TOKEN_SEMICOLON) && parser.token.type != TOKEN_END) {
+        parser_fail(&parser, "Unexpected input");
+        command_destroy(command);
+        return NULL;
+    }
+
+    if (end) *end = parser.token.start;
+    return command;
+}
@@ -0,0 +1,18 @@
+#ifndef SHADE_QUERY_PARSER_H
+#define SHADE_QUERY_PARSER_H
+
+#include "command.h"
+#include "executor.h"
+#include "lexer.h"
+#include "predicate.h"
+
+#define PARSER_ERROR_SIZE 128
+
+Query* parse_query(const char* text, char* error, size_t error_size);
+Predicate* parse_predicate(const char* text, char* error, size_t error_size);
+
+/* Parses one shell statement ending at a `;` or the end of text; *end is set past it, to where
+ * the next statement starts. */
+Command* parse_command(const char* text, const char** end, char* error, size_t error_size);
+
+#endif
@@ -1,5 +1,502 @@
 #include "planner.h"
+#include <math.h>
+#include <string.h>
+
+/* Guesses for predicates nothing better is known about, the same ones PostgreSQL falls back on. */
+#define SELECTIVITY_EQ 0.005
+#define SELECTIVITY_RANGE (1.0 / 3.0)
+#define SELECTIVITY_BETWEEN 0.005
+#define SELECTIVITY_NULL 0.005
+
+/* Costs are in units of one record visited by a scan. */
+#define SCAN_ROW_COST 1.0
+#define INDEX_PAGE_COST 25.0
+#define INDEX_ROW_COST 4.0
+#define HASH_BUILD_ROW_COST 2.0
+#define HASH_PROBE_ROW_COST 1.0
 
 Query* plan_query(QueryType type, const char* table_name) {
     return query_create(type, table_name);
 }
+
+static double min_double(double a, double b) {
+    return a < b ? a : b;
+}
+
+static double clamp_selectivity(double selectivity) {
+    if (selectivity < 0.0) return 0.0;
+    return selectivity > 1.0 ? 1.0 : selectivity;
+}
+
+/* Record ids are dense and sorted, so _id comparisons are estimated exactly by position. */
+static double row_id_selectivity(const Predicate* predicate, const MemoryTable* table) {
+    if (table->record_count == 0 || predicate->low.type != VALUE_INTEGER) return SELECTIVITY_RANGE;
+
+    double rows = (double)table->record_count;
+    int64_t value = predicate->low.data.integer;
+    uint64_t id = value > 0 ? (uint64_t)value : 0;
+    size_t below = memory_table_position(table, id);
+    size_t through = id == UINT64_MAX ? table->record_count : memory_table_position(table, id + 1);
+
+    switch (predicate->op) {
+        case PRED_EQ: return (double)(through - below) / rows;
+        case PRED_NE: return 1.0 - (double)(through - below) / rows;
+        case PRED_LT: return (double)below / rows;
+        case PRED_LE: return (double)through / rows;
+        case PRED_GT: return 1.0 - (double)through / rows;
+        case PRED_GE: return 1.0 - (double)below / rows;
+        default: return SELECTIVITY_BETWEEN;
+    }
+}
+
+static const ColumnStats* column_stats(const MemoryTable* table, int column) {
+    if (!table->stats || column < 0 || (size_t)column >= table->stats->column_count) return NULL;
+
+    const ColumnStats* stats = &table->stats->columns[column];
+    return stats->value_count + stats->null_count > 0 ? stats : NULL;
+}
+
+/* Share of rows with a value between the bounds, from the column's statistics; negative when
+ * they cannot tell. A missing bound is open. */
+static double stats_range(const ColumnStats* column, const Value* low, bool low_inclusive,
+                          const Value* high, bool high_inclusive) {
+    double below_low = low ? column_stats_fraction_below(column, low, !low_inclusive) : 0.0;
+    double below_high = high ? column_stats_fraction_below(column, high, high_inclusive) : 1.0;
+    if (below_low < 0.0 || below_high < 0.0) return -1.0;
+
+    double share = below_high > below_low ? below_high - below_low : 0.0;
+    return share * (1.0 - column_stats_null_fraction(column));
+}
+
+static double stats_selectivity(const Predicate* predicate, const ColumnStats* column) {
+    double not_null = 1.0 - column_stats_null_fraction(column);
+    double equal;
+
+    switch (predicate->op) {
+        case PRED_IS_NULL:
+            return column_stats_null_fraction(column);
+        case PRED_IS_NOT_NULL:
+            return not_null;
+        case PRED_EQ:
+        case PRED_NE:
+            equal = column_stats_fraction_equal(column, &predicate->low);
+            if (equal < 0.0) return -1.0;
+            return not_null * (predicate->op == PRED_EQ ? equal : 1.0 - equal);
+        case PRED_LT:
+        case PRED_LE:
+            return stats_range(column, NULL, false, &predicate->low, predicate->op == PRED_LE);
+        case PRED_GT:
+        case PRED_GE:
+            return stats_range(column, &predicate->low, predicate->op == PRED_GE, NULL, false);
+        case PRED_BETWEEN:
+            return stats_range(column, &predicate->low, true, &predicate->high, true);
+        default:
+            return -1.0;
+    }
+}
+
+double planner_selectivity(const Predicate* predicate, const MemoryTable* table) {
+    if (!predicate) return 1.0;
+
+    double left;
+    double right;
+    switch (predicate->op) {
+        case PRED_AND:
+            return planner_selectivity(predicate->left, table) * planner_selectivity(predicate->right, table);
+        case PRED_OR:
+            left = planner_selectivity(predicate->left, table);
+            right = planner_selectivity(predicate->right, table);
+            return clamp_selectivity(left + right - left * right);
+        case PRED_NOT:
+            return 1.0 - planner_selectivity(predicate->left, table);
+        default:
+            break;
+    }
+
+    if (predicate->column_index == PREDICATE_ROW_ID && predicate->op != PRED_BETWEEN) {
+        return clamp_selectivity(row_id_selectivity(predicate, table));
+    }
+
+    const ColumnStats* column = column_stats(table, predicate->column_index);
+    double estimate = column ? stats_selectivity(predicate, column) : -1.0;
+    if (estimate >= 0.0) return clamp_selectivity(estimate);
+
+    if (predicate->op == PRED_IS_NULL) return SELECTIVITY_NULL;
+    if (predicate->op == PRED_IS_NOT_NULL) return 1.0 - SELECTIVITY_NULL;
+
+    double equal = predicate->column_type == VALUE_BOOLEAN ? 0.5 : SELECTIVITY_EQ;
+    switch (predicate->op) {
+        case PRED_EQ: return equal;
+        case PRED_NE: return 1.0 - equal;
+        case PRED_BETWEEN: return SELECTIVITY_BETWEEN;
+        default: return SELECTIVITY_RANGE;
+    }
+}
+
+static double predicate_cost(const Predicate* predicate) {
+    switch (predicate->op) {
+        case PRED_AND:
+        case PRED_OR:
+            return predicate_cost(predicate->left) + predicate_cost(predicate->right);
+        case PRED_NOT:
+            return predicate_cost(predicate->left);
+        case PRED_IS_NULL:
+        case PRED_IS_NOT_NULL:
+            return 0.5;
+        default:
+            return predicate->column_type == VALUE_STRING ? 3.0 : 1.0;
+    }
+}
+
+typedef struct {
+    Predicate* predicate;
+    double rank;
+} Conjunct;
+
+static size_t count_conjuncts(const Predicate* predicate) {
+    if (predicate->op != PRED_AND) return 1;
+    return count_conjuncts(predicate->left) + count_conjuncts(predicate->right);
+}
+
+static void collect_conjuncts(Predicate* predicate, Conjunct* conjuncts, size_t* count, Predicate** ands,
+                              size_t* and_count) {
+    if (predicate->op != PRED_AND) {
+        conjuncts[(*count)++].predicate = predicate;
+        return;
+    }
+
+    ands[(*and_count)++] = predicate;
+    collect_conjuncts(predicate->left, conjuncts, count, ands, and_count);
+    collect_conjuncts(predicate->right, conjuncts, count, ands, and_count);
+}
+
+static int compare_conjuncts(const void* a, const void* b) {
+    double left = ((const Conjunct*)a)->rank;
+    double right = ((const Conjunct*)b)->rank;
+    return (left > right) - (left < right);
+}
+
+/* Rebuilds each AND chain left-deep with the terms that reject the most rows per unit of cost
+ * first, so the compiled program skips the later terms for batches nothing survives. The chain's
+ * top node stays on top, so shallow copies of a query that share its clauses see the new order. */
+static Predicate* order_filters(Predicate* predicate, const MemoryTable* table) {
+    if (!predicate) return NULL;
+
+    if (predicate->op == PRED_OR) {
+        predicate->left = order_filters(predicate->left, table);
+        predicate->right = order_filters(predicate->right, table);
+        return predicate;
+    }
+    if (predicate->op == PRED_NOT) {
+        predicate->left = order_filters(predicate->left, table);
+        return predicate;
+    }
+    if (predicate->op != PRED_AND) return predicate;
+
+    size_t total = count_conjuncts(predicate);
+    Conjunct* conjuncts = malloc(sizeof(Conjunct) * total);
+    Predicate** ands = malloc(sizeof(Predicate*) * total);
+    if (!conjuncts || !ands) {
+        free(conjuncts);
+        free(ands);
+        return predicate;
+    }
+
+    size_t count = 0;
+    size_t and_count = 0;
+    collect_conjuncts(predicate, conjuncts, &count, ands, &and_count);
+
+    for (size_t i = 0; i < count; i++) {
+        conjuncts[i].predicate = order_filters(conjuncts[i].predicate, table);
+        double selectivity = planner_selectivity(conjuncts[i].predicate, table);
+        conjuncts[i].rank = (selectivity - 1.0) / predicate_cost(conjuncts[i].predicate);
+    }
+
+    /* Insertion sort keeps equally ranked terms in the order they were written. */
+    for (size_t i = 1; i < count; i++) {
+        Conjunct current = conjuncts[i];
+        size_t j = i;
+        while (j > 0 && compare_conjuncts(&conjuncts[j - 1], &current) > 0) {
+            conjuncts[j] = conjuncts[j - 1];
+            j--;
+        }
+        conjuncts[j] = current;
+    }
+
+    Predicate* root = conjuncts[0].predicate;
+    for (size_t i = 1; i < count; i++) {
+        Predicate* node = ands[count - 1 - i];
+        node->left = root;
+        node->right = conjuncts[i].predicate;
+        root = node;
+    }
+
+    free(conjuncts);
+    free(ands);
+    return root;
+}
+
+static void raise_low(uint64_t* low, int64_t bound) {
+    if (bound > 0 && (uint64_t)bound > *low) *low = (uint64_t)bound;
+}
+
+static void lower_high(uint64_t* high, int64_t bound) {
+    uint64_t limit = bound > 0 ? (uint64_t)bound : 0;
+    if (limit < *high) *high = limit;
+}
+
+/* Narrows [low, high] to the ids a bound WHERE clause can match through _id comparisons joined by
+ * AND. Rows outside the range are never visited; the filter still checks every row inside it. */
+static void row_id_range(const Predicate* predicate, uint64_t* low, uint64_t* high) {
+    if (!predicate) return;
+
+    if (predicate->op == PRED_AND) {
+        row_id_range(predicate->left, low, high);
+        row_id_range(predicate->right, low, high);
+        return;
+    }
+
+    if (predicate->column_index != PREDICATE_ROW_ID || predicate->low.type != VALUE_INTEGER) return;
+    int64_t value = predicate->low.data.integer;
+
+    switch (predicate->op) {
+        case PRED_EQ:
+            raise_low(low, value);
+            lower_high(high, value);
+            break;
+        case PRED_GT:
+            if (value == INT64_MAX) {
+                *high = 0;
+            } else {
+                raise_low(low, value + 1);
+            }
+            break;
+        case PRED_GE:
+            raise_low(low, value);
+            break;
+        case PRED_LT:
+            lower_high(high, value == INT64_MIN ? 0 : value - 1);
+            break;
+        case PRED_LE:
+            lower_high(high, value);
+            break;
+        case PRED_BETWEEN:
+            raise_low(low, value);
+            if (predicate->high.type == VALUE_INTEGER) lower_high(high, predicate->high.data.integer);
+            break;
+        default:
+            break;
+    }
+}
+
+void planner_scan_bounds(const Query* query, const MemoryTable* table, size_t* start, size_t* end) {
+    uint64_t low = 0;
+    uint64_t high = UINT64_MAX;
+    row_id_range(query->where, &low, &high);
+
+    *start = memory_table_position(table, low);
+    if (low > high) {
+        *end = *start;
+    } else {
+        *end = high == UINT64_MAX ? table->record_count : memory_table_position(table, high + 1);
+    }
+}
+
+/* Every key of a type sorts at or after this one, and NULL after all of them. */
+static Value lowest_key(ValueType type) {
+    Value key;
+    key.type = type;
+    switch (type) {
+        case VALUE_INTEGER: key.data.integer = INT64_MIN; break;
+        case VALUE_FLOAT: key.data.float_val = -INFINITY; break;
+        case VALUE_BOOLEAN: key.data.boolean = false; break;
+        case VALUE_STRING: key.data.string = (char*)""; break;
+        default: key = value_null(); break;
+    }
+    return key;
+}
+
+typedef struct {
+    bool has_low;
+    bool has_high;
+    Value low;
+    Value high;
+    bool low_inclusive;
+    bool high_inclusive;
+} KeyBounds;
+
+static void tighten_low(KeyBounds* bounds, const Value* key, bool inclusive) {
+    int cmp = bounds->has_low ? value_compare(key, &bounds->low) : 1;
+    if (cmp > 0 || (cmp == 0 && !inclusive)) {
+        bounds->low = *key;
+        bounds->low_inclusive = inclusive;
+        bounds->has_low = true;
+    }
+}
+
+static void tighten_high(KeyBounds* bounds, const Value* key, bool inclusive) {
+    int cmp = bounds->has_high ? value_compare(key, &bounds->high) : -1;
+    if (cmp < 0 || (cmp == 0 && !inclusive)) {
+        bounds->high = *key;
+        bounds->high_inclusive = inclusive;
+        bounds->has_high = true;
+    }
+}
+
+/* Collects bounds on the key column from AND-ed comparisons against literals of its own type. */
+static void key_bounds(const Predicate* predicate, KeyBounds* bounds) {
+    if (predicate->op == PRED_AND) {
+        key_bounds(predicate->left, bounds);
+        key_bounds(predicate->right, bounds);
+        return;
+    }
+
+    if (predicate->column_index != PRIMARY_KEY_COLUMN || predicate->compare_as_float) return;
+    if (predicate->low.type != predicate->column_type) return;
+    if (predicate->op == PRED_BETWEEN && predicate->high.type != predicate->column_type) return;
+
+    switch (predicate->op) {
+        case PRED_EQ:
+            tighten_low(bounds, &predicate->low, true);
+            tighten_high(bounds, &predicate->low, true);
+            break;
+        case PRED_LT:
+        case PRED_LE:
+            tighten_high(bounds, &predicate->low, predicate->op == PRED_LE);
+            break;
+        case PRED_GT:
+        case PRED_GE:
+            tighten_low(bounds, &predicate->low, predicate->op == PRED_GE);
+            break;
+        case PRED_BETWEEN:
+            tighten_low(bounds, &predicate->low, true);
+            tighten_high(bounds, &predicate->high, true);
+            break;
+        default:
+            return;
+    }
+}
+
+static bool key_is_point(const KeyBounds* bounds) {
+    return bounds->has_low && bounds->has_high && bounds->low_inclusive && bounds->high_inclusive &&
+           value_compare(&bounds->low, &bounds->high) == 0;
+}
+
+static double key_selectivity(const KeyBounds* bounds, const MemoryTable* table) {
+    const ColumnStats* column = column_stats(table, PRIMARY_KEY_COLUMN);
+    double estimate = -1.0;
+    if (column && key_is_point(bounds)) {
+        estimate = column_stats_fraction_equal(column, &bounds->low);
+        if (estimate >= 0.0) estimate *= 1.0 - column_stats_null_fraction(column);
+    } else if (column) {
+        estimate = stats_range(column, bounds->has_low ? &bounds->low : NULL, bounds->low_inclusive,
+                               bounds->has_high ? &bounds->high : NULL, bounds->high_inclusive);
+    }
+    if (estimate >= 0.0) return estimate;
+
+    if (key_is_point(bounds)) return SELECTIVITY_EQ;
+    return bounds->has_low && bounds->has_high ? SELECTIVITY_BETWEEN : SELECTIVITY_RANGE;
+}
+
+static double index_height(const BTree* index, double rows) {
+    double fanout = index->order > 1 ? (double)index->order : 2.0;
+    double height = 1.0;
+    for (double reach = fanout; reach < rows; reach *= fanout) {
+        height += 1.0;
+    }
+    return height;
+}
+
+static double index_lookup_cost(const BTree* index, double table_rows, double matches) {
+    double fanout = index->order > 1 ? (double)index->order : 2.0;
+    return (index_height(index, table_rows) + matches / fanout) * INDEX_PAGE_COST + matches * INDEX_ROW_COST;
+}
+
+/* The in-memory key index is a sorted array: one binary search, then a lookup by id per match. */
+static double key_order_cost(double table_rows, double matches) {
+    double probes = 1.0;
+    for (double reach = 2.0; reach < table_rows; reach *= 2.0) {
+        probes += 1.0;
+    }
+    return probes * SCAN_ROW_COST + matches * INDEX_ROW_COST;
+}
+
+/* A walk in key order reads entries until OFFSET plus LIMIT of them have matched, so it only pays
+ * off when that is a small share of the table; without a limit it reads every page. */
+static bool plan_index_order(Query* query, const MemoryTable* table, double selectivity, double scan_cost) {
+    if (!table->primary_index || !query->has_limit || query->order_count != 1 || query_is_aggregate(query)) {
+        return false;
+    }
+    if (!sort_key_bind(&query->order_by[0], table->schema, NULL, 0) ||
+        query->order_by[0].column_index != PRIMARY_KEY_COLUMN) {
+        return false;
+    }
+
+    double table_rows = (double)table->record_count;
+    double wanted = (double)query->offset + (double)query->limit;
+    double entries = selectivity > 0.0 ? min_double(wanted / selectivity, table_rows) : table_rows;
+    return index_lookup_cost(table->primary_index, table_rows, entries) < scan_cost;
+}
+
+bool plan_select(Query* query, const MemoryTable* table, QueryPlan* plan) {
+    memset(plan, 0, sizeof(QueryPlan));
+    plan->access = ACCESS_SCAN;
+    plan->scan_end = table->record_count;
+
+    if (query->where && !predicate_bind(query->where, table->schema, NULL, 0)) return false;
+    query->where = order_filters(query->where, table);
+    planner_scan_bounds(query, table, &plan->scan_start, &plan->scan_end);
+
+    double table_rows = (double)table->record_count;
+    double scanned = (double)(plan->scan_end - plan->scan_start);
+    double selectivity = planner_selectivity(query->where, table);
+    plan->estimated_rows = min_double(table_rows * selectivity, scanned);
+    plan->scan_cost = scanned * SCAN_ROW_COST;
+
+    /* An unordered scan stops once OFFSET plus LIMIT rows have matched. */
+    bool stops_early = query->has_limit && query->order_count == 0 && !query_is_aggregate(query);
+    if (stops_early && selectivity > 0.0) {
+        double wanted = ((double)query->offset + (double)query->limit) / selectivity;
+        plan->scan_cost = min_double(plan->scan_cost, wanted * SCAN_ROW_COST);
+    }
+    plan->index_order = plan_index_order(query, table, selectivity, plan->scan_cost);
+
+    if (!memory_table_has_key_index(table) || !query->where) return true;
+
+    KeyBounds bounds = { .has_low = false };
+    key_bounds(query->where, &bounds);
+    if (!bounds.has_low && !bounds.has_high) return true;
+
+    ValueType key_type = table->schema->columns[PRIMARY_KEY_COLUMN].type;
+    plan->range.start_key = bounds.has_low ? bounds.low : lowest_key(key_type);
+    plan->range.include_start = bounds.has_low ? bounds.low_inclusive : true;
+    plan->range.end_key = bounds.has_high ? bounds.high : value_null();
+    plan->range.include_end = bounds.has_high && bounds.high_inclusive;
+
+    double matches = table_rows * key_selectivity(&bounds, table);
+    plan->index_cost = table->primary_index ? index_lookup_cost(table->primary_index, table_rows, matches) :
+                                              key_order_cost(table_rows, matches);
+    if (plan->index_cost < plan->scan_cost) {
+        plan->access = key_is_point(&bounds) ? ACCESS_INDEX_LOOKUP : ACCESS_INDEX_RANGE;
+        plan->index_order = false;
+    }
+    return true;
+}
+
+JoinStrategy plan_join(const JoinClause* join, const MemoryTable* right, size_t probe_rows) {
+    bool indexed = right->primary_index && join->right_index == PRIMARY_KEY_COLUMN;
+    if (join->strategy == JOIN_HASH || !indexed) return JOIN_HASH;
+    if (join->strategy == JOIN_INDEX) return JOIN_INDEX;
+
+    double right_rows = (double)right->record_count;
+    double hash_cost = right_rows * HASH_BUILD_ROW_COST + (double)probe_rows * HASH_PROBE_ROW_COST;
+
+    /* Each probe is a lookup on the key column, finding one distinct value's share of its rows. */
+    const ColumnStats* column = column_stats(right, PRIMARY_KEY_COLUMN);
+    double matches = 1.0;
+    if (column && column_stats_distinct(column) > 0.0) {
+        matches = (double)column->value_count / column_stats_distinct(column);
+    }
+    double index_cost = (double)probe_rows * index_lookup_cost(right->primary_index, right_rows, matches);
+    return index_cost < hash_cost ? JOIN_INDEX : JOIN_HASH;
+}
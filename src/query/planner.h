@@ -3,6 +3,43 @@
 
 #include "executor.h"
 
+/* The primary index is keyed on the first column. */
+#define PRIMARY_KEY_COLUMN 0
+
+typedef enum {
+    ACCESS_SCAN,
+    ACCESS_INDEX_LOOKUP,
+    ACCESS_INDEX_RANGE
+} AccessMethod;
+
+/* How a SELECT reaches its rows. A scan visits records [scan_start, scan_end), narrowed by _id
+ * bounds; index access reads the primary index over `range`, whose keys are borrowed from the
+ * bound WHERE clause. Either way the whole WHERE clause still runs on every row reached. */
+typedef struct {
+    AccessMethod access;
+    BTreeRange range;
+    size_t scan_start;
+    size_t scan_end;
+    double estimated_rows;
+    double scan_cost;
+    double index_cost;
+    /* Read the primary index in key order for ORDER BY, instead of sorting or keeping a top-K heap,
+     * when that reaches OFFSET plus LIMIT matching rows for less than a scan costs. */
+    bool index_order;
+} QueryPlan;
+
 Query* plan_query(QueryType type, const char* table_name);
 
+/* Fraction of rows a bound predicate is expected to keep. */
+double planner_selectivity(const Predicate* predicate, const MemoryTable* table);
+
+/* Call after the WHERE clause is bound. */
+void planner_scan_bounds(const Query* query, const MemoryTable* table, size_t* start, size_t* end);
+
+/* Binds the WHERE clause, puts its cheapest and most selective AND terms first and picks an
+ * access method. Returns false when the WHERE clause does not bind. */
+bool plan_select(Query* query, const MemoryTable* table, QueryPlan* plan);
+
+JoinStrategy plan_join(const JoinClause* join, const MemoryTable* right, size_t probe_rows);
+
 #endif
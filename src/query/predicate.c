@@ -0,0 +1,200 @@
+#include "predicate.h"
+#include "../util/string_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+static Predicate* predicate_allocate(PredicateOp op) {
+    Predicate* predicate = malloc(sizeof(Predicate));
+    if (!predicate) return NULL;
+
+    predicate->op = op;
+    predicate->column = NULL;
+    predicate->column_index = PREDICATE_UNBOUND;
+    predicate->column_type = VALUE_NULL;
+    predicate->compare_as_float = false;
+    predicate->low = value_null();
+    predicate->high = value_null();
+    predicate->low_parameter = PREDICATE_NO_PARAMETER;
+    predicate->high_parameter = PREDICATE_NO_PARAMETER;
+    predicate->left = NULL;
+    predicate->right = NULL;
+    return predicate;
+}
+
+static Predicate* predicate_leaf(PredicateOp op, const char* column, Value low, Value high) {
+    Predicate* predicate = column ? predicate_allocate(op) : NULL;
+    if (predicate) predicate->column = string_duplicate(column);
+
+    if (!predicate || !predicate->column) {
+        free(predicate);
+        value_destroy(&low);
+        value_destroy(&high);
+        return NULL;
+    }
+
+    predicate->low = low;
+    predicate->high = high;
+    return predicate;
+}
+
+Predicate* predicate_compare(PredicateOp op, const char* column, Value literal) {
+    if (op > PRED_GE) {
+        value_destroy(&literal);
+        return NULL;
+    }
+    return predicate_leaf(op, column, literal, value_null());
+}
+
+Predicate* predicate_between(const char* column, Value low, Value high) {
+    return predicate_leaf(PRED_BETWEEN, column, low, high);
+}
+
+Predicate* predicate_null_check(const char* column, bool negated) {
+    return predicate_leaf(negated ? PRED_IS_NOT_NULL : PRED_IS_NULL, column, value_null(), value_null());
+}
+
+static Predicate* predicate_combine(PredicateOp op, Predicate* left, Predicate* right) {
+    Predicate* predicate = left && (right || op == PRED_NOT) ? predicate_allocate(op) : NULL;
+    if (!predicate) {
+        predicate_destroy(left);
+        predicate_destroy(right);
+        return NULL;
+    }
+
+    predicate->left = left;
+    predicate->right = right;
+    return predicate;
+}
+
+Predicate* predicate_and(Predicate* left, Predicate* right) {
+    return predicate_combine(PRED_AND, left, right);
+}
+
+Predicate* predicate_or(Predicate* left, Predicate* right) {
+    return predicate_combine(PRED_OR, left, right);
+}
+
+Predicate* predicate_not(Predicate* child) {
+    return predicate_combine(PRED_NOT, child, NULL);
+}
+
+void predicate_destroy(Predicate* predicate) {
+    if (!predicate) return;
+
+    predicate_destroy(predicate->left);
+    predicate_destroy(predicate->right);
+    value_destroy(&predicate->low);
+    value_destroy(&predicate->high);
+    free(predicate->column);
+    free(predicate);
+}
+
+static bool bind_error(char* error, size_t error_size, const char* message, const char* column) {
+    if (error && error_size > 0) {
+        snprintf(error, error_size, "%s '%s'", message, column);
+    }
+    return false;
+}
+
+static bool literal_fits(Value* literal, ValueType column_type, bool* compare_as_float) {
+    if (literal->type == VALUE_NULL) return true;
+
+    switch (column_type) {
+        case VALUE_INTEGER:
+            if (literal->type == VALUE_FLOAT) *compare_as_float = true;
+            return literal->type == VALUE_INTEGER || literal->type == VALUE_FLOAT;
+        case VALUE_FLOAT:
+            if (literal->type == VALUE_INTEGER) {
+                *literal = value_float((double)literal->data.integer);
+            }
+            return literal->type == VALUE_FLOAT;
+        default:
+            return literal->type == column_type;
+    }
+}
+
+static void promote_to_float(Value* literal) {
+    if (literal->type == VALUE_INTEGER) {
+        *literal = value_float((double)literal->data.integer);
+    }
+}
+
+static bool parameter_pending(int parameter, const Value* value) {
+    return parameter != PREDICATE_NO_PARAMETER && value->type == VALUE_NULL;
+}
+
+bool predicate_bind(Predicate* predicate, const TableSchema* schema, char* error, size_t error_size) {
+    if (!predicate || !schema) return false;
+
+    switch (predicate->op) {
+        case PRED_AND:
+        case PRED_OR:
+            return predicate_bind(predicate->left, schema, error, error_size) &&
+                   predicate_bind(predicate->right, schema, error, error_size);
+        case PRED_NOT:
+            return predicate_bind(predicate->left, schema, error, error_size);
+        default:
+            break;
+    }
+
+    int column = tableschema_find_column(schema, predicate->column);
+    predicate->column_index = PREDICATE_UNBOUND;
+    if (column >= 0) {
+        predicate->column_index = column;
+        predicate->column_type = schema->columns[column].type;
+    } else if (column == SCHEMA_COLUMN_MISSING &&
+               (string_case_compare(predicate->column, PREDICATE_ROW_ID_COLUMN) == 0 ||
+                string_case_compare(predicate->column, "id") == 0)) {
+        predicate->column_index = PREDICATE_ROW_ID;
+        predicate->column_type = VALUE_INTEGER;
+    }
+
+    if (predicate->column_index == PREDICATE_UNBOUND) {
+        return bind_error(error, error_size, tableschema_lookup_message(column), predicate->column);
+    }
+
+    if (predicate->op == PRED_IS_NULL || predicate->op == PRED_IS_NOT_NULL) return true;
+    if (parameter_pending(predicate->low_parameter, &predicate->low) ||
+        parameter_pending(predicate->high_parameter, &predicate->high)) {
+        return true;
+    }
+
+    predicate->compare_as_float = false;
+    if (predicate->low.type == VALUE_NULL || (predicate->op == PRED_BETWEEN && predicate->high.type == VALUE_NULL) ||
+        !literal_fits(&predicate->low, predicate->column_type, &predicate->compare_as_float) ||
+        !literal_fits(&predicate->high, predicate->column_type, &predicate->compare_as_float)) {
+        return bind_error(error, error_size, "Type mismatch for column", predicate->column);
+    }
+
+    if (predicate->column_type == VALUE_BOOLEAN && predicate->op != PRED_EQ && predicate->op != PRED_NE) {
+        return bind_error(error, error_size, "Only = and != apply to boolean column", predicate->column);
+    }
+
+    if (predicate->compare_as_float) {
+        promote_to_float(&predicate->low);
+        promote_to_float(&predicate->high);
+    }
+
+    return true;
+}
+
+static bool set_parameter(Value* slot, int parameter, const Value* values, size_t count) {
+    if (parameter == PREDICATE_NO_PARAMETER) return true;
+    if ((size_t)parameter >= count) return false;
+
+    Value value = value_clone(&values[parameter]);
+    if (value.type == VALUE_STRING && !value.data.string) return false;
+
+    value_destroy(slot);
+    *slot = value;
+    return true;
+}
+
+bool predicate_set_parameters(Predicate* predicate, const Value* values, size_t count) {
+    if (!predicate) return true;
+
+    return set_parameter(&predicate->low, predicate->low_parameter, values, count) &&
+           set_parameter(&predicate->high, predicate->high_parameter, values, count) &&
+           predicate_set_parameters(predicate->left, values, count) &&
+           predicate_set_parameters(predicate->right, values, count);
+}
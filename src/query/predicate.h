@@ -0,0 +1,58 @@
+#ifndef SHADE_QUERY_PREDICATE_H
+#define SHADE_QUERY_PREDICATE_H
+
+#include "../types/data.h"
+#include "../types/schema.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define PREDICATE_UNBOUND -1
+#define PREDICATE_ROW_ID -2
+#define PREDICATE_ROW_ID_COLUMN "_id"
+#define PREDICATE_NO_PARAMETER -1
+
+typedef enum {
+    PRED_EQ,
+    PRED_NE,
+    PRED_LT,
+    PRED_LE,
+    PRED_GT,
+    PRED_GE,
+    PRED_BETWEEN,
+    PRED_IS_NULL,
+    PRED_IS_NOT_NULL,
+    PRED_AND,
+    PRED_OR,
+    PRED_NOT
+} PredicateOp;
+
+typedef struct Predicate {
+    PredicateOp op;
+    char* column;
+    int column_index;
+    ValueType column_type;
+    bool compare_as_float;
+    Value low;
+    Value high;
+    /* Placeholder positions that fill low and high, or PREDICATE_NO_PARAMETER for literals. */
+    int low_parameter;
+    int high_parameter;
+    struct Predicate* left;
+    struct Predicate* right;
+} Predicate;
+
+/* Constructors take ownership of literals and children, and release them on failure. */
+Predicate* predicate_compare(PredicateOp op, const char* column, Value literal);
+Predicate* predicate_between(const char* column, Value low, Value high);
+Predicate* predicate_null_check(const char* column, bool negated);
+Predicate* predicate_and(Predicate* left, Predicate* right);
+Predicate* predicate_or(Predicate* left, Predicate* right);
+Predicate* predicate_not(Predicate* child);
+void predicate_destroy(Predicate* predicate);
+
+/* Placeholders that have no value yet are type-checked once predicate_set_parameters fills them. */
+bool predicate_bind(Predicate* predicate, const TableSchema* schema, char* error, size_t error_size);
+bool predicate_set_parameters(Predicate* predicate, const Value* values, size_t count);
+
+#endif
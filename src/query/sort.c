@@ -0,0 +1,440 @@
+#include "sort.h"
+#include "predicate.h"
+#include "../util/parallel.h"
+#include <stdio.h>
+#include <string.h>
+
+#define SORT_PARALLEL_MIN_ROWS (64 * 1024)
+#define SORT_RADIX_BITS 8
+#define SORT_RADIX_BUCKETS (1 << SORT_RADIX_BITS)
+
+bool sort_key_bind(SortKey* key, const TableSchema* schema, char* error, size_t error_size) {
+    if (!key || !schema) return false;
+
+    int column = tableschema_find_column(schema, key->column);
+    if (column >= 0) {
+        key->column_index = column;
+        key->column_type = schema->columns[column].type;
+        return true;
+    }
+
+    if (column == SCHEMA_COLUMN_MISSING && (string_case_compare(key->column, PREDICATE_ROW_ID_COLUMN) == 0 ||
+                                            string_case_compare(key->column, "id") == 0)) {
+        key->column_index = PREDICATE_ROW_ID;
+        key->column_type = VALUE_INTEGER;
+        return true;
+    }
+
+    key->column_index = PREDICATE_UNBOUND;
+    if (error && error_size > 0) {
+        snprintf(error, error_size, "%s '%s'", tableschema_lookup_message(column), key->column);
+    }
+    return false;
+}
+
+static const Value* key_value(const SortKey* key, const DataRecord* record) {
+    const Value* value = &record->values[key->column_index];
+    if (value->type != key->column_type) return NULL;
+    if (value->type == VALUE_STRING && !value->data.string) return NULL;
+    return value;
+}
+
+static bool key_is_null(const SortKey* key, const DataRecord* record) {
+    return key->column_index != PREDICATE_ROW_ID && key_value(key, record) == NULL;
+}
+
+/* Order-preserving 64-bit image of the first key; exact for everything but strings. */
+static uint64_t key_prefix(const SortKey* key, const DataRecord* record) {
+    uint64_t prefix = 0;
+
+    if (key->column_index == PREDICATE_ROW_ID) {
+        prefix = record->id;
+    } else {
+        const Value* value = key_value(key, record);
+        if (!value) return 0;
+
+        switch (value->type) {
+            case VALUE_INTEGER:
+                prefix = (uint64_t)value->data.integer ^ (1ULL << 63);
+                break;
+            case VALUE_FLOAT: {
+                double number = value->data.float_val == 0.0 ? 0.0 : value->data.float_val;
+                memcpy(&prefix, &number, sizeof(prefix));
+                prefix = (prefix >> 63) ? ~prefix : prefix | (1ULL << 63);
+                break;
+            }
+            case VALUE_BOOLEAN:
+                prefix = value->data.boolean;
+                break;
+            default: {
+                const unsigned char* text = (const unsigned char*)value->data.string;
+                for (size_t i = 0; i < 8; i++) {
+                    prefix <<= 8;
+                    if (*text) prefix |= *text++;
+                }
+                break;
+            }
+        }
+    }
+
+    return key->descending ? ~prefix : prefix;
+}
+
+static int compare_key(const SortKey* key, const DataRecord* a, const DataRecord* b) {
+    int order;
+
+    if (key->column_index == PREDICATE_ROW_ID) {
+        order = (a->id > b->id) - (a->id < b->id);
+    } else {
+        const Value* left = key_value(key, a);
+        const Value* right = key_value(key, b);
+
+        if (!left || !right) {
+            order = (left == NULL) - (right == NULL);
+        } else {
+            switch (key->column_type) {
+                case VALUE_INTEGER:
+                    order = (left->data.integer > right->data.integer) - (left->data.integer < right->data.integer);
+                    break;
+                case VALUE_FLOAT:
+                    order = (left->data.float_val > right->data.float_val) -
+                            (left->data.float_val < right->data.float_val);
+                    break;
+                case VALUE_BOOLEAN:
+                    order = (int)left->data.boolean - (int)right->data.boolean;
+                    break;
+                default:
+                    order = strcmp(left->data.string, right->data.string);
+                    break;
+            }
+        }
+    }
+
+    return key->descending ? -order : order;
+}
+
+int sort_compare(const SortKey* keys, size_t key_count, const DataRecord* a, const DataRecord* b) {
+    for (size_t k = 0; k < key_count; k++) {
+        int order = compare_key(&keys[k], a, b);
+        if (order != 0) return order;
+    }
+    return 0;
+}
+
+static bool prefix_is_exact(const SortKey* keys, size_t key_count) {
+    return key_count == 1 && keys[0].column_type != VALUE_STRING;
+}
+
+static int compare_entries(const SortKey* keys, size_t key_count, const SortEntry* a, const SortEntry* b) {
+    bool a_null = key_is_null(&keys[0], a->record);
+    bool b_null = key_is_null(&keys[0], b->record);
+
+    if (a_null != b_null) {
+        return (a_null ? 1 : -1) * (keys[0].descending ? -1 : 1);
+    }
+
+    if (!a_null && a->prefix != b->prefix) return a->prefix < b->prefix ? -1 : 1;
+
+    if (a_null || !prefix_is_exact(keys, key_count)) {
+        int order = sort_compare(keys, key_count, a->record, b->record);
+        if (order != 0) return order;
+    }
+
+    return (a->ordinal > b->ordinal) - (a->ordinal < b->ordinal);
+}
+
+static void merge_runs(const SortKey* keys, size_t key_count, const SortEntry* left, size_t left_count,
+                       const SortEntry* right, size_t right_count, SortEntry* out) {
+    size_t i = 0, j = 0, o = 0;
+
+    while (i < left_count && j < right_count) {
+        if (compare_entries(keys, key_count, &right[j], &left[i]) < 0) {
+            out[o++] = right[j++];
+        } else {
+            out[o++] = left[i++];
+        }
+    }
+
+    memcpy(out + o, left + i, sizeof(SortEntry) * (left_count - i));
+    o += left_count - i;
+    memcpy(out + o, right + j, sizeof(SortEntry) * (right_count - j));
+}
+
+static void merge_sort(const SortKey* keys, size_t key_count, SortEntry* entries, SortEntry* scratch, size_t count) {
+    if (count < 2) return;
+
+    if (count <= 16) {
+        for (size_t i = 1; i < count; i++) {
+            SortEntry entry = entries[i];
+            size_t j = i;
+            while (j > 0 && compare_entries(keys, key_count, &entry, &entries[j - 1]) < 0) {
+                entries[j] = entries[j - 1];
+                j--;
+            }
+            entries[j] = entry;
+        }
+        return;
+    }
+
+    size_t half = count / 2;
+    merge_sort(keys, key_count, entries, scratch, half);
+    merge_sort(keys, key_count, entries + half, scratch + half, count - half);
+
+    merge_runs(keys, key_count, entries, half, entries + half, count - half, scratch);
+    memcpy(entries, scratch, sizeof(SortEntry) * count);
+}
+
+static void radix_sort(SortEntry* entries, SortEntry* scratch, size_t count) {
+    SortEntry* source = entries;
+    SortEntry* target = scratch;
+
+    for (size_t shift = 0; shift < 64; shift += SORT_RADIX_BITS) {
+        size_t histogram[SORT_RADIX_BUCKETS] = {0};
+        for (size_t i = 0; i < count; i++) {
+            histogram[(source[i].prefix >> shift) & (SORT_RADIX_BUCKETS - 1)]++;
+        }
+
+        if (histogram[(source[0].prefix >> shift) & (SORT_RADIX_BUCKETS - 1)] == count) continue;
+
+        size_t offset = 0;
+        for (size_t b = 0; b < SORT_RADIX_BUCKETS; b++) {
+            size_t bucket = histogram[b];
+            histogram[b] = offset;
+            offset += bucket;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            target[histogram[(source[i].prefix >> shift) & (SORT_RADIX_BUCKETS - 1)]++] = source[i];
+        }
+
+        SortEntry* swap = source;
+        source = target;
+        target = swap;
+    }
+
+    if (source != entries) memcpy(entries, source, sizeof(SortEntry) * count);
+}
+
+/* Radix sorts by prefix with NULL first keys set apart, then settles prefix ties by full comparison. */
+static void sort_run(const SortKey* keys, size_t key_count, SortEntry* entries, SortEntry* scratch, size_t count) {
+    if (count < 2) return;
+
+    size_t values = 0;
+    size_t nulls = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (key_is_null(&keys[0], entries[i].record)) {
+            scratch[nulls++] = entries[i];
+        } else {
+            entries[values++] = entries[i];
+        }
+    }
+
+    SortEntry* null_entries = keys[0].descending ? entries : entries + values;
+    if (nulls > 0) {
+        if (keys[0].descending) memmove(entries + nulls, entries, sizeof(SortEntry) * values);
+        memcpy(null_entries, scratch, sizeof(SortEntry) * nulls);
+    }
+
+    SortEntry* value_entries = keys[0].descending ? entries + nulls : entries;
+    radix_sort(value_entries, scratch, values);
+
+    if (!prefix_is_exact(keys, key_count)) {
+        size_t start = 0;
+        for (size_t i = 1; i <= values; i++) {
+            if (i == values || value_entries[i].prefix != value_entries[start].prefix) {
+                merge_sort(keys, key_count, value_entries + start, scratch, i - start);
+                start = i;
+            }
+        }
+    }
+
+    if (key_count > 1) merge_sort(keys, key_count, null_entries, scratch, nulls);
+}
+
+typedef struct {
+    const SortKey* keys;
+    size_t key_count;
+    SortEntry* entries;
+    SortEntry* scratch;
+    size_t count;
+    size_t run_count;
+    size_t run_size;
+    size_t width;
+} SortJob;
+
+static void sort_run_task(void* context, size_t index) {
+    SortJob* job = context;
+    size_t start = index * job->run_size;
+    size_t end = start + job->run_size > job->count ? job->count : start + job->run_size;
+
+    sort_run(job->keys, job->key_count, job->entries + start, job->scratch + start, end - start);
+}
+
+static void merge_task(void* context, size_t index) {
+    SortJob* job = context;
+    size_t left = index * 2 * job->width * job->run_size;
+    size_t middle = left + job->width * job->run_size;
+    size_t right = middle + job->width * job->run_size;
+
+    if (middle > job->count) middle = job->count;
+    if (right > job->count) right = job->count;
+
+    merge_runs(job->keys, job->key_count, job->entries + left, middle - left,
+               job->entries + middle, right - middle, job->scratch + left);
+}
+
+bool sort_records(DataRecord** records, size_t count, const SortKey* keys, size_t key_count) {
+    if (!records || !keys || key_count == 0) return false;
+    if (count < 2) return true;
+
+    SortEntry* entries = malloc(sizeof(SortEntry) * count);
+    SortEntry* scratch = malloc(sizeof(SortEntry) * count);
+    if (!entries || !scratch) {
+        free(entries);
+        free(scratch);
+        return false;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        entries[i].prefix = key_prefix(&keys[0], records[i]);
+        entries[i].ordinal = i;
+        entries[i].record = records[i];
+    }
+
+    size_t run_count = 1;
+    if (count >= SORT_PARALLEL_MIN_ROWS) {
+        size_t workers = parallel_worker_count();
+        while (run_count < workers && count / (run_count * 2) >= SORT_PARALLEL_MIN_ROWS / 4) run_count *= 2;
+    }
+
+    SortJob job = {
+        .keys = keys,
+        .key_count = key_count,
+        .entries = entries,
+        .scratch = scratch,
+        .count = count,
+        .run_count = run_count,
+        .run_size = (count + run_count - 1) / run_count,
+        .width = 1
+    };
+
+    bool success = parallel_run(run_count, sort_run_task, &job);
+
+    while (success && job.width < run_count) {
+        size_t merges = (run_count + 2 * job.width - 1) / (2 * job.width);
+        success = parallel_run(merges, merge_task, &job);
+
+        SortEntry* swap = job.entries;
+        job.entries = job.scratch;
+        job.scratch = swap;
+        job.width *= 2;
+    }
+
+    for (size_t i = 0; success && i < count; i++) {
+        records[i] = job.entries[i].record;
+    }
+
+    free(entries);
+    free(scratch);
+    return success;
+}
+
+bool topk_init(TopK* topk, const SortKey* keys, size_t key_count, size_t k) {
+    if (!topk || !keys || key_count == 0) return false;
+
+    topk->keys = keys;
+    topk->key_count = key_count;
+    topk->count = 0;
+    topk->capacity = k;
+    topk->heap = malloc(sizeof(SortEntry) * (k ? k : 1));
+    return topk->heap != NULL;
+}
+
+static bool heap_before(const TopK* topk, size_t a, size_t b) {
+    return compare_entries(topk->keys, topk->key_count, &topk->heap[a], &topk->heap[b]) > 0;
+}
+
+static void heap_swap(TopK* topk, size_t a, size_t b) {
+    SortEntry entry = topk->heap[a];
+    topk->heap[a] = topk->heap[b];
+    topk->heap[b] = entry;
+}
+
+static void heap_sift_down(TopK* topk, size_t index) {
+    for (;;) {
+        size_t largest = index;
+        size_t left = index * 2 + 1;
+        size_t right = left + 1;
+
+        if (left < topk->count && heap_before(topk, left, largest)) largest = left;
+        if (right < topk->count && heap_before(topk, right, largest)) largest = right;
+        if (largest == index) return;
+
+        heap_swap(topk, index, largest);
+        index = largest;
+    }
+}
+
+static void topk_insert(TopK* topk, const SortEntry* entry) {
+    if (topk->capacity == 0) return;
+
+    if (topk->count < topk->capacity) {
+        size_t index = topk->count++;
+        topk->heap[index] = *entry;
+
+        while (index > 0 && heap_before(topk, index, (index - 1) / 2)) {
+            heap_swap(topk, index, (index - 1) / 2);
+            index = (index - 1) / 2;
+        }
+        return;
+    }
+
+    if (compare_entries(topk->keys, topk->key_count, entry, &topk->heap[0]) >= 0) return;
+
+    topk->heap[0] = *entry;
+    heap_sift_down(topk, 0);
+}
+
+void topk_push(TopK* topk, DataRecord* record, uint64_t ordinal) {
+    if (!topk || !record) return;
+
+    SortEntry entry = {
+        .prefix = key_prefix(&topk->keys[0], record),
+        .ordinal = ordinal,
+        .record = record
+    };
+    topk_insert(topk, &entry);
+}
+
+void topk_merge(TopK* into, const TopK* from) {
+    if (!into || !from) return;
+
+    for (size_t i = 0; i < from->count; i++) {
+        topk_insert(into, &from->heap[i]);
+    }
+}
+
+size_t topk_finish(TopK* topk, DataRecord** out_records) {
+    if (!topk || !out_records) return 0;
+
+    size_t count = topk->count;
+    while (topk->count > 1) {
+        heap_swap(topk, 0, --topk->count);
+        heap_sift_down(topk, 0);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        out_records[i] = topk->heap[i].record;
+    }
+
+    topk->count = 0;
+    return count;
+}
+
+void topk_free(TopK* topk) {
+    if (!topk) return;
+
+    free(topk->heap);
+    topk->heap = NULL;
+    topk->count = 0;
+}
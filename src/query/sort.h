@@ -0,0 +1,45 @@
+#ifndef SHADE_QUERY_SORT_H
+#define SHADE_QUERY_SORT_H
+
+#include "../types/data.h"
+#include "../types/schema.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* NULL sorts after every value, so it comes first under DESC. */
+typedef struct {
+    char* column;
+    int column_index;
+    ValueType column_type;
+    bool descending;
+} SortKey;
+
+typedef struct {
+    uint64_t prefix;
+    uint64_t ordinal;
+    DataRecord* record;
+} SortEntry;
+
+/* Keeps the k smallest entries seen so far in a bounded max-heap. */
+typedef struct {
+    const SortKey* keys;
+    size_t key_count;
+    SortEntry* heap;
+    size_t count;
+    size_t capacity;
+} TopK;
+
+bool sort_key_bind(SortKey* key, const TableSchema* schema, char* error, size_t error_size);
+int sort_compare(const SortKey* keys, size_t key_count, const DataRecord* a, const DataRecord* b);
+
+/* Stable: records comparing equal keep their current order. */
+bool sort_records(DataRecord** records, size_t count, const SortKey* keys, size_t key_count);
+
+bool topk_init(TopK* topk, const SortKey* keys, size_t key_count, size_t k);
+void topk_push(TopK* topk, DataRecord* record, uint64_t ordinal);
+void topk_merge(TopK* into, const TopK* from);
+size_t topk_finish(TopK* topk, DataRecord** out_records);
+void topk_free(TopK* topk);
+
+#endif
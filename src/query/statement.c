@@ -0,0 +1,214 @@
+#include "statement.h"
+#include "parser.h"
+#include "../util/hash.h"
+#include <stdio.h>
+#include <string.h>
+
+static void set_message(char* error, size_t error_size, const char* message) {
+    if (error && error_size > 0) snprintf(error, error_size, "%s", message);
+}
+
+static void statement_destroy(PreparedStatement* statement) {
+    if (statement->joined) tableschema_destroy(statement->schema);
+    query_destroy(statement->query);
+    free(statement->text);
+    free(statement);
+}
+
+static PreparedStatement* statement_create(MemoryStorage* storage, const char* text, uint64_t hash,
+                                           char* error, size_t error_size) {
+    Query* query = parse_query(text, error, error_size);
+    if (!query) return NULL;
+
+    MemoryTable* table = memory_storage_get_table(storage, query->table_name);
+    MemoryTable* joined = query->join ? memory_storage_get_table(storage, query->join->table_name) : NULL;
+    if (!table || (query->join && !joined)) {
+        if (error && error_size > 0) {
+            snprintf(error, error_size, "Table '%s' not found", table ? query->join->table_name : query->table_name);
+        }
+        query_destroy(query);
+        return NULL;
+    }
+
+    bool bound = joined ? query_bind_join(query, table->schema, joined->schema, error, error_size)
+                        : query_bind(query, table->schema, error, error_size);
+    if (!bound) {
+        query_destroy(query);
+        return NULL;
+    }
+
+    PreparedStatement* statement = malloc(sizeof(PreparedStatement));
+    char* copy = string_duplicate(text);
+    TableSchema* schema = joined ? join_schema(table->schema, joined->schema) : table->schema;
+    if (!statement || !copy || !schema) {
+        if (joined) tableschema_destroy(schema);
+        free(copy);
+        free(statement);
+        query_destroy(query);
+        set_message(error, error_size, "Out of memory");
+        return NULL;
+    }
+
+    statement->text = copy;
+    statement->hash = hash;
+    statement->query = query;
+    statement->table = table;
+    statement->joined = joined;
+    statement->schema = schema;
+    statement->references = 0;
+    statement->cached = false;
+    statement->generation = 0;
+    statement->last_used = 0;
+    return statement;
+}
+
+StatementCache* statement_cache_create(void) {
+    return calloc(1, sizeof(StatementCache));
+}
+
+static void cache_place(StatementCache* cache, PreparedStatement* statement) {
+    size_t mask = STATEMENT_CACHE_SLOTS - 1;
+    size_t slot = (size_t)statement->hash & mask;
+
+    while (cache->slots[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    cache->slots[slot] = statement;
+}
+
+static void cache_reindex(StatementCache* cache) {
+    memset(cache->slots, 0, sizeof(cache->slots));
+    for (size_t i = 0; i < cache->count; i++) {
+        cache_place(cache, cache->entries[i]);
+    }
+}
+
+static PreparedStatement* cache_lookup(const StatementCache* cache, const char* text, uint64_t hash) {
+    size_t mask = STATEMENT_CACHE_SLOTS - 1;
+    size_t slot = (size_t)hash & mask;
+
+    while (cache->slots[slot]) {
+        PreparedStatement* statement = cache->slots[slot];
+        if (statement->hash == hash && strcmp(statement->text, text) == 0) {
+            return statement;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+static void cache_remove(StatementCache* cache, size_t index) {
+    PreparedStatement* statement = cache->entries[index];
+    statement->cached = false;
+    if (statement->references == 0) statement_destroy(statement);
+
+    cache->entries[index] = cache->entries[--cache->count];
+}
+
+static void cache_evict(StatementCache* cache) {
+    size_t oldest = 0;
+    for (size_t i = 1; i < cache->count; i++) {
+        if (cache->entries[i]->last_used < cache->entries[oldest]->last_used) oldest = i;
+    }
+
+    cache_remove(cache, oldest);
+    cache_reindex(cache);
+}
+
+void statement_cache_invalidate(StatementCache* cache) {
+    if (!cache) return;
+
+    while (cache->count > 0) {
+        cache_remove(cache, cache->count - 1);
+    }
+    memset(cache->slots, 0, sizeof(cache->slots));
+    cache->generation++;
+}
+
+void statement_cache_destroy(StatementCache* cache) {
+    if (!cache) return;
+
+    statement_cache_invalidate(cache);
+    free(cache);
+}
+
+PreparedStatement* statement_prepare(StatementCache* cache, MemoryStorage* storage, const char* text,
+                                     char* error, size_t error_size) {
+    if (!storage || !text) {
+        set_message(error, error_size, "Invalid parameters");
+        return NULL;
+    }
+
+    uint64_t hash = hash_string(text);
+    PreparedStatement* statement = cache ? cache_lookup(cache, text, hash) : NULL;
+
+    if (statement) {
+        cache->hits++;
+    } else {
+        statement = statement_create(storage, text, hash, error, error_size);
+        if (!statement) return NULL;
+
+        if (cache) {
+            cache->misses++;
+            if (cache->count == STATEMENT_CACHE_CAPACITY) cache_evict(cache);
+            cache->entries[cache->count++] = statement;
+            cache_place(cache, statement);
+            statement->cached = true;
+            statement->generation = cache->generation;
+        }
+    }
+
+    if (cache) statement->last_used = ++cache->clock;
+    statement->references++;
+    return statement;
+}
+
+void statement_retain(PreparedStatement* statement) {
+    if (statement) statement->references++;
+}
+
+void statement_release(PreparedStatement* statement) {
+    if (!statement) return;
+
+    if (--statement->references == 0 && !statement->cached) statement_destroy(statement);
+}
+
+PreparedStatement* statement_refresh(StatementCache* cache, MemoryStorage* storage, PreparedStatement* statement,
+                                     char* error, size_t error_size) {
+    if (!cache || statement->generation == cache->generation) return statement;
+
+    PreparedStatement* fresh = statement_prepare(cache, storage, statement->text, error, error_size);
+    if (!fresh) return NULL;
+
+    statement_release(statement);
+    return fresh;
+}
+
+bool statement_bind_parameters(PreparedStatement* statement, const Value* parameters,
+                               char* error, size_t error_size) {
+    Query* query = statement->query;
+
+    for (size_t i = 0; i < query->parameter_count; i++) {
+        if (!parameters || parameters[i].type == VALUE_NULL) {
+            if (error && error_size > 0) snprintf(error, error_size, "Parameter %zu is not bound", i);
+            return false;
+        }
+    }
+
+    if (!predicate_set_parameters(query->where, parameters, query->parameter_count)) {
+        set_message(error, error_size, "Out of memory");
+        return false;
+    }
+    return !query->where || predicate_bind(query->where, statement->schema, error, error_size);
+}
+
+QueryResult* statement_execute(PreparedStatement* statement, const Value* parameters,
+                               char* error, size_t error_size) {
+    if (!statement_bind_parameters(statement, parameters, error, error_size)) return NULL;
+
+    Query* query = statement->query;
+    QueryResult* result = statement->joined ? execute_join_query(statement->table, statement->joined, query)
+                                            : execute_table_query(statement->table, query);
+    if (!result) set_message(error, error_size, "Query failed");
+    return result;
+}
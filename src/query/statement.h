@@ -0,0 +1,66 @@
+#ifndef SHADE_QUERY_STATEMENT_H
+#define SHADE_QUERY_STATEMENT_H
+
+#include "../storage/memory.h"
+#include "executor.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define STATEMENT_CACHE_CAPACITY 64
+#define STATEMENT_CACHE_SLOTS (STATEMENT_CACHE_CAPACITY * 2)
+
+/* A parsed query bound to its tables, run again with fresh parameter values each time. */
+typedef struct {
+    char* text;
+    uint64_t hash;
+    Query* query;
+    MemoryTable* table;
+    MemoryTable* joined;
+    /* The schema the WHERE clause binds against; owned when joined. */
+    TableSchema* schema;
+
+    size_t references;
+    bool cached;
+    uint64_t generation;
+    uint64_t last_used;
+} PreparedStatement;
+
+/* Statements keyed by their exact text; the least recently used is evicted when full. */
+typedef struct {
+    PreparedStatement* entries[STATEMENT_CACHE_CAPACITY];
+    size_t count;
+    PreparedStatement* slots[STATEMENT_CACHE_SLOTS];
+    uint64_t generation;
+    uint64_t clock;
+    size_t hits;
+    size_t misses;
+} StatementCache;
+
+StatementCache* statement_cache_create(void);
+void statement_cache_destroy(StatementCache* cache);
+
+/* Drops every entry; statements prepared before this must be refreshed before they run.
+ * Call whenever a table is dropped or replaced. */
+void statement_cache_invalidate(StatementCache* cache);
+
+/* Returns a reference the caller releases; cache may be NULL for a one-off statement. */
+PreparedStatement* statement_prepare(StatementCache* cache, MemoryStorage* storage, const char* text,
+                                     char* error, size_t error_size);
+/* Takes another reference, e.g. for a result that borrows the statement's schema. */
+void statement_retain(PreparedStatement* statement);
+void statement_release(PreparedStatement* statement);
+
+/* Returns the statement itself while its tables are current, otherwise a new reference prepared
+ * from the same text, releasing the old one. On failure the old reference is kept. */
+PreparedStatement* statement_refresh(StatementCache* cache, MemoryStorage* storage, PreparedStatement* statement,
+                                     char* error, size_t error_size);
+
+/* parameters holds one value per placeholder; NULL values are rejected. */
+bool statement_bind_parameters(PreparedStatement* statement, const Value* parameters,
+                               char* error, size_t error_size);
+/* Binds the parameters and runs the statement. */
+QueryResult* statement_execute(PreparedStatement* statement, const Value* parameters,
+                               char* error, size_t error_size);
+
+#endif
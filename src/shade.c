@@ -3,6 +3,13 @@
 struct ShadeDB {
     MemoryStorage* storage;
     char* last_error;
+    
+    /* Every profile_every-th query runs with a profile attached; 0 turns sampling off. */
+    unsigned int profile_every;
+    uint64_t query_count;
+    char* last_profile;
+    
+    StatementCache* statements;
 };
 
 struct ShadeGhostTableStats {
@@ -36,6 +43,30 @@ struct ShadeQueryResult {
     bool is_ghost_stats;                 
 };
 
+#define DEFAULT_CURSOR_BATCH_SIZE 256
+
+struct ShadeCursor {
+    Query* query;
+    QueryCursor* scan;
+    DataRecord** batch;
+    size_t batch_size;
+    size_t batch_count;
+    size_t batch_position;
+    DataRecord* current;
+};
+
+struct ShadeInsert {
+    MemoryTable* table;
+    Value* values;
+};
+
+struct ShadeStatement {
+    ShadeDB* db;
+    PreparedStatement* prepared;
+    Value* parameters;
+    size_t parameter_count;
+};
+
 static char* last_error = NULL;
 
 static void set_error(const char* message) {
@@ -77,14 +108,37 @@ static Value value_from_void(const void* value, ValueType type) {
     }
 }
 
+static Value* allocate_null_row(size_t column_count) {
+    Value* values = malloc(sizeof(Value) * column_count);
+    if (!values) return NULL;
+    
+    for (size_t i = 0; i < column_count; i++) {
+        values[i] = value_null();
+    }
+    return values;
+}
+
+static void destroy_value_array(Value* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        value_destroy(&values[i]);
+    }
+    free(values);
+}
+
 ShadeDB* shade_db_create(void) {
     ShadeDB* db = malloc(sizeof(ShadeDB));
     if (!db) return NULL;
     
     db->storage = memory_storage_create();
     db->last_error = NULL;
+    db->profile_every = 0;
+    db->query_count = 0;
+    db->last_profile = NULL;
+    db->statements = statement_cache_create();
     
-    if (!db->storage) {
+    if (!db->storage || !db->statements) {
+        memory_storage_destroy(db->storage);
+        statement_cache_destroy(db->statements);
         free(db);
         return NULL;
     }
@@ -95,8 +149,10 @@ ShadeDB* shade_db_create(void) {
 void shade_db_destroy(ShadeDB* db) {
     if (!db) return;
     
+    statement_cache_destroy(db->statements);
     memory_storage_destroy(db->storage);
     free(db->last_error);
+    free(db->last_profile);
     free(db);
 }
 
@@ -155,11 +211,33 @@ bool shade_drop_table(ShadeDB* db, const char* name) {
     bool success = execute_drop_table(db->storage, name);
     if (!success) {
         set_error("Table not found or drop failed");
+    } else {
+        statement_cache_invalidate(db->statements);
     }
     
     return success;
 }
 
+ShadeTable* shade_table_open(ShadeDB* db, const char* name) {
+    if (!db || !name) {
+        set_error("Invalid parameters");
+        return NULL;
+    }
+    
+    MemoryTable* table = memory_storage_get_table(db->storage, name);
+    if (!table) {
+        set_error("Table not found");
+        return NULL;
+    }
+    
+    return (ShadeTable*)table;
+}
+
+const char* shade_table_name(ShadeTable* handle) {
+    if (!handle) return NULL;
+    return ((MemoryTable*)handle)->name;
+}
+
 uint64_t shade_insert(ShadeDB* db, const char* table_name, 
                      const void** values, size_t value_count) {
     if (!db || !table_name || !values) {
@@ -167,12 +245,20 @@ uint64_t shade_insert(ShadeDB* db, const char* table_name,
         return 0;
     }
     
-    MemoryTable* table = memory_storage_get_table(db->storage, table_name);
-    if (!table) {
-        set_error("Table not found");
+    ShadeTable* table = shade_table_open(db, table_name);
+    if (!table) return 0;
+    
+    return shade_table_insert(table, values, value_count);
+}
+
+uint64_t shade_table_insert(ShadeTable* handle, const void** values, size_t value_count) {
+    if (!handle || !values) {
+        set_error("Invalid parameters");
         return 0;
     }
     
+    MemoryTable* table = (MemoryTable*)handle;
+    
     if (value_count != table->schema->column_count) {
         set_error("Wrong number of values");
         return 0;
@@ -188,40 +274,277 @@ uint64_t shade_insert(ShadeDB* db, const char* table_name,
         value_array[i] = value_from_void(values[i], table->schema->columns[i].type);
     }
     
-    uint64_t id = memory_table_insert(table, value_array);
-    
-    free(value_array);
+    uint64_t id = memory_table_insert_owned(table, value_array);
     
     if (id == 0) {
+        destroy_value_array(value_array, value_count);
         set_error("Failed to insert record");
     }
     
     return id;
 }
 
-ShadeQueryResult* shade_select(ShadeDB* db, const char* table_name, 
-                              bool include_ghosts) {
-    if (!db || !table_name) {
+uint64_t shade_insert_batch(ShadeDB* db, const char* table_name, const void** values,
+                           size_t value_count, size_t row_count) {
+    if (!db || !table_name || !values) {
+        set_error("Invalid parameters");
+        return 0;
+    }
+    
+    ShadeTable* table = shade_table_open(db, table_name);
+    if (!table) return 0;
+    
+    return shade_table_insert_batch(table, values, value_count, row_count);
+}
+
+uint64_t shade_table_insert_batch(ShadeTable* handle, const void** values,
+                                 size_t value_count, size_t row_count) {
+    if (!handle || !values || row_count == 0) {
+        set_error("Invalid parameters");
+        return 0;
+    }
+    
+    MemoryTable* table = (MemoryTable*)handle;
+    
+    if (value_count != table->schema->column_count) {
+        set_error("Wrong number of values");
+        return 0;
+    }
+    
+    Value** rows = malloc(sizeof(Value*) * row_count);
+    if (!rows) {
+        set_error("Memory allocation failed");
+        return 0;
+    }
+    
+    for (size_t r = 0; r < row_count; r++) {
+        rows[r] = malloc(sizeof(Value) * value_count);
+        if (!rows[r]) {
+            for (size_t j = 0; j < r; j++) {
+                destroy_value_array(rows[j], value_count);
+            }
+            free(rows);
+            set_error("Memory allocation failed");
+            return 0;
+        }
+        
+        const void** row_values = values + r * value_count;
+        for (size_t i = 0; i < value_count; i++) {
+            rows[r][i] = value_from_void(row_values[i], table->schema->columns[i].type);
+        }
+    }
+    
+    uint64_t first_id = memory_table_insert_batch_owned(table, rows, row_count);
+    
+    if (first_id == 0) {
+        for (size_t r = 0; r < row_count; r++) {
+            destroy_value_array(rows[r], value_count);
+        }
+        set_error("Failed to insert records");
+    }
+    
+    free(rows);
+    return first_id;
+}
+
+bool shade_copy_from(ShadeDB* db, const char* table_name, const char* path,
+                     const char* format, size_t* rows_loaded) {
+    if (rows_loaded) *rows_loaded = 0;
+    
+    if (!db || !table_name || !path) {
+        set_error("Invalid parameters");
+        return false;
+    }
+    
+    CopyFormat copy_format = COPY_FORMAT_AUTO;
+    if (format && !copy_format_parse(format, &copy_format)) {
+        set_error("Unknown copy format");
+        return false;
+    }
+    
+    ShadeTable* table = shade_table_open(db, table_name);
+    if (!table) return false;
+    
+    CopyStats stats;
+    bool success = copy_from_file((MemoryTable*)table, path, copy_format, &stats);
+    if (rows_loaded) *rows_loaded = stats.rows_loaded;
+    
+    if (!success) {
+        set_error(stats.error);
+    }
+    return success;
+}
+
+bool shade_copy_to(ShadeDB* db, const char* table_name, const char* path,
+                   const char* format, bool include_ghosts, size_t* rows_written) {
+    if (rows_written) *rows_written = 0;
+    
+    if (!db || !table_name || !path) {
+        set_error("Invalid parameters");
+        return false;
+    }
+    
+    CopyFormat copy_format = COPY_FORMAT_AUTO;
+    if (format && !copy_format_parse(format, &copy_format)) {
+        set_error("Unknown copy format");
+        return false;
+    }
+    
+    ShadeTable* table = shade_table_open(db, table_name);
+    if (!table) return false;
+    
+    ExportStats stats;
+    bool success = copy_to_file((MemoryTable*)table, path, copy_format, include_ghosts, &stats);
+    if (rows_written) *rows_written = stats.rows_written;
+    
+    if (!success) {
+        set_error(stats.error);
+    }
+    return success;
+}
+
+ShadeInsert* shade_insert_prepare(ShadeTable* handle) {
+    if (!handle) {
         set_error("Invalid parameters");
         return NULL;
     }
     
-    Query* query = query_create(QUERY_SELECT, table_name);
-    if (!query) {
-        set_error("Failed to create query");
+    MemoryTable* table = (MemoryTable*)handle;
+    
+    ShadeInsert* insert = malloc(sizeof(ShadeInsert));
+    if (!insert) {
+        set_error("Memory allocation failed");
         return NULL;
     }
     
-    query->include_ghosts = include_ghosts;
+    insert->table = table;
+    insert->values = allocate_null_row(table->schema->column_count);
+    if (!insert->values) {
+        free(insert);
+        set_error("Memory allocation failed");
+        return NULL;
+    }
     
-    QueryResult* internal_result = execute_query(db->storage, query);
-    query_destroy(query);
+    return insert;
+}
+
+static Value* bind_slot(ShadeInsert* insert, size_t col, ValueType type) {
+    if (!insert || !insert->values) {
+        set_error("Invalid parameters");
+        return NULL;
+    }
+    if (col >= insert->table->schema->column_count) {
+        set_error("Column index out of range");
+        return NULL;
+    }
+    if (type != VALUE_NULL && insert->table->schema->columns[col].type != type) {
+        set_error("Column type mismatch");
+        return NULL;
+    }
     
-    if (!internal_result) {
-        set_error("Table not found or query failed");
+    Value* slot = &insert->values[col];
+    value_destroy(slot);
+    return slot;
+}
+
+bool shade_insert_bind_int(ShadeInsert* insert, size_t col, int64_t value) {
+    Value* slot = bind_slot(insert, col, VALUE_INTEGER);
+    if (!slot) return false;
+    
+    *slot = value_integer(value);
+    return true;
+}
+
+bool shade_insert_bind_float(ShadeInsert* insert, size_t col, double value) {
+    Value* slot = bind_slot(insert, col, VALUE_FLOAT);
+    if (!slot) return false;
+    
+    *slot = value_float(value);
+    return true;
+}
+
+bool shade_insert_bind_bool(ShadeInsert* insert, size_t col, bool value) {
+    Value* slot = bind_slot(insert, col, VALUE_BOOLEAN);
+    if (!slot) return false;
+    
+    *slot = value_boolean(value);
+    return true;
+}
+
+bool shade_insert_bind_string(ShadeInsert* insert, size_t col, const char* value) {
+    Value* slot = bind_slot(insert, col, VALUE_STRING);
+    if (!slot) return false;
+    
+    *slot = value ? value_string(value) : value_null();
+    if (value && !slot->data.string) {
+        set_error("Memory allocation failed");
+        return false;
+    }
+    return true;
+}
+
+bool shade_insert_bind_string_move(ShadeInsert* insert, size_t col, char* buffer) {
+    Value* slot = bind_slot(insert, col, VALUE_STRING);
+    if (!slot) return false;
+    
+    if (buffer) {
+        slot->type = VALUE_STRING;
+        slot->data.string = buffer;
+    }
+    return true;
+}
+
+bool shade_insert_bind_null(ShadeInsert* insert, size_t col) {
+    return bind_slot(insert, col, VALUE_NULL) != NULL;
+}
+
+uint64_t shade_insert_execute(ShadeInsert* insert) {
+    if (!insert || !insert->values) {
+        set_error("Invalid parameters");
+        return 0;
+    }
+    
+    size_t column_count = insert->table->schema->column_count;
+    Value* next_row = allocate_null_row(column_count);
+    if (!next_row) {
+        set_error("Memory allocation failed");
+        return 0;
+    }
+    
+    uint64_t id = memory_table_insert_owned(insert->table, insert->values);
+    if (id == 0) {
+        free(next_row);
+        set_error("Failed to insert record");
+        return 0;
+    }
+    
+    insert->values = next_row;
+    return id;
+}
+
+void shade_insert_finalize(ShadeInsert* insert) {
+    if (!insert) return;
+    
+    if (insert->values) {
+        destroy_value_array(insert->values, insert->table->schema->column_count);
+    }
+    free(insert);
+}
+
+ShadeQueryResult* shade_select(ShadeDB* db, const char* table_name, 
+                              bool include_ghosts) {
+    if (!db || !table_name) {
+        set_error("Invalid parameters");
         return NULL;
     }
     
+    ShadeTable* table = shade_table_open(db, table_name);
+    if (!table) return NULL;
+    
+    return shade_table_select(table, include_ghosts);
+}
+
+static ShadeQueryResult* wrap_result(QueryResult* internal_result, MemoryTable* table) {
     ShadeQueryResult* result = malloc(sizeof(ShadeQueryResult));
     if (!result) {
         queryresult_destroy(internal_result);
@@ -230,7 +553,7 @@ ShadeQueryResult* shade_select(ShadeDB* db, const char* table_name,
     }
     
     result->internal_result = internal_result;
-    result->table = memory_storage_get_table(db->storage, table_name);
+    result->table = table;
     result->current_row = 0;
 
     result->is_ghost_stats = false;
@@ -239,13 +562,282 @@ ShadeQueryResult* shade_select(ShadeDB* db, const char* table_name,
     return result;
 }
 
+static ShadeQueryResult* run_query(MemoryTable* table, Query* query) {
+    QueryResult* internal_result = execute_table_query(table, query);
+    query_destroy(query);
+    
+    if (!internal_result) {
+        set_error("Query failed");
+        return NULL;
+    }
+    return wrap_result(internal_result, table);
+}
+
+static void keep_profile(ShadeDB* db, const QueryProfile* profile) {
+    char line[256];
+    size_t length = 0;
+    size_t lines = profile_line_count(profile);
+    char* text = malloc(lines * sizeof(line) + 1);
+    if (!text) return;
+    
+    for (size_t i = 0; i < lines; i++) {
+        profile_format_line(profile, i, line, sizeof(line));
+        length += (size_t)sprintf(text + length, "%s%s", line, i + 1 < lines ? "\n" : "");
+    }
+    text[length] = '\0';
+    
+    free(db->last_profile);
+    db->last_profile = text;
+}
+
+ShadeQueryResult* shade_table_select(ShadeTable* handle, bool include_ghosts) {
+    return shade_table_select_where(handle, NULL, include_ghosts);
+}
+
+ShadeQueryResult* shade_select_where(ShadeDB* db, const char* table_name,
+                                    const char* where, bool include_ghosts) {
+    if (!db || !table_name) {
+        set_error("Invalid parameters");
+        return NULL;
+    }
+    
+    ShadeTable* table = shade_table_open(db, table_name);
+    if (!table) return NULL;
+    
+    return shade_table_select_where(table, where, include_ghosts);
+}
+
+ShadeQueryResult* shade_table_select_where(ShadeTable* handle, const char* where, bool include_ghosts) {
+    if (!handle) {
+        set_error("Invalid parameters");
+        return NULL;
+    }
+    
+    MemoryTable* table = (MemoryTable*)handle;
+    
+    Query* query = query_create(QUERY_SELECT, NULL);
+    if (!query) {
+        set_error("Failed to create query");
+        return NULL;
+    }
+    
+    query->include_ghosts = include_ghosts;
+    
+    if (where) {
+        char error[PARSER_ERROR_SIZE];
+        query->where = parse_predicate(where, error, sizeof(error));
+        if (!query->where || !predicate_bind(query->where, table->schema, error, sizeof(error))) {
+            query_destroy(query);
+            set_error(error);
+            return NULL;
+        }
+    }
+    
+    return run_query(table, query);
+}
+
+static ShadeQueryResult* execute_statement(ShadeDB* db, PreparedStatement* statement, const Value* parameters) {
+    Query* query = statement->query;
+    bool sampled = db->profile_every > 0 && query->explain == EXPLAIN_NONE &&
+                   ++db->query_count % db->profile_every == 0;
+    
+    QueryProfile profile;
+    if (sampled) {
+        profile_init(&profile, true);
+        query->profile = &profile;
+    }
+    
+    char error[PARSER_ERROR_SIZE];
+    uint64_t started = sampled ? profile_now() : 0;
+    QueryResult* internal_result = statement_execute(statement, parameters, error, sizeof(error));
+    query->profile = NULL;
+    
+    if (!internal_result) {
+        set_error(error);
+        return NULL;
+    }
+    
+    if (sampled) {
+        profile.execution_ns = profile_now() - started;
+        keep_profile(db, &profile);
+    }
+    return wrap_result(internal_result, statement->table);
+}
+
+ShadeQueryResult* shade_query(ShadeDB* db, const char* sql) {
+    if (!db || !sql) {
+        set_error("Invalid parameters");
+        return NULL;
+    }
+    
+    char error[PARSER_ERROR_SIZE];
+    PreparedStatement* statement = statement_prepare(db->statements, db->storage, sql, error, sizeof(error));
+    if (!statement) {
+        set_error(error);
+        return NULL;
+    }
+    
+    ShadeQueryResult* result = NULL;
+    if (statement->query->parameter_count > 0) {
+        set_error("Statement has parameters; use shade_prepare");
+    } else {
+        result = execute_statement(db, statement, NULL);
+    }
+    
+    statement_release(statement);
+    return result;
+}
+
+ShadeStatement* shade_prepare(ShadeDB* db, const char* sql) {
+    if (!db || !sql) {
+        set_error("Invalid parameters");
+        return NULL;
+    }
+    
+    char error[PARSER_ERROR_SIZE];
+    PreparedStatement* prepared = statement_prepare(db->statements, db->storage, sql, error, sizeof(error));
+    if (!prepared) {
+        set_error(error);
+        return NULL;
+    }
+    
+    ShadeStatement* statement = malloc(sizeof(ShadeStatement));
+    size_t count = prepared->query->parameter_count;
+    Value* parameters = count > 0 ? allocate_null_row(count) : NULL;
+    if (!statement || (count > 0 && !parameters)) {
+        free(statement);
+        free(parameters);
+        statement_release(prepared);
+        set_error("Memory allocation failed");
+        return NULL;
+    }
+    
+    statement->db = db;
+    statement->prepared = prepared;
+    statement->parameters = parameters;
+    statement->parameter_count = count;
+    return statement;
+}
+
+size_t shade_statement_param_count(ShadeStatement* statement) {
+    return statement ? statement->parameter_count : 0;
+}
+
+static bool bind_parameter(ShadeStatement* statement, size_t index, Value value) {
+    if (!statement) {
+        value_destroy(&value);
+        set_error("Invalid parameters");
+        return false;
+    }
+    if (index >= statement->parameter_count) {
+        value_destroy(&value);
+        set_error("Parameter index out of range");
+        return false;
+    }
+    
+    value_destroy(&statement->parameters[index]);
+    statement->parameters[index] = value;
+    return true;
+}
+
+bool shade_bind_int(ShadeStatement* statement, size_t index, int64_t value) {
+    return bind_parameter(statement, index, value_integer(value));
+}
+
+bool shade_bind_float(ShadeStatement* statement, size_t index, double value) {
+    return bind_parameter(statement, index, value_float(value));
+}
+
+bool shade_bind_bool(ShadeStatement* statement, size_t index, bool value) {
+    return bind_parameter(statement, index, value_boolean(value));
+}
+
+bool shade_bind_string(ShadeStatement* statement, size_t index, const char* value) {
+    if (!value) {
+        set_error("Invalid parameters");
+        return false;
+    }
+    
+    Value string = value_string(value);
+    if (!string.data.string) {
+        set_error("Memory allocation failed");
+        return false;
+    }
+    return bind_parameter(statement, index, string);
+}
+
+ShadeQueryResult* shade_execute(ShadeStatement* statement) {
+    if (!statement) {
+        set_error("Invalid parameters");
+        return NULL;
+    }
+    
+    ShadeDB* db = statement->db;
+    char error[PARSER_ERROR_SIZE];
+    PreparedStatement* current = statement_refresh(db->statements, db->storage, statement->prepared,
+                                                   error, sizeof(error));
+    if (!current) {
+        set_error(error);
+        return NULL;
+    }
+    
+    statement->prepared = current;
+    return execute_statement(db, current, statement->parameters);
+}
+
+void shade_finalize(ShadeStatement* statement) {
+    if (!statement) return;
+    
+    statement_release(statement->prepared);
+    if (statement->parameters) destroy_value_array(statement->parameters, statement->parameter_count);
+    free(statement);
+}
+
+bool shade_statement_cache_stats(ShadeDB* db, size_t* hits, size_t* misses) {
+    if (!db) {
+        set_error("Invalid parameters");
+        return false;
+    }
+    
+    if (hits) *hits = db->statements->hits;
+    if (misses) *misses = db->statements->misses;
+    return true;
+}
+
+bool shade_set_profile_sampling(ShadeDB* db, unsigned int every) {
+    if (!db) {
+        set_error("Invalid parameters");
+        return false;
+    }
+    
+    db->profile_every = every;
+    db->query_count = 0;
+    return true;
+}
+
+const char* shade_last_profile(ShadeDB* db) {
+    return db ? db->last_profile : NULL;
+}
+
 bool shade_delete(ShadeDB* db, const char* table_name, uint64_t id) {
     if (!db || !table_name) {
         set_error("Invalid parameters");
         return false;
     }
     
-    bool success = execute_delete_simple(db->storage, table_name, id);
+    ShadeTable* table = shade_table_open(db, table_name);
+    if (!table) return false;
+    
+    return shade_table_delete(table, id);
+}
+
+bool shade_table_delete(ShadeTable* handle, uint64_t id) {
+    if (!handle) {
+        set_error("Invalid parameters");
+        return false;
+    }
+    
+    bool success = memory_table_delete((MemoryTable*)handle, id, time(NULL));
     if (!success) {
         set_error("Record not found or already deleted");
     }
@@ -259,7 +851,19 @@ bool shade_resurrect(ShadeDB* db, const char* table_name, uint64_t id) {
         return false;
     }
     
-    bool success = resurrect_ghost(db->storage, table_name, id);
+    ShadeTable* table = shade_table_open(db, table_name);
+    if (!table) return false;
+    
+    return shade_table_resurrect(table, id);
+}
+
+bool shade_table_resurrect(ShadeTable* handle, uint64_t id) {
+    if (!handle) {
+        set_error("Invalid parameters");
+        return false;
+    }
+    
+    bool success = resurrect_table_ghost((MemoryTable*)handle, id);
     if (!success) {
         set_error("Ghost not found or resurrection failed");
     }
@@ -277,6 +881,68 @@ bool shade_decay_ghosts(ShadeDB* db, float amount) {
     return true;
 }
 
+bool shade_analyze(ShadeDB* db, const char* table_name) {
+    if (!db) {
+        set_error("Invalid parameters");
+        return false;
+    }
+
+    if (table_name) {
+        ShadeTable* table = shade_table_open(db, table_name);
+        if (!table) return false;
+        if (!memory_table_analyze((MemoryTable*)table)) {
+            set_error("Failed to analyze table");
+            return false;
+        }
+        return true;
+    }
+
+    for (size_t i = 0; i < db->storage->table_count; i++) {
+        if (!memory_table_analyze(db->storage->tables[i])) {
+            set_error("Failed to analyze table");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool shade_table_row_counts(ShadeDB* db, const char* table_name, size_t* living_count,
+                            size_t* ghost_count, size_t* exorcised_count) {
+    if (!db || !table_name) {
+        set_error("Invalid parameters");
+        return false;
+    }
+
+    MemoryTable* table = (MemoryTable*)shade_table_open(db, table_name);
+    if (!table) return false;
+
+    if (living_count) *living_count = table->stats->living_count;
+    if (ghost_count) *ghost_count = table->stats->ghost_count;
+    if (exorcised_count) *exorcised_count = table->stats->exorcised_count;
+    return true;
+}
+
+bool shade_column_stats(ShadeDB* db, const char* table_name, size_t col, size_t* null_count,
+                        double* distinct_estimate, size_t* histogram_buckets) {
+    if (!db || !table_name) {
+        set_error("Invalid parameters");
+        return false;
+    }
+
+    MemoryTable* table = (MemoryTable*)shade_table_open(db, table_name);
+    if (!table) return false;
+    if (col >= table->stats->column_count) {
+        set_error("Column index out of range");
+        return false;
+    }
+
+    const ColumnStats* column = &table->stats->columns[col];
+    if (null_count) *null_count = column->null_count;
+    if (distinct_estimate) *distinct_estimate = column_stats_distinct(column);
+    if (histogram_buckets) *histogram_buckets = column->bucket_count;
+    return true;
+}
+
 ShadeQueryResult* shade_get_ghost_stats(ShadeDB* db) {
     if (!db) {
         set_error("Invalid parameters");
@@ -417,69 +1083,210 @@ size_t shade_result_count(ShadeQueryResult* result) {
     return result->internal_result->count;
 }
 
+static const TableSchema* result_schema(ShadeQueryResult* result) {
+    if (!result || !result->internal_result) return NULL;
+    return result->internal_result->schema;
+}
+
+static bool result_column(ShadeQueryResult* result, size_t col, size_t* out_column) {
+    const TableSchema* schema = result_schema(result);
+    if (!schema) return false;
+    
+    QueryResult* internal = result->internal_result;
+    if (!internal->column_map) {
+        if (col >= schema->column_count) return false;
+        *out_column = col;
+        return true;
+    }
+    
+    if (col >= internal->column_count) return false;
+    *out_column = internal->column_map[col];
+    return true;
+}
+
 size_t shade_result_column_count(ShadeQueryResult* result) {
-    if (!result || !result->table) return 0;
-    return result->table->schema->column_count;
+    const TableSchema* schema = result_schema(result);
+    if (!schema) return 0;
+    if (result->internal_result->column_map) {
+        return result->internal_result->column_count;
+    }
+    return schema->column_count;
 }
 
 const char* shade_result_column_name(ShadeQueryResult* result, size_t col) {
-    if (!result || !result->table) return NULL;
-    if (col >= result->table->schema->column_count) return NULL;
-    return result->table->schema->columns[col].name;
+    size_t column;
+    if (!result_column(result, col, &column)) return NULL;
+    return result_schema(result)->columns[column].name;
 }
 
 const char* shade_result_column_type(ShadeQueryResult* result, size_t col) {
-    if (!result || !result->table) return NULL;
-    if (col >= result->table->schema->column_count) return NULL;
-    return type_to_string(result->table->schema->columns[col].type);
+    size_t column;
+    if (!result_column(result, col, &column)) return NULL;
+    return type_to_string(result_schema(result)->columns[column].type);
 }
 
 static Value* get_value_checked(ShadeQueryResult* result, size_t row, size_t col) {
-    if (!result || !result->internal_result || !result->table) return NULL;
+    size_t column;
+    if (!result_column(result, col, &column)) return NULL;
     if (row >= result->internal_result->count) return NULL;
-    if (col >= result->table->schema->column_count) return NULL;
     
     DataRecord* record = result->internal_result->records[row];
-    return &record->values[col];
+    return &record->values[column];
 }
 
-bool shade_get_int(ShadeQueryResult* result, size_t row, size_t col, int64_t* out_value) {
-    Value* value = get_value_checked(result, row, col);
+static bool read_int(const Value* value, int64_t* out_value) {
     if (!value || value->type != VALUE_INTEGER) return false;
     
     if (out_value) *out_value = value->data.integer;
     return true;
 }
 
-bool shade_get_float(ShadeQueryResult* result, size_t row, size_t col, double* out_value) {
-    Value* value = get_value_checked(result, row, col);
+static bool read_float(const Value* value, double* out_value) {
     if (!value || value->type != VALUE_FLOAT) return false;
     
     if (out_value) *out_value = value->data.float_val;
     return true;
 }
 
-bool shade_get_bool(ShadeQueryResult* result, size_t row, size_t col, bool* out_value) {
-    Value* value = get_value_checked(result, row, col);
+static bool read_bool(const Value* value, bool* out_value) {
     if (!value || value->type != VALUE_BOOLEAN) return false;
     
     if (out_value) *out_value = value->data.boolean;
     return true;
 }
 
-bool shade_get_string(ShadeQueryResult* result, size_t row, size_t col, const char** out_value) {
-    Value* value = get_value_checked(result, row, col);
+static bool read_string(const Value* value, const char** out_value) {
     if (!value || value->type != VALUE_STRING) return false;
     
     if (out_value) *out_value = value->data.string;
     return true;
 }
 
+bool shade_get_int(ShadeQueryResult* result, size_t row, size_t col, int64_t* out_value) {
+    return read_int(get_value_checked(result, row, col), out_value);
+}
+
+bool shade_get_float(ShadeQueryResult* result, size_t row, size_t col, double* out_value) {
+    return read_float(get_value_checked(result, row, col), out_value);
+}
+
+bool shade_get_bool(ShadeQueryResult* result, size_t row, size_t col, bool* out_value) {
+    return read_bool(get_value_checked(result, row, col), out_value);
+}
+
+bool shade_get_string(ShadeQueryResult* result, size_t row, size_t col, const char** out_value) {
+    return read_string(get_value_checked(result, row, col), out_value);
+}
+
 bool shade_is_null(ShadeQueryResult* result, size_t row, size_t col) {
     Value* value = get_value_checked(result, row, col);
     return value && value->type == VALUE_NULL;
 }
 
+static size_t column_range_checked(ShadeQueryResult* result, size_t* col, ValueType type,
+                                   size_t start_row, size_t row_count, DataRecord*** out_records) {
+    if (!result_schema(result)) {
+        set_error("Invalid parameters");
+        return 0;
+    }
+    if (!result_column(result, *col, col)) {
+        set_error("Column index out of range");
+        return 0;
+    }
+    if (result_schema(result)->columns[*col].type != type) {
+        set_error("Column type mismatch");
+        return 0;
+    }
+    if (start_row >= result->internal_result->count) return 0;
+    
+    size_t available = result->internal_result->count - start_row;
+    *out_records = result->internal_result->records + start_row;
+    return row_count < available ? row_count : available;
+}
+
+size_t shade_get_int_column(ShadeQueryResult* result, size_t col, size_t start_row, size_t row_count,
+                            int64_t* out_values, uint8_t* out_validity) {
+    DataRecord** records = NULL;
+    size_t count = column_range_checked(result, &col, VALUE_INTEGER, start_row, row_count, &records);
+    if (count == 0 || !out_values) return 0;
+    
+    gather_int_column(records, count, col, out_values, out_validity);
+    return count;
+}
+
+size_t shade_get_float_column(ShadeQueryResult* result, size_t col, size_t start_row, size_t row_count,
+                              double* out_values, uint8_t* out_validity) {
+    DataRecord** records = NULL;
+    size_t count = column_range_checked(result, &col, VALUE_FLOAT, start_row, row_count, &records);
+    if (count == 0 || !out_values) return 0;
+    
+    gather_float_column(records, count, col, out_values, out_validity);
+    return count;
+}
+
+size_t shade_get_bool_column(ShadeQueryResult* result, size_t col, size_t start_row, size_t row_count,
+                             bool* out_values, uint8_t* out_validity) {
+    DataRecord** records = NULL;
+    size_t count = column_range_checked(result, &col, VALUE_BOOLEAN, start_row, row_count, &records);
+    if (count == 0 || !out_values) return 0;
+    
+    gather_bool_column(records, count, col, out_values, out_validity);
+    return count;
+}
+
+size_t shade_get_string_column(ShadeQueryResult* result, size_t col, size_t start_row, size_t row_count,
+                               const char** out_values, uint8_t* out_validity) {
+    DataRecord** records = NULL;
+    size_t count = column_range_checked(result, &col, VALUE_STRING, start_row, row_count, &records);
+    if (count == 0 || !out_values) return 0;
+    
+    gather_string_column(records, count, col, out_values, out_validity);
+    return count;
+}
+
+size_t shade_get_state_column(ShadeQueryResult* result, size_t start_row, size_t row_count,
+                              uint8_t* out_ghost_bitmap, float* out_strengths) {
+    if (!result || !result->internal_result) {
+        set_error("Invalid parameters");
+        return 0;
+    }
+    if (start_row >= result->internal_result->count) return 0;
+    
+    size_t available = result->internal_result->count - start_row;
+    size_t count = row_count < available ? row_count : available;
+    
+    gather_state_column(result->internal_result->records + start_row, count,
+                        out_ghost_bitmap, out_strengths);
+    return count;
+}
+
+bool shade_result_export_arrow(ShadeQueryResult* result, struct ArrowSchema* out_schema, 
+                               struct ArrowArray* out_array) {
+    if (!result_schema(result) || !out_schema || !out_array) {
+        set_error("Invalid parameters");
+        return false;
+    }
+    
+    QueryResult* internal = result->internal_result;
+    if (!arrow_export_records(internal->records, internal->count, internal->schema,
+                              internal->column_map, internal->column_count, out_schema, out_array)) {
+        set_error("Arrow export failed");
+        return false;
+    }
+    
+    return true;
+}
+
+bool shade_table_export_arrow(ShadeDB* db, const char* table_name, bool include_ghosts,
+                              struct ArrowSchema* out_schema, struct ArrowArray* out_array) {
+    ShadeQueryResult* result = shade_select(db, table_name, include_ghosts);
+    if (!result) return false;
+    
+    bool success = shade_result_export_arrow(result, out_schema, out_array);
+    shade_free_result(result);
+    return success;
+}
+
 void shade_free_result(ShadeQueryResult* result) {
     if (!result) return;
     
@@ -500,6 +1307,123 @@ void shade_free_result(ShadeQueryResult* result) {
     free(result);
 }
 
+ShadeCursor* shade_cursor_open(ShadeDB* db, const char* table_name, 
+                               bool include_ghosts, size_t batch_size) {
+    if (!db || !table_name) {
+        set_error("Invalid parameters");
+        return NULL;
+    }
+    
+    ShadeTable* table = shade_table_open(db, table_name);
+    if (!table) return NULL;
+    
+    return shade_table_cursor_open(table, include_ghosts, batch_size);
+}
+
+ShadeCursor* shade_table_cursor_open(ShadeTable* handle, bool include_ghosts, size_t batch_size) {
+    if (!handle) {
+        set_error("Invalid parameters");
+        return NULL;
+    }
+    
+    ShadeCursor* cursor = malloc(sizeof(ShadeCursor));
+    if (!cursor) {
+        set_error("Memory allocation failed");
+        return NULL;
+    }
+    
+    cursor->batch_size = batch_size ? batch_size : DEFAULT_CURSOR_BATCH_SIZE;
+    cursor->batch_count = 0;
+    cursor->batch_position = 0;
+    cursor->current = NULL;
+    cursor->scan = NULL;
+    cursor->batch = malloc(sizeof(DataRecord*) * cursor->batch_size);
+    cursor->query = query_create(QUERY_SELECT, NULL);
+    
+    if (!cursor->batch || !cursor->query) {
+        shade_cursor_close(cursor);
+        set_error("Memory allocation failed");
+        return NULL;
+    }
+    
+    cursor->query->include_ghosts = include_ghosts;
+    
+    cursor->scan = query_cursor_open_table((MemoryTable*)handle, cursor->query);
+    if (!cursor->scan) {
+        shade_cursor_close(cursor);
+        set_error("Query failed");
+        return NULL;
+    }
+    
+    return cursor;
+}
+
+bool shade_cursor_next(ShadeCursor* cursor) {
+    if (!cursor) return false;
+    
+    while (cursor->batch_position >= cursor->batch_count) {
+        if (query_cursor_finished(cursor->scan)) {
+            cursor->current = NULL;
+            return false;
+        }
+        cursor->batch_count = query_cursor_fetch(cursor->scan, cursor->batch, cursor->batch_size);
+        cursor->batch_position = 0;
+    }
+    
+    cursor->current = cursor->batch[cursor->batch_position++];
+    return true;
+}
+
+size_t shade_cursor_column_count(ShadeCursor* cursor) {
+    if (!cursor) return 0;
+    return cursor->scan->table->schema->column_count;
+}
+
+uint64_t shade_cursor_row_id(ShadeCursor* cursor) {
+    if (!cursor || !cursor->current) return 0;
+    return cursor->current->id;
+}
+
+bool shade_cursor_is_ghost(ShadeCursor* cursor) {
+    return cursor && cursor->current && cursor->current->state == DATA_STATE_GHOST;
+}
+
+static Value* cursor_value_checked(ShadeCursor* cursor, size_t col) {
+    if (!cursor || !cursor->current) return NULL;
+    if (col >= cursor->current->value_count) return NULL;
+    return &cursor->current->values[col];
+}
+
+bool shade_cursor_get_int(ShadeCursor* cursor, size_t col, int64_t* out_value) {
+    return read_int(cursor_value_checked(cursor, col), out_value);
+}
+
+bool shade_cursor_get_float(ShadeCursor* cursor, size_t col, double* out_value) {
+    return read_float(cursor_value_checked(cursor, col), out_value);
+}
+
+bool shade_cursor_get_bool(ShadeCursor* cursor, size_t col, bool* out_value) {
+    return read_bool(cursor_value_checked(cursor, col), out_value);
+}
+
+bool shade_cursor_get_string(ShadeCursor* cursor, size_t col, const char** out_value) {
+    return read_string(cursor_value_checked(cursor, col), out_value);
+}
+
+bool shade_cursor_is_null(ShadeCursor* cursor, size_t col) {
+    Value* value = cursor_value_checked(cursor, col);
+    return value && value->type == VALUE_NULL;
+}
+
+void shade_cursor_close(ShadeCursor* cursor) {
+    if (!cursor) return;
+    
+    query_cursor_close(cursor->scan);
+    query_destroy(cursor->query);
+    free(cursor->batch);
+    free(cursor);
+}
+
 const char* shade_get_error(void) {
     return last_error;
 }
@@ -5,9 +5,15 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "storage/memory.h"
+#include "storage/copy.h"
 #include "types/schema.h"
 #include "types/value.h"
 #include "query/executor.h"
+#include "query/export.h"
+#include "query/parser.h"
+#include "query/batch.h"
+#include "query/statement.h"
+#include "api/arrow.h"
 #include "ghost/analytics.h"
 #include "ghost/lifecycle.h"
 
@@ -16,6 +22,9 @@ typedef struct ShadeTable ShadeTable;
 typedef struct ShadeGhostTableStats ShadeGhostTableStats;
 typedef struct ShadeGhostStatsResult ShadeGhostStatsResult;
 typedef struct ShadeQueryResult ShadeQueryResult;
+typedef struct ShadeCursor ShadeCursor;
+typedef struct ShadeInsert ShadeInsert;
+typedef struct ShadeStatement ShadeStatement;
 
 ShadeDB* shade_db_create(void);
 void shade_db_destroy(ShadeDB* db);
@@ -28,12 +37,71 @@ bool shade_drop_table(ShadeDB* db, const char* name);
 
 uint64_t shade_insert(ShadeDB* db, const char* table_name, 
                      const void** values, size_t value_count);
+uint64_t shade_insert_batch(ShadeDB* db, const char* table_name, const void** values,
+                           size_t value_count, size_t row_count);
+/* format is "csv", "ndjson", or NULL to pick by file extension. */
+bool shade_copy_from(ShadeDB* db, const char* table_name, const char* path,
+                     const char* format, size_t* rows_loaded);
+bool shade_copy_to(ShadeDB* db, const char* table_name, const char* path,
+                   const char* format, bool include_ghosts, size_t* rows_written);
 ShadeQueryResult* shade_select(ShadeDB* db, const char* table_name, 
                               bool include_ghosts);
+ShadeQueryResult* shade_select_where(ShadeDB* db, const char* table_name,
+                                    const char* where, bool include_ghosts);
+/* Runs a SELECT or DELETE statement; DELETE results hold the records that became ghosts.
+ * EXPLAIN [ANALYZE] statements return their plan as rows of one "QUERY PLAN" column. */
+ShadeQueryResult* shade_query(ShadeDB* db, const char* sql);
+/* Profiles every `every`-th shade_query or shade_execute call as EXPLAIN ANALYZE would, keeping
+ * the text of the latest; 0 turns sampling off. The text stays valid until the next sampled query. */
+bool shade_set_profile_sampling(ShadeDB* db, unsigned int every);
+const char* shade_last_profile(ShadeDB* db);
+
+/* Statements are parsed and bound once, then cached by their text so shade_query and later
+ * prepares of the same text skip that work. `?` placeholders in the WHERE clause are numbered
+ * from 0 in order and must all be bound before each execute; values persist between executes.
+ * Dropping a table re-prepares affected statements on their next execute. */
+ShadeStatement* shade_prepare(ShadeDB* db, const char* sql);
+size_t shade_statement_param_count(ShadeStatement* statement);
+bool shade_bind_int(ShadeStatement* statement, size_t index, int64_t value);
+bool shade_bind_float(ShadeStatement* statement, size_t index, double value);
+bool shade_bind_bool(ShadeStatement* statement, size_t index, bool value);
+bool shade_bind_string(ShadeStatement* statement, size_t index, const char* value);
+ShadeQueryResult* shade_execute(ShadeStatement* statement);
+void shade_finalize(ShadeStatement* statement);
+bool shade_statement_cache_stats(ShadeDB* db, size_t* hits, size_t* misses);
 bool shade_delete(ShadeDB* db, const char* table_name, uint64_t id);
 bool shade_resurrect(ShadeDB* db, const char* table_name, uint64_t id);
 
+/* Table handles stay valid until the table is dropped or the database destroyed. */
+ShadeTable* shade_table_open(ShadeDB* db, const char* name);
+const char* shade_table_name(ShadeTable* table);
+uint64_t shade_table_insert(ShadeTable* table, const void** values, size_t value_count);
+uint64_t shade_table_insert_batch(ShadeTable* table, const void** values, 
+                                 size_t value_count, size_t row_count);
+ShadeQueryResult* shade_table_select(ShadeTable* table, bool include_ghosts);
+ShadeQueryResult* shade_table_select_where(ShadeTable* table, const char* where, bool include_ghosts);
+bool shade_table_delete(ShadeTable* table, uint64_t id);
+bool shade_table_resurrect(ShadeTable* table, uint64_t id);
+ShadeInsert* shade_insert_prepare(ShadeTable* table);
+bool shade_insert_bind_int(ShadeInsert* insert, size_t col, int64_t value);
+bool shade_insert_bind_float(ShadeInsert* insert, size_t col, double value);
+bool shade_insert_bind_bool(ShadeInsert* insert, size_t col, bool value);
+bool shade_insert_bind_string(ShadeInsert* insert, size_t col, const char* value);
+/* Adopts a malloc'd buffer on success; the caller keeps it if the bind fails. */
+bool shade_insert_bind_string_move(ShadeInsert* insert, size_t col, char* buffer);
+bool shade_insert_bind_null(ShadeInsert* insert, size_t col);
+uint64_t shade_insert_execute(ShadeInsert* insert);
+void shade_insert_finalize(ShadeInsert* insert);
+
+ShadeCursor* shade_table_cursor_open(ShadeTable* table, bool include_ghosts, size_t batch_size);
+
 bool shade_decay_ghosts(ShadeDB* db, float amount);
+/* Recomputes planner statistics for one table, or every table when table_name is NULL. */
+bool shade_analyze(ShadeDB* db, const char* table_name);
+bool shade_table_row_counts(ShadeDB* db, const char* table_name, size_t* living_count,
+                            size_t* ghost_count, size_t* exorcised_count);
+bool shade_column_stats(ShadeDB* db, const char* table_name, size_t col, size_t* null_count,
+                        double* distinct_estimate, size_t* histogram_buckets);
 ShadeQueryResult* shade_get_ghost_stats(ShadeDB* db);
 
 bool shade_ghost_stats_get_table_stats(ShadeQueryResult* result, size_t table_index, size_t* living_count, size_t* ghost_count, size_t* exorcised_count, float* ghost_ratio, float* avg_strength);
@@ -54,8 +122,39 @@ bool shade_get_string(ShadeQueryResult* result, size_t row, size_t col, const ch
 
 bool shade_is_null(ShadeQueryResult* result, size_t row, size_t col);
 
+size_t shade_get_int_column(ShadeQueryResult* result, size_t col, size_t start_row, size_t row_count,
+                            int64_t* out_values, uint8_t* out_validity);
+size_t shade_get_float_column(ShadeQueryResult* result, size_t col, size_t start_row, size_t row_count,
+                              double* out_values, uint8_t* out_validity);
+size_t shade_get_bool_column(ShadeQueryResult* result, size_t col, size_t start_row, size_t row_count,
+                             bool* out_values, uint8_t* out_validity);
+size_t shade_get_string_column(ShadeQueryResult* result, size_t col, size_t start_row, size_t row_count,
+                               const char** out_values, uint8_t* out_validity);
+size_t shade_get_state_column(ShadeQueryResult* result, size_t start_row, size_t row_count,
+                              uint8_t* out_ghost_bitmap, float* out_strengths);
+
+bool shade_result_export_arrow(ShadeQueryResult* result, struct ArrowSchema* out_schema, 
+                               struct ArrowArray* out_array);
+bool shade_table_export_arrow(ShadeDB* db, const char* table_name, bool include_ghosts,
+                              struct ArrowSchema* out_schema, struct ArrowArray* out_array);
+
 void shade_free_result(ShadeQueryResult* result);
 
+ShadeCursor* shade_cursor_open(ShadeDB* db, const char* table_name, 
+                               bool include_ghosts, size_t batch_size);
+bool shade_cursor_next(ShadeCursor* cursor);
+size_t shade_cursor_column_count(ShadeCursor* cursor);
+uint64_t shade_cursor_row_id(ShadeCursor* cursor);
+bool shade_cursor_is_ghost(ShadeCursor* cursor);
+
+bool shade_cursor_get_int(ShadeCursor* cursor, size_t col, int64_t* out_value);
+bool shade_cursor_get_float(ShadeCursor* cursor, size_t col, double* out_value);
+bool shade_cursor_get_bool(ShadeCursor* cursor, size_t col, bool* out_value);
+bool shade_cursor_get_string(ShadeCursor* cursor, size_t col, const char** out_value);
+bool shade_cursor_is_null(ShadeCursor* cursor, size_t col);
+
+void shade_cursor_close(ShadeCursor* cursor);
+
 const char* shade_get_error(void);
 void shade_clear_error(void);
 
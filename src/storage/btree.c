@@ -161,12 +161,14 @@ static bool btree_write_node(BTree* tree, BTreeNode* node) {
     long current_pos = ftell(tree->file);
     if (current_pos == -1) return false;
     
+    static const char zero_page[PAGE_SIZE];
     long bytes_written = current_pos - node_offset;
-    for (long i = bytes_written; i < PAGE_SIZE; i++) {
-        if (fputc(0, tree->file) == EOF) return false;
+    if (bytes_written < PAGE_SIZE) {
+        size_t padding = (size_t)(PAGE_SIZE - bytes_written);
+        if (fwrite(zero_page, 1, padding, tree->file) != padding) return false;
     }
     
-    if (fflush(tree->file) != 0) return false;
+    if (!tree->defer_flush && fflush(tree->file) != 0) return false;
     node->is_dirty = false;
     
     return true;
@@ -180,6 +182,7 @@ static BTreeNode* btree_read_node(BTree* tree, uint32_t node_id) {
     
     BTreeNodeHeader header;
     if (fread(&header, sizeof(BTreeNodeHeader), 1, tree->file) != 1) return NULL;
+    tree->pages_read++;
     
     BTreeNode* node = malloc(sizeof(BTreeNode));
     if (!node) return NULL;
@@ -291,6 +294,8 @@ BTree* btree_create(const char* filename, uint32_t order) {
     
     tree->order = order ? order : DEFAULT_BTREE_ORDER;
     tree->next_node_id = 1;
+    tree->defer_flush = false;
+    tree->pages_read = 0;
     tree->filename = string_duplicate(filename);
     if (!tree->filename) {
         free(tree);
@@ -331,6 +336,8 @@ BTree* btree_open(const char* filename) {
     if (!tree) return NULL;
     
     tree->filename = string_duplicate(filename);
+    tree->defer_flush = false;
+    tree->pages_read = 0;
     if (!tree->filename) {
         free(tree);
         return NULL;
@@ -382,6 +389,8 @@ bool btree_split_child(BTree* tree, BTreeNode* parent, int index, BTreeNode* chi
     if (!new_child) return false;
 
     uint32_t mid;
+    uint32_t old_key_count = child->key_count;
+    Value promote_key;
     if (child->type == BTREE_NODE_INTERNAL) {
         mid = tree->order / 2;
         
@@ -393,9 +402,7 @@ bool btree_split_child(BTree* tree, BTreeNode* parent, int index, BTreeNode* chi
             new_child->child_ids[i] = child->child_ids[mid + 1 + i];
         }
 
-        Value promote_key = value_clone(&child->keys[mid]);
-        parent->keys[index] = promote_key;
-
+        promote_key = value_clone(&child->keys[mid]);
         child->key_count = mid;
 
     } else {
@@ -409,19 +416,17 @@ bool btree_split_child(BTree* tree, BTreeNode* parent, int index, BTreeNode* chi
             new_child->record_ids[i] = child->record_ids[mid + i];
         }
 
-        Value promote_key = value_clone(&child->keys[mid]);
-        parent->keys[index] = promote_key;
+        promote_key = value_clone(&child->keys[mid]);
 
         new_child->next_leaf = child->next_leaf;
         child->next_leaf = new_child->id;
 
-        uint32_t old_key_count = child->key_count;
         child->key_count = mid;
         child->record_count = mid;
+    }
 
-        for (uint32_t i = mid; i < old_key_count; i++) {
-            value_destroy(&child->keys[i]);
-        }
+    for (uint32_t i = mid; i < old_key_count; i++) {
+        value_destroy(&child->keys[i]);
     }
 
     for (int i = parent->key_count; i > index; i--) {
@@ -431,6 +436,7 @@ bool btree_split_child(BTree* tree, BTreeNode* parent, int index, BTreeNode* chi
         parent->child_ids[i] = parent->child_ids[i - 1];
     }
 
+    parent->keys[index] = promote_key;
     parent->child_ids[index + 1] = new_child->id;
     parent->key_count++;
 
@@ -538,6 +544,58 @@ bool btree_insert(BTree* tree, const Value* key, uint64_t record_id) {
     }
 }
 
+typedef struct {
+    const Value* key;
+    uint64_t record_id;
+} BTreeBatchEntry;
+
+static int compare_batch_entries(const void* a, const void* b) {
+    const BTreeBatchEntry* left = a;
+    const BTreeBatchEntry* right = b;
+    int cmp = value_compare(left->key, right->key);
+    if (cmp != 0) return cmp;
+    return (left->record_id > right->record_id) - (left->record_id < right->record_id);
+}
+
+void btree_begin_batch(BTree* tree) {
+    if (tree) tree->defer_flush = true;
+}
+
+bool btree_end_batch(BTree* tree) {
+    if (!tree) return false;
+    
+    tree->defer_flush = false;
+    return btree_write_header(tree);
+}
+
+bool btree_insert_batch(BTree* tree, const Value* const* keys, const uint64_t* record_ids, size_t count) {
+    if (!tree || (!keys && count > 0) || (!record_ids && count > 0)) return false;
+    if (count == 0) return true;
+    
+    BTreeBatchEntry* entries = malloc(sizeof(BTreeBatchEntry) * count);
+    if (!entries) return false;
+    
+    for (size_t i = 0; i < count; i++) {
+        entries[i].key = keys[i];
+        entries[i].record_id = record_ids[i];
+    }
+    qsort(entries, count, sizeof(BTreeBatchEntry), compare_batch_entries);
+    
+    bool was_deferred = tree->defer_flush;
+    tree->defer_flush = true;
+    
+    bool success = true;
+    for (size_t i = 0; i < count && success; i++) {
+        success = btree_insert(tree, entries[i].key, entries[i].record_id);
+    }
+    
+    tree->defer_flush = was_deferred;
+    if (!was_deferred && !btree_write_header(tree)) success = false;
+    
+    free(entries);
+    return success;
+}
+
 bool btree_search(BTree* tree, const Value* key, uint64_t** record_ids, uint32_t* count) {
     if (!tree || !key || !record_ids || !count) return false;
     
@@ -634,6 +692,79 @@ void btree_free_results(uint64_t* results) {
     free(results);
 }
 
+/* Reads the page and then its first or last child down to a leaf, pushing each on the path. */
+static bool cursor_descend(BTreeCursor* cursor, uint32_t node_id) {
+    while (true) {
+        BTreeNode* node = cursor->depth < BTREE_CURSOR_MAX_DEPTH ? btree_read_node(cursor->tree, node_id) : NULL;
+        if (!node) {
+            cursor->failed = true;
+            return false;
+        }
+
+        uint32_t depth = cursor->depth++;
+        cursor->path[depth] = node;
+        if (node->type == BTREE_NODE_LEAF) {
+            cursor->slots[depth] = cursor->descending ? node->record_count : 0;
+            return true;
+        }
+
+        cursor->slots[depth] = cursor->descending ? node->key_count : 0;
+        node_id = node->child_ids[cursor->slots[depth]];
+    }
+}
+
+bool btree_cursor_open(BTree* tree, bool descending, BTreeCursor* cursor) {
+    if (!tree || !cursor) return false;
+
+    cursor->tree = tree;
+    cursor->descending = descending;
+    cursor->failed = false;
+    cursor->depth = 0;
+    if (cursor_descend(cursor, tree->root_node_id)) return true;
+
+    btree_cursor_close(cursor);
+    return false;
+}
+
+bool btree_cursor_next(BTreeCursor* cursor, uint64_t* record_id) {
+    while (cursor->depth > 0 && !cursor->failed) {
+        uint32_t depth = cursor->depth - 1;
+        BTreeNode* node = cursor->path[depth];
+        uint32_t* slot = &cursor->slots[depth];
+
+        if (node->type == BTREE_NODE_LEAF) {
+            if (!cursor->descending && *slot < node->record_count) {
+                *record_id = node->record_ids[(*slot)++];
+                return true;
+            }
+            if (cursor->descending && *slot > 0) {
+                *record_id = node->record_ids[--(*slot)];
+                return true;
+            }
+        } else if (!cursor->descending && *slot < node->key_count) {
+            (*slot)++;
+            cursor_descend(cursor, node->child_ids[*slot]);
+            continue;
+        } else if (cursor->descending && *slot > 0) {
+            (*slot)--;
+            cursor_descend(cursor, node->child_ids[*slot]);
+            continue;
+        }
+
+        btree_node_destroy(node);
+        cursor->depth--;
+    }
+    return false;
+}
+
+void btree_cursor_close(BTreeCursor* cursor) {
+    if (!cursor) return;
+
+    while (cursor->depth > 0) {
+        btree_node_destroy(cursor->path[--cursor->depth]);
+    }
+}
+
 uint32_t btree_get_height(BTree* tree) {
     if (!tree) return 0;
     
@@ -44,6 +44,9 @@ typedef struct BTree {
     uint32_t order;
     char* filename;
     FILE* file;
+    bool defer_flush;
+    /* Nodes read from the file since the tree was opened. */
+    uint64_t pages_read;
 } BTree;
 
 typedef struct BTreeRange {
@@ -53,6 +56,19 @@ typedef struct BTreeRange {
     bool include_end;
 } BTreeRange;
 
+#define BTREE_CURSOR_MAX_DEPTH 32
+
+/* Walks the leaf entries in key order, either way, reading each page only once it is reached. Keeps
+ * the path from the root, so a walk that stops early has read height plus the leaves it visited. */
+typedef struct {
+    BTree* tree;
+    bool descending;
+    bool failed;
+    uint32_t depth;
+    BTreeNode* path[BTREE_CURSOR_MAX_DEPTH];
+    uint32_t slots[BTREE_CURSOR_MAX_DEPTH];
+} BTreeCursor;
+
 BTree* btree_create(const char* filename, uint32_t order);
 BTree* btree_open(const char* filename);
 bool btree_flush(BTree* tree);
@@ -60,6 +76,9 @@ void btree_close(BTree* tree);
 void btree_destroy(BTree* tree);
 
 bool btree_insert(BTree* tree, const Value* key, uint64_t record_id);
+bool btree_insert_batch(BTree* tree, const Value* const* keys, const uint64_t* record_ids, size_t count);
+void btree_begin_batch(BTree* tree);
+bool btree_end_batch(BTree* tree);
 bool btree_search(BTree* tree, const Value* key, uint64_t** record_ids, uint32_t* count);
 
 uint64_t* btree_scan_all(BTree* tree, uint32_t* result_count);
@@ -67,6 +86,11 @@ uint64_t* btree_range_query(BTree* tree, const BTreeRange* range, uint32_t* resu
 uint64_t* btree_find_ghosts(BTree* tree, float min_strength, uint32_t* count);
 void btree_free_results(uint64_t* results);
 
+bool btree_cursor_open(BTree* tree, bool descending, BTreeCursor* cursor);
+/* Returns false once every entry has been visited, or when a page cannot be read, which sets failed. */
+bool btree_cursor_next(BTreeCursor* cursor, uint64_t* record_id);
+void btree_cursor_close(BTreeCursor* cursor);
+
 uint32_t btree_get_height(BTree* tree);
 bool btree_validate(BTree* tree);
 
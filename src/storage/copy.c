@@ -0,0 +1,644 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "copy.h"
+#include "../util/parallel.h"
+#include "../util/string_utils.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define COPY_MIN_CHUNK_SIZE (256 * 1024)
+#define COPY_CHUNKS_PER_WORKER 4
+#define COPY_INITIAL_ROWS 1024
+
+typedef struct {
+    const char* start;
+    const char* end;
+    Value** rows;
+    size_t row_count;
+    size_t row_capacity;
+    size_t line_count;
+    size_t rejected;
+    size_t first_rejected_line;
+    char* scratch;
+    size_t scratch_capacity;
+    bool failed;
+} CopyChunk;
+
+typedef struct {
+    const TableSchema* schema;
+    CopyFormat format;
+    CopyChunk* chunks;
+} CopyJob;
+
+bool copy_format_parse(const char* name, CopyFormat* out_format) {
+    if (!name || !out_format) return false;
+
+    if (string_case_compare(name, "csv") == 0) {
+        *out_format = COPY_FORMAT_CSV;
+    } else if (string_case_compare(name, "ndjson") == 0 || string_case_compare(name, "jsonl") == 0) {
+        *out_format = COPY_FORMAT_NDJSON;
+    } else if (string_case_compare(name, "binary") == 0) {
+        *out_format = COPY_FORMAT_BINARY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+CopyFormat copy_format_for_path(const char* path) {
+    const char* extension = path ? strrchr(path, '.') : NULL;
+    if (extension && (string_case_compare(extension, ".ndjson") == 0 ||
+                      string_case_compare(extension, ".jsonl") == 0 ||
+                      string_case_compare(extension, ".json") == 0)) {
+        return COPY_FORMAT_NDJSON;
+    }
+    if (extension && string_case_compare(extension, ".bin") == 0) {
+        return COPY_FORMAT_BINARY;
+    }
+    return COPY_FORMAT_CSV;
+}
+
+static void set_copy_error(CopyStats* stats, const char* message, const char* detail) {
+    snprintf(stats->error, sizeof(stats->error), "%s%s%s", message, detail ? ": " : "", detail ? detail : "");
+}
+
+static bool scratch_reserve(CopyChunk* chunk, size_t length) {
+    if (length + 1 <= chunk->scratch_capacity) return true;
+
+    size_t capacity = chunk->scratch_capacity ? chunk->scratch_capacity : 256;
+    while (capacity < length + 1) capacity *= 2;
+
+    char* scratch = realloc(chunk->scratch, capacity);
+    if (!scratch) return false;
+
+    chunk->scratch = scratch;
+    chunk->scratch_capacity = capacity;
+    return true;
+}
+
+static bool convert_field(const char* text, size_t length, bool quoted, ValueType type, Value* out) {
+    if (length == 0 && !quoted) {
+        *out = value_null();
+        return true;
+    }
+
+    char* end = NULL;
+    switch (type) {
+        case VALUE_INTEGER: {
+            errno = 0;
+            long long parsed = strtoll(text, &end, 10);
+            if (errno != 0 || end != text + length || length == 0) return false;
+            *out = value_integer((int64_t)parsed);
+            return true;
+        }
+        case VALUE_FLOAT: {
+            errno = 0;
+            double parsed = strtod(text, &end);
+            if (errno == ERANGE || end != text + length || length == 0) return false;
+            *out = value_float(parsed);
+            return true;
+        }
+        case VALUE_BOOLEAN:
+            if (string_case_compare(text, "true") == 0 || string_case_compare(text, "t") == 0 ||
+                strcmp(text, "1") == 0) {
+                *out = value_boolean(true);
+            } else if (string_case_compare(text, "false") == 0 || string_case_compare(text, "f") == 0 ||
+                       strcmp(text, "0") == 0) {
+                *out = value_boolean(false);
+            } else {
+                return false;
+            }
+            return true;
+        case VALUE_STRING:
+            *out = value_string(text);
+            return out->data.string != NULL;
+        default:
+            *out = value_null();
+            return true;
+    }
+}
+
+static void destroy_row(Value* row, size_t column_count) {
+    for (size_t i = 0; i < column_count; i++) {
+        value_destroy(&row[i]);
+    }
+    free(row);
+}
+
+static Value* allocate_row(size_t column_count) {
+    Value* row = malloc(sizeof(Value) * column_count);
+    if (!row) return NULL;
+
+    for (size_t i = 0; i < column_count; i++) {
+        row[i] = value_null();
+    }
+    return row;
+}
+
+static const char* read_csv_field(CopyChunk* chunk, const char* p, const char* eol,
+                                  size_t* out_length, bool* out_quoted) {
+    size_t length = 0;
+    *out_quoted = false;
+    if (!scratch_reserve(chunk, 0)) return NULL;
+
+    while (p < eol && (*p == ' ' || *p == '\t')) p++;
+
+    if (p < eol && *p == '"') {
+        *out_quoted = true;
+        p++;
+        while (p < eol) {
+            if (*p == '"') {
+                if (p + 1 < eol && p[1] == '"') {
+                    if (!scratch_reserve(chunk, length + 1)) return NULL;
+                    chunk->scratch[length++] = '"';
+                    p += 2;
+                    continue;
+                }
+                p++;
+                break;
+            }
+            if (!scratch_reserve(chunk, length + 1)) return NULL;
+            chunk->scratch[length++] = *p++;
+        }
+        while (p < eol && *p != ',') p++;
+    } else {
+        const char* start = p;
+        while (p < eol && *p != ',') p++;
+
+        const char* end = p;
+        while (end > start && (end[-1] == ' ' || end[-1] == '\t')) end--;
+
+        length = (size_t)(end - start);
+        if (!scratch_reserve(chunk, length)) return NULL;
+        memcpy(chunk->scratch, start, length);
+    }
+
+    chunk->scratch[length] = '\0';
+    *out_length = length;
+    return p;
+}
+
+static bool csv_line_is_header(CopyChunk* chunk, const TableSchema* schema, const char* p, const char* eol) {
+    for (size_t i = 0; i < schema->column_count; i++) {
+        size_t length;
+        bool quoted;
+        p = read_csv_field(chunk, p, eol, &length, &quoted);
+        if (!p || string_case_compare(chunk->scratch, schema->columns[i].name) != 0) return false;
+        if (i + 1 < schema->column_count) {
+            if (p >= eol) return false;
+            p++;
+        }
+    }
+    return p >= eol;
+}
+
+static Value* parse_csv_line(CopyChunk* chunk, const TableSchema* schema, const char* p, const char* eol) {
+    Value* row = allocate_row(schema->column_count);
+    if (!row) {
+        chunk->failed = true;
+        return NULL;
+    }
+
+    for (size_t i = 0; i < schema->column_count; i++) {
+        size_t length;
+        bool quoted;
+
+        p = read_csv_field(chunk, p, eol, &length, &quoted);
+        if (!p) {
+            chunk->failed = true;
+            destroy_row(row, schema->column_count);
+            return NULL;
+        }
+
+        if (!convert_field(chunk->scratch, length, quoted, schema->columns[i].type, &row[i])) {
+            destroy_row(row, schema->column_count);
+            return NULL;
+        }
+
+        if (i + 1 < schema->column_count) {
+            if (p >= eol) {
+                destroy_row(row, schema->column_count);
+                return NULL;
+            }
+            p++;
+        }
+    }
+
+    if (p < eol) {
+        destroy_row(row, schema->column_count);
+        return NULL;
+    }
+
+    return row;
+}
+
+static const char* skip_json_space(const char* p, const char* eol) {
+    while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    return p;
+}
+
+static size_t encode_utf8(unsigned int codepoint, char* out) {
+    if (codepoint < 0x80) {
+        out[0] = (char)codepoint;
+        return 1;
+    }
+    if (codepoint < 0x800) {
+        out[0] = (char)(0xC0 | (codepoint >> 6));
+        out[1] = (char)(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    out[0] = (char)(0xE0 | (codepoint >> 12));
+    out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (codepoint & 0x3F));
+    return 3;
+}
+
+static const char* read_json_string(CopyChunk* chunk, const char* p, const char* eol, size_t* out_length) {
+    if (p >= eol || *p != '"') return NULL;
+    p++;
+
+    size_t length = 0;
+    while (p < eol && *p != '"') {
+        if (!scratch_reserve(chunk, length + 4)) {
+            chunk->failed = true;
+            return NULL;
+        }
+
+        if (*p != '\\') {
+            chunk->scratch[length++] = *p++;
+            continue;
+        }
+
+        if (++p >= eol) return NULL;
+        switch (*p) {
+            case 'n': chunk->scratch[length++] = '\n'; break;
+            case 't': chunk->scratch[length++] = '\t'; break;
+            case 'r': chunk->scratch[length++] = '\r'; break;
+            case 'b': chunk->scratch[length++] = '\b'; break;
+            case 'f': chunk->scratch[length++] = '\f'; break;
+            case 'u': {
+                if (eol - p < 5) return NULL;
+                unsigned int codepoint = 0;
+                for (int i = 1; i <= 4; i++) {
+                    char c = p[i];
+                    codepoint <<= 4;
+                    if (c >= '0' && c <= '9') codepoint |= (unsigned int)(c - '0');
+                    else if (c >= 'a' && c <= 'f') codepoint |= (unsigned int)(c - 'a' + 10);
+                    else if (c >= 'A' && c <= 'F') codepoint |= (unsigned int)(c - 'A' + 10);
+                    else return NULL;
+                }
+                length += encode_utf8(codepoint, chunk->scratch + length);
+                p += 4;
+                break;
+            }
+            default: chunk->scratch[length++] = *p; break;
+        }
+        p++;
+    }
+
+    if (p >= eol) return NULL;
+    chunk->scratch[length] = '\0';
+    *out_length = length;
+    return p + 1;
+}
+
+static int find_column(const TableSchema* schema, const char* name) {
+    for (size_t i = 0; i < schema->column_count; i++) {
+        if (strcmp(schema->columns[i].name, name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+static const char* read_json_value(CopyChunk* chunk, const char* p, const char* eol,
+                                   ValueType type, Value* out) {
+    if (p >= eol) return NULL;
+
+    if (*p == '"') {
+        size_t length;
+        p = read_json_string(chunk, p, eol, &length);
+        if (!p || type != VALUE_STRING) return NULL;
+        return convert_field(chunk->scratch, length, true, type, out) ? p : NULL;
+    }
+
+    const char* start = p;
+    while (p < eol && *p != ',' && *p != '}' && *p != ' ' && *p != '\t' && *p != '\r') p++;
+
+    size_t length = (size_t)(p - start);
+    if (!scratch_reserve(chunk, length)) {
+        chunk->failed = true;
+        return NULL;
+    }
+    memcpy(chunk->scratch, start, length);
+    chunk->scratch[length] = '\0';
+
+    if (strcmp(chunk->scratch, "null") == 0) {
+        *out = value_null();
+        return p;
+    }
+    if (type == VALUE_STRING) return NULL;
+    if (type == VALUE_BOOLEAN && strcmp(chunk->scratch, "true") != 0 && strcmp(chunk->scratch, "false") != 0) {
+        return NULL;
+    }
+
+    return convert_field(chunk->scratch, length, false, type, out) ? p : NULL;
+}
+
+static const char* skip_json_string(const char* p, const char* eol) {
+    for (p++; p < eol; p++) {
+        if (*p == '\\') {
+            p++;
+        } else if (*p == '"') {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+/* Steps over the value of a key the table has no column for: a string, a literal, or a whole
+ * array or object. */
+static const char* skip_json_value(const char* p, const char* eol) {
+    if (p >= eol) return NULL;
+    if (*p == '"') return skip_json_string(p, eol);
+
+    if (*p == '[' || *p == '{') {
+        size_t depth = 0;
+        while (p < eol) {
+            if (*p == '"') {
+                p = skip_json_string(p, eol);
+                if (!p) return NULL;
+                continue;
+            }
+            if (*p == '[' || *p == '{') {
+                depth++;
+            } else if ((*p == ']' || *p == '}') && --depth == 0) {
+                return p + 1;
+            }
+            p++;
+        }
+        return NULL;
+    }
+
+    const char* start = p;
+    while (p < eol && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\r') p++;
+    return p > start ? p : NULL;
+}
+
+static Value* parse_ndjson_line(CopyChunk* chunk, const TableSchema* schema, const char* p, const char* eol) {
+    p = skip_json_space(p, eol);
+    if (p >= eol || *p != '{') return NULL;
+    p = skip_json_space(p + 1, eol);
+
+    Value* row = allocate_row(schema->column_count);
+    if (!row) {
+        chunk->failed = true;
+        return NULL;
+    }
+
+    if (p < eol && *p == '}') {
+        if (skip_json_space(p + 1, eol) == eol) return row;
+        destroy_row(row, schema->column_count);
+        return NULL;
+    }
+
+    while (p < eol) {
+        size_t key_length;
+        p = read_json_string(chunk, p, eol, &key_length);
+        if (!p) break;
+
+        int column = find_column(schema, chunk->scratch);
+        p = skip_json_space(p, eol);
+        if (p >= eol || *p != ':') break;
+        p = skip_json_space(p + 1, eol);
+
+        if (column < 0) {
+            p = skip_json_value(p, eol);
+        } else {
+            value_destroy(&row[column]);
+            p = read_json_value(chunk, p, eol, schema->columns[column].type, &row[column]);
+        }
+        if (!p) break;
+
+        p = skip_json_space(p, eol);
+        if (p < eol && *p == ',') {
+            p = skip_json_space(p + 1, eol);
+            continue;
+        }
+        if (p < eol && *p == '}' && skip_json_space(p + 1, eol) == eol) {
+            return row;
+        }
+        break;
+    }
+
+    destroy_row(row, schema->column_count);
+    return NULL;
+}
+
+static bool chunk_append_row(CopyChunk* chunk, Value* row) {
+    if (chunk->row_count == chunk->row_capacity) {
+        size_t capacity = chunk->row_capacity ? chunk->row_capacity * 2 : COPY_INITIAL_ROWS;
+        Value** rows = realloc(chunk->rows, sizeof(Value*) * capacity);
+        if (!rows) return false;
+        chunk->rows = rows;
+        chunk->row_capacity = capacity;
+    }
+
+    chunk->rows[chunk->row_count++] = row;
+    return true;
+}
+
+static void parse_chunk(void* context, size_t index) {
+    CopyJob* job = context;
+    CopyChunk* chunk = &job->chunks[index];
+    const TableSchema* schema = job->schema;
+    const char* p = chunk->start;
+
+    while (p < chunk->end && !chunk->failed) {
+        const char* eol = memchr(p, '\n', (size_t)(chunk->end - p));
+        if (!eol) eol = chunk->end;
+
+        const char* next = eol < chunk->end ? eol + 1 : eol;
+        if (eol > p && eol[-1] == '\r') eol--;
+        chunk->line_count++;
+
+        const char* content = skip_json_space(p, eol);
+        if (content == eol) {
+            p = next;
+            continue;
+        }
+
+        if (job->format == COPY_FORMAT_CSV && index == 0 && chunk->line_count == 1 &&
+            csv_line_is_header(chunk, schema, p, eol)) {
+            p = next;
+            continue;
+        }
+
+        Value* row = job->format == COPY_FORMAT_CSV ?
+            parse_csv_line(chunk, schema, p, eol) :
+            parse_ndjson_line(chunk, schema, p, eol);
+
+        if (row) {
+            if (!chunk_append_row(chunk, row)) {
+                destroy_row(row, schema->column_count);
+                chunk->failed = true;
+            }
+        } else if (!chunk->failed) {
+            if (chunk->rejected++ == 0) {
+                chunk->first_rejected_line = chunk->line_count;
+            }
+        }
+
+        p = next;
+    }
+}
+
+static size_t split_chunks(const char* data, size_t length, CopyChunk* chunks, size_t max_chunks) {
+    size_t target = length / max_chunks;
+    if (target < COPY_MIN_CHUNK_SIZE) target = COPY_MIN_CHUNK_SIZE;
+
+    size_t count = 0;
+    const char* p = data;
+    const char* end = data + length;
+
+    while (p < end && count < max_chunks) {
+        const char* chunk_end = end;
+        if (count + 1 < max_chunks && (size_t)(end - p) > target) {
+            const char* newline = memchr(p + target, '\n', (size_t)(end - (p + target)));
+            chunk_end = newline ? newline + 1 : end;
+        }
+
+        memset(&chunks[count], 0, sizeof(CopyChunk));
+        chunks[count].start = p;
+        chunks[count].end = chunk_end;
+        count++;
+        p = chunk_end;
+    }
+
+    return count;
+}
+
+static void release_chunk(CopyChunk* chunk, size_t column_count) {
+    for (size_t i = 0; i < chunk->row_count; i++) {
+        destroy_row(chunk->rows[i], column_count);
+    }
+    free(chunk->rows);
+    free(chunk->scratch);
+    chunk->rows = NULL;
+    chunk->row_count = 0;
+}
+
+bool copy_from_buffer(MemoryTable* table, const char* data, size_t length, CopyFormat format, CopyStats* stats) {
+    CopyStats local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(CopyStats));
+
+    if (!table || (!data && length > 0)) {
+        set_copy_error(stats, "Invalid parameters", NULL);
+        return false;
+    }
+    if (format == COPY_FORMAT_BINARY) {
+        set_copy_error(stats, "Binary format is only supported for export", NULL);
+        return false;
+    }
+    if (length == 0) return true;
+    if (format == COPY_FORMAT_AUTO) format = COPY_FORMAT_CSV;
+
+    size_t max_chunks = parallel_worker_count() * COPY_CHUNKS_PER_WORKER;
+    CopyChunk* chunks = malloc(sizeof(CopyChunk) * max_chunks);
+    if (!chunks) {
+        set_copy_error(stats, "Memory allocation failed", NULL);
+        return false;
+    }
+
+    size_t chunk_count = split_chunks(data, length, chunks, max_chunks);
+    CopyJob job = {
+        .schema = table->schema,
+        .format = format,
+        .chunks = chunks
+    };
+
+    bool success = parallel_run(chunk_count, parse_chunk, &job);
+    for (size_t i = 0; i < chunk_count && success; i++) {
+        if (chunks[i].failed) success = false;
+    }
+    if (!success) set_copy_error(stats, "Memory allocation failed while parsing", NULL);
+
+    size_t lines_before = 0;
+    for (size_t i = 0; i < chunk_count; i++) {
+        CopyChunk* chunk = &chunks[i];
+
+        if (success && chunk->row_count > 0) {
+            if (memory_table_insert_batch_owned(table, chunk->rows, chunk->row_count) == 0) {
+                set_copy_error(stats, "Failed to append rows", NULL);
+                success = false;
+            } else {
+                stats->rows_loaded += chunk->row_count;
+                chunk->row_count = 0;
+            }
+        }
+
+        if (chunk->rejected > 0 && stats->rows_rejected == 0) {
+            stats->first_rejected_line = lines_before + chunk->first_rejected_line;
+        }
+        stats->rows_rejected += chunk->rejected;
+        lines_before += chunk->line_count;
+
+        release_chunk(chunk, table->schema->column_count);
+    }
+
+    free(chunks);
+    return success;
+}
+
+bool copy_from_file(MemoryTable* table, const char* path, CopyFormat format, CopyStats* stats) {
+    CopyStats local_stats;
+    if (!stats) stats = &local_stats;
+    memset(stats, 0, sizeof(CopyStats));
+
+    if (!table || !path) {
+        set_copy_error(stats, "Invalid parameters", NULL);
+        return false;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        set_copy_error(stats, "Cannot open file", path);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        set_copy_error(stats, "Cannot stat file", path);
+        return false;
+    }
+
+    if (format == COPY_FORMAT_AUTO) format = copy_format_for_path(path);
+    if (format == COPY_FORMAT_BINARY) {
+        close(fd);
+        set_copy_error(stats, "Binary format is only supported for export", NULL);
+        return false;
+    }
+
+    size_t length = (size_t)info.st_size;
+    if (length == 0) {
+        close(fd);
+        return true;
+    }
+
+    void* mapped = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        set_copy_error(stats, "Cannot map file", path);
+        return false;
+    }
+
+    bool success = copy_from_buffer(table, mapped, length, format, stats);
+    munmap(mapped, length);
+    return success;
+}
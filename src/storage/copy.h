@@ -0,0 +1,28 @@
+#ifndef SHADE_STORAGE_COPY_H
+#define SHADE_STORAGE_COPY_H
+
+#include "memory.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    COPY_FORMAT_AUTO,
+    COPY_FORMAT_CSV,
+    COPY_FORMAT_NDJSON,
+    COPY_FORMAT_BINARY
+} CopyFormat;
+
+typedef struct {
+    size_t rows_loaded;
+    size_t rows_rejected;
+    size_t first_rejected_line;
+    char error[128];
+} CopyStats;
+
+bool copy_format_parse(const char* name, CopyFormat* out_format);
+CopyFormat copy_format_for_path(const char* path);
+
+bool copy_from_file(MemoryTable* table, const char* path, CopyFormat format, CopyStats* stats);
+bool copy_from_buffer(MemoryTable* table, const char* data, size_t length, CopyFormat format, CopyStats* stats);
+
+#endif
@@ -1,8 +1,10 @@
 #include "memory.h"
+#include "../util/hash.h"
 
 #define INITIAL_CAPACITY 16
 #define GROWTH_FACTOR 2
 #define DEFAULT_BTREE_ORDER 4
+#define INITIAL_CATALOG_CAPACITY 32
 
 static int get_primary_key_column(TableSchema* schema) {
     (void)schema;
@@ -18,6 +20,51 @@ static char* create_btree_filename(const char* data_dir, const char* table_name)
     return filename;
 }
 
+static void catalog_place(MemoryTable** catalog, size_t capacity, MemoryTable* table) {
+    size_t mask = capacity - 1;
+    size_t slot = (size_t)table->name_hash & mask;
+    
+    while (catalog[slot]) {
+        slot = (slot + 1) & mask;
+    }
+    catalog[slot] = table;
+}
+
+static bool catalog_rebuild(MemoryStorage* storage, size_t capacity) {
+    MemoryTable** catalog = calloc(capacity, sizeof(MemoryTable*));
+    if (!catalog) return false;
+    
+    for (size_t i = 0; i < storage->table_count; i++) {
+        catalog_place(catalog, capacity, storage->tables[i]);
+    }
+    
+    free(storage->catalog);
+    storage->catalog = catalog;
+    storage->catalog_capacity = capacity;
+    return true;
+}
+
+static void catalog_reindex(MemoryStorage* storage) {
+    memset(storage->catalog, 0, sizeof(MemoryTable*) * storage->catalog_capacity);
+    for (size_t i = 0; i < storage->table_count; i++) {
+        catalog_place(storage->catalog, storage->catalog_capacity, storage->tables[i]);
+    }
+}
+
+static MemoryTable* catalog_lookup(const MemoryStorage* storage, const char* name, uint64_t hash) {
+    size_t mask = storage->catalog_capacity - 1;
+    size_t slot = (size_t)hash & mask;
+    
+    while (storage->catalog[slot]) {
+        MemoryTable* table = storage->catalog[slot];
+        if (table->name_hash == hash && strcmp(table->name, name) == 0) {
+            return table;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
 MemoryStorage* memory_storage_create(void) {
     MemoryStorage* storage = malloc(sizeof(MemoryStorage));
     if (!storage) return NULL;
@@ -32,6 +79,17 @@ MemoryStorage* memory_storage_create(void) {
     storage->capacity = INITIAL_CAPACITY;
     storage->persistence_enabled = false;
     storage->data_directory = NULL;
+    storage->defer_index = false;
+    storage->first_id = 1;
+    storage->id_step = 1;
+    
+    storage->catalog = calloc(INITIAL_CATALOG_CAPACITY, sizeof(MemoryTable*));
+    storage->catalog_capacity = INITIAL_CATALOG_CAPACITY;
+    if (!storage->catalog) {
+        free(storage->tables);
+        free(storage);
+        return NULL;
+    }
     
     return storage;
 }
@@ -56,6 +114,8 @@ void memory_storage_destroy(MemoryStorage* storage) {
                 datarecord_destroy(table->records[j]);
             }
             free(table->records);
+            free(table->key_order);
+            table_stats_destroy(table->stats);
             
             if (table->schema) {
                 tableschema_destroy(table->schema);
@@ -65,6 +125,7 @@ void memory_storage_destroy(MemoryStorage* storage) {
         }
     }
     free(storage->tables);
+    free(storage->catalog);
     free(storage->data_directory);
     free(storage);
 }
@@ -72,10 +133,13 @@ void memory_storage_destroy(MemoryStorage* storage) {
 MemoryTable* memory_storage_create_table(MemoryStorage* storage, const char* name, TableSchema* schema) {
     if (!storage || !name || !schema) return NULL;
     
-    for (size_t i = 0; i < storage->table_count; i++) {
-        if (strcmp(storage->tables[i]->name, name) == 0) {
-            return NULL; 
-        }
+    uint64_t name_hash = hash_string(name);
+    if (catalog_lookup(storage, name, name_hash)) {
+        return NULL; 
+    }
+    
+    if ((storage->table_count + 1) * 2 > storage->catalog_capacity) {
+        if (!catalog_rebuild(storage, storage->catalog_capacity * GROWTH_FACTOR)) return NULL;
     }
     
     if (storage->table_count >= storage->capacity) {
@@ -90,17 +154,27 @@ MemoryTable* memory_storage_create_table(MemoryStorage* storage, const char* nam
     if (!table) return NULL;
     
     table->name = string_duplicate(name);
+    table->name_hash = name_hash;
     table->schema = schema; 
     table->records = malloc(sizeof(DataRecord*) * INITIAL_CAPACITY);
     table->record_count = 0;
     table->capacity = INITIAL_CAPACITY;
-    table->next_id = 1;
+    table->next_id = storage->first_id;
+    table->id_step = storage->id_step;
     table->use_persistence = storage->persistence_enabled;
     table->primary_index = NULL;
-    
-    if (!table->name || !table->records) {
+    table->indexed_count = 0;
+    table->index_entries = 0;
+    table->key_order = storage->persistence_enabled ? NULL : malloc(sizeof(DataRecord*) * INITIAL_CAPACITY);
+    table->key_ordered = 0;
+    table->defer_index = storage->defer_index;
+    table->stats = table_stats_create(schema);
+    
+    if (!table->name || !table->records || !table->stats || (!storage->persistence_enabled && !table->key_order)) {
         free(table->name);
         free(table->records);
+        free(table->key_order);
+        table_stats_destroy(table->stats);
         free(table);
         return NULL;
     }
@@ -110,10 +184,12 @@ MemoryTable* memory_storage_create_table(MemoryStorage* storage, const char* nam
         if (btree_filename) {
             table->primary_index = btree_create(btree_filename, DEFAULT_BTREE_ORDER);
             free(btree_filename);
+            if (table->defer_index) btree_begin_batch(table->primary_index);
         }
     }
     
     storage->tables[storage->table_count++] = table;
+    catalog_place(storage->catalog, storage->catalog_capacity, table);
     return table;
 }
 
@@ -121,12 +197,11 @@ bool memory_storage_drop_table(MemoryStorage* storage, const char* name) {
     if (!storage || !name) return false;
     
     size_t table_index = -1;
-    MemoryTable* table_to_drop = NULL;
+    MemoryTable* table_to_drop = catalog_lookup(storage, name, hash_string(name));
     
-    for (size_t i = 0; i < storage->table_count; i++) {
-        if (strcmp(storage->tables[i]->name, name) == 0) {
+    for (size_t i = 0; table_to_drop && i < storage->table_count; i++) {
+        if (storage->tables[i] == table_to_drop) {
             table_index = i;
-            table_to_drop = storage->tables[i];
             break;
         }
     }
@@ -151,6 +226,8 @@ bool memory_storage_drop_table(MemoryStorage* storage, const char* name) {
             datarecord_destroy(table_to_drop->records[i]);
         }
         free(table_to_drop->records);
+        free(table_to_drop->key_order);
+        table_stats_destroy(table_to_drop->stats);
         
         tableschema_destroy(table_to_drop->schema);
         free(table_to_drop);
@@ -161,6 +238,8 @@ bool memory_storage_drop_table(MemoryStorage* storage, const char* name) {
     }
     
     storage->table_count--;
+    
+    catalog_reindex(storage);
 
     if (storage->capacity > INITIAL_CAPACITY && 
         storage->table_count * 4 <= storage->capacity) {
@@ -184,55 +263,268 @@ bool memory_storage_drop_table(MemoryStorage* storage, const char* name) {
 MemoryTable* memory_storage_get_table(MemoryStorage* storage, const char* name) {
     if (!storage || !name) return NULL;
     
-    for (size_t i = 0; i < storage->table_count; i++) {
-        if (strcmp(storage->tables[i]->name, name) == 0) {
-            return storage->tables[i];
+    return catalog_lookup(storage, name, hash_string(name));
+}
+
+static bool ensure_record_capacity(MemoryTable* table, size_t additional) {
+    if (table->record_count + additional <= table->capacity) return true;
+    
+    size_t new_capacity = table->capacity;
+    while (new_capacity < table->record_count + additional) {
+        new_capacity *= GROWTH_FACTOR;
+    }
+    
+    DataRecord** new_records = realloc(table->records, sizeof(DataRecord*) * new_capacity);
+    if (!new_records) return false;
+    table->records = new_records;
+    table->capacity = new_capacity;
+    return true;
+}
+
+/* Adds every record past indexed_count to the primary index, several at once in one batch. */
+static void index_pending(MemoryTable* table) {
+    size_t from = table->indexed_count;
+    size_t count = table->record_count - from;
+    table->indexed_count = table->record_count;
+    
+    int key_column = get_primary_key_column(table->schema);
+    if (!table->primary_index || count == 0 || key_column < 0 ||
+        (uint32_t)key_column >= table->schema->column_count) {
+        return;
+    }
+    
+    DataRecord** pending = table->records + from;
+    if (count == 1) {
+        if (btree_insert(table->primary_index, &pending[0]->values[key_column], pending[0]->id)) {
+            table->index_entries++;
         }
+        return;
     }
-    return NULL;
+    
+    const Value** keys = malloc(sizeof(Value*) * count);
+    uint64_t* ids = malloc(sizeof(uint64_t) * count);
+    
+    if (keys && ids) {
+        for (size_t i = 0; i < count; i++) {
+            keys[i] = &pending[i]->values[key_column];
+            ids[i] = pending[i]->id;
+        }
+        if (btree_insert_batch(table->primary_index, keys, ids, count)) table->index_entries += count;
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            if (btree_insert(table->primary_index, &pending[i]->values[key_column], pending[i]->id)) {
+                table->index_entries++;
+            }
+        }
+    }
+    
+    free(keys);
+    free(ids);
+}
+
+void memory_table_sync_index(MemoryTable* table) {
+    if (table && table->indexed_count < table->record_count) index_pending(table);
+}
+
+static uint64_t append_record(MemoryTable* table, DataRecord* record) {
+    table->records[table->record_count++] = record;
+    uint64_t new_id = table->next_id;
+    table->next_id += table->id_step;
+    table_stats_add(table->stats, record);
+    
+    if (!table->defer_index) index_pending(table);
+    return new_id;
 }
 
 uint64_t memory_table_insert(MemoryTable* table, const Value* values) {
     if (!table || !values) return 0;
     
-    if (table->record_count >= table->capacity) {
-        size_t new_capacity = table->capacity * GROWTH_FACTOR;
-        DataRecord** new_records = realloc(table->records, sizeof(DataRecord*) * new_capacity);
-        if (!new_records) return 0;
-        table->records = new_records;
-        table->capacity = new_capacity;
-    }
+    if (!ensure_record_capacity(table, 1)) return 0;
     
     DataRecord* record = datarecord_create(table->next_id, values, table->schema->column_count);
     if (!record) return 0;
     
-    table->records[table->record_count++] = record;
-    uint64_t new_id = table->next_id++;
+    return append_record(table, record);
+}
+
+uint64_t memory_table_insert_owned(MemoryTable* table, Value* values) {
+    if (!table || !values) return 0;
+    
+    if (!ensure_record_capacity(table, 1)) return 0;
+    
+    DataRecord* record = datarecord_create_owned(table->next_id, values, table->schema->column_count);
+    if (!record) return 0;
+    
+    return append_record(table, record);
+}
+
+uint64_t memory_table_insert_batch_owned(MemoryTable* table, Value** rows, size_t row_count) {
+    if (!table || !rows || row_count == 0) return 0;
+    
+    if (!ensure_record_capacity(table, row_count)) return 0;
     
-    if (table->primary_index) {
-        int key_column = get_primary_key_column(table->schema);
-        if (key_column >= 0 && (uint32_t)key_column < table->schema->column_count) {
-            btree_insert(table->primary_index, &values[key_column], new_id);
+    size_t column_count = table->schema->column_count;
+    uint64_t first_id = table->next_id;
+    
+    DataRecord** created = malloc(sizeof(DataRecord*) * row_count);
+    if (!created) return 0;
+    
+    for (size_t i = 0; i < row_count; i++) {
+        created[i] = datarecord_create_owned(first_id + i * table->id_step, rows[i], column_count);
+        if (!created[i]) {
+            for (size_t j = 0; j < i; j++) {
+                created[j]->values = NULL;
+                datarecord_destroy(created[j]);
+            }
+            free(created);
+            return 0;
         }
     }
     
-    return new_id;
+    memcpy(table->records + table->record_count, created, sizeof(DataRecord*) * row_count);
+    table->record_count += row_count;
+    table->next_id += row_count * table->id_step;
+    
+    for (size_t i = 0; i < row_count; i++) {
+        table_stats_add(table->stats, created[i]);
+    }
+    
+    if (!table->defer_index) index_pending(table);
+    
+    free(created);
+    return first_id;
+}
+
+bool memory_table_append_records(MemoryTable* table, DataRecord** records, size_t count) {
+    if (!table || (!records && count > 0)) return false;
+    if (count == 0) return true;
+    
+    if (!ensure_record_capacity(table, count)) return false;
+    
+    for (size_t i = 0; i < count; i++) {
+        table->records[table->record_count++] = records[i];
+        table_stats_add(table->stats, records[i]);
+    }
+    table->next_id = records[count - 1]->id + table->id_step;
+    
+    if (!table->defer_index) index_pending(table);
+    return true;
+}
+
+size_t memory_table_position(const MemoryTable* table, uint64_t id) {
+    size_t low = 0;
+    size_t high = table->record_count;
+    
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (table->records[middle]->id < id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
 }
 
 DataRecord* memory_table_get(MemoryTable* table, uint64_t id) {
     if (!table) return NULL;
     
-    for (size_t i = 0; i < table->record_count; i++) {
-        if (table->records[i]->id == id && datarecord_is_queryable(table->records[i])) {
-            return table->records[i];
-        }
+    size_t position = memory_table_position(table, id);
+    if (position < table->record_count && table->records[position]->id == id &&
+        datarecord_is_queryable(table->records[position])) {
+        return table->records[position];
     }
     return NULL;
 }
 
+bool memory_table_has_key_index(const MemoryTable* table) {
+    return table && (table->primary_index || table->key_order);
+}
+
+/* NULL keys, including strings without text, sort after every other key as in the primary index. */
+static int compare_keys(const Value* a, const Value* b) {
+    bool a_null = a->type == VALUE_NULL || (a->type == VALUE_STRING && !a->data.string);
+    bool b_null = b->type == VALUE_NULL || (b->type == VALUE_STRING && !b->data.string);
+    if (a_null || b_null) return (int)a_null - (int)b_null;
+    return value_compare(a, b);
+}
+
+static const Value* record_key(const DataRecord* record) {
+    return &record->values[get_primary_key_column(NULL)];
+}
+
+static int compare_key_order(const void* a, const void* b) {
+    const DataRecord* left = *(DataRecord* const*)a;
+    const DataRecord* right = *(DataRecord* const*)b;
+    int order = compare_keys(record_key(left), record_key(right));
+    return order != 0 ? order : (left->id > right->id) - (left->id < right->id);
+}
+
+/* Sorts the records added since the last read and merges them into key_order from the back. Their
+ * ids are past every id already there, so entries with equal keys stay in id order. */
+static bool sync_key_order(MemoryTable* table) {
+    size_t from = table->key_ordered;
+    size_t count = table->record_count - from;
+    if (count == 0) return true;
+    
+    DataRecord** added = malloc(sizeof(DataRecord*) * count);
+    DataRecord** grown = added ? realloc(table->key_order, sizeof(DataRecord*) * table->capacity) : NULL;
+    if (!grown) {
+        free(added);
+        return false;
+    }
+    table->key_order = grown;
+    
+    memcpy(added, table->records + from, sizeof(DataRecord*) * count);
+    size_t sorted = 1;
+    while (sorted < count && compare_key_order(&added[sorted - 1], &added[sorted]) < 0) sorted++;
+    if (sorted < count) qsort(added, count, sizeof(DataRecord*), compare_key_order);
+    
+    size_t kept = from;
+    size_t total = table->record_count;
+    while (count > 0) {
+        if (kept > 0 && compare_key_order(&table->key_order[kept - 1], &added[count - 1]) > 0) {
+            table->key_order[--total] = table->key_order[--kept];
+        } else {
+            table->key_order[--total] = added[--count];
+        }
+    }
+    
+    free(added);
+    table->key_ordered = table->record_count;
+    return true;
+}
+
+/* Position in key_order of the first record whose key is at least `key`, or past it when `after`. */
+static size_t key_order_position(const MemoryTable* table, const Value* key, bool after) {
+    size_t low = 0;
+    size_t high = table->key_ordered;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        int order = compare_keys(record_key(table->key_order[middle]), key);
+        if (order < 0 || (after && order == 0)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
 DataRecord* memory_table_get_by_key(MemoryTable* table, const Value* key, uint32_t key_column) {
     (void)key_column;
-    if (!table || !key || !table->primary_index) return NULL;
+    if (!table || !key || !memory_table_has_key_index(table)) return NULL;
+    memory_table_sync_index(table);
+    
+    if (!table->primary_index) {
+        if (!sync_key_order(table)) return NULL;
+        
+        size_t end = key_order_position(table, key, true);
+        for (size_t i = key_order_position(table, key, false); i < end; i++) {
+            if (datarecord_is_queryable(table->key_order[i])) return table->key_order[i];
+        }
+        return NULL;
+    }
     
     uint64_t* record_ids = NULL;
     uint32_t count = 0;
@@ -252,16 +544,21 @@ DataRecord* memory_table_get_by_key(MemoryTable* table, const Value* key, uint32
 bool memory_table_delete(MemoryTable* table, uint64_t id, int64_t timestamp) {
     if (!table) return false;
     
-    for (size_t i = 0; i < table->record_count; i++) {
-        if (table->records[i]->id == id && table->records[i]->state == DATA_STATE_LIVING) {
-            datarecord_mark_ghost(table->records[i], timestamp);
-            
-            return true;
-        }
+    size_t position = memory_table_position(table, id);
+    if (position < table->record_count && table->records[position]->id == id &&
+        table->records[position]->state == DATA_STATE_LIVING) {
+        datarecord_mark_ghost(table->records[position], timestamp);
+        table_stats_transition(table->stats, DATA_STATE_LIVING, DATA_STATE_GHOST);
+        return true;
     }
     return false;
 }
 
+bool memory_table_analyze(MemoryTable* table) {
+    if (!table) return false;
+    return table_stats_analyze(table->stats, table->records, table->record_count);
+}
+
 DataRecord** memory_table_scan(MemoryTable* table, size_t* result_count) {
     if (!table || !result_count) return NULL;
     
@@ -328,12 +625,28 @@ DataRecord** memory_table_find_ghosts(MemoryTable* table, size_t* result_count)
 
 uint64_t* memory_table_range_query(MemoryTable* table, const BTreeRange* range, uint32_t key_column, uint32_t* result_count) {
     (void)key_column;
-    if (!table || !range || !result_count || !table->primary_index) {
-        *result_count = 0;
+    if (!table || !range || !result_count || !memory_table_has_key_index(table)) {
+        if (result_count) *result_count = 0;
         return NULL;
     }
     
-    return btree_range_query(table->primary_index, range, result_count);
+    memory_table_sync_index(table);
+    if (table->primary_index) return btree_range_query(table->primary_index, range, result_count);
+    
+    *result_count = 0;
+    if (!sync_key_order(table)) return NULL;
+    
+    size_t start = key_order_position(table, &range->start_key, !range->include_start);
+    size_t end = key_order_position(table, &range->end_key, range->include_end);
+    if (end <= start) return NULL;
+    
+    uint64_t* ids = malloc(sizeof(uint64_t) * (end - start));
+    if (!ids) return NULL;
+    for (size_t i = start; i < end; i++) {
+        ids[i - start] = table->key_order[i]->id;
+    }
+    *result_count = (uint32_t)(end - start);
+    return ids;
 }
 
 bool memory_storage_enable_persistence(MemoryStorage* storage, const char* data_dir) {
@@ -359,12 +672,17 @@ bool memory_storage_enable_persistence(MemoryStorage* storage, const char* data_
                 free(btree_filename);
                 
                 if (table->primary_index) {
+                    free(table->key_order);
+                    table->key_order = NULL;
+                    table->key_ordered = 0;
+                    if (table->defer_index) btree_begin_batch(table->primary_index);
+                    table->indexed_count = table->record_count;
                     int key_column = get_primary_key_column(table->schema);
                     for (size_t j = 0; j < table->record_count; j++) {
-                        if (datarecord_is_queryable(table->records[j]) && key_column >= 0) {
-                            btree_insert(table->primary_index, 
-                                       &table->records[j]->values[key_column], 
-                                       table->records[j]->id);
+                        if (datarecord_is_queryable(table->records[j]) && key_column >= 0 &&
+                            btree_insert(table->primary_index, &table->records[j]->values[key_column],
+                                         table->records[j]->id)) {
+                            table->index_entries++;
                         }
                     }
                 }
@@ -380,6 +698,7 @@ bool memory_storage_save(MemoryStorage* storage) {
     
     for (size_t i = 0; i < storage->table_count; i++) {
         if (storage->tables[i]->primary_index) {
+            memory_table_sync_index(storage->tables[i]);
             btree_flush(storage->tables[i]->primary_index);
         }
     }
@@ -387,6 +706,29 @@ bool memory_storage_save(MemoryStorage* storage) {
     return true;
 }
 
+void memory_storage_defer_index(MemoryStorage* storage, bool defer) {
+    if (!storage) return;
+    
+    storage->defer_index = defer;
+    for (size_t i = 0; i < storage->table_count; i++) {
+        MemoryTable* table = storage->tables[i];
+        table->defer_index = defer;
+        if (defer) {
+            btree_begin_batch(table->primary_index);
+        } else if (table->primary_index) {
+            memory_table_sync_index(table);
+            btree_end_batch(table->primary_index);
+        }
+    }
+}
+
+void memory_storage_partition_ids(MemoryStorage* storage, size_t index, size_t count) {
+    if (!storage || count == 0 || index >= count) return;
+    
+    storage->first_id = index + 1;
+    storage->id_step = count;
+}
+
 MemoryStorage* memory_storage_load(const char* data_dir) {
     if (!data_dir) return NULL;
     
@@ -461,15 +803,8 @@ void memory_table_debug_info(const MemoryTable* table) {
     printf("      Persistence: %s\n", table->use_persistence ? "enabled" : "disabled");
     printf("      B-tree: %s\n", table->primary_index ? "present" : "not present");
     
-    size_t living = 0, ghosts = 0, exorcised = 0;
-    for (size_t i = 0; i < table->record_count; i++) {
-        switch (table->records[i]->state) {
-            case DATA_STATE_LIVING: living++; break;
-            case DATA_STATE_GHOST: ghosts++; break;
-            case DATA_STATE_EXORCISED: exorcised++; break;
-        }
+    if (table->stats) {
+        printf("      Record states: %zu living, %zu ghosts, %zu exorcised\n",
+               table->stats->living_count, table->stats->ghost_count, table->stats->exorcised_count);
     }
-    
-    printf("      Record states: %zu living, %zu ghosts, %zu exorcised\n", 
-           living, ghosts, exorcised);
 }
@@ -4,6 +4,7 @@
 #include "../types/data.h"
 #include "../types/schema.h"
 #include "btree.h"
+#include "stats.h"
 #include <stdbool.h>
 #include <stdlib.h>
 #include "../util/string_utils.h"
@@ -14,14 +15,27 @@ typedef struct BTreeRange BTreeRange;
 
 typedef struct {
     char* name;
+    uint64_t name_hash;
     TableSchema* schema;
     DataRecord** records;
     size_t record_count;
     size_t capacity;
     uint64_t next_id;
+    uint64_t id_step;
 
     BTree* primary_index;
+    /* Records before this position are in primary_index. While index writes are deferred the
+     * rest wait for memory_table_sync_index, which every index reader calls first. */
+    size_t indexed_count;
+    /* Entries primary_index holds; fewer than indexed_count when records were left out of it. */
+    size_t index_entries;
+    /* Without persistence the key index lives in memory instead: key_order holds the first
+     * key_ordered records sorted by key, then id, and takes in the rest when next read. */
+    DataRecord** key_order;
+    size_t key_ordered;
+    bool defer_index;
     bool use_persistence;
+    TableStats* stats;
 } MemoryTable;
 
 typedef struct {
@@ -29,8 +43,15 @@ typedef struct {
     size_t table_count;
     size_t capacity;
 
+    MemoryTable** catalog;
+    size_t catalog_capacity;
+
     bool persistence_enabled;
     char* data_directory;
+    bool defer_index;
+    /* New tables number their records first_id, first_id + id_step, ... */
+    uint64_t first_id;
+    uint64_t id_step;
 } MemoryStorage;
 
 MemoryStorage* memory_storage_create(void);
@@ -41,12 +62,24 @@ bool memory_storage_drop_table(MemoryStorage* storage, const char* name);
 MemoryTable* memory_storage_get_table(MemoryStorage* storage, const char* name);
 
 uint64_t memory_table_insert(MemoryTable* table, const Value* values);
+uint64_t memory_table_insert_owned(MemoryTable* table, Value* values);
+uint64_t memory_table_insert_batch_owned(MemoryTable* table, Value** rows, size_t row_count);
+/* Takes ownership of records that keep their ids, which must ascend past every id in the table. */
+bool memory_table_append_records(MemoryTable* table, DataRecord** records, size_t count);
+/* Records are kept in id order: returns the position of the first record with an id of at least `id`. */
+size_t memory_table_position(const MemoryTable* table, uint64_t id);
 DataRecord* memory_table_get(MemoryTable* table, uint64_t id);
 bool memory_table_update(MemoryTable* table, uint64_t id, const Value* values);
 bool memory_table_delete(MemoryTable* table, uint64_t id, int64_t timestamp);
 DataRecord** memory_table_scan(MemoryTable* table, size_t* result_count);
 DataRecord** memory_table_find_ghosts(MemoryTable* table, size_t* result_count);
 
+/* Rebuilds the table's statistics, including histograms, from its records. */
+bool memory_table_analyze(MemoryTable* table);
+
+void memory_table_sync_index(MemoryTable* table);
+/* Whether the table has a key index, on disk or in memory, for the lookups below. */
+bool memory_table_has_key_index(const MemoryTable* table);
 DataRecord* memory_table_get_by_key(MemoryTable* table, const Value* key, uint32_t key_column);
 uint64_t* memory_table_range_query(MemoryTable* table, const BTreeRange* range, uint32_t key_column, uint32_t* result_count);
 
@@ -54,6 +87,12 @@ bool memory_storage_enable_persistence(MemoryStorage* storage, const char* data_
 bool memory_storage_save(MemoryStorage* storage);
 MemoryStorage* memory_storage_load(const char* data_dir);
 bool memory_storage_flush(MemoryStorage* storage);
+/* Deferring makes inserts skip the primary indexes, which catch up in one batch per table when
+ * next read and when deferral ends; index headers are only written then. */
+void memory_storage_defer_index(MemoryStorage* storage, bool defer);
+/* Lets several storages hold partitions of the same tables without sharing ids: partition
+ * `index` of `count` numbers records index + 1, index + 1 + count, ... Applies to new tables. */
+void memory_storage_partition_ids(MemoryStorage* storage, size_t index, size_t count);
 
 void memory_storage_debug_info(const MemoryStorage* storage);
 void memory_table_debug_info(const MemoryTable* table);
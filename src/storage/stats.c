@@ -0,0 +1,324 @@
+#include "stats.h"
+#include "../util/hash.h"
+#include <string.h>
+
+TableStats* table_stats_create(const TableSchema* schema) {
+    if (!schema) return NULL;
+
+    TableStats* stats = calloc(1, sizeof(TableStats));
+    if (!stats) return NULL;
+
+    stats->column_count = schema->column_count;
+    stats->columns = calloc(schema->column_count ? schema->column_count : 1, sizeof(ColumnStats));
+    if (!stats->columns) {
+        free(stats);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < stats->column_count; i++) {
+        stats->columns[i].min = value_null();
+        stats->columns[i].max = value_null();
+    }
+    return stats;
+}
+
+static void column_stats_clear(ColumnStats* column) {
+    value_destroy(&column->min);
+    value_destroy(&column->max);
+    for (size_t i = 0; column->bounds && i <= column->bucket_count; i++) {
+        value_destroy(&column->bounds[i]);
+    }
+    free(column->bounds);
+
+    memset(column, 0, sizeof(ColumnStats));
+    column->min = value_null();
+    column->max = value_null();
+}
+
+void table_stats_destroy(TableStats* stats) {
+    if (!stats) return;
+
+    for (size_t i = 0; i < stats->column_count; i++) {
+        column_stats_clear(&stats->columns[i]);
+    }
+    free(stats->columns);
+    free(stats);
+}
+
+static bool is_numeric(const Value* value) {
+    return value->type == VALUE_INTEGER || value->type == VALUE_FLOAT;
+}
+
+static double numeric(const Value* value) {
+    return value->type == VALUE_INTEGER ? (double)value->data.integer : value->data.float_val;
+}
+
+/* Integer literals are compared against FLOAT columns and the other way round. */
+static int stats_compare(const Value* a, const Value* b) {
+    if (is_numeric(a) && is_numeric(b) && a->type != b->type) {
+        double left = numeric(a);
+        double right = numeric(b);
+        return (left > right) - (left < right);
+    }
+    return value_compare(a, b);
+}
+
+/* A string without text, which value_string(NULL) makes, counts as NULL. */
+static bool stats_is_null(const Value* value) {
+    return value->type == VALUE_NULL || (value->type == VALUE_STRING && !value->data.string);
+}
+
+static uint64_t value_hash(const Value* value) {
+    uint64_t bits = 0;
+    switch (value->type) {
+        case VALUE_INTEGER:
+            bits = (uint64_t)value->data.integer;
+            break;
+        case VALUE_FLOAT: {
+            double number = value->data.float_val == 0.0 ? 0.0 : value->data.float_val;
+            memcpy(&bits, &number, sizeof(bits));
+            break;
+        }
+        case VALUE_BOOLEAN:
+            bits = value->data.boolean;
+            break;
+        case VALUE_STRING:
+            return hash_mix(hash_string(value->data.string));
+        default:
+            break;
+    }
+    return hash_mix(bits ^ 0x9e3779b97f4a7c15ULL);
+}
+
+/* K minimum values: the sketch keeps the smallest distinct hashes, and how tightly they
+ * pack the hash space gives the distinct count. */
+static void sketch_add(ColumnStats* column, uint64_t hash) {
+    size_t count = column->sketch_count;
+    if (count == STATS_SKETCH_SIZE && hash >= column->sketch[count - 1]) return;
+
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (column->sketch[middle] < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < count && column->sketch[low] == hash) return;
+
+    if (count == STATS_SKETCH_SIZE) count--;
+    memmove(&column->sketch[low + 1], &column->sketch[low], sizeof(uint64_t) * (count - low));
+    column->sketch[low] = hash;
+    column->sketch_count = count + 1;
+}
+
+static void bound_update(Value* bound, const Value* value, int direction) {
+    if (bound->type != VALUE_NULL && stats_compare(value, bound) * direction <= 0) return;
+
+    Value copy = value_clone(value);
+    if (copy.type == VALUE_STRING && !copy.data.string) return;
+
+    value_destroy(bound);
+    *bound = copy;
+}
+
+static void column_stats_add(ColumnStats* column, const Value* value) {
+    if (stats_is_null(value)) {
+        column->null_count++;
+        return;
+    }
+
+    column->value_count++;
+    bound_update(&column->min, value, -1);
+    bound_update(&column->max, value, 1);
+    sketch_add(column, value_hash(value));
+}
+
+static void count_state(TableStats* stats, DataState state, bool add) {
+    size_t* count = state == DATA_STATE_LIVING ? &stats->living_count :
+                    state == DATA_STATE_GHOST ? &stats->ghost_count : &stats->exorcised_count;
+    if (add) {
+        (*count)++;
+    } else if (*count > 0) {
+        (*count)--;
+    }
+}
+
+void table_stats_add(TableStats* stats, const DataRecord* record) {
+    if (!stats || !record) return;
+
+    count_state(stats, record->state, true);
+    stats->modified_count++;
+
+    size_t columns = record->value_count < stats->column_count ? record->value_count : stats->column_count;
+    for (size_t i = 0; i < columns; i++) {
+        column_stats_add(&stats->columns[i], &record->values[i]);
+    }
+}
+
+void table_stats_transition(TableStats* stats, DataState from, DataState to) {
+    if (!stats || from == to) return;
+
+    count_state(stats, from, false);
+    count_state(stats, to, true);
+    stats->modified_count++;
+}
+
+static int compare_sampled(const void* a, const void* b) {
+    return stats_compare(*(const Value* const*)a, *(const Value* const*)b);
+}
+
+static bool build_histogram(ColumnStats* column, const Value** sample, size_t count) {
+    if (count == 0) return true;
+
+    qsort(sample, count, sizeof(Value*), compare_sampled);
+
+    size_t buckets = count < STATS_HISTOGRAM_BUCKETS ? count : STATS_HISTOGRAM_BUCKETS;
+    Value* bounds = malloc(sizeof(Value) * (buckets + 1));
+    if (!bounds) return false;
+
+    for (size_t i = 0; i <= buckets; i++) {
+        bounds[i] = value_clone(sample[i * (count - 1) / buckets]);
+    }
+
+    column->bounds = bounds;
+    column->bucket_count = buckets;
+    return true;
+}
+
+bool table_stats_analyze(TableStats* stats, DataRecord* const* records, size_t count) {
+    if (!stats || (!records && count > 0)) return false;
+
+    for (size_t i = 0; i < stats->column_count; i++) {
+        column_stats_clear(&stats->columns[i]);
+    }
+    stats->living_count = 0;
+    stats->ghost_count = 0;
+    stats->exorcised_count = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        count_state(stats, records[i]->state, true);
+        if (records[i]->state == DATA_STATE_EXORCISED) continue;
+
+        size_t columns = records[i]->value_count < stats->column_count ? records[i]->value_count : stats->column_count;
+        for (size_t c = 0; c < columns; c++) {
+            column_stats_add(&stats->columns[c], &records[i]->values[c]);
+        }
+    }
+
+    /* Histograms describe what default queries see, so they sample living rows only. */
+    size_t stride = stats->living_count > STATS_SAMPLE_ROWS ? stats->living_count / STATS_SAMPLE_ROWS : 1;
+    const Value** sample = malloc(sizeof(Value*) * (stats->living_count / stride + 1));
+    bool success = sample != NULL;
+
+    for (size_t c = 0; success && c < stats->column_count; c++) {
+        size_t sampled = 0;
+        size_t seen = 0;
+        for (size_t i = 0; i < count; i++) {
+            const DataRecord* record = records[i];
+            if (record->state != DATA_STATE_LIVING || c >= record->value_count) continue;
+            if (seen++ % stride != 0 || stats_is_null(&record->values[c])) continue;
+            sample[sampled++] = &record->values[c];
+        }
+        success = build_histogram(&stats->columns[c], sample, sampled);
+    }
+    free(sample);
+
+    stats->modified_count = 0;
+    stats->analyzed = success;
+    return success;
+}
+
+double column_stats_null_fraction(const ColumnStats* column) {
+    size_t total = column->null_count + column->value_count;
+    return total > 0 ? (double)column->null_count / (double)total : 0.0;
+}
+
+double column_stats_distinct(const ColumnStats* column) {
+    if (column->sketch_count < STATS_SKETCH_SIZE) return (double)column->sketch_count;
+
+    double largest = (double)column->sketch[STATS_SKETCH_SIZE - 1] / 18446744073709551616.0;
+    double estimate = largest > 0.0 ? (double)(STATS_SKETCH_SIZE - 1) / largest : (double)column->value_count;
+    return estimate < (double)column->value_count ? estimate : (double)column->value_count;
+}
+
+/* Where `value` falls between two bounds, as a share of the gap between them. */
+static double interpolate(const Value* low, const Value* high, const Value* value) {
+    if (!is_numeric(low) || !is_numeric(high) || !is_numeric(value)) return 0.5;
+
+    double span = numeric(high) - numeric(low);
+    if (span <= 0.0) return 0.5;
+
+    double position = (numeric(value) - numeric(low)) / span;
+    return position < 0.0 ? 0.0 : position > 1.0 ? 1.0 : position;
+}
+
+/* Share of sampled values below `value`, or at or below it when inclusive. */
+static double histogram_fraction(const ColumnStats* column, const Value* value, bool inclusive) {
+    const Value* bounds = column->bounds;
+    size_t buckets = column->bucket_count;
+
+    size_t low = 0;
+    size_t high = buckets + 1;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        int cmp = stats_compare(&bounds[middle], value);
+        if (cmp < 0 || (inclusive && cmp == 0)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    if (low == 0) return 0.0;
+    if (low > buckets) return 1.0;
+
+    /* The value lies in bucket low - 1; a bound equal to it sits at one end of that bucket. */
+    double within;
+    if (!inclusive && stats_compare(&bounds[low], value) == 0) {
+        within = 1.0;
+    } else if (inclusive && stats_compare(&bounds[low - 1], value) == 0) {
+        within = 0.0;
+    } else {
+        within = interpolate(&bounds[low - 1], &bounds[low], value);
+    }
+    return ((double)(low - 1) + within) / (double)buckets;
+}
+
+double column_stats_fraction_below(const ColumnStats* column, const Value* value, bool inclusive) {
+    if (!column || value->type == VALUE_NULL || column->value_count == 0) return -1.0;
+
+    double equal = column_stats_distinct(column) > 0.0 ? 1.0 / column_stats_distinct(column) : 0.0;
+    double fraction;
+    if (column->bucket_count > 0) {
+        fraction = histogram_fraction(column, value, inclusive);
+        if (inclusive) {
+            double below = histogram_fraction(column, value, false);
+            if (fraction < below + equal && stats_compare(value, &column->max) <= 0) fraction = below + equal;
+        }
+    } else if (is_numeric(&column->min) && is_numeric(value)) {
+        fraction = interpolate(&column->min, &column->max, value);
+        if (inclusive && stats_compare(value, &column->max) <= 0) fraction += equal;
+    } else {
+        return -1.0;
+    }
+
+    if (stats_compare(value, &column->min) < 0 || (!inclusive && stats_compare(value, &column->min) == 0)) return 0.0;
+    if (stats_compare(value, &column->max) > 0 || (inclusive && stats_compare(value, &column->max) == 0)) return 1.0;
+    return fraction > 1.0 ? 1.0 : fraction;
+}
+
+double column_stats_fraction_equal(const ColumnStats* column, const Value* value) {
+    if (!column || value->type == VALUE_NULL || column->value_count == 0) return -1.0;
+    if (stats_compare(value, &column->min) < 0 || stats_compare(value, &column->max) > 0) return 0.0;
+
+    double distinct = column_stats_distinct(column);
+    double equal = distinct > 0.0 ? 1.0 / distinct : 1.0;
+    if (column->bucket_count == 0) return equal;
+
+    /* A value spanning several histogram bounds is more common than the distinct count says. */
+    double spanned = histogram_fraction(column, value, true) - histogram_fraction(column, value, false);
+    return spanned > equal ? spanned : equal;
+}
@@ -0,0 +1,57 @@
+#ifndef SHADE_STORAGE_STATS_H
+#define SHADE_STORAGE_STATS_H
+
+#include "../types/data.h"
+#include "../types/schema.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define STATS_SKETCH_SIZE 256
+#define STATS_HISTOGRAM_BUCKETS 32
+#define STATS_SAMPLE_ROWS 30000
+
+/* Counts, bounds and the distinct sketch follow every insert but never shrink; the histogram
+ * only changes on analyze, which also recomputes everything else from the records. */
+typedef struct {
+    size_t null_count;
+    size_t value_count;
+    Value min;
+    Value max;
+
+    /* The smallest distinct value hashes seen, ascending. */
+    uint64_t sketch[STATS_SKETCH_SIZE];
+    size_t sketch_count;
+
+    /* Equi-depth over a sample of living values: bucket i spans bounds[i] to bounds[i + 1]
+     * and holds the same share of rows as every other bucket. */
+    Value* bounds;
+    size_t bucket_count;
+} ColumnStats;
+
+typedef struct {
+    size_t living_count;
+    size_t ghost_count;
+    size_t exorcised_count;
+    size_t modified_count;
+    bool analyzed;
+    size_t column_count;
+    ColumnStats* columns;
+} TableStats;
+
+TableStats* table_stats_create(const TableSchema* schema);
+void table_stats_destroy(TableStats* stats);
+
+void table_stats_add(TableStats* stats, const DataRecord* record);
+void table_stats_transition(TableStats* stats, DataState from, DataState to);
+bool table_stats_analyze(TableStats* stats, DataRecord* const* records, size_t count);
+
+double column_stats_null_fraction(const ColumnStats* column);
+double column_stats_distinct(const ColumnStats* column);
+
+/* Share of non-NULL values below `value`, or at or below it when inclusive; negative when
+ * nothing is known about the column's distribution. */
+double column_stats_fraction_below(const ColumnStats* column, const Value* value, bool inclusive);
+double column_stats_fraction_equal(const ColumnStats* column, const Value* value);
+
+#endif
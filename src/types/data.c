@@ -27,6 +27,20 @@ DataRecord* datarecord_create(uint64_t id, const Value* values, size_t value_cou
     return record;
 }
 
+DataRecord* datarecord_create_owned(uint64_t id, Value* values, size_t value_count) {
+    DataRecord* record = malloc(sizeof(DataRecord));
+    if (!record) return NULL;
+    
+    record->id = id;
+    record->state = DATA_STATE_LIVING;
+    record->values = value_count > 0 ? values : NULL;
+    record->value_count = value_count;
+    record->deleted_at = 0;
+    record->ghost_strength = 1.0f;
+    
+    return record;
+}
+
 void datarecord_destroy(DataRecord* record) {
     if (!record) return;
     
@@ -23,6 +23,7 @@ typedef struct {
 } DataRecord;
 
 DataRecord* datarecord_create(uint64_t id, const Value* values, size_t value_count);
+DataRecord* datarecord_create_owned(uint64_t id, Value* values, size_t value_count);
 void datarecord_destroy(DataRecord* record);
 
 void datarecord_mark_ghost(DataRecord* record, int64_t timestamp);
@@ -46,6 +46,30 @@ void tableschema_destroy(TableSchema* schema) {
     free(schema);
 }
 
+int tableschema_find_column(const TableSchema* schema, const char* name) {
+    if (!schema || !name) return SCHEMA_COLUMN_MISSING;
+    
+    for (size_t i = 0; i < schema->column_count; i++) {
+        if (string_case_compare(schema->columns[i].name, name) == 0) return (int)i;
+    }
+    
+    if (strchr(name, '.')) return SCHEMA_COLUMN_MISSING;
+    
+    int found = SCHEMA_COLUMN_MISSING;
+    for (size_t i = 0; i < schema->column_count; i++) {
+        const char* column = strchr(schema->columns[i].name, '.');
+        if (column && string_case_compare(column + 1, name) == 0) {
+            if (found != SCHEMA_COLUMN_MISSING) return SCHEMA_COLUMN_AMBIGUOUS;
+            found = (int)i;
+        }
+    }
+    return found;
+}
+
+const char* tableschema_lookup_message(int lookup) {
+    return lookup == SCHEMA_COLUMN_AMBIGUOUS ? "Ambiguous column" : "Unknown column";
+}
+
 ColumnSchema column_create(const char* name, ValueType type) {
     ColumnSchema column = {
         .name = name ? string_duplicate(name) : NULL,
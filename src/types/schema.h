@@ -16,9 +16,16 @@ typedef struct {
     size_t column_count;
 } TableSchema;
 
+#define SCHEMA_COLUMN_MISSING -1
+#define SCHEMA_COLUMN_AMBIGUOUS -2
+
 TableSchema* tableschema_create(const char* name, const ColumnSchema* columns, size_t column_count);
 void tableschema_destroy(TableSchema* schema);
 
+/* Matches names case-insensitively; an unqualified name also matches a unique "table.column". */
+int tableschema_find_column(const TableSchema* schema, const char* name);
+const char* tableschema_lookup_message(int lookup);
+
 ColumnSchema column_create(const char* name, ValueType type);
 
 #endif
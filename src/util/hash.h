@@ -0,0 +1,9 @@
+#ifndef SHADE_HASH_H
+#define SHADE_HASH_H
+
+#include <stdint.h>
+
+uint64_t hash_mix(uint64_t hash);
+uint64_t hash_string(const char* text);
+
+#endif
@@ -0,0 +1,86 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "parallel.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define MAX_PARALLEL_WORKERS 64
+
+typedef struct {
+    ParallelTask task;
+    void* context;
+    size_t task_count;
+    size_t next_task;
+    pthread_mutex_t lock;
+} ParallelJob;
+
+static __thread bool thread_serial = false;
+
+size_t parallel_worker_count(void) {
+    if (thread_serial) return 1;
+    
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (online < 1) return 1;
+    if (online > MAX_PARALLEL_WORKERS) return MAX_PARALLEL_WORKERS;
+    return (size_t)online;
+}
+
+void parallel_set_thread_serial(bool serial) {
+    thread_serial = serial;
+}
+
+static void* parallel_worker(void* arg) {
+    ParallelJob* job = arg;
+    
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        size_t index = job->next_task++;
+        pthread_mutex_unlock(&job->lock);
+        
+        if (index >= job->task_count) break;
+        job->task(job->context, index);
+    }
+    
+    return NULL;
+}
+
+bool parallel_run(size_t task_count, ParallelTask task, void* context) {
+    if (!task) return false;
+    if (task_count == 0) return true;
+    
+    size_t workers = parallel_worker_count();
+    if (workers > task_count) workers = task_count;
+    
+    if (workers <= 1) {
+        for (size_t i = 0; i < task_count; i++) {
+            task(context, i);
+        }
+        return true;
+    }
+    
+    ParallelJob job = {
+        .task = task,
+        .context = context,
+        .task_count = task_count,
+        .next_task = 0
+    };
+    if (pthread_mutex_init(&job.lock, NULL) != 0) return false;
+    
+    pthread_t threads[MAX_PARALLEL_WORKERS];
+    size_t started = 0;
+    
+    for (size_t i = 1; i < workers; i++) {
+        if (pthread_create(&threads[started], NULL, parallel_worker, &job) != 0) break;
+        started++;
+    }
+    
+    parallel_worker(&job);
+    
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    
+    pthread_mutex_destroy(&job.lock);
+    return true;
+}
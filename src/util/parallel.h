@@ -0,0 +1,15 @@
+#ifndef SHADE_PARALLEL_H
+#define SHADE_PARALLEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef void (*ParallelTask)(void* context, size_t task_index);
+
+size_t parallel_worker_count(void);
+/* Makes parallel_run in the calling thread run every task itself, for threads that already have
+ * a core of their own. */
+void parallel_set_thread_serial(bool serial);
+bool parallel_run(size_t task_count, ParallelTask task, void* context);
+
+#endif
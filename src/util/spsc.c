@@ -0,0 +1,48 @@
+#include "spsc.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool spsc_init(SpscQueue* queue, size_t capacity) {
+    memset(queue, 0, sizeof(SpscQueue));
+
+    size_t size = 2;
+    while (size < capacity) {
+        size *= 2;
+    }
+
+    queue->slots = calloc(size, sizeof(void*));
+    if (!queue->slots) return false;
+    queue->mask = size - 1;
+    return true;
+}
+
+void spsc_free(SpscQueue* queue) {
+    free(queue->slots);
+    queue->slots = NULL;
+}
+
+/* The release store of an index publishes the slot writes before it; the acquire load on the
+ * other side makes them visible before the slot is read. */
+bool spsc_push(SpscQueue* queue, void* item) {
+    size_t tail = queue->tail;
+    if (tail - queue->cached_head > queue->mask) {
+        queue->cached_head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+        if (tail - queue->cached_head > queue->mask) return false;
+    }
+
+    queue->slots[tail & queue->mask] = item;
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void* spsc_pop(SpscQueue* queue) {
+    size_t head = queue->head;
+    if (head == queue->cached_tail) {
+        queue->cached_tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+        if (head == queue->cached_tail) return NULL;
+    }
+
+    void* item = queue->slots[head & queue->mask];
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    return item;
+}
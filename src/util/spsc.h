@@ -0,0 +1,33 @@
+#ifndef SHADE_SPSC_H
+#define SHADE_SPSC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SPSC_CACHE_LINE 64
+
+/* Lock-free ring of pointers between exactly one producer thread and one consumer thread. Each
+ * side keeps its index on its own cache line, with a stale copy of the other side's to avoid
+ * touching the shared line on every call. */
+typedef struct {
+    void** slots;
+    size_t mask;
+    char pad0[SPSC_CACHE_LINE];
+    size_t head;
+    size_t cached_tail;
+    char pad1[SPSC_CACHE_LINE];
+    size_t tail;
+    size_t cached_head;
+    char pad2[SPSC_CACHE_LINE];
+} SpscQueue;
+
+/* capacity is rounded up to a power of two. */
+bool spsc_init(SpscQueue* queue, size_t capacity);
+void spsc_free(SpscQueue* queue);
+
+/* Producer side; false when the ring is full. */
+bool spsc_push(SpscQueue* queue, void* item);
+/* Consumer side; NULL when the ring is empty. */
+void* spsc_pop(SpscQueue* queue);
+
+#endif
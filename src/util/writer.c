@@ -0,0 +1,238 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "writer.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static BufferedWriter* writer_allocate(int fd, bool owns_fd, size_t capacity) {
+    BufferedWriter* writer = malloc(sizeof(BufferedWriter));
+    if (!writer) return NULL;
+
+    if (capacity < 64) capacity = WRITER_DEFAULT_CAPACITY;
+
+    writer->buffer = malloc(capacity);
+    if (!writer->buffer) {
+        free(writer);
+        return NULL;
+    }
+
+    writer->fd = fd;
+    writer->owns_fd = owns_fd;
+    writer->length = 0;
+    writer->capacity = capacity;
+    writer->bytes_written = 0;
+    writer->failed = false;
+    return writer;
+}
+
+BufferedWriter* writer_open(const char* path, size_t capacity) {
+    if (!path) return NULL;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return NULL;
+
+    BufferedWriter* writer = writer_allocate(fd, true, capacity);
+    if (!writer) close(fd);
+    return writer;
+}
+
+BufferedWriter* writer_create_fd(int fd, size_t capacity) {
+    if (fd < 0) return NULL;
+    return writer_allocate(fd, false, capacity);
+}
+
+static bool write_fully(BufferedWriter* writer, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(writer->fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            writer->failed = true;
+            return false;
+        }
+        data += written;
+        length -= (size_t)written;
+        writer->bytes_written += (uint64_t)written;
+    }
+    return true;
+}
+
+bool writer_flush(BufferedWriter* writer) {
+    if (!writer || writer->failed) return false;
+
+    bool success = write_fully(writer, writer->buffer, writer->length);
+    writer->length = 0;
+    return success;
+}
+
+bool writer_close(BufferedWriter* writer) {
+    if (!writer) return false;
+
+    bool success = writer_flush(writer);
+    if (writer->owns_fd && close(writer->fd) != 0) {
+        success = false;
+    }
+
+    free(writer->buffer);
+    free(writer);
+    return success;
+}
+
+static char* writer_reserve(BufferedWriter* writer, size_t length) {
+    if (writer->failed) return NULL;
+    if (writer->capacity - writer->length < length && !writer_flush(writer)) return NULL;
+    if (writer->capacity < length) return NULL;
+    return writer->buffer + writer->length;
+}
+
+bool writer_put_bytes(BufferedWriter* writer, const void* data, size_t length) {
+    if (!writer || writer->failed) return false;
+
+    if (length > writer->capacity / 2) {
+        return writer_flush(writer) && write_fully(writer, data, length);
+    }
+
+    char* out = writer_reserve(writer, length);
+    if (!out) return false;
+
+    memcpy(out, data, length);
+    writer->length += length;
+    return true;
+}
+
+bool writer_put_char(BufferedWriter* writer, char c) {
+    if (!writer) return false;
+
+    char* out = writer_reserve(writer, 1);
+    if (!out) return false;
+
+    *out = c;
+    writer->length++;
+    return true;
+}
+
+bool writer_put_string(BufferedWriter* writer, const char* text) {
+    return text ? writer_put_bytes(writer, text, strlen(text)) : false;
+}
+
+static size_t format_uint(uint64_t value, char* out) {
+    char digits[20];
+    size_t position = sizeof(digits);
+
+    while (value >= 100) {
+        size_t pair = (size_t)(value % 100) * 2;
+        value /= 100;
+        digits[--position] = digit_pairs[pair + 1];
+        digits[--position] = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        size_t pair = (size_t)value * 2;
+        digits[--position] = digit_pairs[pair + 1];
+        digits[--position] = digit_pairs[pair];
+    } else {
+        digits[--position] = (char)('0' + value);
+    }
+
+    size_t length = sizeof(digits) - position;
+    memcpy(out, digits + position, length);
+    return length;
+}
+
+bool writer_put_uint(BufferedWriter* writer, uint64_t value) {
+    if (!writer) return false;
+
+    char* out = writer_reserve(writer, 20);
+    if (!out) return false;
+
+    writer->length += format_uint(value, out);
+    return true;
+}
+
+bool writer_put_int(BufferedWriter* writer, int64_t value) {
+    if (!writer) return false;
+
+    char* out = writer_reserve(writer, 21);
+    if (!out) return false;
+
+    size_t length = 0;
+    uint64_t magnitude = (uint64_t)value;
+    if (value < 0) {
+        out[length++] = '-';
+        magnitude = 0 - magnitude;
+    }
+
+    writer->length += length + format_uint(magnitude, out + length);
+    return true;
+}
+
+bool writer_put_double(BufferedWriter* writer, double value) {
+    if (!writer) return false;
+
+    char* out = writer_reserve(writer, 32);
+    if (!out) return false;
+
+    if (isfinite(value) && fabs(value) < 1e15 && value == (double)(int64_t)value) {
+        size_t length = 0;
+        int64_t integral = (int64_t)value;
+        uint64_t magnitude = (uint64_t)integral;
+        if (integral < 0 || (integral == 0 && signbit(value))) {
+            out[length++] = '-';
+            magnitude = 0 - magnitude;
+        }
+        length += format_uint(magnitude, out + length);
+        out[length++] = '.';
+        out[length++] = '0';
+        writer->length += length;
+        return true;
+    }
+
+    int length = snprintf(out, 32, "%.15g", value);
+    if (isfinite(value) && strtod(out, NULL) != value) {
+        length = snprintf(out, 32, "%.17g", value);
+    }
+
+    writer->length += (size_t)length;
+    return true;
+}
+
+bool writer_put_u8(BufferedWriter* writer, uint8_t value) {
+    return writer_put_char(writer, (char)value);
+}
+
+bool writer_put_u32(BufferedWriter* writer, uint32_t value) {
+    unsigned char bytes[4];
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    return writer_put_bytes(writer, bytes, sizeof(bytes));
+}
+
+bool writer_put_u64(BufferedWriter* writer, uint64_t value) {
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+    return writer_put_bytes(writer, bytes, sizeof(bytes));
+}
+
+bool writer_put_f64(BufferedWriter* writer, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return writer_put_u64(writer, bits);
+}
@@ -0,0 +1,37 @@
+#ifndef SHADE_WRITER_H
+#define SHADE_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define WRITER_DEFAULT_CAPACITY (1 << 20)
+
+typedef struct {
+    int fd;
+    bool owns_fd;
+    char* buffer;
+    size_t length;
+    size_t capacity;
+    uint64_t bytes_written;
+    bool failed;
+} BufferedWriter;
+
+BufferedWriter* writer_open(const char* path, size_t capacity);
+BufferedWriter* writer_create_fd(int fd, size_t capacity);
+bool writer_flush(BufferedWriter* writer);
+bool writer_close(BufferedWriter* writer);
+
+bool writer_put_bytes(BufferedWriter* writer, const void* data, size_t length);
+bool writer_put_char(BufferedWriter* writer, char c);
+bool writer_put_string(BufferedWriter* writer, const char* text);
+bool writer_put_int(BufferedWriter* writer, int64_t value);
+bool writer_put_uint(BufferedWriter* writer, uint64_t value);
+bool writer_put_double(BufferedWriter* writer, double value);
+
+bool writer_put_u8(BufferedWriter* writer, uint8_t value);
+bool writer_put_u32(BufferedWriter* writer, uint32_t value);
+bool writer_put_u64(BufferedWriter* writer, uint64_t value);
+bool writer_put_f64(BufferedWriter* writer, double value);
+
+#endif
@@ -479,6 +479,740 @@ void test_edge_cases() {
     printf("Edge cases tests passed\n");
 }
 
+void test_cursor_streaming() {
+    printf("Testing cursor streaming...\n");
+    
+    ShadeDB* db = shade_db_create();
+    assert(db != NULL);
+    
+    const char* cols[] = {"id", "name", "score"};
+    const char* types[] = {"INT", "STRING", "FLOAT"};
+    shade_create_table(db, "events", cols, types, 3);
+    
+    for (int64_t i = 1; i <= 10; i++) {
+        const char* name = "event";
+        double score = i * 1.5;
+        const void* values[] = {&i, name, &score};
+        shade_insert(db, "events", values, 3);
+    }
+    shade_delete(db, "events", 4);
+    
+    ShadeCursor* cursor = shade_cursor_open(db, "events", false, 3);
+    assert(cursor != NULL);
+    assert(shade_cursor_column_count(cursor) == 3);
+    
+    size_t rows = 0;
+    int64_t id_sum = 0;
+    while (shade_cursor_next(cursor)) {
+        int64_t id;
+        const char* name;
+        double score;
+        assert(shade_cursor_get_int(cursor, 0, &id));
+        assert(shade_cursor_get_string(cursor, 1, &name));
+        assert(shade_cursor_get_float(cursor, 2, &score));
+        assert(strcmp(name, "event") == 0);
+        assert(score == id * 1.5);
+        assert(shade_cursor_row_id(cursor) == (uint64_t)id);
+        assert(!shade_cursor_is_ghost(cursor));
+        assert(!shade_cursor_get_int(cursor, 1, &id));
+        assert(!shade_cursor_get_int(cursor, 99, &id));
+        id_sum += id;
+        rows++;
+    }
+    assert(rows == 9);
+    assert(id_sum == 55 - 4);
+    assert(shade_cursor_next(cursor) == false);
+    shade_cursor_close(cursor);
+    
+    cursor = shade_cursor_open(db, "events", true, 0);
+    assert(cursor != NULL);
+    size_t ghosts = 0;
+    rows = 0;
+    while (shade_cursor_next(cursor)) {
+        if (shade_cursor_is_ghost(cursor)) ghosts++;
+        rows++;
+    }
+    assert(rows == 10);
+    assert(ghosts == 1);
+    shade_cursor_close(cursor);
+    
+    cursor = shade_cursor_open(db, "events", false, 4);
+    assert(shade_cursor_next(cursor));
+    assert(shade_cursor_next(cursor));
+    shade_cursor_close(cursor);
+    
+    cursor = shade_cursor_open(db, "missing", false, 4);
+    assert(cursor == NULL);
+    assert(shade_get_error() != NULL);
+    shade_clear_error();
+    
+    assert(shade_cursor_next(NULL) == false);
+    shade_cursor_close(NULL);
+    
+    shade_db_destroy(db);
+    printf("Cursor streaming tests passed\n");
+}
+
+void test_column_batch_accessors() {
+    printf("Testing column batch accessors...\n");
+    
+    ShadeDB* db = shade_db_create();
+    assert(db != NULL);
+    
+    const char* cols[] = {"id", "label", "weight", "flag"};
+    const char* types[] = {"INT", "STRING", "FLOAT", "BOOL"};
+    shade_create_table(db, "metrics", cols, types, 4);
+    
+    const char* labels[] = {"a", "b", "c", "d", "e", "f", "g", "h", "i", "j"};
+    for (int64_t i = 0; i < 10; i++) {
+        double weight = i * 0.25;
+        bool flag = (i % 2) == 0;
+        const void* values[] = {&i, labels[i], &weight, &flag};
+        shade_insert(db, "metrics", values, 4);
+    }
+    shade_delete(db, "metrics", 3);
+    
+    ShadeQueryResult* result = shade_select(db, "metrics", true);
+    assert(shade_result_count(result) == 10);
+    
+    int64_t ints[16];
+    uint8_t validity[2];
+    size_t rows = shade_get_int_column(result, 0, 0, 16, ints, validity);
+    assert(rows == 10);
+    for (size_t i = 0; i < rows; i++) {
+        assert(ints[i] == (int64_t)i);
+    }
+    assert(validity[0] == 0xFF && (validity[1] & 0x03) == 0x03);
+    
+    double floats[4];
+    rows = shade_get_float_column(result, 2, 4, 4, floats, NULL);
+    assert(rows == 4);
+    assert(floats[0] == 1.0 && floats[3] == 1.75);
+    
+    bool flags[10];
+    rows = shade_get_bool_column(result, 3, 0, 10, flags, NULL);
+    assert(rows == 10);
+    assert(flags[0] == true && flags[1] == false);
+    
+    const char* strings[3];
+    rows = shade_get_string_column(result, 1, 8, 3, strings, validity);
+    assert(rows == 2);
+    assert(strcmp(strings[0], "i") == 0 && strcmp(strings[1], "j") == 0);
+    assert((validity[0] & 0x03) == 0x03);
+    
+    uint8_t ghosts[2];
+    float strengths[10];
+    rows = shade_get_state_column(result, 0, 10, ghosts, strengths);
+    assert(rows == 10);
+    assert(ghosts[0] == 0x04 && ghosts[1] == 0x00);
+    assert(strengths[2] == 1.0f);
+    
+    assert(shade_get_int_column(result, 1, 0, 10, ints, NULL) == 0);
+    assert(shade_get_error() != NULL);
+    shade_clear_error();
+    
+    assert(shade_get_int_column(result, 9, 0, 10, ints, NULL) == 0);
+    assert(shade_get_error() != NULL);
+    shade_clear_error();
+    
+    assert(shade_get_int_column(result, 0, 10, 5, ints, NULL) == 0);
+    
+    shade_free_result(result);
+    shade_db_destroy(db);
+    printf("Column batch accessors tests passed\n");
+}
+
+void test_arrow_export() {
+    printf("Testing Arrow export...\n");
+    
+    ShadeDB* db = shade_db_create();
+    assert(db != NULL);
+    
+    const char* cols[] = {"id", "name", "score", "active"};
+    const char* types[] = {"INT", "STRING", "FLOAT", "BOOL"};
+    shade_create_table(db, "people", cols, types, 4);
+    
+    const char* names[] = {"Ann", "Bo", "Cyd"};
+    for (int64_t i = 0; i < 3; i++) {
+        double score = 10.0 + i;
+        bool active = i != 1;
+        const void* values[] = {&i, names[i], &score, &active};
+        shade_insert(db, "people", values, 4);
+    }
+    shade_delete(db, "people", 2);
+    
+    struct ArrowSchema schema;
+    struct ArrowArray array;
+    bool success = shade_table_export_arrow(db, "people", true, &schema, &array);
+    assert(success == true);
+    
+    assert(strcmp(schema.format, "+s") == 0);
+    assert(schema.n_children == 6);
+    assert(strcmp(schema.children[0]->format, "l") == 0);
+    assert(strcmp(schema.children[1]->format, "u") == 0);
+    assert(strcmp(schema.children[2]->format, "g") == 0);
+    assert(strcmp(schema.children[3]->format, "b") == 0);
+    assert(strcmp(schema.children[1]->name, "name") == 0);
+    assert(strcmp(schema.children[4]->name, ARROW_STATE_COLUMN) == 0);
+    assert(strcmp(schema.children[5]->name, ARROW_STRENGTH_COLUMN) == 0);
+    
+    assert(array.length == 3);
+    assert(array.n_children == 6);
+    
+    const int64_t* ids = array.children[0]->buffers[1];
+    assert(ids[0] == 0 && ids[2] == 2);
+    assert(array.children[0]->null_count == 0);
+    
+    const int32_t* offsets = array.children[1]->buffers[1];
+    const char* data = array.children[1]->buffers[2];
+    assert(offsets[0] == 0 && offsets[1] == 3 && offsets[3] == 8);
+    assert(strncmp(data + offsets[1], "Bo", 2) == 0);
+    
+    const double* scores = array.children[2]->buffers[1];
+    assert(scores[1] == 11.0);
+    
+    const uint8_t* active_bits = array.children[3]->buffers[1];
+    assert((active_bits[0] & 0x07) == 0x05);
+    
+    const int32_t* state_offsets = array.children[4]->buffers[1];
+    const char* states = array.children[4]->buffers[2];
+    assert(strncmp(states + state_offsets[1], "GHOST", 5) == 0);
+    
+    const float* strengths = array.children[5]->buffers[1];
+    assert(strengths[0] == 1.0f && strengths[1] == 1.0f);
+    
+    array.release(&array);
+    schema.release(&schema);
+    assert(array.release == NULL && schema.release == NULL);
+    
+    ShadeQueryResult* result = shade_select(db, "people", false);
+    success = shade_result_export_arrow(result, &schema, &array);
+    assert(success == true);
+    assert(array.length == 2);
+    
+    struct ArrowArray moved_child = *array.children[1];
+    array.children[1]->release = NULL;
+    array.release(&array);
+    moved_child.release(&moved_child);
+    schema.release(&schema);
+    shade_free_result(result);
+    
+    success = shade_table_export_arrow(db, "missing", false, &schema, &array);
+    assert(success == false);
+    assert(shade_get_error() != NULL);
+    shade_clear_error();
+    
+    shade_db_destroy(db);
+    printf("Arrow export tests passed\n");
+}
+
+void test_table_handles() {
+    printf("Testing table handles...\n");
+    
+    ShadeDB* db = shade_db_create();
+    assert(db != NULL);
+    
+    const char* cols[] = {"id", "name"};
+    const char* types[] = {"INT", "STRING"};
+    ShadeTable* created = shade_create_table(db, "accounts", cols, types, 2);
+    
+    ShadeTable* table = shade_table_open(db, "accounts");
+    assert(table != NULL);
+    assert(table == created);
+    assert(strcmp(shade_table_name(table), "accounts") == 0);
+    
+    for (int64_t i = 1; i <= 5; i++) {
+        const char* name = "holder";
+        const void* values[] = {&i, name};
+        assert(shade_table_insert(table, values, 2) == (uint64_t)i);
+    }
+    
+    const void* short_row[] = {NULL};
+    assert(shade_table_insert(table, short_row, 1) == 0);
+    assert(shade_get_error() != NULL);
+    shade_clear_error();
+    
+    assert(shade_table_delete(table, 2) == true);
+    assert(shade_table_delete(table, 2) == false);
+    shade_clear_error();
+    
+    ShadeQueryResult* result = shade_table_select(table, false);
+    assert(shade_result_count(result) == 4);
+    assert(shade_result_column_count(result) == 2);
+    shade_free_result(result);
+    
+    assert(shade_table_resurrect(table, 2) == true);
+    
+    ShadeCursor* cursor = shade_table_cursor_open(table, false, 2);
+    size_t rows = 0;
+    while (shade_cursor_next(cursor)) rows++;
+    assert(rows == 5);
+    shade_cursor_close(cursor);
+    
+    assert(shade_table_open(db, "missing") == NULL);
+    assert(shade_get_error() != NULL);
+    shade_clear_error();
+    
+    assert(shade_table_select(NULL, false) == NULL);
+    shade_clear_error();
+    
+    shade_db_destroy(db);
+    printf("Table handles tests passed\n");
+}
+
+void test_prepared_insert() {
+    printf("Testing prepared inserts...\n");
+    
+    ShadeDB* db = shade_db_create();
+    assert(db != NULL);
+    
+    const char* cols[] = {"id", "name", "score", "active"};
+    const char* types[] = {"INT", "STRING", "FLOAT", "BOOL"};
+    ShadeTable* table = shade_create_table(db, "players", cols, types, 4);
+    
+    ShadeInsert* insert = shade_insert_prepare(table);
+    assert(insert != NULL);
+    
+    for (int64_t i = 0; i < 3; i++) {
+        assert(shade_insert_bind_int(insert, 0, i));
+        assert(shade_insert_bind_string(insert, 1, "copied"));
+        assert(shade_insert_bind_float(insert, 2, i * 2.0));
+        assert(shade_insert_bind_bool(insert, 3, true));
+        assert(shade_insert_execute(insert) == (uint64_t)(i + 1));
+    }
+    
+    char* owned = malloc(6);
+    strcpy(owned, "moved");
+    assert(shade_insert_bind_int(insert, 0, 42));
+    assert(shade_insert_bind_string_move(insert, 1, owned));
+    assert(shade_insert_bind_null(insert, 2));
+    assert(shade_insert_execute(insert) == 4);
+    
+    assert(shade_insert_execute(insert) == 5);
+    
+    assert(shade_insert_bind_int(insert, 1, 7) == false);
+    assert(shade_get_error() != NULL);
+    shade_clear_error();
+    assert(shade_insert_bind_int(insert, 9, 7) == false);
+    shade_clear_error();
+    
+    assert(shade_insert_bind_string(insert, 1, "discarded"));
+    shade_insert_finalize(insert);
+    
+    ShadeQueryResult* result = shade_table_select(table, false);
+    assert(shade_result_count(result) == 5);
+    
+    const char* name;
+    assert(shade_get_string(result, 3, 1, &name));
+    assert(strcmp(name, "moved") == 0);
+    assert(name == owned);
+    assert(shade_is_null(result, 3, 2));
+    
+    double score;
+    assert(shade_get_float(result, 2, 2, &score));
+    assert(score == 4.0);
+    
+    assert(shade_is_null(result, 4, 0));
+    assert(shade_is_null(result, 4, 1));
+    
+    shade_free_result(result);
+    
+    assert(shade_insert_prepare(NULL) == NULL);
+    shade_clear_error();
+    
+    shade_db_destroy(db);
+    printf("Prepared insert tests passed\n");
+}
+
+void test_batch_insert() {
+    printf("Testing batch inserts...\n");
+    
+    ShadeDB* db = shade_db_create();
+    assert(db != NULL);
+    
+    const char* cols[] = {"id", "name"};
+    const char* types[] = {"INT", "STRING"};
+    shade_create_table(db, "batch", cols, types, 2);
+    
+    int64_t ids[100];
+    const void* values[200];
+    for (size_t i = 0; i < 100; i++) {
+        ids[i] = (int64_t)i * 10;
+        values[i * 2] = &ids[i];
+        values[i * 2 + 1] = "row";
+    }
+    
+    uint64_t first_id = shade_insert_batch(db, "batch", values, 2, 100);
+    assert(first_id == 1);
+    
+    ShadeTable* table = shade_table_open(db, "batch");
+    first_id = shade_table_insert_batch(table, values, 2, 3);
+    assert(first_id == 101);
+    
+    ShadeQueryResult* result = shade_select(db, "batch", false);
+    assert(shade_result_count(result) == 103);
+    
+    int64_t value;
+    assert(shade_get_int(result, 99, 0, &value) && value == 990);
+    assert(shade_get_int(result, 102, 0, &value) && value == 20);
+    shade_free_result(result);
+    
+    assert(shade_insert_batch(db, "batch", values, 3, 1) == 0);
+    assert(shade_get_error() != NULL);
+    shade_clear_error();
+    
+    assert(shade_insert_batch(db, "missing", values, 2, 1) == 0);
+    shade_clear_error();
+    
+    assert(shade_table_insert_batch(table, values, 2, 0) == 0);
+    shade_clear_error();
+    
+    shade_db_destroy(db);
+    printf("Batch insert tests passed\n");
+}
+
+void test_select_where() {
+    printf("Testing filtered selects...\n");
+    
+    ShadeDB* db = shade_db_create();
+    const char* cols[] = {"id", "city"};
+    const char* types[] = {"INT", "STRING"};
+    shade_create_table(db, "visits", cols, types, 2);
+    
+    const char* cities[] = {"Oslo", "Lima", "Oslo", "Pune"};
+    for (int64_t i = 0; i < 4; i++) {
+        const void* values[] = {&i, cities[i]};
+        shade_insert(db, "visits", values, 2);
+    }
+    shade_delete(db, "visits", 1);
+    
+    ShadeQueryResult* result = shade_select_where(db, "visits", "city = 'Oslo'", false);
+    assert(shade_result_count(result) == 1);
+    int64_t id;
+    assert(shade_get_int(result, 0, 0, &id) && id == 2);
+    shade_free_result(result);
+    
+    result = shade_select_where(db, "visits", "city = 'Oslo'", true);
+    assert(shade_result_count(result) == 2);
+    shade_free_result(result);
+    
+    assert(shade_select_where(db, "visits", "country = 'NO'", false) == NULL);
+    assert(strstr(shade_get_error(), "country") != NULL);
+    assert(shade_select_where(db, "visits", "id >", false) == NULL);
+    shade_clear_error();
+    
+    shade_db_destroy(db);
+    
+    printf("Filtered select tests passed\n");
+}
+
+void test_query_projection() {
+    printf("Testing projected queries...\n");
+    
+    ShadeDB* db = shade_db_create();
+    const char* cols[] = {"id", "label", "weight"};
+    const char* types[] = {"INT", "STRING", "FLOAT"};
+    shade_create_table(db, "parcels", cols, types, 3);
+    
+    for (int64_t i = 0; i < 6; i++) {
+        double weight = i * 2.0;
+        const void* values[] = {&i, "box", &weight};
+        shade_insert(db, "parcels", values, 3);
+    }
+    
+    ShadeQueryResult* result = shade_query(db, "SELECT weight, id FROM parcels WHERE id < 3");
+    assert(result != NULL);
+    assert(shade_result_count(result) == 3);
+    assert(shade_result_column_count(result) == 2);
+    assert(strcmp(shade_result_column_name(result, 0), "weight") == 0);
+    assert(strcmp(shade_result_column_type(result, 1), "INT") == 0);
+    assert(shade_result_column_name(result, 2) == NULL);
+    
+    double weight;
+    int64_t id;
+    assert(shade_get_float(result, 2, 0, &weight) && weight == 4.0);
+    assert(shade_get_int(result, 2, 1, &id) && id == 2);
+    assert(shade_get_string(result, 0, 2, NULL) == false);
+    
+    int64_t ids[3];
+    assert(shade_get_int_column(result, 1, 0, 3, ids, NULL) == 3);
+    assert(ids[0] == 0 && ids[2] == 2);
+    
+    struct ArrowSchema schema;
+    struct ArrowArray array;
+    assert(shade_result_export_arrow(result, &schema, &array));
+    assert(schema.n_children == 4);
+    assert(strcmp(schema.children[0]->name, "weight") == 0);
+    schema.release(&schema);
+    array.release(&array);
+    shade_free_result(result);
+    
+    result = shade_query(db, "DELETE FROM parcels WHERE weight > 6");
+    assert(shade_result_count(result) == 2);
+    shade_free_result(result);
+    
+    assert(shade_query(db, "SELECT nothing FROM parcels") == NULL);
+    assert(shade_query(db, "SELECT * FROM nowhere") == NULL);
+    shade_clear_error();
+    
+    shade_db_destroy(db);
+    
+    printf("Projected query tests passed\n");
+}
+
+void test_query_aggregates() {
+    printf("Testing aggregate queries...\n");
+    
+    ShadeDB* db = shade_db_create();
+    const char* cols[] = {"id", "price"};
+    const char* types[] = {"INT", "FLOAT"};
+    shade_create_table(db, "orders", cols, types, 2);
+    
+    for (int64_t i = 1; i <= 4; i++) {
+        double price = i * 10.0;
+        const void* values[] = {&i, &price};
+        shade_insert(db, "orders", values, 2);
+    }
+    shade_delete(db, "orders", 4);
+    
+    ShadeQueryResult* result = shade_query(db, "SELECT COUNT(*), SUM(price), MAX(id) FROM orders");
+    assert(result != NULL);
+    assert(shade_result_count(result) == 1);
+    assert(shade_result_column_count(result) == 3);
+    assert(strcmp(shade_result_column_name(result, 1), "SUM(price)") == 0);
+    assert(strcmp(shade_result_column_type(result, 0), "INT") == 0);
+    
+    int64_t count;
+    double sum;
+    assert(shade_get_int(result, 0, 0, &count) && count == 3);
+    assert(shade_get_float(result, 0, 1, &sum) && sum == 60.0);
+    assert(shade_get_int_column(result, 2, 0, 1, &count, NULL) == 1 && count == 3);
+    
+    struct ArrowSchema schema;
+    struct ArrowArray array;
+    assert(shade_result_export_arrow(result, &schema, &array));
+    assert(array.length == 1);
+    schema.release(&schema);
+    array.release(&array);
+    shade_free_result(result);
+    
+    result = shade_query(db, "SELECT WEIGHTED_SUM(price) FROM orders WITH GHOSTS");
+    assert(shade_get_float(result, 0, 0, &sum) && sum == 100.0);
+    shade_free_result(result);
+    
+    result = shade_query(db, "SELECT id, COUNT(*) FROM orders WHERE id > 1 GROUP BY id");
+    assert(shade_result_count(result) == 2);
+    assert(strcmp(shade_result_column_name(result, 0), "id") == 0);
+    for (size_t row = 0; row < 2; row++) {
+        int64_t id;
+        assert(shade_get_int(result, row, 0, &id) && (id == 2 || id == 3));
+        assert(shade_get_int(result, row, 1, &count) && count == 1);
+    }
+    shade_free_result(result);
+    
+    result = shade_query(db, "SELECT price FROM orders ORDER BY price DESC LIMIT 2");
+    assert(shade_result_count(result) == 2);
+    assert(shade_get_float(result, 0, 0, &sum) && sum == 30.0);
+    assert(shade_get_float(result, 1, 0, &sum) && sum == 20.0);
+    shade_free_result(result);
+    
+    shade_db_destroy(db);
+    
+    printf("Aggregate query tests passed\n");
+}
+
+void test_table_statistics() {
+    printf("Testing table statistics...\n");
+    
+    ShadeDB* db = shade_db_create();
+    const char* cols[] = {"id", "tag"};
+    const char* types[] = {"INT", "STRING"};
+    shade_create_table(db, "events", cols, types, 2);
+    
+    for (int64_t i = 1; i <= 100; i++) {
+        const char* tag = i % 2 == 0 ? "even" : "odd";
+        const void* values[] = {&i, tag};
+        shade_insert(db, "events", values, 2);
+    }
+    shade_delete(db, "events", 1);
+    shade_delete(db, "events", 2);
+    
+    size_t living, ghosts, exorcised;
+    assert(shade_table_row_counts(db, "events", &living, &ghosts, &exorcised));
+    assert(living == 98 && ghosts == 2 && exorcised == 0);
+    
+    size_t nulls, buckets;
+    double distinct;
+    assert(shade_column_stats(db, "events", 1, &nulls, &distinct, &buckets));
+    assert(nulls == 0 && distinct == 2.0 && buckets == 0);
+    
+    assert(shade_analyze(db, "events"));
+    assert(shade_analyze(db, NULL));
+    assert(shade_column_stats(db, "events", 0, &nulls, &distinct, &buckets));
+    assert(distinct == 100.0 && buckets > 0);
+    
+    assert(!shade_analyze(db, "missing"));
+    assert(!shade_table_row_counts(db, "missing", &living, NULL, NULL));
+    assert(!shade_column_stats(db, "events", 2, &nulls, NULL, NULL));
+    assert(strcmp(shade_get_error(), "Column index out of range") == 0);
+    
+    shade_db_destroy(db);
+    
+    printf("Table statistics tests passed\n");
+}
+
+void test_explain_and_sampling() {
+    printf("Testing EXPLAIN and profile sampling...\n");
+    
+    ShadeDB* db = shade_db_create();
+    const char* cols[] = {"id", "price"};
+    const char* types[] = {"INT", "FLOAT"};
+    shade_create_table(db, "orders", cols, types, 2);
+    for (int64_t i = 1; i <= 50; i++) {
+        double price = i * 2.0;
+        const void* values[] = {&i, &price};
+        shade_insert(db, "orders", values, 2);
+    }
+    
+    ShadeQueryResult* result = shade_query(db, "EXPLAIN SELECT * FROM orders WHERE price > 10 ORDER BY price");
+    assert(result != NULL && shade_result_count(result) == 2);
+    assert(strcmp(shade_result_column_name(result, 0), "QUERY PLAN") == 0);
+    const char* line;
+    assert(shade_get_string(result, 0, 0, &line) && strcmp(line, "Sort (1 key)") == 0);
+    assert(shade_get_string(result, 1, 0, &line) && strstr(line, "-> Seq Scan on orders"));
+    shade_free_result(result);
+    
+    assert(shade_last_profile(db) == NULL);
+    assert(shade_set_profile_sampling(db, 2));
+    
+    result = shade_query(db, "SELECT * FROM orders WHERE id <= 5");
+    shade_free_result(result);
+    assert(shade_last_profile(db) == NULL);
+    
+    result = shade_query(db, "SELECT COUNT(*) FROM orders");
+    shade_free_result(result);
+    const char* profile = shade_last_profile(db);
+    assert(profile != NULL && strncmp(profile, "Aggregate on orders  (actual rows=1 in=50", 41) == 0);
+    assert(strstr(profile, "\nExecution time: "));
+    
+    assert(shade_set_profile_sampling(db, 0));
+    result = shade_query(db, "SELECT * FROM orders");
+    shade_free_result(result);
+    assert(shade_last_profile(db) == profile);
+    assert(!shade_set_profile_sampling(NULL, 1));
+    
+    shade_db_destroy(db);
+    
+    printf("EXPLAIN and profile sampling tests passed\n");
+}
+
+void test_prepared_statements() {
+    printf("Testing prepared statements and the statement cache...\n");
+    
+    ShadeDB* db = shade_db_create();
+    const char* cols[] = {"id", "name", "price"};
+    const char* types[] = {"INT", "STRING", "FLOAT"};
+    shade_create_table(db, "orders", cols, types, 3);
+    const char* customer_cols[] = {"id", "tier"};
+    const char* customer_types[] = {"INT", "INT"};
+    shade_create_table(db, "customers", customer_cols, customer_types, 2);
+    for (int64_t i = 1; i <= 50; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "item%d", (int)(i % 5));
+        double price = i * 2.0;
+        const void* values[] = {&i, name, &price};
+        shade_insert(db, "orders", values, 3);
+        int64_t tier = i % 3;
+        const void* customer[] = {&i, &tier};
+        shade_insert(db, "customers", customer, 2);
+    }
+    
+    ShadeStatement* select = shade_prepare(db, "SELECT id FROM orders WHERE price >= ? AND name = ? ORDER BY id DESC");
+    assert(select != NULL && shade_statement_param_count(select) == 2);
+    assert(shade_execute(select) == NULL);
+    assert(strcmp(shade_get_error(), "Parameter 0 is not bound") == 0);
+    
+    assert(shade_bind_int(select, 0, 60));
+    assert(shade_bind_string(select, 1, "item3"));
+    assert(!shade_bind_int(select, 2, 1));
+    ShadeQueryResult* result = shade_execute(select);
+    assert(result != NULL && shade_result_count(result) == 4);
+    int64_t id;
+    assert(shade_get_int(result, 0, 0, &id) && id == 48);
+    shade_free_result(result);
+    
+    assert(shade_bind_float(select, 0, 90.5));
+    result = shade_execute(select);
+    assert(result != NULL && shade_result_count(result) == 1);
+    shade_free_result(result);
+    
+    assert(shade_bind_bool(select, 1, true));
+    assert(shade_execute(select) == NULL);
+    assert(shade_bind_string(select, 1, "item3"));
+    
+    ShadeStatement* count = shade_prepare(db, "SELECT name, COUNT(*) FROM orders WHERE id <= ? GROUP BY name ORDER BY name");
+    ShadeStatement* join = shade_prepare(db, "SELECT * FROM orders JOIN customers ON orders.id = customers.id WHERE tier = ?");
+    assert(count != NULL && join != NULL);
+    for (int64_t limit = 10; limit <= 20; limit += 10) {
+        assert(shade_bind_int(count, 0, limit));
+        result = shade_execute(count);
+        assert(result != NULL && shade_result_count(result) == 5);
+        assert(shade_get_int(result, 0, 1, &id) && id == limit / 5);
+        shade_free_result(result);
+        
+        assert(shade_bind_int(join, 0, limit / 10));
+        result = shade_execute(join);
+        assert(result != NULL && shade_result_count(result) == 17);
+        shade_free_result(result);
+    }
+    
+    size_t hits, misses;
+    assert(shade_statement_cache_stats(db, &hits, &misses) && hits == 0 && misses == 3);
+    for (int i = 0; i < 3; i++) {
+        result = shade_query(db, "SELECT COUNT(*) FROM orders WHERE price > 50");
+        assert(result != NULL);
+        shade_free_result(result);
+    }
+    assert(shade_statement_cache_stats(db, &hits, &misses) && hits == 2 && misses == 4);
+    assert(shade_query(db, "SELECT * FROM orders WHERE id = ?") == NULL);
+    
+    ShadeStatement* delete = shade_prepare(db, "DELETE FROM orders WHERE id = ?");
+    for (int64_t target = 1; target <= 3; target++) {
+        assert(shade_bind_int(delete, 0, target));
+        result = shade_execute(delete);
+        assert(result != NULL && shade_result_count(result) == 1);
+        shade_free_result(result);
+    }
+    result = shade_query(db, "SELECT COUNT(*) FROM orders");
+    int64_t living;
+    assert(shade_get_int(result, 0, 0, &living) && living == 47);
+    shade_free_result(result);
+    
+    assert(shade_drop_table(db, "orders"));
+    assert(shade_execute(select) == NULL);
+    assert(strcmp(shade_get_error(), "Table 'orders' not found") == 0);
+    
+    shade_create_table(db, "orders", cols, types, 3);
+    int64_t new_id = 7;
+    double price = 100.0;
+    const void* values[] = {&new_id, "item3", &price};
+    shade_insert(db, "orders", values, 3);
+    result = shade_execute(select);
+    assert(result != NULL && shade_result_count(result) == 1);
+    shade_free_result(result);
+    
+    shade_finalize(select);
+    shade_finalize(count);
+    shade_finalize(join);
+    shade_finalize(delete);
+    shade_finalize(NULL);
+    assert(shade_prepare(db, "SELECT * FROM nowhere WHERE id = ?") == NULL);
+    
+    shade_db_destroy(db);
+    
+    printf("Prepared statement tests passed\n");
+}
+
 int main() {
     printf("=== Shade Embedded API Tests ===\n\n");
     
@@ -493,6 +1227,18 @@ int main() {
     test_ghost_stats_accessors();
     test_memory_management();
     test_edge_cases();
+    test_cursor_streaming();
+    test_column_batch_accessors();
+    test_arrow_export();
+    test_table_handles();
+    test_prepared_insert();
+    test_batch_insert();
+    test_select_where();
+    test_query_projection();
+    test_query_aggregates();
+    test_table_statistics();
+    test_explain_and_sampling();
+    test_prepared_statements();
     
     printf("\nAll embedded API tests passed!\n");
     return 0;
@@ -10,6 +10,10 @@
 #include "../src/storage/memory.h"
 #include "../src/query/executor.h"
 #include "../src/query/planner.h"
+#include "../src/query/export.h"
+#include "../src/query/parser.h"
+#include "../src/query/statement.h"
+#include "../src/api/cli.h"
 
 void test_query_creation() {
     printf("Testing query creation...\n");
@@ -165,6 +169,1972 @@ void test_ghost_threshold() {
     printf("Ghost threshold tests passed\n");
 }
 
+void test_where_clause() {
+    printf("Testing WHERE predicates...\n");
+    
+    MemoryStorage* storage = memory_storage_create();
+    ColumnSchema columns[] = {
+        column_create("id", VALUE_INTEGER),
+        column_create("name", VALUE_STRING),
+        column_create("score", VALUE_FLOAT),
+        column_create("active", VALUE_BOOLEAN)
+    };
+    TableSchema* schema = tableschema_create("people", columns, 4);
+    MemoryTable* table = memory_storage_create_table(storage, "people", schema);
+    
+    const size_t ROW_COUNT = 2500;
+    char name[32];
+    for (size_t i = 0; i < ROW_COUNT; i++) {
+        snprintf(name, sizeof(name), "user%04zu", i);
+        Value values[] = {
+            value_integer((int64_t)i), value_string(name),
+            i % 10 == 0 ? value_null() : value_float(i / 2.0), value_boolean(i % 2 == 0)
+        };
+        memory_table_insert(table, values);
+        value_destroy(&values[1]);
+    }
+    
+    struct { const char* text; size_t expected; } cases[] = {
+        { "SELECT * FROM people WHERE id < 100", 100 },
+        { "SELECT * FROM people WHERE id BETWEEN 1000 AND 1999", 1000 },
+        { "SELECT * FROM people WHERE id NOT BETWEEN 10 AND 2499", 10 },
+        { "SELECT * FROM people WHERE score >= 1000", 450 },
+        { "SELECT * FROM people WHERE score > 10.5 AND score <= 20", 17 },
+        { "SELECT * FROM people WHERE score IS NULL", 250 },
+        { "SELECT * FROM people WHERE active = true AND id < 10", 5 },
+        { "SELECT * FROM people WHERE name = 'user0042' OR name = \"user2000\"", 2 },
+        { "SELECT * FROM people WHERE name >= 'user2400'", 100 },
+        { "SELECT * FROM people WHERE NOT (id > 5 OR active != false)", 3 },
+        { "SELECT * FROM people WHERE id = 2.5", 0 },
+        { "SELECT * FROM people WHERE _id = 1 AND id = 0;", 1 },
+        { "select * from people where ID >= -1 and id <> 3", 2499 }
+    };
+    
+    char error[PARSER_ERROR_SIZE];
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        Query* query = parse_query(cases[i].text, error, sizeof(error));
+        assert(query != NULL);
+        assert(query->type == QUERY_SELECT);
+        
+        QueryResult* result = execute_table_query(table, query);
+        assert(result != NULL);
+        assert(result->count == cases[i].expected);
+        
+        queryresult_destroy(result);
+        query_destroy(query);
+    }
+    
+    assert(parse_query("SELECT * FROM people WHERE", error, sizeof(error)) == NULL);
+    assert(strstr(error, "end of input") != NULL);
+    assert(parse_query("SELECT * FROM people WHERE id = 'open", error, sizeof(error)) == NULL);
+    assert(parse_query("SELECT * FROM people WHERE (id = 1", error, sizeof(error)) == NULL);
+    assert(parse_query("UPDATE people", error, sizeof(error)) == NULL);
+    
+    Predicate* unknown = parse_predicate("missing = 1", error, sizeof(error));
+    assert(unknown != NULL);
+    assert(predicate_bind(unknown, schema, error, sizeof(error)) == false);
+    assert(strcmp(error, "Unknown column 'missing'") == 0);
+    predicate_destroy(unknown);
+    
+    Predicate* mismatch = parse_predicate("active > true", error, sizeof(error));
+    assert(predicate_bind(mismatch, schema, error, sizeof(error)) == false);
+    predicate_destroy(mismatch);
+    
+    Query* remove_query = parse_query("DELETE FROM people WHERE id >= 2000 AND active = true", error, sizeof(error));
+    assert(remove_query != NULL && remove_query->type == QUERY_DELETE);
+    QueryResult* removed = execute_table_query(table, remove_query);
+    assert(removed->count == 250);
+    assert(memory_table_get(table, 2001)->state == DATA_STATE_GHOST);
+    queryresult_destroy(removed);
+    query_destroy(remove_query);
+    
+    Query* living = parse_query("SELECT * FROM people WHERE id >= 2000", error, sizeof(error));
+    QueryResult* result = execute_table_query(table, living);
+    assert(result->count == 250);
+    assert(result->ghost_count == 250);
+    queryresult_destroy(result);
+    
+    living->include_ghosts = true;
+    QueryCursor* cursor = query_cursor_open_table(table, living);
+    DataRecord* batch[64];
+    size_t total = 0;
+    size_t fetched;
+    while ((fetched = query_cursor_fetch(cursor, batch, 64)) > 0) {
+        for (size_t i = 0; i < fetched; i++) {
+            assert(batch[i]->values[0].data.integer >= 2000);
+        }
+        total += fetched;
+    }
+    assert(total == 500);
+    query_cursor_close(cursor);
+    query_destroy(living);
+    
+    memory_storage_destroy(storage);
+    for (int i = 0; i < 4; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("WHERE predicate tests passed\n");
+}
+
+void test_predicate_bytecode() {
+    printf("Testing compiled predicate programs...\n");
+    
+    ColumnSchema columns[] = {
+        column_create("n", VALUE_INTEGER),
+        column_create("x", VALUE_FLOAT),
+        column_create("flag", VALUE_BOOLEAN),
+        column_create("tag", VALUE_STRING)
+    };
+    TableSchema* schema = tableschema_create("numbers", columns, 4);
+    
+    const size_t ROW_COUNT = 3000;
+    DataRecord** records = malloc(sizeof(DataRecord*) * ROW_COUNT);
+    for (size_t i = 0; i < ROW_COUNT; i++) {
+        Value values[] = {
+            i % 100 == 99 ? value_null() : value_integer((int64_t)i - 1500),
+            i % 50 == 7 ? value_null() : value_float(i * 0.25),
+            value_boolean(i % 3 == 0),
+            i % 40 == 3 ? value_null() : value_string(i % 2 ? "odd" : "even")
+        };
+        records[i] = datarecord_create(i + 1, values, 4);
+        value_destroy(&values[3]);
+    }
+    
+    struct { const char* text; bool constant; bool value; } folds[] = {
+        { "n = 2.5", true, false },
+        { "NOT n = 2.5", false, false },
+        { "NOT _id IS NULL", true, true },
+        { "x BETWEEN 5 AND 1", true, false },
+        { "_id IS NOT NULL OR n > 3", true, true },
+        { "n > 3 AND (tag < 'a' AND flag = true)", false, false },
+        { "n > 3 AND _id IS NULL", true, false },
+        { "n < 1e30", false, false }
+    };
+    
+    char error[PARSER_ERROR_SIZE];
+    for (size_t i = 0; i < sizeof(folds) / sizeof(folds[0]); i++) {
+        Predicate* predicate = parse_predicate(folds[i].text, error, sizeof(error));
+        assert(predicate_bind(predicate, schema, error, sizeof(error)));
+        
+        PredicateProgram* program = predicate_compile(predicate);
+        assert(program != NULL);
+        bool value;
+        assert(predicate_program_is_constant(program, &value) == folds[i].constant);
+        if (folds[i].constant) assert(value == folds[i].value);
+        
+        predicate_program_destroy(program);
+        predicate_destroy(predicate);
+    }
+    
+    struct { const char* text; const char* equivalent; } pairs[] = {
+        { "n < 2.5", "n <= 2" },
+        { "n >= -3.5", "n > -4" },
+        { "n BETWEEN -10.5 AND 10.5", "n >= -10 AND n <= 10" },
+        { "n != 7.5", "n IS NOT NULL" },
+        { "n < 1e30", "n IS NOT NULL" },
+        { "flag != true", "flag = false" },
+        { "NOT (tag = 'odd' OR x > 100) AND n > 0", "tag = 'even' AND x <= 100 AND n >= 1" },
+        /* A negated comparison is as unknown on NULL as the comparison itself. */
+        { "NOT n = 2.5", "n IS NOT NULL" },
+        { "NOT x = 1.5", "x != 1.5" },
+        { "NOT (tag = 'odd')", "tag != 'odd'" },
+        { "NOT x BETWEEN 5 AND 10", "x < 5 OR x > 10" },
+        { "NOT x BETWEEN 5 AND 1", "x IS NOT NULL" },
+        { "NOT (n > 0 AND tag = 'odd')", "n <= 0 OR tag != 'odd'" },
+        { "NOT (NOT x > 3)", "x > 3" },
+        { "NOT tag IS NULL", "tag IS NOT NULL" }
+    };
+    
+    uint8_t* mask = malloc(ROW_COUNT);
+    uint8_t* expected = malloc(ROW_COUNT);
+    for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++) {
+        Predicate* left = parse_predicate(pairs[i].text, error, sizeof(error));
+        Predicate* right = parse_predicate(pairs[i].equivalent, error, sizeof(error));
+        assert(predicate_bind(left, schema, error, sizeof(error)));
+        assert(predicate_bind(right, schema, error, sizeof(error)));
+        
+        PredicateProgram* program = predicate_compile(left);
+        PredicateProgram* reference = predicate_compile(right);
+        assert(predicate_program_run(program, records, ROW_COUNT, mask));
+        assert(predicate_program_run(reference, records, ROW_COUNT, expected));
+        assert(memcmp(mask, expected, ROW_COUNT) == 0);
+        
+        predicate_program_destroy(program);
+        predicate_program_destroy(reference);
+        predicate_destroy(left);
+        predicate_destroy(right);
+    }
+    
+    Predicate* predicate = parse_predicate("NOT x = 1.5", error, sizeof(error));
+    predicate_bind(predicate, schema, error, sizeof(error));
+    PredicateProgram* program = predicate_compile(predicate);
+    assert(predicate_program_run(program, records, ROW_COUNT, mask));
+    assert(mask[7] == 0 && mask[8] == 1);
+    predicate_program_destroy(program);
+    predicate_destroy(predicate);
+    
+    /* A string without text, as shade_insert stores a NULL pointer, is NULL to every test. */
+    free(records[23]->values[3].data.string);
+    records[23]->values[3].data.string = NULL;
+    const char* textless[] = {"tag = 'odd'", "tag != 'even'", "NOT tag = 'even'", "tag BETWEEN 'a' AND 'z'",
+                              "tag IS NULL", "tag IS NOT NULL", "NOT tag IS NULL"};
+    for (size_t i = 0; i < sizeof(textless) / sizeof(textless[0]); i++) {
+        predicate = parse_predicate(textless[i], error, sizeof(error));
+        assert(predicate_bind(predicate, schema, error, sizeof(error)));
+        program = predicate_compile(predicate);
+        assert(predicate_program_run(program, records, ROW_COUNT, mask));
+        assert(mask[23] == (i == 4) && mask[25] == (i < 4 || i == 5 || i == 6));
+        predicate_program_destroy(program);
+        predicate_destroy(predicate);
+    }
+    
+    predicate = parse_predicate("n >= 0 AND flag = true", error, sizeof(error));
+    predicate_bind(predicate, schema, error, sizeof(error));
+    program = predicate_compile(predicate);
+    
+    DataRecord** subset = malloc(sizeof(DataRecord*) * ROW_COUNT);
+    memcpy(subset, records, sizeof(DataRecord*) * ROW_COUNT);
+    size_t kept = predicate_program_filter(program, subset, ROW_COUNT);
+    assert(kept == 495);
+    for (size_t i = 0; i < kept; i++) {
+        assert(subset[i]->values[0].data.integer >= 0 && subset[i]->values[2].data.boolean);
+        assert(i == 0 || subset[i]->id > subset[i - 1]->id);
+    }
+    
+    free(subset);
+    predicate_program_destroy(program);
+    predicate_destroy(predicate);
+    free(mask);
+    free(expected);
+    for (size_t i = 0; i < ROW_COUNT; i++) {
+        datarecord_destroy(records[i]);
+    }
+    free(records);
+    tableschema_destroy(schema);
+    for (int i = 0; i < 4; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("Compiled predicate tests passed\n");
+}
+
+void test_projection() {
+    printf("Testing column projection...\n");
+    
+    MemoryStorage* storage = memory_storage_create();
+    ColumnSchema columns[] = {
+        column_create("a", VALUE_INTEGER),
+        column_create("b", VALUE_STRING),
+        column_create("c", VALUE_FLOAT)
+    };
+    TableSchema* schema = tableschema_create("wide", columns, 3);
+    MemoryTable* table = memory_storage_create_table(storage, "wide", schema);
+    
+    for (int64_t i = 0; i < 10; i++) {
+        Value values[] = { value_integer(i), value_string("text"), value_float(i * 1.5) };
+        memory_table_insert(table, values);
+        value_destroy(&values[1]);
+    }
+    
+    char error[PARSER_ERROR_SIZE];
+    Query* query = parse_query("SELECT c, A FROM wide WHERE a >= 5", error, sizeof(error));
+    assert(query != NULL);
+    assert(query->select_count == 2);
+    assert(strcmp(query->select_columns[0], "c") == 0);
+    assert(query_bind(query, schema, error, sizeof(error)));
+    
+    QueryResult* result = execute_table_query(table, query);
+    assert(result->count == 5);
+    assert(result->column_count == 2);
+    assert(result->column_map[0] == 2 && result->column_map[1] == 0);
+    queryresult_destroy(result);
+    
+    QueryCursor* cursor = query_cursor_open_table(table, query);
+    assert(cursor->column_count == 2 && cursor->column_map[0] == 2);
+    query_cursor_close(cursor);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM wide", error, sizeof(error));
+    result = execute_table_query(table, query);
+    assert(result->column_count == 3 && result->column_map[2] == 2);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT a, missing FROM wide", error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)) == false);
+    assert(strcmp(error, "Unknown column 'missing'") == 0);
+    assert(execute_table_query(table, query) == NULL);
+    query_destroy(query);
+    
+    assert(parse_query("SELECT a, FROM wide", error, sizeof(error)) == NULL);
+    assert(parse_query("SELECT FROM wide", error, sizeof(error)) == NULL);
+    
+    memory_storage_destroy(storage);
+    for (int i = 0; i < 3; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("Column projection tests passed\n");
+}
+
+void test_aggregates() {
+    printf("Testing aggregates...\n");
+    
+    MemoryStorage* storage = memory_storage_create();
+    ColumnSchema columns[] = {
+        column_create("n", VALUE_INTEGER),
+        column_create("x", VALUE_FLOAT),
+        column_create("tag", VALUE_STRING)
+    };
+    TableSchema* schema = tableschema_create("agg", columns, 3);
+    MemoryTable* table = memory_storage_create_table(storage, "agg", schema);
+    
+    const size_t rows = 150000;
+    char tag[16];
+    for (size_t i = 0; i < rows; i++) {
+        snprintf(tag, sizeof(tag), "tag%zu", i % 7);
+        Value values[] = {
+            i % 10 == 0 ? value_null() : value_integer((int64_t)i - 1000),
+            value_float(i * 0.25),
+            value_string(tag)
+        };
+        memory_table_insert(table, values);
+        value_destroy(&values[2]);
+    }
+    
+    for (size_t i = 3; i < rows; i += 4) {
+        datarecord_mark_ghost(table->records[i], time(NULL));
+        table->records[i]->ghost_strength = 0.5f;
+    }
+    
+    int64_t living = 0, n_count = 0, n_sum = 0, n_min = INT64_MAX, n_max = INT64_MIN, small = 0;
+    double x_sum = 0.0, weight = 0.0, weighted_x = 0.0;
+    for (size_t i = 0; i < table->record_count; i++) {
+        DataRecord* record = table->records[i];
+        double w = record->state == DATA_STATE_GHOST ? 0.5 : 1.0;
+        weight += w;
+        weighted_x += w * record->values[1].data.float_val;
+        if (record->state != DATA_STATE_LIVING) continue;
+        
+        living++;
+        x_sum += record->values[1].data.float_val;
+        small += record->values[1].data.float_val < 100.0;
+        if (record->values[0].type == VALUE_INTEGER) {
+            int64_t n = record->values[0].data.integer;
+            n_count++;
+            n_sum += n;
+            if (n < n_min) n_min = n;
+            if (n > n_max) n_max = n;
+        }
+    }
+    
+    char error[PARSER_ERROR_SIZE];
+    Query* query = parse_query("SELECT COUNT(*), count(n), SUM(n), AVG(x), MIN(n), MAX(n), MAX(tag) FROM agg",
+                               error, sizeof(error));
+    assert(query != NULL && query->aggregate_count == 7 && query->select_count == 0);
+    assert(query_bind(query, schema, error, sizeof(error)));
+    
+    QueryResult* result = execute_table_query(table, query);
+    assert(result != NULL && result->derived);
+    assert(result->count == 1 && result->column_count == 7);
+    assert(result->ghost_count == rows / 4);
+    assert(strcmp(result->schema->columns[0].name, "COUNT(*)") == 0);
+    assert(strcmp(result->schema->columns[1].name, "COUNT(n)") == 0);
+    assert(result->schema->columns[3].type == VALUE_FLOAT);
+    assert(result->schema->columns[6].type == VALUE_STRING);
+    
+    Value* values = result->records[0]->values;
+    assert(values[0].data.integer == living);
+    assert(values[1].data.integer == n_count);
+    assert(values[2].type == VALUE_INTEGER && values[2].data.integer == n_sum);
+    assert(fabs(values[3].data.float_val - x_sum / living) < 1e-6);
+    assert(values[4].data.integer == n_min && values[5].data.integer == n_max);
+    assert(strcmp(values[6].data.string, "tag6") == 0);
+    queryresult_destroy(result);
+    
+    assert(query_cursor_open_table(table, query) == NULL);
+    query_destroy(query);
+    
+    query = parse_query("SELECT WEIGHTED_COUNT(*), WEIGHTED_SUM(x), WEIGHTED_AVG(x), COUNT(*) FROM agg WITH GHOSTS",
+                        error, sizeof(error));
+    assert(query != NULL && query_bind(query, schema, error, sizeof(error)));
+    result = execute_table_query(table, query);
+    values = result->records[0]->values;
+    assert(values[0].type == VALUE_FLOAT && fabs(values[0].data.float_val - weight) < 1e-6);
+    assert(fabs(values[1].data.float_val - weighted_x) / weighted_x < 1e-12);
+    assert(fabs(values[2].data.float_val - weighted_x / weight) < 1e-6);
+    assert(values[3].data.integer == (int64_t)rows);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT COUNT(*), SUM(n), MIN(tag), WEIGHTED_AVG(x) FROM agg WHERE n > 1000000",
+                        error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)));
+    result = execute_table_query(table, query);
+    values = result->records[0]->values;
+    assert(values[0].data.integer == 0);
+    assert(values[1].type == VALUE_NULL && values[2].type == VALUE_NULL && values[3].type == VALUE_NULL);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT COUNT(*) FROM agg WHERE x < 100", error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)));
+    result = execute_table_query(table, query);
+    assert(result->records[0]->values[0].data.integer == small);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT SUM(tag) FROM agg", error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)) == false);
+    assert(strcmp(error, "SUM requires a numeric column, got 'tag'") == 0);
+    query_destroy(query);
+    
+    assert(parse_query("SELECT AVG(*) FROM agg", error, sizeof(error)) == NULL);
+    assert(parse_query("SELECT n, COUNT(*) FROM agg", error, sizeof(error)) == NULL);
+    assert(parse_query("SELECT MEDIAN(n) FROM agg", error, sizeof(error)) == NULL);
+    assert(parse_query("SELECT COUNT(n FROM agg", error, sizeof(error)) == NULL);
+    
+    memory_storage_destroy(storage);
+    for (int i = 0; i < 3; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("Aggregate tests passed\n");
+}
+
+void test_group_by() {
+    printf("Testing GROUP BY...\n");
+    
+    MemoryStorage* storage = memory_storage_create();
+    ColumnSchema columns[] = {
+        column_create("k", VALUE_INTEGER),
+        column_create("name", VALUE_STRING),
+        column_create("even", VALUE_BOOLEAN),
+        column_create("v", VALUE_FLOAT)
+    };
+    TableSchema* schema = tableschema_create("grp", columns, 4);
+    MemoryTable* table = memory_storage_create_table(storage, "grp", schema);
+    
+    const size_t rows = 200000;
+    char name[16];
+    for (size_t i = 0; i < rows; i++) {
+        snprintf(name, sizeof(name), "name%zu", i % 37);
+        Value values[] = {
+            i % 1001 == 1000 ? value_null() : value_integer((int64_t)(i % 1001)),
+            value_string(name),
+            value_boolean(i % 2 == 0),
+            value_float((double)(i % 10))
+        };
+        memory_table_insert(table, values);
+        value_destroy(&values[1]);
+    }
+    for (size_t i = 2; i < rows; i += 3) {
+        datarecord_mark_ghost(table->records[i], time(NULL));
+    }
+    
+    int64_t counts[1001] = {0};
+    double sums[1001] = {0};
+    int64_t name_counts[37] = {0};
+    for (size_t i = 0; i < table->record_count; i++) {
+        DataRecord* record = table->records[i];
+        if (record->state != DATA_STATE_LIVING) continue;
+        
+        size_t key = record->values[0].type == VALUE_NULL ? 1000 : (size_t)record->values[0].data.integer;
+        counts[key]++;
+        sums[key] += record->values[3].data.float_val;
+        name_counts[atoi(record->values[1].data.string + 4)]++;
+    }
+    
+    char error[PARSER_ERROR_SIZE];
+    Query* query = parse_query("SELECT SUM(v), k, COUNT(*) FROM grp GROUP BY k", error, sizeof(error));
+    assert(query != NULL && query->group_count == 1 && query->aggregates[1].position == 2);
+    assert(query_bind(query, schema, error, sizeof(error)));
+    
+    for (int pass = 0; pass < 2; pass++) {
+        query->memory_budget = pass == 0 ? 0 : 4096;
+        QueryResult* result = execute_table_query(table, query);
+        assert(result != NULL && result->derived && result->count == 1001);
+        assert(result->column_count == 3);
+        assert(strcmp(result->schema->columns[1].name, "k") == 0);
+        
+        bool seen[1001] = {false};
+        for (size_t i = 0; i < result->count; i++) {
+            Value* values = result->records[i]->values;
+            size_t key = values[1].type == VALUE_NULL ? 1000 : (size_t)values[1].data.integer;
+            assert(!seen[key]);
+            seen[key] = true;
+            assert(values[2].data.integer == counts[key]);
+            assert(fabs(values[0].data.float_val - sums[key]) < 1e-6);
+        }
+        queryresult_destroy(result);
+    }
+    query_destroy(query);
+    
+    query = parse_query("SELECT name, even, COUNT(*), MAX(k) FROM grp WHERE k < 500 GROUP BY name, even",
+                        error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)));
+    QueryResult* result = execute_table_query(table, query);
+    assert(result->count == 74);
+    for (size_t i = 0; i < result->count; i++) {
+        assert(strncmp(result->records[i]->values[0].data.string, "name", 4) == 0);
+        assert(result->records[i]->values[3].data.integer < 500);
+    }
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT name, COUNT(*) FROM grp WHERE k > 5000 GROUP BY name", error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)));
+    result = execute_table_query(table, query);
+    assert(result != NULL && result->count == 0);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT name, COUNT(*) FROM grp GROUP BY name", error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)));
+    
+    GroupOutput outputs[] = { { false, 0 }, { true, 0 } };
+    GroupBy* groups = groupby_create(query->group_by, 1, query->aggregates, 1, outputs, 2, 2, 2, 2048);
+    assert(groups != NULL);
+    for (size_t i = 0; i < table->record_count; i++) {
+        if (table->records[i]->state == DATA_STATE_LIVING) {
+            assert(groupby_add(groups, i % 2, &table->records[i], 1));
+        }
+    }
+    
+    DataRecord** records;
+    size_t count;
+    assert(groupby_finish(groups, &records, &count));
+    assert(count == 37);
+    assert(groupby_spill_count(groups) > 0);
+    for (size_t i = 0; i < count; i++) {
+        int index = atoi(records[i]->values[0].data.string + 4);
+        assert(records[i]->values[1].data.integer == name_counts[index]);
+        datarecord_destroy(records[i]);
+    }
+    free(records);
+    groupby_destroy(groups);
+    query_destroy(query);
+    
+    query = parse_query("SELECT k, name FROM grp GROUP BY k", error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)) == false);
+    assert(strcmp(error, "Column 'name' must appear in GROUP BY") == 0);
+    query_destroy(query);
+    
+    query = parse_query("SELECT COUNT(*) FROM grp GROUP BY v", error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)) == false);
+    query_destroy(query);
+    
+    assert(parse_query("SELECT * FROM grp GROUP BY k", error, sizeof(error)) == NULL);
+    assert(parse_query("SELECT k FROM grp GROUP k", error, sizeof(error)) == NULL);
+    
+    memory_storage_destroy(storage);
+    for (int i = 0; i < 4; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("GROUP BY tests passed\n");
+}
+
+/* Runs the query on each partition, merges their partial rows and checks the result against the
+ * query run on the whole table. */
+static void assert_partial_merge(MemoryTable* whole, MemoryTable** parts, size_t part_count, const char* sql) {
+    char error[PARSER_ERROR_SIZE];
+    Query* query = parse_query(sql, error, sizeof(error));
+    assert(query != NULL && query_bind(query, whole->schema, error, sizeof(error)));
+    
+    DataRecord* partials[4096];
+    size_t partial_count = 0;
+    for (size_t p = 0; p < part_count; p++) {
+        DataRecord** rows;
+        size_t count;
+        assert(execute_partial_aggregate(parts[p], query, &rows, &count));
+        assert(partial_count + count <= 4096);
+        memcpy(partials + partial_count, rows, sizeof(DataRecord*) * count);
+        partial_count += count;
+        free(rows);
+    }
+    
+    QueryResult* merged = merge_partial_aggregates(query, whole->schema, partials, partial_count);
+    QueryResult* expected = execute_table_query(whole, query);
+    assert(merged != NULL && expected != NULL);
+    assert(merged->count == expected->count && merged->column_count == expected->column_count);
+    for (size_t c = 0; c < merged->column_count; c++) {
+        assert(strcmp(merged->schema->columns[c].name, expected->schema->columns[c].name) == 0);
+    }
+    
+    for (size_t i = 0; i < merged->count; i++) {
+        for (size_t c = 0; c < merged->column_count; c++) {
+            const Value* a = &merged->records[i]->values[c];
+            const Value* b = &expected->records[i]->values[c];
+            assert(a->type == b->type);
+            if (a->type == VALUE_FLOAT) {
+                assert(fabs(a->data.float_val - b->data.float_val) < 1e-6);
+            } else if (a->type != VALUE_NULL) {
+                assert(value_equals(a, b));
+            }
+        }
+    }
+    
+    for (size_t i = 0; i < partial_count; i++) {
+        datarecord_destroy(partials[i]);
+    }
+    queryresult_destroy(merged);
+    queryresult_destroy(expected);
+    query_destroy(query);
+}
+
+void test_partial_aggregates() {
+    printf("Testing partial aggregates...\n");
+    
+    MemoryStorage* storage = memory_storage_create();
+    ColumnSchema columns[] = {
+        column_create("k", VALUE_INTEGER),
+        column_create("name", VALUE_STRING),
+        column_create("even", VALUE_BOOLEAN),
+        column_create("v", VALUE_FLOAT)
+    };
+    MemoryTable* whole = memory_storage_create_table(storage, "whole", tableschema_create("whole", columns, 4));
+    MemoryTable* parts[3];
+    for (size_t p = 0; p < 3; p++) {
+        char name[16];
+        snprintf(name, sizeof(name), "part%zu", p);
+        parts[p] = memory_storage_create_table(storage, name, tableschema_create(name, columns, 4));
+    }
+    
+    char name[16];
+    for (size_t i = 0; i < 3000; i++) {
+        snprintf(name, sizeof(name), "name%zu", (i * 7) % 23);
+        Value values[] = {
+            i % 97 == 0 ? value_null() : value_integer((int64_t)(i % 500)),
+            i % 89 == 0 ? value_null() : value_string(name),
+            value_boolean(i % 3 == 0),
+            value_float((double)(i % 41) - 20.5)
+        };
+        /* Partitions are uneven, and the last one gets only rows with k of 7. */
+        MemoryTable* part = i % 500 == 7 ? parts[2] : parts[i % 5 == 0 ? 0 : 1];
+        memory_table_insert(whole, values);
+        memory_table_insert(part, values);
+        value_destroy(&values[1]);
+        
+        if (i % 4 == 1) {
+            datarecord_mark_ghost(whole->records[whole->record_count - 1], 1000);
+            datarecord_mark_ghost(part->records[part->record_count - 1], 1000);
+        }
+    }
+    
+    assert_partial_merge(whole, parts, 3, "SELECT COUNT(*), SUM(k), AVG(v), MIN(k), MAX(v), MIN(name), MAX(name) FROM whole");
+    assert_partial_merge(whole, parts, 3, "SELECT name, COUNT(*), SUM(v), MIN(v), MAX(k), AVG(k) FROM whole "
+                                          "WHERE k < 400 GROUP BY name ORDER BY name DESC LIMIT 7 OFFSET 2");
+    assert_partial_merge(whole, parts, 3, "SELECT COUNT(k), MAX(name), even, k FROM whole GROUP BY even, k ORDER BY k, even");
+    assert_partial_merge(whole, parts, 3, "SELECT WEIGHTED_COUNT(*), WEIGHTED_SUM(v), WEIGHTED_AVG(k), COUNT(*) "
+                                          "FROM whole WITH GHOSTS");
+    assert_partial_merge(whole, parts, 3, "SELECT k, COUNT(*) FROM whole WHERE k = 7 GROUP BY k");
+    
+    /* The planner reorders the shared AND chain in place, keeping its top node. */
+    char error[PARSER_ERROR_SIZE];
+    PreparedStatement* statement = statement_prepare(NULL, storage, "SELECT COUNT(*) FROM part1 "
+                                                     "WHERE k > 50 AND name = 'name3' AND even = TRUE",
+                                                     error, sizeof(error));
+    assert(statement != NULL);
+    Predicate* where = statement->query->where;
+    int64_t first_count = -1;
+    for (int pass = 0; pass < 2; pass++) {
+        DataRecord** rows;
+        size_t count;
+        assert(execute_partial_aggregate(statement->table, statement->query, &rows, &count) && count == 1);
+        assert(statement->query->where == where);
+        if (pass == 0) first_count = rows[0]->values[0].data.integer;
+        assert(rows[0]->values[0].data.integer == first_count);
+        datarecord_destroy(rows[0]);
+        free(rows);
+    }
+    statement_release(statement);
+    
+    /* Nothing matches: one row of empty aggregates, or no groups at all. */
+    assert_partial_merge(whole, parts, 3, "SELECT COUNT(*), SUM(k), MIN(name), AVG(v) FROM whole WHERE k > 1000");
+    assert_partial_merge(whole, parts, 3, "SELECT name, COUNT(*) FROM whole WHERE k > 1000 GROUP BY name");
+    
+    Query* query = parse_query("SELECT COUNT(*), MAX(v) FROM whole", error, sizeof(error));
+    assert(query_bind(query, whole->schema, error, sizeof(error)));
+    QueryResult* result = merge_partial_aggregates(query, whole->schema, NULL, 0);
+    assert(result != NULL && result->count == 1);
+    assert(result->records[0]->values[0].data.integer == 0);
+    assert(result->records[0]->values[1].type == VALUE_NULL);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    memory_storage_destroy(storage);
+    for (int i = 0; i < 4; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("Partial aggregate tests passed\n");
+}
+
+static void assert_ordered(QueryResult* result, const size_t* columns, const bool* descending, size_t key_count) {
+    for (size_t i = 1; i < result->count; i++) {
+        DataRecord* previous = result->records[i - 1];
+        DataRecord* current = result->records[i];
+        
+        int order = 0;
+        for (size_t k = 0; k < key_count && order == 0; k++) {
+            order = value_compare(&previous->values[columns[k]], &current->values[columns[k]]);
+            if (descending[k]) order = -order;
+        }
+        assert(order < 0 || (order == 0 && previous->id < current->id));
+    }
+}
+
+void test_order_by() {
+    printf("Testing ORDER BY...\n");
+    
+    MemoryStorage* storage = memory_storage_create();
+    ColumnSchema columns[] = {
+        column_create("k", VALUE_INTEGER),
+        column_create("name", VALUE_STRING),
+        column_create("f", VALUE_FLOAT),
+        column_create("b", VALUE_BOOLEAN)
+    };
+    TableSchema* schema = tableschema_create("ord", columns, 4);
+    MemoryTable* table = memory_storage_create_table(storage, "ord", schema);
+    
+    const size_t rows = 150000;
+    char name[32];
+    for (size_t i = 0; i < rows; i++) {
+        size_t mixed = (i * 7919) % rows;
+        snprintf(name, sizeof(name), "customer%05zu", mixed % 5003);
+        Value values[] = {
+            i % 97 == 0 ? value_null() : value_integer((int64_t)(mixed % 20011) - 10000),
+            value_string(name),
+            value_float(((double)(mixed % 1000) - 500.0) / 8.0),
+            value_boolean(mixed % 3 == 0)
+        };
+        memory_table_insert(table, values);
+        value_destroy(&values[1]);
+    }
+    for (size_t i = 4; i < rows; i += 5) {
+        datarecord_mark_ghost(table->records[i], time(NULL));
+    }
+    size_t living = rows - rows / 5;
+    
+    char error[PARSER_ERROR_SIZE];
+    Query* query = parse_query("SELECT * FROM ord ORDER BY k", error, sizeof(error));
+    assert(query != NULL && query->order_count == 1 && !query->order_by[0].descending);
+    assert(query_bind(query, schema, error, sizeof(error)));
+    QueryResult* result = execute_table_query(table, query);
+    assert(result->count == living);
+    assert_ordered(result, (size_t[]){ 0 }, (bool[]){ false }, 1);
+    assert(result->records[result->count - 1]->values[0].type == VALUE_NULL);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT name, k FROM ord ORDER BY name DESC, k ASC", error, sizeof(error));
+    assert(query != NULL && query->order_count == 2 && query->order_by[0].descending);
+    assert(query_bind(query, schema, error, sizeof(error)));
+    result = execute_table_query(table, query);
+    assert(result->count == living && result->column_count == 2);
+    assert_ordered(result, (size_t[]){ 1, 0 }, (bool[]){ true, false }, 2);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM ord WHERE k < 100 ORDER BY f DESC, name", error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)));
+    QueryResult* sorted = execute_table_query(table, query);
+    assert_ordered(sorted, (size_t[]){ 2, 1 }, (bool[]){ true, false }, 2);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM ord WHERE k < 100 ORDER BY f DESC, name LIMIT 25", error, sizeof(error));
+    assert(query != NULL && query->has_limit && query->limit == 25);
+    assert(query_bind(query, schema, error, sizeof(error)));
+    result = execute_table_query(table, query);
+    assert(result->count == 25);
+    for (size_t i = 0; i < result->count; i++) {
+        assert(result->records[i] == sorted->records[i]);
+    }
+    queryresult_destroy(result);
+    queryresult_destroy(sorted);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM ord WITH GHOSTS ORDER BY b, _id DESC LIMIT 10000", error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)));
+    result = execute_table_query(table, query);
+    assert(result->count == 10000 && result->ghost_count == rows / 5);
+    for (size_t i = 1; i < result->count; i++) {
+        assert(!result->records[i]->values[3].data.boolean);
+        assert(result->records[i - 1]->id > result->records[i]->id);
+    }
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM ord LIMIT 7", error, sizeof(error));
+    result = execute_table_query(table, query);
+    assert(result->count == 7 && result->records[6]->id == 8);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT b, COUNT(*) FROM ord GROUP BY b ORDER BY count(*) DESC LIMIT 1", error, sizeof(error));
+    assert(query != NULL && strcmp(query->order_by[0].column, "COUNT(*)") == 0);
+    assert(query_bind(query, schema, error, sizeof(error)));
+    result = execute_table_query(table, query);
+    assert(result->derived && result->count == 1);
+    assert(result->records[0]->values[0].data.boolean == false);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT b, COUNT(*) FROM ord GROUP BY b ORDER BY k", error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)) == false);
+    assert(strcmp(error, "ORDER BY column 'k' must appear in the select list") == 0);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM ord ORDER BY missing", error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)) == false);
+    query_destroy(query);
+    
+    assert(parse_query("SELECT * FROM ord ORDER k", error, sizeof(error)) == NULL);
+    assert(parse_query("SELECT * FROM ord LIMIT many", error, sizeof(error)) == NULL);
+    assert(parse_query("SELECT * FROM ord LIMIT 3 ORDER BY k", error, sizeof(error)) == NULL);
+    
+    memory_storage_destroy(storage);
+    
+    storage = memory_storage_create();
+    assert(memory_storage_enable_persistence(storage, "test_order_data"));
+    schema = tableschema_create("indexed", columns, 4);
+    table = memory_storage_create_table(storage, "indexed", schema);
+    assert(table->primary_index != NULL);
+    MemoryStorage* plain = memory_storage_create();
+    MemoryTable* unindexed = memory_storage_create_table(plain, "indexed", tableschema_create("indexed", columns, 4));
+    
+    for (size_t i = 0; i < 3000; i++) {
+        Value values[] = {
+            value_integer((int64_t)((i * 37) % 500)),
+            value_string("x"),
+            value_float((double)i),
+            value_boolean(i % 2 == 0)
+        };
+        memory_table_insert(table, values);
+        memory_table_insert(unindexed, values);
+        value_destroy(&values[1]);
+    }
+    
+    /* Keys repeat six times each, so the walk has to hand ties back in id order as the sort does. */
+    const char* indexed_queries[] = {
+        "SELECT * FROM indexed ORDER BY k",
+        "SELECT * FROM indexed WHERE b = TRUE ORDER BY k DESC",
+        "SELECT * FROM indexed ORDER BY k DESC LIMIT 40",
+        "SELECT * FROM indexed ORDER BY k LIMIT 9 OFFSET 4",
+        "SELECT * FROM indexed WHERE b = FALSE ORDER BY k DESC LIMIT 5 OFFSET 2"
+    };
+    const size_t expected[] = { 3000, 1500, 40, 9, 5 };
+    for (size_t q = 0; q < 5; q++) {
+        query = parse_query(indexed_queries[q], error, sizeof(error));
+        assert(query_bind(query, schema, error, sizeof(error)));
+        result = execute_table_query(table, query);
+        assert(result->count == expected[q]);
+        assert_ordered(result, (size_t[]){ 0 }, (bool[]){ query->order_by[0].descending }, 1);
+        
+        QueryResult* reference = execute_table_query(unindexed, query);
+        assert(reference->count == result->count);
+        for (size_t i = 0; i < result->count; i++) {
+            assert(result->records[i]->id == reference->records[i]->id);
+        }
+        queryresult_destroy(reference);
+        queryresult_destroy(result);
+        query_destroy(query);
+    }
+    
+    memory_storage_destroy(plain);
+    memory_storage_destroy(storage);
+    remove("test_order_data/indexed.btree");
+    remove("test_order_data");
+    
+    for (int i = 0; i < 4; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("ORDER BY tests passed\n");
+}
+
+void test_limit_offset() {
+    printf("Testing LIMIT and OFFSET...\n");
+    
+    MemoryStorage* storage = memory_storage_create();
+    ColumnSchema columns[] = {
+        column_create("k", VALUE_INTEGER),
+        column_create("v", VALUE_INTEGER)
+    };
+    TableSchema* schema = tableschema_create("pages", columns, 2);
+    MemoryTable* table = memory_storage_create_table(storage, "pages", schema);
+    
+    const size_t rows = 200000;
+    for (size_t i = 0; i < rows; i++) {
+        Value values[] = { value_integer((int64_t)((i * 7919) % 1000)), value_integer((int64_t)(i % 10)) };
+        memory_table_insert(table, values);
+    }
+    for (size_t i = 3; i < rows; i += 4) {
+        datarecord_mark_ghost(table->records[i], time(NULL));
+    }
+    
+    char error[PARSER_ERROR_SIZE];
+    Query* query = parse_query("SELECT * FROM pages", error, sizeof(error));
+    QueryResult* all = execute_table_query(table, query);
+    assert(all->count == rows - rows / 4);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM pages LIMIT 10 OFFSET 100", error, sizeof(error));
+    assert(query != NULL && query->has_limit && query->limit == 10 && query->offset == 100);
+    QueryResult* result = execute_table_query(table, query);
+    assert(result->count == 10);
+    for (size_t i = 0; i < result->count; i++) {
+        assert(result->records[i] == all->records[100 + i]);
+    }
+    assert(result->ghost_count < 40);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM pages OFFSET 149990", error, sizeof(error));
+    assert(query != NULL && !query->has_limit);
+    result = execute_table_query(table, query);
+    assert(result->count == 10 && result->records[9] == all->records[all->count - 1]);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM pages WHERE _id > 180000 LIMIT 5", error, sizeof(error));
+    result = execute_table_query(table, query);
+    assert(result->count == 5 && result->records[0]->id == 180001);
+    assert(result->ghost_count + result->exorcised_count <= 2);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM pages WHERE v > 3 AND _id BETWEEN 11 AND 40", error, sizeof(error));
+    result = execute_table_query(table, query);
+    size_t expected = 0;
+    for (size_t i = 10; i < 40; i++) {
+        if (i % 4 != 3 && i % 10 > 3) expected++;
+    }
+    assert(result->count == expected);
+    for (size_t i = 0; i < result->count; i++) {
+        assert(result->records[i]->id >= 11 && result->records[i]->id <= 40);
+    }
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    const char* empty_queries[] = {
+        "SELECT * FROM pages WHERE _id < 1",
+        "SELECT * FROM pages WHERE _id > 9223372036854775807",
+        "SELECT * FROM pages WHERE _id >= 20 AND _id <= 10",
+        "SELECT * FROM pages LIMIT 5 OFFSET 200000"
+    };
+    for (size_t q = 0; q < 4; q++) {
+        query = parse_query(empty_queries[q], error, sizeof(error));
+        result = execute_table_query(table, query);
+        assert(result != NULL && result->count == 0);
+        queryresult_destroy(result);
+        query_destroy(query);
+    }
+    
+    query = parse_query("SELECT * FROM pages WHERE _id = 4 OR _id = 78", error, sizeof(error));
+    result = execute_table_query(table, query);
+    assert(result->count == 1 && result->records[0]->id == 78);
+    queryresult_destroy(result);
+    query_destroy(query);
+    queryresult_destroy(all);
+    
+    query = parse_query("SELECT * FROM pages ORDER BY k DESC", error, sizeof(error));
+    QueryResult* sorted = execute_table_query(table, query);
+    query_destroy(query);
+    
+    const char* ordered_queries[] = {
+        "SELECT * FROM pages ORDER BY k DESC LIMIT 5 OFFSET 10",
+        "SELECT * FROM pages ORDER BY k DESC LIMIT 20 OFFSET 9000"
+    };
+    const size_t offsets[] = { 10, 9000 };
+    for (size_t q = 0; q < 2; q++) {
+        query = parse_query(ordered_queries[q], error, sizeof(error));
+        result = execute_table_query(table, query);
+        assert(result->count == query->limit);
+        for (size_t i = 0; i < result->count; i++) {
+            assert(result->records[i] == sorted->records[offsets[q] + i]);
+        }
+        queryresult_destroy(result);
+        query_destroy(query);
+    }
+    queryresult_destroy(sorted);
+    
+    query = parse_query("SELECT v, COUNT(*) FROM pages GROUP BY v ORDER BY v LIMIT 2 OFFSET 3", error, sizeof(error));
+    assert(query_bind(query, schema, error, sizeof(error)));
+    result = execute_table_query(table, query);
+    assert(result->count == 2);
+    assert(result->records[0]->values[0].data.integer == 3 && result->records[1]->values[0].data.integer == 4);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM pages WHERE _id >= 50 LIMIT 3000 OFFSET 10", error, sizeof(error));
+    QueryCursor* cursor = query_cursor_open_table(table, query);
+    assert(cursor != NULL);
+    DataRecord* batch[1024];
+    size_t fetched = 0;
+    size_t count;
+    while ((count = query_cursor_fetch(cursor, batch, 1024)) > 0) {
+        if (fetched == 0) assert(batch[0]->id == 63);
+        fetched += count;
+    }
+    assert(fetched == 3000 && query_cursor_finished(cursor));
+    query_cursor_close(cursor);
+    query_destroy(query);
+    
+    assert(parse_query("SELECT * FROM pages LIMIT 5 OFFSET", error, sizeof(error)) == NULL);
+    assert(parse_query("SELECT * FROM pages OFFSET -1", error, sizeof(error)) == NULL);
+    
+    memory_storage_destroy(storage);
+    for (int i = 0; i < 2; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("LIMIT and OFFSET tests passed\n");
+}
+
+static Query* parse_join_query(MemoryStorage* storage, const char* sql, char* error, size_t error_size) {
+    Query* query = parse_query(sql, error, error_size);
+    assert(query != NULL && query->join != NULL);
+    
+    MemoryTable* left = memory_storage_get_table(storage, query->table_name);
+    MemoryTable* right = memory_storage_get_table(storage, query->join->table_name);
+    if (!query_bind_join(query, left->schema, right->schema, error, error_size)) {
+        query_destroy(query);
+        return NULL;
+    }
+    return query;
+}
+
+static void fill_join_tables(MemoryTable* orders, MemoryTable* customers, size_t order_rows, size_t customer_rows) {
+    char text[32];
+    for (size_t i = 0; i < customer_rows; i++) {
+        snprintf(text, sizeof(text), "r%zu", i % 50);
+        Value values[] = {
+            i % 13 == 5 ? value_null() : value_integer((int64_t)(i % (customer_rows * 3 / 4))),
+            value_string("customer"),
+            value_string(text),
+            value_integer((int64_t)i)
+        };
+        memory_table_insert(customers, values);
+        value_destroy(&values[1]);
+        value_destroy(&values[2]);
+    }
+    for (size_t i = 0; i < customer_rows; i += 7) {
+        datarecord_mark_ghost(customers->records[i], time(NULL));
+    }
+    
+    for (size_t i = 0; i < order_rows; i++) {
+        Value values[] = {
+            value_integer((int64_t)i),
+            i % 101 == 0 ? value_null() : value_integer((int64_t)((i * 7919) % (customer_rows + customer_rows / 10))),
+            value_integer((int64_t)(i % 1000))
+        };
+        memory_table_insert(orders, values);
+    }
+    for (size_t i = 2; i < order_rows; i += 9) {
+        datarecord_mark_ghost(orders->records[i], time(NULL));
+    }
+}
+
+static size_t expected_join_rows(MemoryTable* orders, MemoryTable* customers, bool ghost_customers) {
+    size_t key_count = customers->record_count + 1;
+    size_t* matches = calloc(key_count, sizeof(size_t));
+    for (size_t i = 0; i < customers->record_count; i++) {
+        DataRecord* record = customers->records[i];
+        if (record->values[0].type == VALUE_NULL) continue;
+        if (record->state == DATA_STATE_LIVING || ghost_customers) matches[record->values[0].data.integer]++;
+    }
+    
+    size_t expected = 0;
+    for (size_t i = 0; i < orders->record_count; i++) {
+        DataRecord* record = orders->records[i];
+        int64_t key = record->values[1].data.integer;
+        if (record->state != DATA_STATE_LIVING || record->values[1].type == VALUE_NULL) continue;
+        if (key < (int64_t)key_count) expected += matches[key];
+    }
+    free(matches);
+    return expected;
+}
+
+/* Rows come out in left order, then right order: (order_id, seq) must strictly increase. */
+static void assert_join_rows(QueryResult* result) {
+    for (size_t i = 0; i < result->count; i++) {
+        const Value* values = result->records[i]->values;
+        assert(values[1].data.integer == values[3].data.integer);
+        assert((result->records[i]->state == DATA_STATE_GHOST) == (values[6].data.integer % 7 == 0));
+        if (i == 0) continue;
+        
+        const Value* previous = result->records[i - 1]->values;
+        assert(previous[0].data.integer < values[0].data.integer ||
+               (previous[0].data.integer == values[0].data.integer && previous[6].data.integer < values[6].data.integer));
+    }
+}
+
+void test_join() {
+    printf("Testing JOIN...\n");
+    
+    ColumnSchema order_columns[] = {
+        column_create("order_id", VALUE_INTEGER),
+        column_create("customer", VALUE_INTEGER),
+        column_create("amount", VALUE_INTEGER)
+    };
+    ColumnSchema customer_columns[] = {
+        column_create("id", VALUE_INTEGER),
+        column_create("name", VALUE_STRING),
+        column_create("region", VALUE_STRING),
+        column_create("seq", VALUE_INTEGER)
+    };
+    ColumnSchema region_columns[] = {
+        column_create("code", VALUE_STRING),
+        column_create("name", VALUE_STRING)
+    };
+    
+    MemoryStorage* storage = memory_storage_create();
+    MemoryTable* orders = memory_storage_create_table(storage, "orders", tableschema_create("orders", order_columns, 3));
+    MemoryTable* customers = memory_storage_create_table(storage, "customers",
+                                                         tableschema_create("customers", customer_columns, 4));
+    MemoryTable* regions = memory_storage_create_table(storage, "regions", tableschema_create("regions", region_columns, 2));
+    fill_join_tables(orders, customers, 60000, 24000);
+    
+    char text[32];
+    for (size_t i = 0; i < 40; i++) {
+        snprintf(text, sizeof(text), "r%zu", i);
+        Value values[] = { value_string(text), value_string(i % 2 == 0 ? "east" : "west") };
+        memory_table_insert(regions, values);
+        value_destroy(&values[0]);
+        value_destroy(&values[1]);
+    }
+    
+    char error[PARSER_ERROR_SIZE];
+    Query* query = parse_join_query(storage, "SELECT * FROM orders JOIN customers ON customer = customers.id",
+                                    error, sizeof(error));
+    assert(query != NULL && query->join->left_index == 1 && query->join->right_index == 0);
+    QueryResult* result = execute_query(storage, query);
+    size_t expected = expected_join_rows(orders, customers, false);
+    assert(result != NULL && expected > 0 && result->count == expected);
+    assert(result->schema->column_count == 7 && strcmp(result->schema->columns[4].name, "customers.name") == 0);
+    assert_join_rows(result);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_join_query(storage, "SELECT * FROM orders INNER JOIN customers WITH GHOSTS ON customers.id = orders.customer",
+                             error, sizeof(error));
+    assert(query != NULL && query->join->include_ghosts && strcmp(query->join->left_column, "orders.customer") == 0);
+    result = execute_query(storage, query);
+    assert(result->count == expected_join_rows(orders, customers, true) && result->count > expected);
+    assert_join_rows(result);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_join_query(storage, "SELECT customers.seq, name FROM customers JOIN regions ON region = code",
+                             error, sizeof(error));
+    assert(query == NULL && strstr(error, "Ambiguous column") != NULL);
+    
+    query = parse_join_query(storage, "SELECT seq, regions.name FROM customers JOIN regions ON region = code WHERE seq < 1000",
+                             error, sizeof(error));
+    assert(query != NULL);
+    result = execute_query(storage, query);
+    expected = 0;
+    for (size_t i = 0; i < 1000; i++) {
+        if (i % 7 != 0 && i % 50 < 40) expected++;
+    }
+    assert(result->count == expected && result->column_count == 2);
+    for (size_t i = 0; i < result->count; i++) {
+        int64_t seq = result->records[i]->values[result->column_map[0]].data.integer;
+        const char* region = result->records[i]->values[result->column_map[1]].data.string;
+        assert(strcmp(region, seq % 50 % 2 == 0 ? "east" : "west") == 0);
+    }
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_join_query(storage, "SELECT region, COUNT(*) FROM orders JOIN customers ON customer = id GROUP BY region",
+                             error, sizeof(error));
+    assert(query != NULL);
+    result = execute_query(storage, query);
+    assert(result->derived && result->count == 50);
+    size_t total = 0;
+    for (size_t i = 0; i < result->count; i++) {
+        total += (size_t)result->records[i]->values[1].data.integer;
+    }
+    assert(total == expected_join_rows(orders, customers, false));
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_join_query(storage,
+                             "SELECT * FROM orders JOIN customers ON customer = id WHERE amount > 500 ORDER BY amount DESC, seq LIMIT 20",
+                             error, sizeof(error));
+    result = execute_query(storage, query);
+    assert(result->count == 20 && result->records[0]->values[2].data.integer == 999);
+    assert_ordered(result, (size_t[]){ 2, 6 }, (bool[]){ true, false }, 2);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    query = parse_join_query(storage, "SELECT * FROM orders JOIN customers ON customer = name", error, sizeof(error));
+    assert(query == NULL && strstr(error, "same type") != NULL);
+    query = parse_join_query(storage, "SELECT * FROM orders JOIN customers ON customer = amount", error, sizeof(error));
+    assert(query == NULL && strstr(error, "each table") != NULL);
+    query = parse_join_query(storage, "SELECT * FROM orders JOIN customers ON customer = missing", error, sizeof(error));
+    assert(query == NULL && strstr(error, "Unknown column") != NULL);
+    assert(parse_query("SELECT * FROM orders JOIN customers ON customer < id", error, sizeof(error)) == NULL);
+    assert(parse_query("SELECT * FROM orders JOIN customers customer = id", error, sizeof(error)) == NULL);
+    
+    query = parse_query("SELECT * FROM orders JOIN customers ON customer = id", error, sizeof(error));
+    assert(execute_table_query(orders, query) == NULL);
+    assert(query_cursor_open_table(orders, query) == NULL);
+    query_destroy(query);
+    
+    memory_storage_destroy(storage);
+    
+    storage = memory_storage_create();
+    assert(memory_storage_enable_persistence(storage, "test_join_data"));
+    orders = memory_storage_create_table(storage, "orders", tableschema_create("orders", order_columns, 3));
+    customers = memory_storage_create_table(storage, "customers", tableschema_create("customers", customer_columns, 4));
+    assert(customers->primary_index != NULL);
+    fill_join_tables(orders, customers, 5000, 3000);
+    
+    const char* sql = "SELECT * FROM orders JOIN customers ON customer = id";
+    query = parse_join_query(storage, sql, error, sizeof(error));
+    query->join->strategy = JOIN_HASH;
+    QueryResult* hashed = execute_query(storage, query);
+    query_destroy(query);
+    assert(hashed->count == expected_join_rows(orders, customers, false));
+    
+    query = parse_join_query(storage, sql, error, sizeof(error));
+    query->join->strategy = JOIN_INDEX;
+    result = execute_query(storage, query);
+    assert(result->count == hashed->count);
+    for (size_t i = 0; i < result->count; i++) {
+        assert(result->records[i]->values[0].data.integer == hashed->records[i]->values[0].data.integer);
+        assert(result->records[i]->values[6].data.integer == hashed->records[i]->values[6].data.integer);
+    }
+    queryresult_destroy(result);
+    queryresult_destroy(hashed);
+    query_destroy(query);
+    
+    query = parse_join_query(storage, "SELECT * FROM orders JOIN customers WITH GHOSTS ON customer = id WHERE order_id < 40",
+                             error, sizeof(error));
+    query->join->strategy = JOIN_INDEX;
+    result = execute_query(storage, query);
+    expected = 0;
+    for (size_t i = 0; i < result->count; i++) {
+        assert(result->records[i]->values[0].data.integer < 40);
+        if (result->records[i]->state == DATA_STATE_GHOST) expected++;
+    }
+    assert(result->count > 0 && expected > 0);
+    assert_join_rows(result);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    memory_storage_destroy(storage);
+    remove("test_join_data/orders.btree");
+    remove("test_join_data/customers.btree");
+    remove("test_join_data");
+    
+    for (int i = 0; i < 3; i++) {
+        free((char*)order_columns[i].name);
+    }
+    for (int i = 0; i < 4; i++) {
+        free((char*)customer_columns[i].name);
+    }
+    for (int i = 0; i < 2; i++) {
+        free((char*)region_columns[i].name);
+    }
+    
+    printf("JOIN tests passed\n");
+}
+
+static QueryResult* planned_result(MemoryTable* table, const char* sql, AccessMethod expected) {
+    char error[PARSER_ERROR_SIZE];
+    Query* query = parse_query(sql, error, sizeof(error));
+    assert(query != NULL && query_bind(query, table->schema, error, sizeof(error)));
+    
+    QueryPlan plan;
+    assert(plan_select(query, table, &plan));
+    assert(plan.access == expected);
+    
+    QueryResult* result = execute_table_query(table, query);
+    assert(result != NULL);
+    query_destroy(query);
+    return result;
+}
+
+static void assert_same_rows(QueryResult* a, QueryResult* b) {
+    assert(a->count == b->count);
+    for (size_t i = 0; i < a->count; i++) {
+        assert(a->records[i]->id == b->records[i]->id);
+    }
+}
+
+void test_query_planner() {
+    printf("Testing query planner...\n");
+    
+    ColumnSchema columns[] = {
+        column_create("k", VALUE_INTEGER),
+        column_create("name", VALUE_STRING),
+        column_create("b", VALUE_BOOLEAN)
+    };
+    
+    MemoryStorage* plain = memory_storage_create();
+    MemoryTable* keyed = memory_storage_create_table(plain, "keys", tableschema_create("keys", columns, 3));
+    assert(keyed->primary_index == NULL && memory_table_has_key_index(keyed));
+    MemoryStorage* storage = memory_storage_create();
+    assert(memory_storage_enable_persistence(storage, "test_planner_data"));
+    MemoryTable* indexed = memory_storage_create_table(storage, "keys", tableschema_create("keys", columns, 3));
+    assert(indexed->primary_index != NULL);
+    
+    const size_t rows = 4000;
+    char name[32];
+    for (size_t i = 0; i < rows; i++) {
+        snprintf(name, sizeof(name), "n%zu", i % 7);
+        Value values[] = {
+            i % 50 == 0 ? value_null() : value_integer((int64_t)((i * 7919) % 997)),
+            value_string(name),
+            value_boolean(i % 2 == 0)
+        };
+        memory_table_insert(keyed, values);
+        memory_table_insert(indexed, values);
+        value_destroy(&values[1]);
+    }
+    for (size_t i = 3; i < rows; i += 5) {
+        datarecord_mark_ghost(keyed->records[i], time(NULL));
+        datarecord_mark_ghost(indexed->records[i], time(NULL));
+    }
+    
+    /* The same records without any key index, which every plan has to agree with. */
+    MemoryTable unkeyed = *keyed;
+    unkeyed.key_order = NULL;
+    
+    /* The in-memory key index costs no page reads, so it beats a scan of 40 rows where the B-tree does not. */
+    struct {
+        const char* sql;
+        AccessMethod access;
+        AccessMethod in_memory;
+    } cases[] = {
+        { "SELECT * FROM keys WHERE k = 42", ACCESS_INDEX_LOOKUP, ACCESS_INDEX_LOOKUP },
+        { "SELECT * FROM keys WITH GHOSTS WHERE k = 42 AND b = TRUE", ACCESS_INDEX_LOOKUP, ACCESS_INDEX_LOOKUP },
+        { "SELECT * FROM keys WHERE k BETWEEN 100 AND 104", ACCESS_INDEX_RANGE, ACCESS_INDEX_RANGE },
+        { "SELECT * FROM keys WHERE k >= 7 AND k < 9 AND name != 'n3'", ACCESS_INDEX_RANGE, ACCESS_INDEX_RANGE },
+        { "SELECT * FROM keys WHERE k = 42 ORDER BY name DESC", ACCESS_INDEX_LOOKUP, ACCESS_INDEX_LOOKUP },
+        { "SELECT * FROM keys WHERE k > 5", ACCESS_SCAN, ACCESS_SCAN },
+        { "SELECT * FROM keys WHERE k = 42 OR k = 43", ACCESS_SCAN, ACCESS_SCAN },
+        { "SELECT * FROM keys WHERE k = 42.0", ACCESS_SCAN, ACCESS_SCAN },
+        { "SELECT * FROM keys WHERE k = 42 AND k = 43", ACCESS_INDEX_RANGE, ACCESS_INDEX_RANGE },
+        { "SELECT * FROM keys WHERE _id <= 40 AND k = 42", ACCESS_SCAN, ACCESS_INDEX_LOOKUP }
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        QueryResult* expected = planned_result(&unkeyed, cases[c].sql, ACCESS_SCAN);
+        QueryResult* result = planned_result(indexed, cases[c].sql, cases[c].access);
+        QueryResult* in_memory = planned_result(keyed, cases[c].sql, cases[c].in_memory);
+        assert_same_rows(result, expected);
+        assert_same_rows(in_memory, expected);
+        if (c < 2) assert(result->count > 0);
+        queryresult_destroy(in_memory);
+        queryresult_destroy(result);
+        queryresult_destroy(expected);
+    }
+    
+    /* Records added after the key index was built join it on the next read, after the older equal keys. */
+    for (size_t i = 0; i < 3; i++) {
+        Value values[] = { value_integer(i == 1 ? 998 : 42), value_string("late"), value_boolean(true) };
+        memory_table_insert(keyed, values);
+        value_destroy(&values[1]);
+    }
+    unkeyed = *keyed;
+    unkeyed.key_order = NULL;
+    QueryResult* expected = planned_result(&unkeyed, "SELECT * FROM keys WHERE k >= 42 AND k <= 42", ACCESS_SCAN);
+    QueryResult* late = planned_result(keyed, "SELECT * FROM keys WHERE k >= 42 AND k <= 42", ACCESS_INDEX_LOOKUP);
+    assert_same_rows(late, expected);
+    assert(strcmp(late->records[late->count - 1]->values[1].data.string, "late") == 0);
+    queryresult_destroy(late);
+    queryresult_destroy(expected);
+    
+    Value key = value_integer(998);
+    DataRecord* found = memory_table_get_by_key(keyed, &key, PRIMARY_KEY_COLUMN);
+    assert(found && found->id == keyed->records[keyed->record_count - 2]->id);
+    BTreeRange range = { .start_key = value_integer(996), .include_start = true, .end_key = value_integer(998) };
+    uint32_t range_count = 0;
+    uint64_t* range_ids = memory_table_range_query(keyed, &range, PRIMARY_KEY_COLUMN, &range_count);
+    assert(range_count > 0 && range_ids);
+    for (uint32_t i = 0; i < range_count; i++) {
+        DataRecord* record = keyed->records[memory_table_position(keyed, range_ids[i])];
+        assert(record->id == range_ids[i]);
+        assert(record->values[0].data.integer >= 996 && record->values[0].data.integer < 998);
+    }
+    btree_free_results(range_ids);
+    
+    QueryResult* result = planned_result(indexed, "SELECT k, COUNT(*) FROM keys WHERE k BETWEEN 10 AND 12 GROUP BY k",
+                                         ACCESS_INDEX_RANGE);
+    assert(result->derived && result->count == 3);
+    queryresult_destroy(result);
+    
+    char error[PARSER_ERROR_SIZE];
+    Query* query = parse_query("SELECT * FROM keys WHERE k IS NOT NULL AND name = 'n1' AND b = TRUE", error, sizeof(error));
+    QueryPlan plan;
+    assert(plan_select(query, indexed, &plan) && plan.access == ACCESS_SCAN);
+    assert(query->where->op == PRED_AND && query->where->right->op == PRED_IS_NOT_NULL);
+    assert(query->where->left->left->column_index == 2 && query->where->left->right->column_index == 1);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM keys WHERE _id <= 100", error, sizeof(error));
+    assert(query_bind(query, indexed->schema, error, sizeof(error)));
+    double selectivity = planner_selectivity(query->where, indexed);
+    assert(selectivity > 0.0249 && selectivity < 0.0251);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM keys WHERE missing = 1", error, sizeof(error));
+    assert(!plan_select(query, indexed, &plan));
+    query_destroy(query);
+    
+    query = parse_query("DELETE FROM keys WHERE k = 42", error, sizeof(error));
+    assert(query != NULL && query_bind(query, indexed->schema, error, sizeof(error)));
+    result = execute_table_query(indexed, query);
+    assert(result->count > 0);
+    for (size_t i = 0; i < result->count; i++) {
+        assert(result->records[i]->state == DATA_STATE_GHOST && result->records[i]->values[0].data.integer == 42);
+    }
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    JoinClause* join = join_clause_create("keys");
+    join->right_index = PRIMARY_KEY_COLUMN;
+    assert(plan_join(join, indexed, 10) == JOIN_INDEX);
+    assert(plan_join(join, indexed, rows) == JOIN_HASH);
+    assert(plan_join(join, keyed, 10) == JOIN_HASH);
+    join->strategy = JOIN_INDEX;
+    assert(plan_join(join, indexed, rows) == JOIN_INDEX);
+    join_clause_destroy(join);
+    
+    memory_storage_destroy(plain);
+    memory_storage_destroy(storage);
+    remove("test_planner_data/keys.btree");
+    remove("test_planner_data");
+    
+    for (int i = 0; i < 3; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("Query planner tests passed\n");
+}
+
+static size_t planned_count(MemoryTable* table, const char* sql, AccessMethod expected) {
+    QueryResult* result = planned_result(table, sql, expected);
+    size_t count = result->count;
+    queryresult_destroy(result);
+    return count;
+}
+
+void test_planner_statistics() {
+    printf("Testing planner statistics...\n");
+    
+    ColumnSchema columns[] = {
+        column_create("k", VALUE_INTEGER),
+        column_create("v", VALUE_INTEGER)
+    };
+    MemoryStorage* storage = memory_storage_create();
+    assert(memory_storage_enable_persistence(storage, "test_planner_stats_data"));
+    MemoryTable* table = memory_storage_create_table(storage, "skewed", tableschema_create("skewed", columns, 2));
+    
+    /* Nine rows in ten share k = 1; the rest have keys of their own. */
+    const size_t rows = 4000;
+    for (size_t i = 0; i < rows; i++) {
+        Value values[] = {
+            value_integer(i % 10 == 0 ? (int64_t)(1000 + i) : 1),
+            i % 4 == 0 ? value_null() : value_integer((int64_t)i)
+        };
+        memory_table_insert(table, values);
+    }
+    
+    /* Before ANALYZE only the distinct count is known, which makes k = 1 look rare. */
+    assert(planned_count(table, "SELECT * FROM skewed WHERE k = 1", ACCESS_INDEX_LOOKUP) == rows - rows / 10);
+    
+    assert(memory_table_analyze(table));
+    assert(planned_count(table, "SELECT * FROM skewed WHERE k = 1", ACCESS_SCAN) == rows - rows / 10);
+    assert(planned_count(table, "SELECT * FROM skewed WHERE k = 1010", ACCESS_INDEX_LOOKUP) == 1);
+    assert(planned_count(table, "SELECT * FROM skewed WHERE k BETWEEN 2000 AND 2100", ACCESS_INDEX_RANGE) == 11);
+    assert(planned_count(table, "SELECT * FROM skewed WHERE k >= 1", ACCESS_SCAN) == rows);
+    assert(planned_count(table, "SELECT * FROM skewed WHERE k > 100000", ACCESS_INDEX_RANGE) == 0);
+    
+    char error[PARSER_ERROR_SIZE];
+    Query* query = parse_query("SELECT * FROM skewed WHERE v IS NULL", error, sizeof(error));
+    assert(query_bind(query, table->schema, error, sizeof(error)));
+    double selectivity = planner_selectivity(query->where, table);
+    assert(selectivity > 0.249 && selectivity < 0.251);
+    query_destroy(query);
+    
+    query = parse_query("SELECT * FROM skewed WHERE v < 1000", error, sizeof(error));
+    assert(query_bind(query, table->schema, error, sizeof(error)));
+    selectivity = planner_selectivity(query->where, table);
+    assert(selectivity > 0.15 && selectivity < 0.22);
+    query_destroy(query);
+    
+    /* A probe into k finds about as many rows as each distinct key holds. */
+    JoinClause* join = join_clause_create("skewed");
+    join->right_index = PRIMARY_KEY_COLUMN;
+    assert(plan_join(join, table, 10) == JOIN_INDEX);
+    assert(plan_join(join, table, 200) == JOIN_HASH);
+    join_clause_destroy(join);
+    
+    memory_storage_destroy(storage);
+    remove("test_planner_stats_data/skewed.btree");
+    remove("test_planner_stats_data");
+    for (int i = 0; i < 2; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("Planner statistics tests passed\n");
+}
+
+static QueryResult* explain(MemoryTable* table, const char* sql) {
+    char error[PARSER_ERROR_SIZE];
+    Query* query = parse_query(sql, error, sizeof(error));
+    assert(query != NULL && query->explain != EXPLAIN_NONE);
+    assert(query_bind(query, table->schema, error, sizeof(error)));
+    
+    QueryResult* result = execute_table_query(table, query);
+    assert(result != NULL && result->derived && result->column_count == 1);
+    assert(strcmp(result->schema->columns[0].name, "QUERY PLAN") == 0);
+    query_destroy(query);
+    return result;
+}
+
+static const char* plan_line(const QueryResult* result, size_t line) {
+    assert(line < result->count);
+    return result->records[line]->values[0].data.string;
+}
+
+void test_explain() {
+    printf("Testing EXPLAIN...\n");
+    
+    ColumnSchema columns[] = {
+        column_create("k", VALUE_INTEGER),
+        column_create("name", VALUE_STRING)
+    };
+    MemoryStorage* storage = memory_storage_create();
+    assert(memory_storage_enable_persistence(storage, "test_explain_data"));
+    MemoryTable* table = memory_storage_create_table(storage, "keys", tableschema_create("keys", columns, 2));
+    
+    const size_t rows = 2000;
+    char name[32];
+    for (size_t i = 0; i < rows; i++) {
+        snprintf(name, sizeof(name), "n%zu", i % 5);
+        Value values[] = { value_integer((int64_t)i), value_string(name) };
+        memory_table_insert(table, values);
+        value_destroy(&values[1]);
+    }
+    
+    QueryResult* result = explain(table, "EXPLAIN SELECT * FROM keys WHERE k = 42 AND name = 'n2'");
+    assert(result->count == 2);
+    assert(strncmp(plan_line(result, 0), "Filter", 6) == 0 && strstr(plan_line(result, 0), "estimated rows="));
+    assert(strcmp(plan_line(result, 1), "  -> Index Lookup on keys") == 0);
+    queryresult_destroy(result);
+    
+    result = explain(table, "EXPLAIN SELECT name, COUNT(*) FROM keys GROUP BY name ORDER BY name LIMIT 2");
+    assert(result->count == 3);
+    assert(strcmp(plan_line(result, 0), "Limit 2 offset 0") == 0);
+    assert(strcmp(plan_line(result, 1), "  -> Sort (1 key)") == 0);
+    assert(strcmp(plan_line(result, 2), "    -> Group Aggregate on keys") == 0);
+    queryresult_destroy(result);
+    
+    result = explain(table, "EXPLAIN SELECT * FROM keys ORDER BY k DESC LIMIT 3");
+    assert(result->count == 2 && strstr(plan_line(result, 1), "Index Order Scan on keys"));
+    queryresult_destroy(result);
+    
+    /* The walk stops at OFFSET plus LIMIT, reading the path down and a leaf or two. */
+    result = explain(table, "EXPLAIN ANALYZE SELECT * FROM keys ORDER BY k LIMIT 3 OFFSET 2");
+    assert(result->count == 3 && strstr(plan_line(result, 1), "Index Order Scan on keys"));
+    unsigned long long pages = 0;
+    const char* read = strstr(plan_line(result, 1), "pages=");
+    assert(read && sscanf(read, "pages=%llu", &pages) == 1);
+    assert(pages > 0 && pages < 20);
+    queryresult_destroy(result);
+    
+    /* Without a limit the walk reads every leaf, and sorting after a scan is cheaper. */
+    result = explain(table, "EXPLAIN SELECT * FROM keys ORDER BY k");
+    assert(result->count == 2 && strstr(plan_line(result, 0), "Sort (1 key)"));
+    queryresult_destroy(result);
+    
+    result = explain(table, "EXPLAIN SELECT * FROM keys WHERE name = 'n1' ORDER BY name LIMIT 5");
+    assert(result->count == 2 && strstr(plan_line(result, 1), "Top-K Scan on keys (k=5)"));
+    queryresult_destroy(result);
+    
+    result = explain(table, "EXPLAIN ANALYZE SELECT * FROM keys WHERE k BETWEEN 10 AND 19");
+    assert(result->count == 3);
+    assert(strstr(plan_line(result, 0), "actual rows=10 in=10"));
+    assert(strstr(plan_line(result, 1), "Index Range Scan on keys") && strstr(plan_line(result, 1), "in=10"));
+    assert(strstr(plan_line(result, 1), "pages=0") == NULL);
+    assert(strncmp(plan_line(result, 2), "Execution time: ", 16) == 0);
+    queryresult_destroy(result);
+    
+    /* A plain EXPLAIN never runs the statement; EXPLAIN ANALYZE does. */
+    result = explain(table, "EXPLAIN DELETE FROM keys WHERE name = 'n4'");
+    assert(strcmp(plan_line(result, 0), "Delete on keys") == 0);
+    assert(table->stats->ghost_count == 0);
+    queryresult_destroy(result);
+    result = explain(table, "EXPLAIN ANALYZE DELETE FROM keys WHERE name = 'n4'");
+    assert(strstr(plan_line(result, 0), "actual rows=400 in=400"));
+    assert(table->stats->ghost_count == rows / 5);
+    queryresult_destroy(result);
+    
+    /* A profile attached to an ordinary query records the same stages. */
+    char error[PARSER_ERROR_SIZE];
+    Query* query = parse_query("SELECT * FROM keys WHERE name != 'n0' LIMIT 10 OFFSET 5", error, sizeof(error));
+    assert(query_bind(query, table->schema, error, sizeof(error)));
+    QueryProfile profile;
+    profile_init(&profile, true);
+    query->profile = &profile;
+    result = execute_table_query(table, query);
+    assert(result->count == 10);
+    assert(profile.operator_count == 2);
+    assert(profile.operators[0].kind == OPERATOR_SCAN && profile.operators[0].rows_out == 15);
+    assert(profile.operators[0].rows_in < rows && profile.operators[0].allocations > 0);
+    assert(profile.operators[1].kind == OPERATOR_LIMIT && profile.operators[1].rows_in == 15);
+    assert(profile.operators[1].rows_out == 10);
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    MemoryTable* other = memory_storage_create_table(storage, "names", tableschema_create("names", columns + 1, 1));
+    Value value = value_string("n1");
+    memory_table_insert(other, &value);
+    value_destroy(&value);
+    
+    query = parse_query("EXPLAIN ANALYZE SELECT k FROM keys JOIN names ON keys.name = names.name WHERE k < 100",
+                        error, sizeof(error));
+    assert(query_bind_join(query, table->schema, other->schema, error, sizeof(error)));
+    result = execute_query(storage, query);
+    assert(result != NULL && result->count == 3);
+    assert(strstr(plan_line(result, 0), "Filter") && strstr(plan_line(result, 0), "actual rows=20 in=400"));
+    assert(strstr(plan_line(result, 1), "Hash Join keys with names on keys.name = names.name"));
+    queryresult_destroy(result);
+    query_destroy(query);
+    
+    memory_storage_destroy(storage);
+    remove("test_explain_data/keys.btree");
+    remove("test_explain_data/names.btree");
+    remove("test_explain_data");
+    for (int i = 0; i < 2; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("EXPLAIN tests passed\n");
+}
+
+void test_prepared_statements() {
+    printf("Testing prepared statements...\n");
+    
+    MemoryStorage* storage = memory_storage_create();
+    ColumnSchema columns[] = {
+        column_create("id", VALUE_INTEGER),
+        column_create("price", VALUE_FLOAT)
+    };
+    TableSchema* schema = tableschema_create("items", columns, 2);
+    MemoryTable* table = memory_storage_create_table(storage, "items", schema);
+    for (int64_t i = 1; i <= 100; i++) {
+        Value values[] = { value_integer(i), value_float(i * 0.5) };
+        memory_table_insert(table, values);
+    }
+    
+    char error[PARSER_ERROR_SIZE];
+    Query* query = parse_query("SELECT * FROM items WHERE id BETWEEN ? AND ? OR price = ?", error, sizeof(error));
+    assert(query != NULL && query->parameter_count == 3);
+    assert(query->where->left->low_parameter == 0 && query->where->left->high_parameter == 1);
+    assert(query->where->right->low_parameter == 2);
+    assert(query_bind(query, schema, error, sizeof(error)));
+    
+    Value parameters[] = { value_integer(10), value_integer(12), value_integer(40) };
+    assert(predicate_set_parameters(query->where, parameters, 3));
+    assert(predicate_bind(query->where, schema, error, sizeof(error)));
+    QueryResult* result = execute_table_query(table, query);
+    assert(result != NULL && result->count == 4);
+    queryresult_destroy(result);
+    assert(!predicate_set_parameters(query->where, parameters, 2));
+    query_destroy(query);
+    
+    assert(parse_query("SELECT * FROM items WHERE id = -?", error, sizeof(error)) == NULL);
+    
+    StatementCache* cache = statement_cache_create();
+    PreparedStatement* statement = statement_prepare(cache, storage, "SELECT * FROM items WHERE id > ?", error, sizeof(error));
+    assert(statement != NULL && cache->misses == 1);
+    assert(statement_execute(statement, NULL, error, sizeof(error)) == NULL);
+    assert(strcmp(error, "Parameter 0 is not bound") == 0);
+    
+    for (int64_t bound = 90; bound <= 95; bound += 5) {
+        Value parameter = value_integer(bound);
+        result = statement_execute(statement, &parameter, error, sizeof(error));
+        assert(result != NULL && result->count == (size_t)(100 - bound));
+        queryresult_destroy(result);
+    }
+    Value mismatched = value_string("ninety");
+    assert(statement_execute(statement, &mismatched, error, sizeof(error)) == NULL);
+    value_destroy(&mismatched);
+    
+    PreparedStatement* again = statement_prepare(cache, storage, "SELECT * FROM items WHERE id > ?", error, sizeof(error));
+    assert(again == statement && cache->hits == 1 && statement->references == 2);
+    statement_release(again);
+    
+    char text[64];
+    for (int i = 0; i < STATEMENT_CACHE_CAPACITY; i++) {
+        snprintf(text, sizeof(text), "SELECT * FROM items WHERE id = %d", i);
+        statement_release(statement_prepare(cache, storage, text, error, sizeof(error)));
+    }
+    assert(cache->count == STATEMENT_CACHE_CAPACITY && !statement->cached);
+    assert(statement_refresh(cache, storage, statement, error, sizeof(error)) == statement);
+    
+    statement_cache_invalidate(cache);
+    assert(cache->count == 0);
+    PreparedStatement* fresh = statement_refresh(cache, storage, statement, error, sizeof(error));
+    assert(fresh != NULL && fresh != statement && fresh->cached);
+    statement_release(fresh);
+    
+    assert(statement_prepare(cache, storage, "SELECT * FROM missing", error, sizeof(error)) == NULL);
+    assert(strcmp(error, "Table 'missing' not found") == 0);
+    
+    statement_cache_destroy(cache);
+    memory_storage_destroy(storage);
+    for (int i = 0; i < 2; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("Prepared statement tests passed\n");
+}
+
+void test_parse_command() {
+    printf("Testing shell statement parsing...\n");
+    
+    char error[PARSER_ERROR_SIZE];
+    const char* end;
+    const char* script = "create table users (id INT, name STRING, score FLOAT);\n"
+                         "INSERT INTO users VALUES (1, 'Ann O''Neil', -2.5), (2, bob, NULL);"
+                         "  SELECT * FROM users WHERE name = 'a;b'  ; ";
+    
+    Command* command = parse_command(script, &end, error, sizeof(error));
+    assert(command != NULL && command->type == COMMAND_CREATE_TABLE);
+    assert(strcmp(command->table_name, "users") == 0 && command->column_count == 3);
+    assert(strcmp(command->columns[1].name, "name") == 0 && command->columns[2].type == VALUE_FLOAT);
+    command_destroy(command);
+    
+    command = parse_command(end, &end, error, sizeof(error));
+    assert(command != NULL && command->type == COMMAND_INSERT);
+    assert(command->row_count == 2 && command->row_width == 3);
+    assert(strcmp(command->rows[0][1].data.string, "Ann O'Neil") == 0);
+    assert(command->rows[0][2].type == VALUE_FLOAT && command->rows[0][2].data.float_val == -2.5);
+    assert(strcmp(command->rows[1][1].data.string, "bob") == 0 && command->rows[1][2].type == VALUE_NULL);
+    command_destroy(command);
+    
+    command = parse_command(end, &end, error, sizeof(error));
+    assert(command != NULL && command->type == COMMAND_QUERY);
+    assert(strcmp(command->text, "SELECT * FROM users WHERE name = 'a;b'") == 0);
+    assert(*end == '\0');
+    command_destroy(command);
+    
+    command = parse_command("COPY users TO ./out/users.csv WITH GHOSTS FORMAT ndjson", &end, error, sizeof(error));
+    assert(command != NULL && command->type == COMMAND_COPY_TO);
+    assert(strcmp(command->path, "./out/users.csv") == 0 && command->include_ghosts);
+    assert(command->format == COPY_FORMAT_NDJSON);
+    command_destroy(command);
+    
+    command = parse_command("RESURRECT users 18446744073709551615", &end, error, sizeof(error));
+    assert(command != NULL && command->id == UINT64_MAX);
+    command_destroy(command);
+    
+    command = parse_command("INSERT INTO t VALUES (-9223372036854775808)", &end, error, sizeof(error));
+    assert(command != NULL && command->rows[0][0].data.integer == INT64_MIN);
+    command_destroy(command);
+    assert(parse_command("INSERT INTO t VALUES (9223372036854775808)", &end, error, sizeof(error)) == NULL);
+    assert(strncmp(error, "Number out of range", 19) == 0);
+    
+    command = parse_command("  ;", &end, error, sizeof(error));
+    assert(command != NULL && command->type == COMMAND_EMPTY);
+    command_destroy(command);
+    
+    assert(parse_command("INSERT INTO t VALUES (1, 2), (3)", &end, error, sizeof(error)) == NULL);
+    assert(strcmp(error, "Rows must have the same number of values near ')'") == 0);
+    assert(parse_command("CREATE TABLE t (id BLOB)", &end, error, sizeof(error)) == NULL);
+    assert(parse_command("DROP TABLE t extra", &end, error, sizeof(error)) == NULL);
+    assert(strcmp(error, "Unexpected input near 'extra'") == 0);
+    assert(parse_command("FROBNICATE t", &end, error, sizeof(error)) == NULL);
+    assert(strcmp(error, "Unknown command near 'FROBNICATE'") == 0);
+    
+    /* Nothing bounds the length of a statement or its number of values. */
+    const size_t ROWS = 5000;
+    char* text = malloc(ROWS * 32 + 64);
+    size_t length = (size_t)sprintf(text, "INSERT INTO t VALUES ");
+    for (size_t i = 0; i < ROWS; i++) {
+        length += (size_t)sprintf(text + length, "%s(%zu, \"row %zu\")", i > 0 ? ", " : "", i, i);
+    }
+    command = parse_command(text, &end, error, sizeof(error));
+    assert(command != NULL && command->row_count == ROWS);
+    assert(strcmp(command->rows[ROWS - 1][1].data.string, "row 4999") == 0);
+    command_destroy(command);
+    free(text);
+    
+    printf("Shell statement parsing tests passed\n");
+}
+
+static FILE* script_file(const char* text) {
+    FILE* script = tmpfile();
+    assert(script != NULL);
+    fputs(text, script);
+    rewind(script);
+    return script;
+}
+
+void test_run_script() {
+    printf("Testing scripts...\n");
+    
+    CLIState* cli = cli_create();
+    FILE* script = script_file(
+        "CREATE TABLE t (\n"
+        "  id INT,\n"
+        "  name STRING\n"
+        ");\n"
+        "\n"
+        "INSERT INTO t VALUES\n"
+        "  (1, \"a;\n"
+        "b\"),\n"
+        "  (2, \"x\"); INSERT INTO t VALUES (3, \"y\");\n"
+        "DELETE FROM t\n"
+        "  WHERE id = 2;\n"
+        "INSERT INTO t VALUES (4, \"z\")");
+    assert(cli_run_script(cli, script, "script"));
+    fclose(script);
+    
+    MemoryTable* table = memory_storage_get_table(cli->storage, "t");
+    assert(table != NULL && table->record_count == 4 && table->stats->ghost_count == 1);
+    assert(strcmp(table->records[0]->values[1].data.string, "a;\nb") == 0);
+    assert(table->records[3]->values[0].data.integer == 4);
+    
+    /* A failed statement does not stop the ones after it. */
+    script = script_file("SELECT * FROM missing;\nINSERT INTO t\n  VALUES (5, \"w\");\n");
+    assert(!cli_run_script(cli, script, "script"));
+    fclose(script);
+    assert(table->record_count == 5);
+    
+    cli_destroy(cli);
+    printf("Script tests passed\n");
+}
+
+static char* read_file(const char* path, size_t* out_length) {
+    FILE* file = fopen(path, "rb");
+    assert(file != NULL);
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    char* data = malloc((size_t)length + 1);
+    assert(fread(data, 1, (size_t)length, file) == (size_t)length);
+    data[length] = '\0';
+    fclose(file);
+    
+    *out_length = (size_t)length;
+    return data;
+}
+
+void test_copy_to() {
+    printf("Testing streaming export...\n");
+    
+    MemoryStorage* storage = memory_storage_create();
+    ColumnSchema columns[] = {
+        column_create("id", VALUE_INTEGER),
+        column_create("name", VALUE_STRING),
+        column_create("score", VALUE_FLOAT)
+    };
+    TableSchema* schema = tableschema_create("export", columns, 3);
+    MemoryTable* table = memory_storage_create_table(storage, "export", schema);
+    
+    const size_t ROW_COUNT = 3000;
+    char name[32];
+    for (size_t i = 0; i < ROW_COUNT; i++) {
+        snprintf(name, sizeof(name), i % 7 == 0 ? "say \"hi\", %zu" : "row%zu", i);
+        Value values[] = { value_integer(-(int64_t)i), value_string(name), value_float(i * 0.1) };
+        if (i == 5) {
+            value_destroy(&values[1]);
+            values[1] = value_null();
+        }
+        memory_table_insert(table, values);
+        value_destroy(&values[1]);
+    }
+    execute_delete_simple(storage, "export", 2);
+    
+    const char* csv_path = "test_export.csv";
+    ExportStats stats;
+    assert(copy_to_file(table, csv_path, COPY_FORMAT_AUTO, false, &stats) == true);
+    assert(stats.rows_written == ROW_COUNT - 1);
+    
+    TableSchema* copy_schema = tableschema_create("reloaded", columns, 3);
+    MemoryTable* reloaded = memory_storage_create_table(storage, "reloaded", copy_schema);
+    CopyStats load_stats;
+    assert(copy_from_file(reloaded, csv_path, COPY_FORMAT_AUTO, &load_stats) == true);
+    assert(load_stats.rows_loaded == ROW_COUNT - 1);
+    assert(load_stats.rows_rejected == 0);
+    
+    for (size_t i = 0; i < reloaded->record_count; i++) {
+        DataRecord* source = table->records[i < 1 ? i : i + 1];
+        DataRecord* copy = reloaded->records[i];
+        for (size_t c = 0; c < 3; c++) {
+            assert(value_equals(&source->values[c], &copy->values[c]));
+        }
+    }
+    remove(csv_path);
+    
+    const char* json_path = "test_export.ndjson";
+    assert(copy_to_file(table, json_path, COPY_FORMAT_AUTO, true, &stats) == true);
+    assert(stats.rows_written == ROW_COUNT);
+    
+    size_t length;
+    char* json = read_file(json_path, &length);
+    assert(length == stats.bytes_written);
+    assert(strncmp(json, "{\"id\":0,\"name\":\"say \\\"hi\\\", 0\",\"score\":0.0,\"_state\":\"LIVING\"", 60) == 0);
+    assert(strstr(json, "\"name\":null") != NULL);
+    assert(strstr(json, "\"_state\":\"GHOST\"") != NULL);
+    free(json);
+    remove(json_path);
+    
+    const char* binary_path = "test_export.bin";
+    assert(copy_to_file(table, binary_path, COPY_FORMAT_AUTO, false, &stats) == true);
+    char* binary = read_file(binary_path, &length);
+    assert(memcmp(binary, EXPORT_BINARY_MAGIC, 8) == 0);
+    assert(binary[length - 9] == 0);
+    uint64_t trailer_count;
+    memcpy(&trailer_count, binary + length - 8, sizeof(trailer_count));
+    assert(trailer_count == ROW_COUNT - 1);
+    free(binary);
+    remove(binary_path);
+    
+    assert(copy_from_file(reloaded, binary_path, COPY_FORMAT_BINARY, &load_stats) == false);
+    assert(copy_to_file(table, "/nonexistent/dir/out.csv", COPY_FORMAT_CSV, false, &stats) == false);
+    
+    /* value_string(NULL) makes a string without text, which exports as NULL. */
+    TableSchema* holes_schema = tableschema_create("holes", columns, 3);
+    MemoryTable* holes = memory_storage_create_table(storage, "holes", holes_schema);
+    Value hole[] = { value_integer(1), value_string(NULL), value_float(0.5) };
+    memory_table_insert(holes, hole);
+    
+    assert(copy_to_file(holes, csv_path, COPY_FORMAT_AUTO, false, &stats) == true);
+    char* text = read_file(csv_path, &length);
+    assert(strstr(text, "\n1,,0.5\n") != NULL);
+    free(text);
+    remove(csv_path);
+    
+    assert(copy_to_file(holes, json_path, COPY_FORMAT_AUTO, false, &stats) == true);
+    text = read_file(json_path, &length);
+    assert(strstr(text, "\"name\":null") != NULL);
+    free(text);
+    remove(json_path);
+    
+    assert(copy_to_file(holes, binary_path, COPY_FORMAT_AUTO, false, &stats) == true);
+    assert(stats.rows_written == 1);
+    remove(binary_path);
+    
+    memory_storage_destroy(storage);
+    for (int i = 0; i < 3; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("Streaming export tests passed\n");
+}
+
 int main() {
     printf("=== Shade Database Query Tests ===\n\n");
     
@@ -172,6 +2142,22 @@ int main() {
     test_basic_select();
     test_ghost_queries();
     test_ghost_threshold();
+    test_copy_to();
+    test_where_clause();
+    test_predicate_bytecode();
+    test_projection();
+    test_aggregates();
+    test_group_by();
+    test_partial_aggregates();
+    test_order_by();
+    test_limit_offset();
+    test_join();
+    test_query_planner();
+    test_planner_statistics();
+    test_explain();
+    test_prepared_statements();
+    test_parse_command();
+    test_run_script();
     
     printf("\nAll query tests passed!\n");
     return 0;
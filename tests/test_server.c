@@ -0,0 +1,635 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../src/api/client.h"
+#include "../src/api/protocol.h"
+#include "../src/api/server.h"
+#include "../src/api/shard.h"
+#include "../src/util/spsc.h"
+
+#define TEST_SOCKET_PATH "test_server.sock"
+#define TEST_SOCKET "unix:" TEST_SOCKET_PATH
+
+static void* run_server(void* arg) {
+    assert(server_run((ShadeServer*)arg));
+    return NULL;
+}
+
+void test_wire_format() {
+    printf("Testing wire format...\n");
+
+    WireBuffer buffer;
+    wire_buffer_init(&buffer);
+
+    size_t start = wire_begin_message(&buffer, MESSAGE_ROWS, 77);
+    Value values[] = {value_integer(-42), value_float(2.5), value_boolean(true), value_string("ghost"), value_null()};
+    wire_put_u32(&buffer, 7);
+    for (size_t i = 0; i < 5; i++) {
+        wire_put_value(&buffer, &values[i]);
+    }
+    wire_end_message(&buffer, start);
+    assert(!buffer.failed);
+
+    WireFrame frame;
+    assert(wire_next_frame(buffer.data, buffer.length - 1, &frame) == FRAME_PARTIAL);
+    assert(wire_next_frame(buffer.data, 3, &frame) == FRAME_PARTIAL);
+    assert(wire_next_frame(buffer.data, buffer.length, &frame) == FRAME_READY);
+    assert(frame.type == MESSAGE_ROWS);
+    assert(frame.request == 77);
+    assert(frame.size == buffer.length);
+    WireReader reader = frame.payload;
+    assert(wire_get_u32(&reader) == 7);
+
+    for (size_t i = 0; i < 5; i++) {
+        Value decoded;
+        assert(wire_get_value(&reader, &decoded));
+        assert(value_equals(&decoded, &values[i]) || (i == 4 && decoded.type == VALUE_NULL));
+        value_destroy(&decoded);
+    }
+    assert(reader.position == reader.length);
+    assert(wire_get_u8(&reader) == 0 && reader.failed);
+
+    char oversized[PROTOCOL_HEADER_SIZE] = {(char)0xff, (char)0xff, (char)0xff, (char)0x7f, MESSAGE_EXEC};
+    assert(wire_next_frame(oversized, sizeof(oversized), &frame) == FRAME_INVALID);
+
+    wire_buffer_consume(&buffer, frame.size);
+    assert(buffer.length == 0);
+    wire_buffer_free(&buffer);
+    value_destroy(&values[3]);
+
+    struct sockaddr_storage address;
+    socklen_t length;
+    char error[PROTOCOL_ERROR_SIZE];
+    assert(protocol_resolve_address("5433", &address, &length, error, sizeof(error)));
+    assert(address.ss_family == AF_INET && ntohs(((struct sockaddr_in*)&address)->sin_port) == 5433);
+    assert(protocol_resolve_address("127.0.0.1:80", &address, &length, error, sizeof(error)));
+    assert(protocol_resolve_address("unix:shade.sock", &address, &length, error, sizeof(error)));
+    assert(address.ss_family == AF_UNIX && strcmp(((struct sockaddr_un*)&address)->sun_path, "shade.sock") == 0);
+    assert(protocol_resolve_address("/tmp/shade.sock", &address, &length, error, sizeof(error)));
+    assert(!protocol_resolve_address("localhost:80", &address, &length, error, sizeof(error)));
+    assert(protocol_resolve_address("127.0.0.2:80", &address, &length, error, sizeof(error)));
+    assert(!protocol_resolve_address("0.0.0.0:5433", &address, &length, error, sizeof(error)));
+    assert(strcmp(error, "Address '0.0.0.0:5433' is not a loopback address") == 0);
+    assert(!protocol_resolve_address("192.168.1.5:5433", &address, &length, error, sizeof(error)));
+    assert(!protocol_resolve_address("70000", &address, &length, error, sizeof(error)));
+    assert(!protocol_resolve_address("", &address, &length, error, sizeof(error)));
+
+    printf("Wire format tests passed\n");
+}
+
+void test_server_round_trips() {
+    printf("Testing server round trips...\n");
+
+    MemoryStorage* storage = memory_storage_create();
+    StatementCache* statements = statement_cache_create();
+    char error[PROTOCOL_ERROR_SIZE];
+
+    /* Only a socket left behind is replaced; a file at the path stays. */
+    FILE* file = fopen("test_server_data.csv", "w");
+    assert(file != NULL);
+    fputs("id\n1\n", file);
+    fclose(file);
+    assert(server_create(storage, statements, "./test_server_data.csv", error, sizeof(error)) == NULL);
+    assert(strcmp(error, "Cannot listen on './test_server_data.csv': address in use") == 0);
+    assert(access("test_server_data.csv", F_OK) == 0);
+    remove("test_server_data.csv");
+
+    struct sockaddr_un stale = {.sun_family = AF_UNIX};
+    strcpy(stale.sun_path, TEST_SOCKET_PATH);
+    int stale_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert(stale_fd >= 0 && bind(stale_fd, (struct sockaddr*)&stale, sizeof(stale)) == 0);
+    close(stale_fd);
+
+    ShadeServer* server = server_create(storage, statements, TEST_SOCKET, error, sizeof(error));
+    assert(server != NULL);
+
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, run_server, server) == 0);
+
+    ShadeClient* client = shade_client_connect(TEST_SOCKET, error, sizeof(error));
+    assert(client != NULL);
+
+    ShadeClientResult* result = shade_client_exec(client, "CREATE TABLE users (id INT, name STRING, score FLOAT)");
+    assert(result != NULL);
+    shade_client_result_free(result);
+
+    result = shade_client_exec(client, "INSERT INTO users VALUES (1, 'ada', 9.5), (2, 'bob', 3), (3, NULL, 7.25)");
+    assert(result != NULL);
+    assert(shade_client_result_affected(result) == 3);
+    assert(shade_client_result_first_id(result) == 1);
+    shade_client_result_free(result);
+
+    assert(shade_client_exec(client, "INSERT INTO users VALUES (4, 'eve')") == NULL);
+    assert(strcmp(shade_client_error(client), "Expected 3 values, got 2") == 0);
+    assert(shade_client_exec(client, "SELEC * FROM users") == NULL);
+    assert(shade_client_exec(client, "SELECT * FROM users; SELECT * FROM users") == NULL);
+    assert(shade_client_exec(client, "GHOST STATS") == NULL);
+
+    result = shade_client_exec(client, "SELECT name, score FROM users WHERE id >= 2");
+    assert(result != NULL);
+    assert(shade_client_result_column_count(result) == 2);
+    assert(strcmp(shade_client_result_column_name(result, 0), "name") == 0);
+    assert(shade_client_result_column_type(result, 1) == VALUE_FLOAT);
+    assert(shade_client_result_row_count(result) == 2);
+    assert(shade_client_result_row_id(result, 0) == 2);
+    assert(strcmp(shade_client_result_value(result, 0, 0)->data.string, "bob") == 0);
+    assert(shade_client_result_value(result, 0, 1)->data.float_val == 3.0);
+    assert(shade_client_result_value(result, 1, 0)->type == VALUE_NULL);
+    assert(shade_client_result_value(result, 2, 0) == NULL);
+    shade_client_result_free(result);
+
+    size_t param_count = 0;
+    uint32_t lookup = shade_client_prepare(client, "SELECT name FROM users WHERE id = ?", &param_count);
+    assert(lookup != 0);
+    assert(param_count == 1);
+
+    Value id = value_integer(1);
+    result = shade_client_execute(client, lookup, &id, 1);
+    assert(result != NULL);
+    assert(shade_client_result_row_count(result) == 1);
+    assert(strcmp(shade_client_result_value(result, 0, 0)->data.string, "ada") == 0);
+    shade_client_result_free(result);
+
+    assert(shade_client_execute(client, lookup, NULL, 0) == NULL);
+    assert(strcmp(shade_client_error(client), "Expected 1 parameters, got 0") == 0);
+    assert(shade_client_exec(client, "SELECT name FROM users WHERE id = ?") == NULL);
+
+    uint32_t remove = shade_client_prepare(client, "DELETE FROM users WHERE id = 2", NULL);
+    assert(remove != 0 && remove != lookup);
+    result = shade_client_execute(client, remove, NULL, 0);
+    assert(shade_client_result_row_count(result) == 1);
+    assert(shade_client_result_is_ghost(result, 0));
+    shade_client_result_free(result);
+    assert(shade_client_finalize(client, remove));
+    assert(!shade_client_finalize(client, remove));
+    assert(shade_client_prepare(client, "SELECT * FROM missing", NULL) == 0);
+    assert(strcmp(shade_client_error(client), "Table 'missing' not found") == 0);
+
+    /* Results larger than one row batch arrive across several frames. */
+    result = shade_client_exec(client, "CREATE TABLE numbers (n INT, label STRING)");
+    shade_client_result_free(result);
+    for (int i = 0; i < 10; i++) {
+        char sql[4096];
+        size_t used = (size_t)snprintf(sql, sizeof(sql), "INSERT INTO numbers VALUES ");
+        for (int j = 0; j < 100; j++) {
+            used += (size_t)snprintf(sql + used, sizeof(sql) - used, "%s(%d, 'row')", j ? ", " : "", i * 100 + j);
+        }
+        result = shade_client_exec(client, sql);
+        assert(result != NULL);
+        shade_client_result_free(result);
+    }
+    result = shade_client_exec(client, "SELECT * FROM numbers");
+    assert(shade_client_result_row_count(result) == 1000);
+    assert(shade_client_result_affected(result) == 1000);
+    assert(shade_client_result_value(result, 999, 0)->data.integer == 999);
+    shade_client_result_free(result);
+
+    ShadeClient* second = shade_client_connect(TEST_SOCKET, error, sizeof(error));
+    assert(second != NULL);
+    result = shade_client_exec(second, "DROP TABLE users");
+    assert(result != NULL);
+    shade_client_result_free(result);
+    shade_client_close(second);
+
+    assert(shade_client_execute(client, lookup, &id, 1) == NULL);
+    assert(strcmp(shade_client_error(client), "Table 'users' not found") == 0);
+
+    shade_client_close(client);
+    assert(shade_client_connect("unix:missing.sock", error, sizeof(error)) == NULL);
+
+    server_stop(server);
+    pthread_join(thread, NULL);
+    server_destroy(server);
+    assert(access(TEST_SOCKET_PATH, F_OK) != 0);
+
+    statement_cache_destroy(statements);
+    memory_storage_destroy(storage);
+
+    printf("Server round trip tests passed\n");
+}
+
+void test_pipelining() {
+    printf("Testing pipelined requests...\n");
+
+    MemoryStorage* storage = memory_storage_create();
+    StatementCache* statements = statement_cache_create();
+    char error[PROTOCOL_ERROR_SIZE];
+    ShadeServer* server = server_create(storage, statements, TEST_SOCKET, error, sizeof(error));
+    assert(server != NULL);
+
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, run_server, server) == 0);
+
+    ShadeClient* client = shade_client_connect(TEST_SOCKET, error, sizeof(error));
+    assert(client != NULL);
+    assert(shade_client_receive(client, NULL) == NULL);
+
+    /* Requests queue up and their replies are matched by id. */
+    uint32_t create = shade_client_send_exec(client, "CREATE TABLE items (id INT, label STRING)");
+    char sql[8192];
+    uint32_t inserts[20];
+    for (int i = 0; i < 20; i++) {
+        size_t used = (size_t)snprintf(sql, sizeof(sql), "INSERT INTO items VALUES ");
+        for (int j = 0; j < 100; j++) {
+            int id = i * 100 + j;
+            used += (size_t)snprintf(sql + used, sizeof(sql) - used, "%s(%d, 'label-%d-padding-padding-padding')",
+                                     j ? ", " : "", id, id);
+        }
+        inserts[i] = shade_client_send_exec(client, sql);
+        assert(inserts[i] != 0);
+    }
+    uint32_t prepare = shade_client_send_prepare(client, "SELECT id FROM items WHERE id = ?");
+    uint32_t failing = shade_client_send_exec(client, "SELECT * FROM nowhere");
+    assert(shade_client_in_flight(client) == 23);
+    assert(shade_client_exec(client, "SELECT * FROM items") == NULL);
+    assert(strcmp(shade_client_error(client), "Receive pipelined replies first") == 0);
+
+    uint32_t statement = 0;
+    size_t inserted = 0;
+    bool failed_seen = false;
+    while (shade_client_in_flight(client) > 0) {
+        uint32_t request;
+        ShadeClientResult* result = shade_client_receive(client, &request);
+        if (request == failing) {
+            assert(result == NULL);
+            assert(strcmp(shade_client_error(client), "Table 'nowhere' not found") == 0);
+            failed_seen = true;
+            continue;
+        }
+        assert(result != NULL);
+        if (request == prepare) {
+            statement = shade_client_result_statement(result);
+            assert(shade_client_result_param_count(result) == 1);
+        } else if (request != create) {
+            assert(shade_client_result_first_id(result) == (uint64_t)(request - inserts[0]) * 100 + 1);
+            inserted += shade_client_result_affected(result);
+        }
+        shade_client_result_free(result);
+    }
+    assert(failed_seen && statement != 0 && inserted == 2000);
+
+    uint32_t lookups[200];
+    for (int i = 0; i < 200; i++) {
+        Value key = value_integer(i * 7);
+        lookups[i] = shade_client_send_execute(client, statement, &key, 1);
+    }
+    for (int i = 0; i < 200; i++) {
+        uint32_t request;
+        ShadeClientResult* result = shade_client_receive(client, &request);
+        int index = (int)(request - lookups[0]);
+        assert(index >= 0 && index < 200);
+        assert(shade_client_result_row_count(result) == 1);
+        assert(shade_client_result_value(result, 0, 0)->data.integer == index * 7);
+        shade_client_result_free(result);
+    }
+
+    /* Row batches of large results interleave, so a small query is not stuck behind them. */
+    uint32_t large[2];
+    large[0] = shade_client_send_exec(client, "SELECT * FROM items");
+    large[1] = shade_client_send_exec(client, "SELECT * FROM items WITH GHOSTS");
+    uint32_t small = shade_client_send_exec(client, "SELECT label FROM items WHERE id = 5");
+    uint32_t order[3];
+    for (int i = 0; i < 3; i++) {
+        ShadeClientResult* result = shade_client_receive(client, &order[i]);
+        assert(result != NULL);
+        assert(shade_client_result_row_count(result) == (order[i] == small ? 1 : 2000));
+        if (order[i] != small) {
+            assert(shade_client_result_value(result, 1999, 0)->data.integer == 1999);
+        }
+        shade_client_result_free(result);
+    }
+    assert(order[0] == small);
+    (void)large;
+
+    /* More queries than a connection may have in flight, with replies larger than the high
+     * water mark, still all complete. */
+    size_t query_count = SERVER_MAX_IN_FLIGHT * 2;
+    for (size_t i = 0; i < query_count; i++) {
+        assert(shade_client_send_exec(client, "SELECT * FROM items") != 0);
+    }
+    for (size_t i = 0; i < query_count; i++) {
+        ShadeClientResult* result = shade_client_receive(client, NULL);
+        assert(result != NULL);
+        assert(shade_client_result_row_count(result) == 2000);
+        shade_client_result_free(result);
+    }
+
+    /* Dropping a table finishes the rows already promised from it first. */
+    ShadeClient* other = shade_client_connect(TEST_SOCKET, error, sizeof(error));
+    for (int i = 0; i < 8; i++) {
+        shade_client_send_exec(client, "SELECT * FROM items");
+    }
+    shade_client_flush(client);
+    ShadeClientResult* dropped = shade_client_exec(other, "DROP TABLE items");
+    assert(dropped != NULL);
+    shade_client_result_free(dropped);
+    for (int i = 0; i < 8; i++) {
+        ShadeClientResult* result = shade_client_receive(client, NULL);
+        if (result) {
+            assert(shade_client_result_row_count(result) == 2000);
+            assert(strncmp(shade_client_result_value(result, 1999, 1)->data.string, "label-1999", 10) == 0);
+        }
+        shade_client_result_free(result);
+    }
+    shade_client_close(other);
+
+    /* Requests still unanswered when the client goes away are dropped with the connection. */
+    shade_client_send_exec(client, "CREATE TABLE late (id INT)");
+    shade_client_close(client);
+
+    server_stop(server);
+    pthread_join(thread, NULL);
+    server_destroy(server);
+    statement_cache_destroy(statements);
+    memory_storage_destroy(storage);
+
+    printf("Pipelined request tests passed\n");
+}
+
+#define SPSC_TEST_ITEMS 100000
+
+static void* produce_items(void* arg) {
+    SpscQueue* queue = arg;
+    for (uintptr_t i = 1; i <= SPSC_TEST_ITEMS; i++) {
+        while (!spsc_push(queue, (void*)i)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+void test_spsc_queue() {
+    printf("Testing SPSC queue...\n");
+
+    SpscQueue queue;
+    assert(spsc_init(&queue, 3));
+    assert(spsc_pop(&queue) == NULL);
+    for (uintptr_t i = 1; i <= 4; i++) {
+        assert(spsc_push(&queue, (void*)i));
+    }
+    assert(!spsc_push(&queue, (void*)5));
+    assert(spsc_pop(&queue) == (void*)1);
+    assert(spsc_push(&queue, (void*)5));
+    for (uintptr_t i = 2; i <= 5; i++) {
+        assert(spsc_pop(&queue) == (void*)i);
+    }
+    assert(spsc_pop(&queue) == NULL);
+
+    /* Items cross threads whole and in order. */
+    pthread_t producer;
+    assert(pthread_create(&producer, NULL, produce_items, &queue) == 0);
+    uintptr_t expected = 1;
+    while (expected <= SPSC_TEST_ITEMS) {
+        void* item = spsc_pop(&queue);
+        if (!item) {
+            sched_yield();
+            continue;
+        }
+        assert((uintptr_t)item == expected);
+        expected++;
+    }
+    pthread_join(producer, NULL);
+    spsc_free(&queue);
+
+    printf("SPSC queue tests passed\n");
+}
+
+void test_sharded_server() {
+    printf("Testing sharded server...\n");
+
+    MemoryStorage* storage = memory_storage_create();
+    StatementCache* statements = statement_cache_create();
+    char error[PROTOCOL_ERROR_SIZE];
+    ShadeServer* server = server_create_sharded(storage, statements, TEST_SOCKET, 3, error, sizeof(error));
+    assert(server != NULL);
+
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, run_server, server) == 0);
+
+    ShadeClient* client = shade_client_connect(TEST_SOCKET, error, sizeof(error));
+    assert(client != NULL);
+
+    ShadeClientResult* result = shade_client_exec(client, "CREATE TABLE events (k INT, grp STRING, v FLOAT)");
+    assert(result != NULL);
+    shade_client_result_free(result);
+    assert(shade_client_exec(client, "CREATE TABLE events (k INT)") == NULL);
+    assert(strcmp(shade_client_error(client), "Table 'events' already exists") == 0);
+
+    /* Inserts spread over the shards, whose ids never collide. */
+    char sql[4096];
+    for (int i = 0; i < 12; i++) {
+        size_t used = (size_t)snprintf(sql, sizeof(sql), "INSERT INTO events VALUES ");
+        for (int j = 0; j < 50; j++) {
+            int k = i * 50 + j;
+            used += (size_t)snprintf(sql + used, sizeof(sql) - used, "%s(%d, 'g%d', %d.5)", j ? ", " : "", k, k % 4, k);
+        }
+        assert(shade_client_send_exec(client, sql) != 0);
+    }
+    shade_client_send_exec(client, "INSERT INTO events VALUES (1, 'g1')");
+    size_t inserted = 0;
+    bool failed_seen = false;
+    while (shade_client_in_flight(client) > 0) {
+        result = shade_client_receive(client, NULL);
+        if (!result) {
+            assert(strcmp(shade_client_error(client), "Expected 3 values, got 2") == 0);
+            failed_seen = true;
+            continue;
+        }
+        assert(shade_client_result_first_id(result) > 0);
+        inserted += shade_client_result_affected(result);
+        shade_client_result_free(result);
+    }
+    assert(inserted == 600 && failed_seen);
+
+    result = shade_client_exec(client, "SELECT k FROM events");
+    assert(shade_client_result_row_count(result) == 600);
+    uint64_t ids[600];
+    int keys[600];
+    for (size_t i = 0; i < 600; i++) {
+        ids[i] = shade_client_result_row_id(result, i);
+        keys[i] = (int)shade_client_result_value(result, i, 0)->data.integer;
+        assert(i == 0 || ids[i] > ids[i - 1]);
+    }
+    shade_client_result_free(result);
+
+    size_t param_count = 0;
+    /* Each row lives on the shard its first value hashes to, which its id names. */
+    ShardPool* pool = shard_pool_create(3, error, sizeof(error));
+    assert(pool != NULL);
+    for (size_t i = 0; i < 600; i++) {
+        Value key = value_integer(keys[i]);
+        assert((ids[i] - 1) % 3 == shard_pool_owner(pool, &key));
+    }
+
+    /* Equality on the key, alone or AND-ed, routes to that shard; anything else goes everywhere. */
+    MemoryStorage* router = memory_storage_create();
+    ColumnSchema columns[] = {column_create("k", VALUE_INTEGER), column_create("v", VALUE_FLOAT)};
+    memory_storage_create_table(router, "events", tableschema_create("events", columns, 2));
+    const char* routes[] = {"SELECT * FROM events WHERE k = 42 AND v > 1.0", "SELECT * FROM events WHERE _id = 5",
+                            "SELECT * FROM events WHERE k > 42", "SELECT * FROM events WHERE v = 42.0",
+                            "SELECT * FROM events WHERE k = 42 OR k = 43"};
+    Value forty_two = value_integer(42);
+    size_t expected_routes[] = {shard_pool_owner(pool, &forty_two), 1, SIZE_MAX, SIZE_MAX, SIZE_MAX};
+    for (size_t i = 0; i < 5; i++) {
+        PreparedStatement* statement = statement_prepare(NULL, router, routes[i], error, sizeof(error));
+        assert(statement != NULL && statement_bind_parameters(statement, NULL, error, sizeof(error)));
+        assert(shard_pool_route(pool, statement->query) == expected_routes[i]);
+        statement_release(statement);
+    }
+    memory_storage_destroy(router);
+    for (size_t i = 0; i < 2; i++) {
+        free((char*)columns[i].name);
+    }
+    shard_pool_destroy(pool);
+
+    uint32_t by_key = shade_client_prepare(client, "SELECT k, grp FROM events WHERE k = ?", &param_count);
+    assert(by_key != 0 && param_count == 1);
+    for (int k = 0; k < 600; k += 41) {
+        Value key = value_integer(k);
+        result = shade_client_execute(client, by_key, &key, 1);
+        assert(shade_client_result_row_count(result) == 1);
+        assert(shade_client_result_value(result, 0, 0)->data.integer == k);
+        shade_client_result_free(result);
+    }
+
+    /* An _id lookup goes to the one shard that owns it. */
+    uint32_t lookup = shade_client_prepare(client, "SELECT k, grp FROM events WHERE _id = ?", &param_count);
+    assert(lookup != 0 && param_count == 1);
+    for (size_t i = 0; i < 600; i += 37) {
+        Value id = value_integer((int64_t)ids[i]);
+        result = shade_client_execute(client, lookup, &id, 1);
+        assert(shade_client_result_row_count(result) == 1);
+        assert(shade_client_result_row_id(result, 0) == ids[i]);
+        assert(shade_client_result_value(result, 0, 0)->data.integer == keys[i]);
+        shade_client_result_free(result);
+    }
+    Value missing = value_integer(100000);
+    result = shade_client_execute(client, lookup, &missing, 1);
+    assert(shade_client_result_row_count(result) == 0);
+    shade_client_result_free(result);
+
+    /* Sorted windows merge across shards before OFFSET applies. */
+    result = shade_client_exec(client, "SELECT k FROM events WHERE k >= 100 ORDER BY k DESC LIMIT 5 OFFSET 3");
+    assert(shade_client_result_row_count(result) == 5);
+    for (size_t i = 0; i < 5; i++) {
+        assert(shade_client_result_value(result, i, 0)->data.integer == 596 - (int64_t)i);
+    }
+    shade_client_result_free(result);
+
+    result = shade_client_exec(client, "SELECT COUNT(*), SUM(k), AVG(v) FROM events WHERE k < 100");
+    assert(shade_client_result_row_count(result) == 1);
+    assert(strcmp(shade_client_result_column_name(result, 0), "COUNT(*)") == 0);
+    assert(shade_client_result_value(result, 0, 0)->data.integer == 100);
+    assert(shade_client_result_value(result, 0, 1)->data.integer == 4950);
+    assert(shade_client_result_value(result, 0, 2)->data.float_val == 50.0);
+    shade_client_result_free(result);
+
+    result = shade_client_exec(client, "SELECT grp, COUNT(*) FROM events GROUP BY grp ORDER BY grp");
+    assert(shade_client_result_row_count(result) == 4);
+    for (size_t i = 0; i < 4; i++) {
+        char group[8];
+        snprintf(group, sizeof(group), "g%zu", i);
+        assert(strcmp(shade_client_result_value(result, i, 0)->data.string, group) == 0);
+        assert(shade_client_result_value(result, i, 1)->data.integer == 150);
+    }
+    shade_client_result_free(result);
+
+    /* Shards answer with partial states per group, merged before ORDER BY and LIMIT apply. */
+    result = shade_client_exec(client, "SELECT grp, MIN(k), MAX(v), AVG(k), COUNT(*) FROM events "
+                                       "GROUP BY grp ORDER BY grp DESC LIMIT 2");
+    assert(shade_client_result_row_count(result) == 2);
+    for (size_t i = 0; i < 2; i++) {
+        int64_t group = 3 - (int64_t)i;
+        assert(shade_client_result_value(result, i, 1)->data.integer == group);
+        assert(shade_client_result_value(result, i, 2)->data.float_val == 596.5 + (double)group);
+        assert(shade_client_result_value(result, i, 3)->data.float_val == 298.0 + (double)group);
+        assert(shade_client_result_value(result, i, 4)->data.integer == 150);
+    }
+    shade_client_result_free(result);
+
+    result = shade_client_exec(client, "SELECT COUNT(*), MIN(grp), SUM(k) FROM events WHERE k < 0");
+    assert(shade_client_result_row_count(result) == 1);
+    assert(shade_client_result_value(result, 0, 0)->data.integer == 0);
+    assert(shade_client_result_value(result, 0, 1)->type == VALUE_NULL);
+    assert(shade_client_result_value(result, 0, 2)->type == VALUE_NULL);
+    shade_client_result_free(result);
+
+    /* Shards run shallow copies of their cached statements, which must still see every term the
+     * next time round. */
+    for (int pass = 0; pass < 2; pass++) {
+        result = shade_client_exec(client, "SELECT COUNT(*) FROM events WHERE k > 50 AND grp = 'g3' AND v < 300.0");
+        assert(shade_client_result_value(result, 0, 0)->data.integer == 63);
+        shade_client_result_free(result);
+        result = shade_client_exec(client, "SELECT k FROM events WHERE k > 50 AND grp = 'g3' AND v < 300.0");
+        assert(shade_client_result_row_count(result) == 63);
+        shade_client_result_free(result);
+    }
+
+    result = shade_client_exec(client, "DELETE FROM events WHERE k < 10");
+    assert(shade_client_result_row_count(result) == 10);
+    shade_client_result_free(result);
+    result = shade_client_exec(client, "SELECT COUNT(*) FROM events");
+    assert(shade_client_result_value(result, 0, 0)->data.integer == 590);
+    shade_client_result_free(result);
+
+    result = shade_client_exec(client, "CREATE TABLE groups (grp STRING, label STRING)");
+    shade_client_result_free(result);
+    assert(shade_client_exec(client, "SELECT * FROM events JOIN groups ON events.grp = groups.grp") == NULL);
+    assert(strcmp(shade_client_error(client), "Joins are not supported across shards") == 0);
+    assert(shade_client_exec(client, "EXPLAIN SELECT * FROM events") == NULL);
+
+    /* Gathered rows are copies, so a drop does not wait on queries in flight. */
+    for (int i = 0; i < 4; i++) {
+        shade_client_send_exec(client, "SELECT * FROM events");
+    }
+    uint32_t drop = shade_client_send_exec(client, "DROP TABLE events");
+    while (shade_client_in_flight(client) > 0) {
+        uint32_t request;
+        result = shade_client_receive(client, &request);
+        assert(result != NULL);
+        if (request != drop) assert(shade_client_result_row_count(result) == 590);
+        shade_client_result_free(result);
+    }
+    Value id = value_integer((int64_t)ids[0]);
+    assert(shade_client_execute(client, lookup, &id, 1) == NULL);
+    assert(strcmp(shade_client_error(client), "Table 'events' not found") == 0);
+
+    /* Requests left on shards when the client goes away are dropped once they come back. */
+    result = shade_client_exec(client, "CREATE TABLE late (id INT)");
+    shade_client_result_free(result);
+    shade_client_send_exec(client, "INSERT INTO late VALUES (1), (2)");
+    shade_client_send_exec(client, "SELECT * FROM late");
+    shade_client_close(client);
+
+    server_stop(server);
+    pthread_join(thread, NULL);
+    server_destroy(server);
+
+    /* The shards own every row, so they start from an empty catalog. */
+    assert(server_create_sharded(storage, statements, TEST_SOCKET, 2, error, sizeof(error)) == NULL);
+
+    statement_cache_destroy(statements);
+    memory_storage_destroy(storage);
+
+    printf("Sharded server tests passed\n");
+}
+
+int main() {
+    printf("=== Shade Server Tests ===\n\n");
+
+    test_wire_format();
+    test_server_round_trips();
+    test_pipelining();
+    test_spsc_queue();
+    test_sharded_server();
+
+    printf("\nAll server tests passed!\n");
+    return 0;
+}
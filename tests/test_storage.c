@@ -7,6 +7,8 @@
 #include "../src/types/value.h"
 #include "../src/types/schema.h"
 #include "../src/storage/memory.h"
+#include "../src/storage/copy.h"
+#include "../src/ghost/lifecycle.h"
 
 void test_schema_creation() {
     printf("Testing schema creation...\n");
@@ -260,6 +262,53 @@ void test_storage_scalability() {
     printf("Storage scalability tests passed\n");
 }
 
+void test_table_catalog() {
+    printf("Testing hashed table catalog...\n");
+    
+    MemoryStorage* storage = memory_storage_create();
+    ColumnSchema columns[] = { column_create("id", VALUE_INTEGER) };
+    
+    const size_t NUM_TABLES = 200;
+    MemoryTable* created[200];
+    char name[32];
+    
+    for (size_t i = 0; i < NUM_TABLES; i++) {
+        snprintf(name, sizeof(name), "table_%zu", i);
+        TableSchema* schema = tableschema_create(name, columns, 1);
+        created[i] = memory_storage_create_table(storage, name, schema);
+        assert(created[i] != NULL);
+    }
+    assert(storage->table_count == NUM_TABLES);
+    assert(storage->catalog_capacity >= NUM_TABLES * 2);
+    
+    TableSchema* duplicate = tableschema_create("table_7", columns, 1);
+    assert(memory_storage_create_table(storage, "table_7", duplicate) == NULL);
+    tableschema_destroy(duplicate);
+    
+    for (size_t i = 0; i < NUM_TABLES; i++) {
+        snprintf(name, sizeof(name), "table_%zu", i);
+        assert(memory_storage_get_table(storage, name) == created[i]);
+    }
+    assert(memory_storage_get_table(storage, "table_200") == NULL);
+    
+    for (size_t i = 0; i < NUM_TABLES; i += 2) {
+        snprintf(name, sizeof(name), "table_%zu", i);
+        assert(memory_storage_drop_table(storage, name) == true);
+    }
+    assert(memory_storage_drop_table(storage, "table_0") == false);
+    
+    for (size_t i = 0; i < NUM_TABLES; i++) {
+        snprintf(name, sizeof(name), "table_%zu", i);
+        MemoryTable* table = memory_storage_get_table(storage, name);
+        assert(i % 2 == 0 ? table == NULL : table == created[i]);
+    }
+    
+    memory_storage_destroy(storage);
+    free((char*)columns[0].name);
+    
+    printf("Hashed table catalog tests passed\n");
+}
+
 void test_btree_persistence() {
     printf("Testing B-tree persistence...\n");
     
@@ -391,6 +440,23 @@ void test_btree_node_splitting() {
     btree_close(tree);
     remove(filename);
     
+    tree = btree_create(filename, 4);
+    for (int i = 0; i < 2000; i++) {
+        Value key = value_integer((i * 37) % 1009);
+        assert(btree_insert(tree, &key, (uint64_t)i));
+    }
+    
+    uint32_t count = 0;
+    uint64_t* ids = btree_scan_all(tree, &count);
+    assert(count == 2000);
+    for (uint32_t i = 1; i < count; i++) {
+        assert((ids[i - 1] * 37) % 1009 <= (ids[i] * 37) % 1009);
+    }
+    btree_free_results(ids);
+    
+    btree_close(tree);
+    remove(filename);
+    
     printf("B-tree node splitting tests passed\n");
 }
 
@@ -479,6 +545,130 @@ void test_btree_integration() {
     printf("B-tree integration tests passed\n");
 }
 
+void test_batch_insert_with_index() {
+    printf("Testing batch insert with primary index...\n");
+    
+    MemoryStorage* storage = memory_storage_create();
+    assert(memory_storage_enable_persistence(storage, "test_batch_data"));
+    
+    ColumnSchema columns[] = {
+        column_create("id", VALUE_INTEGER),
+        column_create("name", VALUE_STRING)
+    };
+    TableSchema* schema = tableschema_create("items", columns, 2);
+    MemoryTable* table = memory_storage_create_table(storage, "items", schema);
+    assert(table->primary_index != NULL);
+    
+    const size_t ROWS = 50;
+    Value* rows[50];
+    for (size_t i = 0; i < ROWS; i++) {
+        rows[i] = malloc(sizeof(Value) * 2);
+        rows[i][0] = value_integer((int64_t)(ROWS - i));
+        rows[i][1] = value_string("item");
+    }
+    
+    uint64_t first_id = memory_table_insert_batch_owned(table, rows, ROWS);
+    assert(first_id == 1);
+    assert(table->record_count == ROWS);
+    assert(table->next_id == ROWS + 1);
+    assert(table->capacity >= ROWS);
+    assert(table->primary_index->defer_flush == false);
+    
+    for (size_t i = 0; i < ROWS; i++) {
+        assert(table->records[i]->id == i + 1);
+        assert(table->records[i]->values == rows[i]);
+    }
+    
+    for (int64_t key = 1; key <= (int64_t)ROWS; key++) {
+        Value lookup = value_integer(key);
+        DataRecord* record = memory_table_get_by_key(table, &lookup, 0);
+        assert(record != NULL);
+        assert(record->values[0].data.integer == key);
+        assert(record->id == (uint64_t)(ROWS - key + 1));
+    }
+    
+    uint32_t scan_count = 0;
+    uint64_t* all_ids = btree_scan_all(table->primary_index, &scan_count);
+    assert(scan_count == ROWS);
+    assert(all_ids[0] == ROWS);
+    btree_free_results(all_ids);
+    
+    assert(memory_table_insert_batch_owned(table, rows, 0) == 0);
+    
+    memory_storage_destroy(storage);
+    remove("test_batch_data/items.btree");
+    rmdir("test_batch_data");
+    
+    for (int i = 0; i < 2; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("Batch insert with primary index tests passed\n");
+}
+
+void test_deferred_index() {
+    printf("Testing deferred index writes...\n");
+    
+    MemoryStorage* storage = memory_storage_create();
+    assert(memory_storage_enable_persistence(storage, "test_defer_data"));
+    memory_storage_defer_index(storage, true);
+    
+    ColumnSchema columns[] = {
+        column_create("id", VALUE_INTEGER),
+        column_create("name", VALUE_STRING)
+    };
+    TableSchema* schema = tableschema_create("items", columns, 2);
+    MemoryTable* table = memory_storage_create_table(storage, "items", schema);
+    assert(table->defer_index);
+    assert(table->primary_index->defer_flush);
+    
+    for (int64_t key = 1; key <= 20; key++) {
+        Value values[] = {value_integer(key), value_string("item")};
+        assert(memory_table_insert(table, values) == (uint64_t)key);
+        value_destroy(&values[1]);
+    }
+    assert(table->indexed_count == 0);
+    
+    Value lookup = value_integer(7);
+    DataRecord* record = memory_table_get_by_key(table, &lookup, 0);
+    assert(record != NULL && record->id == 7);
+    assert(table->indexed_count == 20);
+    
+    Value* rows[5];
+    for (size_t i = 0; i < 5; i++) {
+        rows[i] = malloc(sizeof(Value) * 2);
+        rows[i][0] = value_integer((int64_t)(21 + i));
+        rows[i][1] = value_string("batch");
+    }
+    assert(memory_table_insert_batch_owned(table, rows, 5) == 21);
+    assert(table->indexed_count == 20);
+    
+    memory_storage_defer_index(storage, false);
+    assert(table->indexed_count == 25);
+    assert(!table->defer_index);
+    assert(!table->primary_index->defer_flush);
+    
+    uint32_t scan_count = 0;
+    uint64_t* all_ids = btree_scan_all(table->primary_index, &scan_count);
+    assert(scan_count == 25);
+    btree_free_results(all_ids);
+    
+    Value after[] = {value_integer(26), value_string("after")};
+    memory_table_insert(table, after);
+    value_destroy(&after[1]);
+    assert(table->indexed_count == 26);
+    
+    memory_storage_destroy(storage);
+    remove("test_defer_data/items.btree");
+    rmdir("test_defer_data");
+    
+    for (int i = 0; i < 2; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("Deferred index write tests passed\n");
+}
+
 void test_persistence_lifecycle() {
     printf("Testing persistence lifecycle...\n");
     
@@ -528,8 +718,10 @@ void test_btree_insert_search() {
     assert(btree_insert(tree, &key, 999));
     uint64_t* results = NULL;
     uint32_t count = 0;
+    uint64_t pages_read = tree->pages_read;
     assert(btree_search(tree, &key, &results, &count));
     assert(count == 1 && results[0] == 999);
+    assert(tree->pages_read > pages_read);
     btree_free_results(results);
     value_destroy(&key);
     btree_close(tree);
@@ -537,6 +729,214 @@ void test_btree_insert_search() {
     printf("B-tree insert/search test passed\n");
 }
 
+void test_copy_csv() {
+    printf("Testing CSV bulk load...\n");
+    
+    ColumnSchema columns[] = {
+        column_create("id", VALUE_INTEGER),
+        column_create("name", VALUE_STRING),
+        column_create("score", VALUE_FLOAT),
+        column_create("active", VALUE_BOOLEAN)
+    };
+    TableSchema* schema = tableschema_create("people", columns, 4);
+    MemoryStorage* storage = memory_storage_create();
+    MemoryTable* table = memory_storage_create_table(storage, "people", schema);
+    
+    const char* csv =
+        "id,name,score,active\n"
+        "1,Alice,9.5,true\n"
+        "2,\"Smith, \"\"Bob\"\"\",7.25,0\r\n"
+        "\n"
+        "x,Broken,1.0,true\n"
+        "3,,,f\n"
+        "4,Extra,1.0,true,9\n";
+    
+    CopyStats stats;
+    assert(copy_from_buffer(table, csv, strlen(csv), COPY_FORMAT_CSV, &stats) == true);
+    assert(stats.rows_loaded == 3);
+    assert(stats.rows_rejected == 2);
+    assert(stats.first_rejected_line == 5);
+    assert(table->record_count == 3);
+    
+    DataRecord* bob = memory_table_get(table, 2);
+    assert(bob != NULL);
+    assert(strcmp(bob->values[1].data.string, "Smith, \"Bob\"") == 0);
+    assert(fabs(bob->values[2].data.float_val - 7.25) < 0.0001);
+    assert(bob->values[3].data.boolean == false);
+    
+    DataRecord* empty = memory_table_get(table, 3);
+    assert(empty->values[0].data.integer == 3);
+    assert(empty->values[1].type == VALUE_NULL);
+    assert(empty->values[2].type == VALUE_NULL);
+    
+    size_t row_count = 50000;
+    size_t capacity = row_count * 32;
+    char* large = malloc(capacity);
+    size_t length = 0;
+    for (size_t i = 0; i < row_count; i++) {
+        length += snprintf(large + length, capacity - length, "%zu,row_%zu,%zu.5,%s\n",
+                           i + 100, i, i, i % 2 ? "true" : "false");
+    }
+    
+    assert(copy_from_buffer(table, large, length, COPY_FORMAT_CSV, &stats) == true);
+    assert(stats.rows_loaded == row_count);
+    assert(stats.rows_rejected == 0);
+    assert(table->record_count == row_count + 3);
+    
+    for (size_t i = 0; i < row_count; i += 997) {
+        DataRecord* record = memory_table_get(table, i + 4);
+        assert(record->values[0].data.integer == (int64_t)(i + 100));
+    }
+    free(large);
+    
+    memory_storage_destroy(storage);
+    for (int i = 0; i < 4; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("CSV bulk load tests passed\n");
+}
+
+void test_copy_ndjson() {
+    printf("Testing NDJSON bulk load...\n");
+    
+    ColumnSchema columns[] = {
+        column_create("id", VALUE_INTEGER),
+        column_create("name", VALUE_STRING),
+        column_create("active", VALUE_BOOLEAN)
+    };
+    TableSchema* schema = tableschema_create("events", columns, 3);
+    MemoryStorage* storage = memory_storage_create();
+    MemoryTable* table = memory_storage_create_table(storage, "events", schema);
+    
+    const char* ndjson =
+        "{\"id\": 1, \"name\": \"caf\\u00e9\\n\", \"active\": true}\n"
+        "{\"name\": \"no id\", \"ignored\": 12}\n"
+        "{\"id\": \"oops\"}\n"
+        "{\"id\": 3, \"active\": null}\n"
+        "{\"id\": 4, \"extra\": true, \"tags\": [1, \"a]\", {\"b\": null}], \"meta\": {\"k\": \"}\\\"\"}, \"active\": false}\n"
+        "{\"id\": 5, \"extra\": [1, 2}\n"
+        "not json\n";
+    
+    CopyStats stats;
+    assert(copy_from_buffer(table, ndjson, strlen(ndjson), COPY_FORMAT_NDJSON, &stats) == true);
+    assert(stats.rows_loaded == 4);
+    assert(stats.rows_rejected == 3);
+    assert(stats.first_rejected_line == 3);
+    
+    DataRecord* first = memory_table_get(table, 1);
+    assert(strcmp(first->values[1].data.string, "caf\xc3\xa9\n") == 0);
+    assert(first->values[2].data.boolean == true);
+    
+    DataRecord* second = memory_table_get(table, 2);
+    assert(second->values[0].type == VALUE_NULL);
+    assert(strcmp(second->values[1].data.string, "no id") == 0);
+    
+    DataRecord* third = memory_table_get(table, 3);
+    assert(third->values[0].data.integer == 3);
+    assert(third->values[2].type == VALUE_NULL);
+    
+    /* Keys without a column are skipped whatever their value holds. */
+    DataRecord* fourth = memory_table_get(table, 4);
+    assert(fourth->values[0].data.integer == 4);
+    assert(fourth->values[2].type == VALUE_BOOLEAN && fourth->values[2].data.boolean == false);
+    
+    CopyFormat format;
+    assert(copy_format_parse("NDJSON", &format) && format == COPY_FORMAT_NDJSON);
+    assert(copy_format_parse("xml", &format) == false);
+    assert(copy_format_for_path("data/events.jsonl") == COPY_FORMAT_NDJSON);
+    assert(copy_format_for_path("data/events.csv") == COPY_FORMAT_CSV);
+    assert(copy_from_file(table, "/nonexistent/file.csv", COPY_FORMAT_AUTO, &stats) == false);
+    
+    memory_storage_destroy(storage);
+    for (int i = 0; i < 3; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("NDJSON bulk load tests passed\n");
+}
+
+void test_table_stats() {
+    printf("Testing table statistics...\n");
+    
+    MemoryStorage* storage = memory_storage_create();
+    ColumnSchema columns[] = {
+        column_create("k", VALUE_INTEGER),
+        column_create("s", VALUE_STRING),
+        column_create("f", VALUE_FLOAT)
+    };
+    MemoryTable* table = memory_storage_create_table(storage, "stats", tableschema_create("stats", columns, 3));
+    TableStats* stats = table->stats;
+    assert(stats != NULL && stats->column_count == 3 && !stats->analyzed);
+    
+    const size_t rows = 2000;
+    char text[32];
+    /* Half the NULLs are strings without text, as value_string(NULL) makes. */
+    for (size_t i = 0; i < rows; i++) {
+        snprintf(text, sizeof(text), "s%zu", i % 7);
+        Value values[] = {
+            value_integer((int64_t)(i % 1000)),
+            i % 10 == 0 ? (i % 20 == 0 ? value_string(NULL) : value_null()) : value_string(text),
+            value_float((double)i * 0.5)
+        };
+        memory_table_insert(table, values);
+        value_destroy(&values[1]);
+    }
+    
+    assert(stats->living_count == rows && stats->ghost_count == 0 && stats->modified_count == rows);
+    assert(stats->columns[0].null_count == 0 && stats->columns[1].null_count == rows / 10);
+    assert(stats->columns[0].min.data.integer == 0 && stats->columns[0].max.data.integer == 999);
+    assert(strcmp(stats->columns[1].min.data.string, "s0") == 0);
+    assert(fabs(column_stats_null_fraction(&stats->columns[1]) - 0.1) < 1e-9);
+    assert(column_stats_distinct(&stats->columns[1]) == 7.0);
+    double distinct = column_stats_distinct(&stats->columns[0]);
+    assert(distinct > 850.0 && distinct < 1150.0);
+    
+    /* Without a histogram, numeric columns interpolate between min and max. */
+    Value probe = value_integer(500);
+    double below = column_stats_fraction_below(&stats->columns[0], &probe, false);
+    assert(below > 0.45 && below < 0.55);
+    Value outside = value_integer(5000);
+    assert(column_stats_fraction_below(&stats->columns[0], &outside, false) == 1.0);
+    assert(column_stats_fraction_equal(&stats->columns[0], &outside) == 0.0);
+    Value name = value_string("s3");
+    assert(column_stats_fraction_below(&stats->columns[1], &name, false) < 0.0);
+    
+    for (uint64_t id = 1; id <= 200; id++) {
+        assert(memory_table_delete(table, id, 1234567890));
+    }
+    assert(stats->living_count == rows - 200 && stats->ghost_count == 200);
+    decay_all_ghosts(storage, 0.5f);
+    assert(resurrect_table_ghost(table, 7));
+    decay_all_ghosts(storage, 0.6f);
+    assert(stats->living_count == rows - 199 && stats->ghost_count == 0 && stats->exorcised_count == 199);
+    
+    assert(memory_table_analyze(table));
+    assert(stats->analyzed && stats->modified_count == 0);
+    assert(stats->living_count == rows - 199 && stats->exorcised_count == 199);
+    assert(stats->columns[1].null_count == rows / 10 - 20);
+    assert(stats->columns[0].bucket_count == STATS_HISTOGRAM_BUCKETS);
+    
+    /* Keys below 200 lost a copy to the exorcism: 300 of the 1801 living keys are below 250. */
+    probe = value_integer(250);
+    below = column_stats_fraction_below(&stats->columns[0], &probe, false);
+    assert(below > 0.14 && below < 0.2);
+    double at_or_below = column_stats_fraction_below(&stats->columns[0], &probe, true);
+    assert(at_or_below >= below && at_or_below < below + 0.01);
+    double equal = column_stats_fraction_equal(&stats->columns[0], &probe);
+    assert(equal > 0.0005 && equal < 0.002);
+    below = column_stats_fraction_below(&stats->columns[1], &name, false);
+    assert(below > 0.3 && below < 0.6);
+    
+    value_destroy(&name);
+    memory_storage_destroy(storage);
+    for (int i = 0; i < 3; i++) {
+        free((char*)columns[i].name);
+    }
+    
+    printf("Table statistics tests passed\n");
+}
+
 int main() {
     printf("=== Shade Database Storage Tests ===\n\n");
     
@@ -546,6 +946,10 @@ int main() {
     test_data_operations();
     test_ghost_operations();
     test_storage_scalability();
+    test_table_catalog();
+    test_copy_csv();
+    test_copy_ndjson();
+    test_table_stats();
 
     test_btree_creation();
     test_btree_insert_search();
@@ -554,6 +958,8 @@ int main() {
     test_btree_node_splitting();
 
     test_btree_integration();
+    test_batch_insert_with_index();
+    test_deferred_index();
     test_persistence_lifecycle();
     
     printf("\nAll storage tests passed!\n");